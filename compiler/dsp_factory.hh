@@ -79,6 +79,9 @@ class dsp_factory_base {
     
         virtual std::vector<std::string> getDSPFactoryLibraryList() = 0;
     
+        // The 'init' code of a DSP compiled with '-sr' sets its compiled rate : reports a requested rate it did not use
+        static void checkSampleRate(int sample_rate, int used_sample_rate);
+    
         // Sub-classes will typically implement this method to create a factory from a stream
         static dsp_factory_base* read(std::istream* in) { return nullptr; }
   
@@ -28,7 +28,7 @@
 #include <iostream>
 using namespace std;
 
-const char* yyfilename  = "????";
+thread_local const char* yyfilename  = "????";
 
 void lexerror(const char* msg)
 {
@@ -25,7 +25,7 @@
 #include "tlib.hh"
 
 extern int 			yylineno;
-extern const char * yyfilename;
+extern thread_local const char * yyfilename;
 
 // associate and retrieve file and line properties to a symbol definition
 void 		setDefProp(Tree sym, const char* filename, int lineno);
@@ -79,6 +79,14 @@ class AbsPrim : public xtended
         Typed::VarType result_type;
         vector<Typed::VarType> arg_types;
        
+        // Sign known from the interval
+        interval i = types[0]->getInterval();
+        if (i.valid && (i.lo >= 0)) {
+            return args.front();
+        } else if (i.valid && (i.hi <= 0)) {
+            return InstBuilder::genSub(InstBuilder::genTypedZero((types[0]->nature() == kInt) ? Typed::kInt32 : itfloat()), args.front());
+        }
+       
         ::Type t = infereSigType(types);
         if (t->nature() == kReal) {
             list<ValueInst*> casted_args;
@@ -55,7 +55,7 @@ class Exp10Prim : public xtended
 		num n;
 		faustassert(args.size() == arity());
 		if (isNum(args[0],n)) {
-			return tree(exp(double(n)));
+			return tree(pow(10., double(n)));
 		} else {
 			return tree(symbol(), args[0]);
 		}
@@ -20,6 +20,7 @@
  ************************************************************************/
 
 #include <math.h>
+#include <limits.h>
 
 #include "xtended.hh"
 #include "Text.hh"
@@ -70,6 +71,12 @@ class FloorPrim : public xtended
         list<ValueInst*> casted_args;
         prepareTypeArgsResult(result, args, types, result_type, arg_types, casted_args);
 
+        // Positive values in the int range : truncation by conversions instead of a function call
+        interval i = types[0]->getInterval();
+        if ((result_type != Typed::kInt32) && i.valid && (i.lo >= 0) && (i.hi < double(INT_MAX))) {
+            return InstBuilder::genCastNumFloatInst(InstBuilder::genCastNumIntInst(casted_args.front()));
+        }
+
         return container->pushFunction(subst("floor$0", isuffix()), result_type, arg_types, casted_args);
     }
     
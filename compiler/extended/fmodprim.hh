@@ -78,6 +78,24 @@ class FmodPrim : public xtended
         vector<Typed::VarType> arg_types;
         list<ValueInst*> casted_args;
         prepareTypeArgsResult(result, args, types, result_type, arg_types, casted_args);
+        
+        // Values already in the range of the result
+        if (isSmaller(types[0]->getInterval(), types[1]->getInterval())) {
+            return casted_args.front();
+        }
+        
+        // Positive values by powers of two : x - y * floor(x * (1/y)) is exact
+        double y;
+        interval i = types[0]->getInterval();
+        if (i.valid && (i.lo >= 0) && isSimpleValue(args.front()) && isRealNum(casted_args.back(), y) && isPowerOfTwo(y)) {
+            BasicCloneVisitor cloner;
+            ValueInst* x = casted_args.front();
+            list<ValueInst*> floor_args;
+            floor_args.push_back(InstBuilder::genMul(x->clone(&cloner), InstBuilder::genRealNumInst(result_type, 1. / y)));
+            vector<Typed::VarType> floor_types(1, result_type);
+            ValueInst* quotient = container->pushFunction(subst("floor$0", isuffix()), result_type, floor_types, floor_args);
+            return InstBuilder::genSub(x->clone(&cloner), InstBuilder::genMul(InstBuilder::genRealNumInst(result_type, y), quotient));
+        }
      
         return container->pushFunction(subst("fmod$0", isuffix()), result_type, arg_types, casted_args);
     }
@@ -46,7 +46,7 @@ class FtzPrim : public xtended
     
  private:
 
-    static int freshnum;		// counter for fTempFTZxxx fresh variables
+    static thread_local int freshnum;		// counter for fTempFTZxxx fresh variables
     
  public:
 
@@ -82,7 +82,8 @@ class FtzPrim : public xtended
 		faustassert(types.size() == arity());
 
 		Type t = infereSigType(types);
-		if ((t->nature() == kReal) && (gGlobal->gFTZMode > 0)) {
+		// No ftz code when the interval of the signal excludes denormals
+		if ((t->nature() == kReal) && (gGlobal->gFTZMode > 0) && !isNormal(t->getInterval())) {
             
             switch (gGlobal->gFTZMode) {
             
@@ -144,7 +145,7 @@ class FtzPrim : public xtended
             }
                 
         } else {
-			// No ftz code for integer signals
+			// No ftz code for integer or normal signals
 			return *args.begin();
 		}
 	}
@@ -177,5 +178,5 @@ class FtzPrim : public xtended
     
 };
 
-int FtzPrim::freshnum = 0;
+thread_local int FtzPrim::freshnum = 0;
 
@@ -96,6 +96,13 @@ class MaxPrim : public xtended
         
         result_type = (result->nature() == kInt) ? Typed::kInt32 : itfloat();
         
+        // Clamping already proven by the intervals
+        if (isBelow(types[1]->getInterval(), types[0]->getInterval())) {
+            return castArg(result, types[0], args.front());
+        } else if (isBelow(types[0]->getInterval(), types[1]->getInterval())) {
+            return castArg(result, types[1], args.back());
+        }
+        
         // generates code compatible with overloaded max
 		int n0 = types[0]->nature();
 		int n1 = types[1]->nature();
@@ -95,6 +95,13 @@ class MinPrim : public xtended
         list<ValueInst*> casted_args;
         
         result_type = (result->nature() == kInt) ? Typed::kInt32 : itfloat();
+        
+        // Clamping already proven by the intervals
+        if (isBelow(types[0]->getInterval(), types[1]->getInterval())) {
+            return castArg(result, types[0], args.front());
+        } else if (isBelow(types[1]->getInterval(), types[0]->getInterval())) {
+            return castArg(result, types[1], args.back());
+        }
          
         // generates code compatible with overloaded min
 		int n0 = types[0]->nature();
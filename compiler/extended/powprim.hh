@@ -78,22 +78,24 @@ class PowPrim : public xtended
         Typed::VarType result_type = (result->nature() == kInt) ? Typed::kInt32 : itfloat();
        
         list<ValueInst*>::const_iterator it = args.begin();
+        ValueInst* arg0 = *it;
         it++;
         Int32NumInst* arg1 = dynamic_cast<Int32NumInst*>(*it);
+        double real_arg1;
+        ValueInst* res = NULL;
 
         if ((types[1]->nature() == kInt)
             && (types[1]->variability() == kKonst)
             && (types[1]->computability() == kComp)
             && arg1
-            && (gGlobal->gOutputLang != "interp")
-            && (gGlobal->gOutputLang != "ajs")
-            && !(startWith(gGlobal->gOutputLang, "wast"))
-            && !(startWith(gGlobal->gOutputLang, "wasm"))) { // In 'interpreter' and 'wast/wasm' backends, do not generate 'faustpower' function call, fallback to 'pow'
-
-            arg_types[0] = (types[0]->nature() == kInt) ? Typed::kInt32 : itfloat();
-            arg_types[1] = Typed::kInt32;
-            return container->pushFunction(container->getFaustPowerName(), result_type, arg_types, args);
-
+            && (arg1->fNum >= 0)) {
+            res = generateIntPower(container, arg0, arg1->fNum, result_type, (types[0]->nature() == kInt) ? Typed::kInt32 : itfloat());
+        } else if ((types[0]->nature() == kReal) && isRealNum(*it, real_arg1)) {
+            res = generateRealPower(container, arg0, real_arg1);
+        }
+        
+        if (res) {
+            return res;
         } else {
 
             // Both arguments forced to itfloat()
@@ -111,6 +113,58 @@ class PowPrim : public xtended
         }
     }
     
+    // Multiplications, or NULL when 'pow' has to be used
+    ValueInst* generateIntPower(CodeContainer* container, ValueInst* x, int n, Typed::VarType result_type, Typed::VarType arg_type)
+    {
+        // In 'interpreter' and 'wast/wasm' backends, do not generate 'faustpower' function call
+        if ((gGlobal->gOutputLang != "interp")
+            && (gGlobal->gOutputLang != "ajs")
+            && !(startWith(gGlobal->gOutputLang, "wast"))
+            && !(startWith(gGlobal->gOutputLang, "wasm"))) {
+            
+            vector<Typed::VarType> arg_types(2);
+            arg_types[0] = arg_type;
+            arg_types[1] = Typed::kInt32;
+            list<ValueInst*> args;
+            args.push_back(x);
+            args.push_back(InstBuilder::genInt32NumInst(n));
+            return container->pushFunction(container->getFaustPowerName(), result_type, arg_types, args);
+            
+        } else if (isSimpleValue(x)) {
+            // Inlined multiplications, computed like 'faustpower' in the other backends
+            return genPowerChain(x, n, result_type);
+        } else {
+            return NULL;
+        }
+    }
+    
+    // Real exponents known at compile time, or NULL when 'pow' has to be used
+    ValueInst* generateRealPower(CodeContainer* container, ValueInst* x, double y)
+    {
+        if ((fabs(y) <= 64) && (y == floor(y))) {
+            int n = int(y);
+            if (n == 0) {
+                return InstBuilder::genRealNumInst(itfloat(), 1.);
+            } else if (n == 1) {
+                return x;
+            } else if (n == -1) {
+                return InstBuilder::genDiv(InstBuilder::genRealNumInst(itfloat(), 1.), x);
+            } else if ((n == 2) || gGlobal->gApproxReductions) {
+                // Several roundings instead of one when n > 2
+                ValueInst* res = generateIntPower(container, x, (n < 0) ? -n : n, itfloat(), itfloat());
+                return (res && (n < 0)) ? InstBuilder::genDiv(InstBuilder::genRealNumInst(itfloat(), 1.), res) : res;
+            }
+        } else if ((y == 0.5) && gGlobal->gApproxReductions) {
+            // Only differs for -0 and -inf
+            vector<Typed::VarType> arg_types(1, itfloat());
+            list<ValueInst*> args;
+            args.push_back(x);
+            return container->pushFunction(subst("sqrt$0", isuffix()), itfloat(), arg_types, args);
+        }
+        
+        return NULL;
+    }
+    
     virtual string old_generateCode(Klass* klass, const vector<string>& args, const vector<Type>& types)
     {
         faustassert(args.size() == arity());
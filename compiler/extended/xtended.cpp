@@ -40,3 +40,50 @@ void xtended::prepareTypeArgsResult(::Type result,
     }
 }
 
+
+bool isRealNum(ValueInst* val, double& num)
+{
+    FloatNumInst* float_num = dynamic_cast<FloatNumInst*>(val);
+    DoubleNumInst* double_num = dynamic_cast<DoubleNumInst*>(val);
+
+    if (float_num) {
+        num = float_num->fNum;
+        return true;
+    } else if (double_num) {
+        num = double_num->fNum;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+ValueInst* genPowerChain(ValueInst* x, int n, Typed::VarType type)
+{
+    BasicCloneVisitor cloner;
+
+    if (n == 0) {
+        return (type == Typed::kInt32) ? InstBuilder::genInt32NumInst(1) : InstBuilder::genRealNumInst(type, 1.);
+    } else {
+        ValueInst* res = x->clone(&cloner);
+        for (int i = 0; i < n - 1; i++) {
+            res = InstBuilder::genMul(res, x->clone(&cloner));
+        }
+        return res;
+    }
+}
+
+bool isNormal(const interval& x)
+{
+    return x.valid && ((x.lo >= inummin()) || (x.hi <= -inummin()) || ((x.lo == 0) && (x.hi == 0)));
+}
+
+ValueInst* castArg(::Type result, ::Type type, ValueInst* val)
+{
+    if (result->nature() == kReal) {
+        return promote2real(type->nature(), val);
+    } else if (type->boolean() == kBool) {
+        return InstBuilder::genCastNumIntInst(val);
+    } else {
+        return val;
+    }
+}
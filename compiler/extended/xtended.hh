@@ -94,5 +94,33 @@ inline ValueInst* promote2int(int type, ValueInst* val) { return (type == kInt)
 inline ValueInst* cast2real(int type, ValueInst* val) { return (type == kReal) ? InstBuilder::genCastNumFloatInst(val) : val; }
 inline ValueInst* cast2int(int type, ValueInst* val) { return (type == kInt) ? InstBuilder::genCastNumIntInst(val) : val; }
 
+// Strength reductions of the primitives : the ones that may change the rounding of results are only done with -ar
+
+// Variables and numbers can be used several times in the reduced code
+inline bool isSimpleValue(ValueInst* val) { return dynamic_cast<SimpleValueInst*>(val); }
+
+inline bool isPowerOfTwo(double num) { int exp; return (num > 0) && (frexp(num, &exp) == 0.5); }
+
+// True if 'val' is a real number
+bool isRealNum(ValueInst* val, double& num);
+
+// 'x' multiplied 'n' times (n >= 0), in the same order as the 'faustpower' functions
+ValueInst* genPowerChain(ValueInst* x, int n, Typed::VarType type);
+
+// Specializations from the intervals computed by the type inference : the values of a signal are supposed
+// to stay in its interval, like the ones of a slider stay in its range
+
+// True if no value of 'x' is greater than a value of 'y'
+inline bool isBelow(const interval& x, const interval& y) { return x.valid && y.valid && (x.hi <= y.lo); }
+
+// True if all values of 'x' have a lower magnitude than all (positive) values of 'y'
+inline bool isSmaller(const interval& x, const interval& y) { return x.valid && y.valid && (y.lo > 0) && (-x.lo < y.lo) && (x.hi < y.lo); }
+
+// True if no value of 'x' is a denormal in the current float precision
+bool isNormal(const interval& x);
+
+// 'val' of type 'type' converted in the 'result' type of a primitive (booleans are explicitly casted to 0/1)
+ValueInst* castArg(::Type result, ::Type type, ValueInst* val);
+
 #endif
 
@@ -23,10 +23,64 @@
 #define __FAUST_GARBAGE__
 
 #include <stdio.h>
+#include <stdint.h>
 #include <new>
+#include <vector>
 
 #include "exception.hh"
 
+class Garbageable;
+
+// Region allocator for the Garbageable objects of a compilation : objects are bump allocated
+// in chunks by size class, recycled in a free list when deleted, and all released by cleanup().
+// Live objects are kept in a single list, so that cleanup() destroys them in reverse allocation order
+
+class GarbageableArena {
+
+    private:
+    
+        static const size_t kGranularity = 16;
+        static const size_t kMaxSmallSize = 512;
+        static const size_t kChunkSize = 64 * 1024;
+        static const uint32_t kLarge = UINT32_MAX;
+    
+        // Precedes each object, keeps it 16 bytes aligned
+        struct Header {
+            Header* fPrev;      // Live object allocated just after
+            Header* fNext;      // Live object allocated just before
+            uint32_t fClass;    // Size class index or kLarge (allocated separately)
+            uint32_t fLive;
+            uint64_t fPad;
+        };
+    
+        struct SizeClass {
+            std::vector<char*> fChunks;
+            char* fCur;
+            char* fEnd;
+            void* fFreeList;
+            SizeClass():fCur(0), fEnd(0), fFreeList(0) {}
+        };
+    
+        SizeClass fClasses[kMaxSmallSize / kGranularity];
+        Header* fLiveList;      // Last allocated live object first
+        size_t fLiveCount;
+    
+        static size_t slotSize(uint32_t index) { return sizeof(Header) + (index + 1) * kGranularity; }
+        void* link(Header* header, uint32_t index);
+    
+    public:
+    
+        GarbageableArena():fLiveList(0), fLiveCount(0) {}
+    
+        void* allocate(size_t size);
+        void release(void* ptr, bool recycle);
+    
+        // Destroys all live objects, then frees all chunks
+        void cleanup();
+    
+        size_t getLiveCount() { return fLiveCount; }
+};
+
 class Garbageable {
 
     public:
@@ -76,8 +76,8 @@ EXPORT asmjs_dsp_factory* createAsmDSPFactoryFromString(const string& name_app,
                                                              true);
     if (dsp_factory_aux) {
         asmjs_dsp_factory* factory = new asmjs_dsp_factory(dsp_factory_aux);
-        gAsmjsFactoryTable.setFactory(factory);
         factory->setSHAKey(sha_key);
+        gAsmjsFactoryTable.setFactory(factory);
         factory->setDSPCode(expanded_dsp_content);
         return factory;
     } else {
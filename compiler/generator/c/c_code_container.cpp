@@ -28,7 +28,7 @@
 
 using namespace std;
 
-map <string, bool> CInstVisitor::gFunctionSymbolTable;
+thread_local map <string, bool> CInstVisitor::gFunctionSymbolTable;
 
 dsp_factory_base* CCodeContainer::produceFactory()
 {
@@ -648,6 +648,18 @@ void CodeContainer::processFIR(void)
     // Possibly add "fSamplingFreq" field
     generateSR();
     
+    // Possibly compute common and loop-invariant expressions once (scalar loop only)
+    if (gGlobal->gValueNumbering && !gGlobal->gVectorSwitch) {
+        BlockInst* body = InstBuilder::genBlockInst();
+        fCurLoop->pushBlock(fCurLoop->fPreInst, body);
+        fCurLoop->pushBlock(fCurLoop->fComputeInst, body);
+        fCurLoop->pushBlock(fCurLoop->fPostInst, body);
+        ValueNumbering numbering;
+        fCurLoop->fPreInst = InstBuilder::genBlockInst();
+        fCurLoop->fComputeInst = numbering.getCode(body, fComputeBlockInstructions);
+        fCurLoop->fPostInst = InstBuilder::genBlockInst();
+    }
+    
     if (gGlobal->gGroupTaskSwitch) {
         CodeLoop::computeUseCount(fCurLoop);
         set<CodeLoop*> visited;
@@ -164,6 +164,9 @@ class CodeContainer : public virtual Garbageable {
                 << " -ftz " << gGlobal->gFTZMode
                 << ((gGlobal->gMemoryManager) ? " -mem" : "");
             }
+            if (gGlobal->gFixedSampleRate > 0) {
+                dst << " -sr " << gGlobal->gFixedSampleRate;
+            }
         }
     
         void printHeader(ostream& dst)
@@ -200,7 +203,11 @@ class CodeContainer : public virtual Garbageable {
             if (!fGeneratedSR) {
                 pushDeclare(InstBuilder::genDecStructVar("fSamplingFreq", InstBuilder::genBasicTyped(Typed::kInt32)));
             }
-            pushFrontInitMethod(InstBuilder::genStoreStructVar("fSamplingFreq", InstBuilder::genLoadFunArgsVar("samplingFreq")));
+            // With a fixed sample rate, instances always run at this rate
+            ValueInst* sample_rate = (gGlobal->gFixedSampleRate > 0)
+                ? static_cast<ValueInst*>(InstBuilder::genInt32NumInst(gGlobal->gFixedSampleRate))
+                : InstBuilder::genLoadFunArgsVar("samplingFreq");
+            pushFrontInitMethod(InstBuilder::genStoreStructVar("fSamplingFreq", sample_rate));
         }
     
         BlockInst* inlineSubcontainersFunCalls(BlockInst* block);
@@ -289,7 +296,7 @@ class CodeContainer : public virtual Garbageable {
    
         void produceInfoFunctions(int tabs, const string& classname, const string& obj, bool ismethod, bool isvirtual, TextInstVisitor* producer);
     
-        void generateDAGLoop(BlockInst* loop_code, DeclareVarInst* count);
+        virtual void generateDAGLoop(BlockInst* loop_code, DeclareVarInst* count);
         
         void generateJSONFile();
         void generateMetaData(JSONUI* json);
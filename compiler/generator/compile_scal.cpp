@@ -71,7 +71,7 @@ static Klass* signal2klass(Klass* parent, const string& name, Tree sig)
 						getFreshID
 *****************************************************************************/
 
-map<string, int> ScalarCompiler::fIDCounters;
+thread_local map<string, int> ScalarCompiler::fIDCounters;
 
 string ScalarCompiler::getFreshID(const string& prefix)
 {
@@ -52,7 +52,7 @@ class ScalarCompiler : public Compiler
 
     map<Tree, Tree> fConditionProperty;    // used with the new X,Y:enable --> sigEnable(X*Y,Y>0) primitive
 
-    static map<string, int> fIDCounters;
+    static thread_local map<string, int> fIDCounters;
     Tree fSharingKey;
     old_OccMarkup* fOccMarkup;
     bool fHasIota;
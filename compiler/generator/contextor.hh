@@ -40,8 +40,8 @@
  */
 class contextor
 {
-	static int 	top;
-	static int	pile[1024];
+	static thread_local int	top;
+	static thread_local int	pile[1024];
 
  public:
 	contextor(int n)	{ top = 0; pile[top] = n; }	// contructor to be called only once at the
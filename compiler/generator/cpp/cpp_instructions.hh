@@ -35,7 +35,7 @@ class CPPInstVisitor : public TextInstVisitor {
          Global functions names table as a static variable in the visitor
          so that each function prototype is generated as most once in the module.
          */
-        static map <string, bool> gFunctionSymbolTable;
+        static thread_local map <string, bool> gFunctionSymbolTable;
   
     public:
 		using TextInstVisitor::visit;
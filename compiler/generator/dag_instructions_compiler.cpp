@@ -243,6 +243,12 @@ ValueInst* DAGInstructionsCompiler::generateLoopCode(Tree sig)
                 fContainer->openLoop(sig, "i");
                 ValueInst* c = InstructionsCompiler::generateCode(sig);
                 fContainer->closeLoop(sig);
+                // x may have been compiled in a loop of the enclosing one (by generateCodeRecursions),
+                // the current loop also needs it when the (empty) projection loop has been absorbed
+                CodeLoop* ls;
+                if (fContainer->getLoopProperty(x, ls)) {
+                    l->addBackwardDependency(ls);
+                }
                 return c;
             }
         } else {
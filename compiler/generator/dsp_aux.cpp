@@ -121,11 +121,14 @@ static vector<string> reorganizeCompilationOptionsAux(vector<string>& options)
     } else {
         addKeyIfExisting(options, newoptions, "-scal", "-scal", position);
         addKeyIfExisting(options, newoptions, "-inpl", "", position);
+        addKeyIfExisting(options, newoptions, "-vn", "", position);
     }
     
     addKeyValueIfExisting(options, newoptions, "-mcd", "16");
     addKeyValueIfExisting(options, newoptions, "-cn", "");
     addKeyValueIfExisting(options, newoptions, "-ftz", "0");
+    addKeyValueIfExisting(options, newoptions, "-sr", "");
+    addKeyIfExisting(options, newoptions, "-ar", "", position);
     
     //------STEP4 - Add other types of Faust options
     /*
@@ -222,6 +225,14 @@ void dsp_factory_imp::destroy(void* ptr)
     }
 }
 
+void dsp_factory_base::checkSampleRate(int sample_rate, int used_sample_rate)
+{
+    if (sample_rate != used_sample_rate) {
+        cerr << "ERROR : DSP compiled for a " << used_sample_rate << " Hz sample rate, cannot be initialized at "
+             << sample_rate << " Hz" << endl;
+    }
+}
+
 // External libfaust API
 
 EXPORT string expandDSPFromFile(const string& filename,
@@ -27,10 +27,13 @@
 #include <map>
 #include <list>
 #include <vector>
+#include <unordered_map>
+#include <atomic>
 
 #include "faust/dsp/dsp.h"
 #include "export.hh"
 #include "exception.hh"
+#include "TMutex.h"
 
 /*!
     \brief the base class for smart pointers implementation
@@ -43,13 +46,13 @@ class faust_smartable {
     
     private:
         
-        unsigned refCount;
+        std::atomic<unsigned> refCount;     // instances of a factory can be created and deleted concurrently
         
     public:
         //! gives the reference count of the object
         unsigned refs() const         { return refCount; }
         //! addReference increments the ref count and checks for refCount overflow
-        void addReference()           { refCount++; faustassert(refCount != 0); }
+        void addReference()           { faustassert(++refCount != 0); }
         //! removeReference delete the object when refCount is zero
         void removeReference()		  { if (--refCount == 0) delete this; }
         
@@ -141,124 +144,229 @@ template<class T> class faust_smartptr {
 // Smart DSP factory table
 //----------------------------------------------------------------
 
+/*
+ Factories are indexed by SHA key and by pointer, and the table can be used from several threads.
+ 
+ The memory of a factory is its code size plus the size of its instances, as given to setFactory and addDSP.
+ When deleteDSPFactory releases the last reference of a factory, the factory becomes 'idle' : it stays in
+ the table (getFactory can give it again) as long as the memory of all factories is within the budget, idle
+ factories being otherwise deleted, least recently used first. With a null budget (the default) factories
+ are deleted when their last reference is released.
+*/
+
 template <class T>
-struct dsp_factory_table : public std::map<T, std::list<dsp*> >
-{
-    typedef typename std::map<T, std::list<dsp*> >::iterator factory_iterator;
+class dsp_factory_table {
     
-    dsp_factory_table()
-    {}
-    virtual ~dsp_factory_table()
-    {}
+    private:
     
-    bool getFactory(const std::string& sha_key, factory_iterator& res)
-    {
-        factory_iterator it;
-        
-        for (it = this->begin(); it != this->end(); it++) {
-            if ((*it).first->getSHAKey() == sha_key) {
-                res = it;
+        struct factory_entry {
+            
+            T fFactory;
+            std::string fSHAKey;
+            std::list<dsp*> fInstances;
+            size_t fCodeSize;
+            size_t fDSPSize;    // Of one instance
+            bool fIdle;
+            std::list<const void*>::iterator fIdleIt;
+            
+            factory_entry():fCodeSize(0), fDSPSize(0), fIdle(false)
+            {}
+            
+            size_t getMemorySize() { return fCodeSize + fInstances.size() * fDSPSize; }
+        };
+    
+        typedef typename std::unordered_map<const void*, factory_entry>::iterator factory_iterator;
+        typedef std::unordered_multimap<std::string, const void*>::iterator sha_key_iterator;
+    
+        std::unordered_map<const void*, factory_entry> fFactories;
+        std::unordered_multimap<std::string, const void*> fSHAKeys;
+        std::list<const void*> fIdleFactories;     // Least recently used first
+    
+        size_t fMemorySize;
+        size_t fMemoryBudget;
+    
+        TLockAble fLock;
+    
+        static const void* getKey(T factory) { return &(*factory); }
+    
+        void erase(factory_iterator it)
+        {
+            std::pair<sha_key_iterator, sha_key_iterator> range = fSHAKeys.equal_range((*it).second.fSHAKey);
+            for (sha_key_iterator it1 = range.first; it1 != range.second; it1++) {
+                if ((*it1).second == (*it).first) {
+                    fSHAKeys.erase(it1);
+                    break;
+                }
+            }
+            if ((*it).second.fIdle) {
+                fIdleFactories.erase((*it).second.fIdleIt);
+            }
+            fMemorySize -= (*it).second.getMemorySize();
+            // Pointer will be deleted if not referenced anymore
+            fFactories.erase(it);
+        }
+    
+        void evictIdleFactories()
+        {
+            while (fIdleFactories.size() > 0 && (fMemoryBudget == 0 || fMemorySize > fMemoryBudget)) {
+                erase(fFactories.find(fIdleFactories.front()));
+            }
+        }
+    
+    public:
+    
+        dsp_factory_table():fMemorySize(0), fMemoryBudget(0)
+        {}
+        virtual ~dsp_factory_table()
+        {}
+    
+        // If found, the caller gets a new reference on the factory
+        bool getFactory(const std::string& sha_key, T& res)
+        {
+            TLock lock(&fLock);
+            sha_key_iterator it = fSHAKeys.find(sha_key);
+            
+            if (it != fSHAKeys.end()) {
+                factory_entry& entry = fFactories[(*it).second];
+                if (entry.fIdle) {
+                    // The reference of an idle factory is given back
+                    fIdleFactories.erase(entry.fIdleIt);
+                    entry.fIdle = false;
+                } else {
+                    entry.fFactory->addReference();
+                }
+                res = entry.fFactory;
                 return true;
+            } else {
+                return false;
             }
         }
-        
-        return false;
-    }
     
-    void setFactory(T factory)
-    {
-        this->insert(std::pair<T, std::list<dsp*> >(factory, std::list<dsp*>()));
-    }
+        // To be called once the SHA key of the factory is set
+        void setFactory(T factory, size_t code_size = 0)
+        {
+            TLock lock(&fLock);
+            factory_entry& entry = fFactories[getKey(factory)];
+            entry.fFactory = factory;
+            entry.fSHAKey = factory->getSHAKey();
+            entry.fCodeSize = code_size;
+            fSHAKeys.insert(std::make_pair(entry.fSHAKey, getKey(factory)));
+            fMemorySize += code_size;
+            evictIdleFactories();
+        }
     
-    bool addDSP(T factory, dsp* dsp)
-    {
-        // Remove 'dsp' from its factory
-        factory_iterator it = this->find(factory);
-        
-        if (it != this->end()) {
-            (*it).second.push_back(dsp);
-            return true;
-        } else {
-            std::cerr << "WARNING : addDSP factory not found!" << std::endl;
-            return false;
+        bool addDSP(T factory, dsp* dsp, size_t dsp_size = 0)
+        {
+            TLock lock(&fLock);
+            factory_iterator it = fFactories.find(getKey(factory));
+            
+            if (it != fFactories.end()) {
+                fMemorySize -= (*it).second.getMemorySize();
+                (*it).second.fInstances.push_back(dsp);
+                (*it).second.fDSPSize = dsp_size;
+                fMemorySize += (*it).second.getMemorySize();
+                evictIdleFactories();
+                return true;
+            } else {
+                std::cerr << "WARNING : addDSP factory not found!" << std::endl;
+                return false;
+            }
         }
-    }
     
-    bool removeDSP(T factory, dsp* dsp)
-    {
-        // Remove 'dsp' from its factory
-        factory_iterator it = this->find(factory);
-        faustassert(it != this->end());
-        
-        if (it != this->end()) {
-            (*it).second.remove(dsp);
-            return true;
-        } else {
-            std::cerr << "WARNING : removeDSP factory not found!" << std::endl;
-            return false;
+        bool removeDSP(T factory, dsp* dsp)
+        {
+            TLock lock(&fLock);
+            // Remove 'dsp' from its factory
+            factory_iterator it = fFactories.find(getKey(factory));
+            faustassert(it != fFactories.end());
+            
+            if (it != fFactories.end()) {
+                fMemorySize -= (*it).second.getMemorySize();
+                (*it).second.fInstances.remove(dsp);
+                fMemorySize += (*it).second.getMemorySize();
+                return true;
+            } else {
+                std::cerr << "WARNING : removeDSP factory not found!" << std::endl;
+                return false;
+            }
         }
-    }
     
-    std::vector<std::string> getAllDSPFactories()
-    {
-        factory_iterator it;
-        std::vector<std::string> sha_key_list;
-        
-        for (it = this->begin(); it != this->end(); it++) {
-            sha_key_list.push_back((*it).first->getSHAKey());
+        std::vector<std::string> getAllDSPFactories()
+        {
+            TLock lock(&fLock);
+            std::vector<std::string> sha_key_list;
+            
+            for (factory_iterator it = fFactories.begin(); it != fFactories.end(); it++) {
+                sha_key_list.push_back((*it).second.fSHAKey);
+            }
+            
+            return sha_key_list;
         }
-        
-        return sha_key_list;
-    }
     
-    dsp_factory* getDSPFactoryFromSHAKey(const std::string& sha_key)
-    {
-        factory_iterator it;
-        
-        if (getFactory(sha_key, it)) {
-            T sfactory = (*it).first;
-            sfactory->addReference();
-            return sfactory;
-        } else {
-            std::cerr << "WARNING : getDSPFactoryFromSHAKey factory not found!" << std::endl;
-            return 0;
+        dsp_factory* getDSPFactoryFromSHAKey(const std::string& sha_key)
+        {
+            T sfactory;
+            
+            if (getFactory(sha_key, sfactory)) {
+                return sfactory;
+            } else {
+                std::cerr << "WARNING : getDSPFactoryFromSHAKey factory not found!" << std::endl;
+                return 0;
+            }
         }
-    }
     
-    bool deleteDSPFactory(T factory)
-    {
-        factory_iterator it;
-        
-        if ((it = this->find(factory)) != this->end()) {
-            std::list<dsp*> dsp_list = (*it).second;
-            if (factory->refs() == 2) { // Function argument + the one in table...
+        // Return true if the factory pointer was deleted
+        bool deleteDSPFactory(T factory)
+        {
+            TLock lock(&fLock);
+            factory_iterator it = fFactories.find(getKey(factory));
+            
+            if (it == fFactories.end() || (*it).second.fIdle) {
+                std::cerr << "WARNING : deleteDSPFactory factory not found!" << std::endl;
+                return false;
+            } else if (factory->refs() == 2) { // Function argument + the one in table...
                 // Possibly delete remaining DSP
-                std::list<dsp*>::iterator it;
-                for (it = dsp_list.begin(); it != dsp_list.end(); it++) { delete (*it); }
-                // Last use, remove from the global table, pointer will be deleted
-                this->erase(factory);
-                return true;
+                std::list<dsp*> dsp_list = (*it).second.fInstances;
+                for (std::list<dsp*>::iterator it1 = dsp_list.begin(); it1 != dsp_list.end(); it1++) { delete (*it1); }
+                // Last use, the factory is now idle
+                (*it).second.fIdle = true;
+                (*it).second.fIdleIt = fIdleFactories.insert(fIdleFactories.end(), getKey(factory));
+                evictIdleFactories();
+                return fFactories.find(getKey(factory)) == fFactories.end();
             } else {
                 factory->removeReference();
                 return false;
             }
-        } else {
-            std::cerr << "WARNING : deleteDSPFactory factory not found!" << std::endl;
-            return false;
         }
-    }
     
-    void deleteAllDSPFactories()
-    {
-        factory_iterator it;
-        
-        for (it = this->begin(); it != this->end(); it++) {
-            // Decrement counter up to one...
-            while (((*it).first)->refs() > 1) { ((*it).first)->removeReference(); }
+        void deleteAllDSPFactories()
+        {
+            TLock lock(&fLock);
+            
+            for (factory_iterator it = fFactories.begin(); it != fFactories.end(); it++) {
+                // Decrement counter up to one...
+                while ((*it).second.fFactory->refs() > 1) { (*it).second.fFactory->removeReference(); }
+            }
+            // Then clear the table thus finally deleting all ref = 1 smart pointers
+            fFactories.clear();
+            fSHAKeys.clear();
+            fIdleFactories.clear();
+            fMemorySize = 0;
+        }
+    
+        // Idle factories are deleted to stay within the budget (0 means no idle factory is kept)
+        void setMemoryBudget(size_t budget)
+        {
+            TLock lock(&fLock);
+            fMemoryBudget = budget;
+            evictIdleFactories();
+        }
+    
+        size_t getMemorySize()
+        {
+            TLock lock(&fLock);
+            return fMemorySize;
         }
-        // Then clear the table thus finally deleting all ref = 1 smart pointers
-        this->clear();
-    }
     
 };
 
@@ -72,3 +72,365 @@ bool sortTypeDeclarations(StatementInst* a, StatementInst* b)
     }
 }
 
+
+/*
+ Value numbering and loop-invariant code motion
+*/
+
+// Buffers accessed by pointers (inputs/outputs) may alias
+static bool isPointerAccess(Address* address)
+{
+    return dynamic_cast<IndexedAddress*>(address) && (address->getAccess() & (Address::kStack | Address::kFunArgs));
+}
+
+// Variables stored in a statement
+struct StoredVariables : public DispatchVisitor {
+
+    set<string> fNames;
+    bool fMemory;
+
+    StoredVariables():fMemory(false)
+    {}
+
+    using DispatchVisitor::visit;
+
+    virtual void visit(DeclareVarInst* inst)
+    {
+        fNames.insert(inst->fAddress->getName());
+        DispatchVisitor::visit(inst);
+    }
+
+    virtual void visit(StoreVarInst* inst)
+    {
+        fNames.insert(inst->fAddress->getName());
+        fMemory |= isPointerAccess(inst->fAddress);
+        DispatchVisitor::visit(inst);
+    }
+
+};
+
+// Method calls may change the object state, and values cannot be moved across 'tee' or taken addresses
+struct UnsafeInstructions : public DispatchVisitor {
+
+    bool fFound;
+
+    UnsafeInstructions():fFound(false)
+    {}
+
+    using DispatchVisitor::visit;
+
+    virtual void visit(FunCallInst* inst)
+    {
+        fFound |= inst->fMethod;
+        DispatchVisitor::visit(inst);
+    }
+
+    virtual void visit(TeeVarInst* inst) { fFound = true; }
+    virtual void visit(LoadVarAddressInst* inst) { fFound = true; }
+
+};
+
+// Declarations and stores (possibly in an array) are rewritten, other statements are kept as they are
+static bool isRewritable(StatementInst* inst)
+{
+    DeclareVarInst* dec_inst = dynamic_cast<DeclareVarInst*>(inst);
+    StoreVarInst* store_inst = dynamic_cast<StoreVarInst*>(inst);
+
+    if (dec_inst) {
+        return dec_inst->fValue && dynamic_cast<NamedAddress*>(dec_inst->fAddress) && dynamic_cast<BasicTyped*>(dec_inst->fType);
+    } else if (store_inst) {
+        IndexedAddress* indexed = dynamic_cast<IndexedAddress*>(store_inst->fAddress);
+        return dynamic_cast<NamedAddress*>(store_inst->fAddress) || (indexed && dynamic_cast<NamedAddress*>(indexed->fAddress));
+    } else {
+        return false;
+    }
+}
+
+static ValueInst* getIndex(StatementInst* inst)
+{
+    StoreVarInst* store_inst = dynamic_cast<StoreVarInst*>(inst);
+    IndexedAddress* indexed = (store_inst) ? dynamic_cast<IndexedAddress*>(store_inst->fAddress) : NULL;
+    return (indexed) ? indexed->fIndex : NULL;
+}
+
+static ValueInst* getValue(StatementInst* inst)
+{
+    DeclareVarInst* dec_inst = dynamic_cast<DeclareVarInst*>(inst);
+    return (dec_inst) ? dec_inst->fValue : dynamic_cast<StoreVarInst*>(inst)->fValue;
+}
+
+bool ValueNumbering::isOptimizable(BlockInst* body)
+{
+    UnsafeInstructions unsafe;
+    body->accept(&unsafe);
+    return !unsafe.fFound;
+}
+
+int ValueNumbering::getNumber(ValueInst* inst)
+{
+    map<ValueInst*, int>::iterator it = fNumbers.find(inst);
+    return (it != fNumbers.end()) ? (*it).second : -1;
+}
+
+int ValueNumbering::number(const string& key, bool invariant, bool leaf, Typed::VarType type)
+{
+    map<string, int>::iterator it = fValues.find(key);
+    if (it != fValues.end()) {
+        return (*it).second;
+    }
+
+    int num = int(fInvariant.size());
+    fValues[key] = num;
+    fInvariant.push_back(invariant);
+    fLeaf.push_back(leaf);
+    fTypes.push_back(type);
+    fCount.push_back(0);
+    return num;
+}
+
+// Returns -1 for values that cannot be numbered
+int ValueNumbering::number(ValueInst* inst)
+{
+    stringstream key;
+    int num = -1;
+
+    if (Int32NumInst* int_num = dynamic_cast<Int32NumInst*>(inst)) {
+        key << "i" << int_num->fNum;
+        num = number(key.str(), true, true, Typed::kInt32);
+    } else if (FloatNumInst* float_num = dynamic_cast<FloatNumInst*>(inst)) {
+        // Exact representation
+        char buffer[64];
+        snprintf(buffer, 64, "f%a", double(float_num->fNum));
+        num = number(buffer, true, true, Typed::kFloat);
+    } else if (DoubleNumInst* double_num = dynamic_cast<DoubleNumInst*>(inst)) {
+        char buffer[64];
+        snprintf(buffer, 64, "d%a", double_num->fNum);
+        num = number(buffer, true, true, Typed::kDouble);
+    } else if (LoadVarInst* load = dynamic_cast<LoadVarInst*>(inst)) {
+        NamedAddress* named = dynamic_cast<NamedAddress*>(load->fAddress);
+        IndexedAddress* indexed = dynamic_cast<IndexedAddress*>(load->fAddress);
+        string name = load->fAddress->getName();
+        Typed::VarType type = (gGlobal->hasVarType(name)) ? gGlobal->getVarType(name) : Typed::kNoType;
+        bool invariant = (fStored.find(name) == fStored.end()) && !(load->fAddress->getAccess() & Address::kLoop);
+
+        if (load->fAddress->getAccess() & Address::kVolatile) {
+            num = -1;
+        } else if (named) {
+            key << "l" << name << "@" << fVersions[name];
+            num = number(key.str(), invariant, true, type);
+        } else if (indexed && dynamic_cast<NamedAddress*>(indexed->fAddress)) {
+            int index = number(indexed->fIndex);
+            if (index >= 0) {
+                key << "l" << name << "[" << index << "]@" << fVersions[name];
+                if (isPointerAccess(indexed)) {
+                    key << "#" << fMemory;
+                    invariant = false;
+                }
+                num = number(key.str(), invariant && fInvariant[index], true, Typed::getTypeFromPtr(type));
+            }
+        }
+    } else if (BinopInst* binop = dynamic_cast<BinopInst*>(inst)) {
+        int num1 = number(binop->fInst1);
+        int num2 = number(binop->fInst2);
+        if (num1 >= 0 && num2 >= 0) {
+            if (isCommutativeOpcode(binop->fOpcode) && num1 > num2) {
+                std::swap(num1, num2);
+            }
+            Typed::VarType type1 = fTypes[num1];
+            Typed::VarType type2 = fTypes[num2];
+            Typed::VarType type = Typed::kNoType;
+            if (isBoolOpcode(binop->fOpcode)) {
+                type = Typed::kBool;
+            } else if (isRealType(type1) || isRealType(type2)) {
+                type = (isRealType(type1)) ? type1 : type2;
+            } else if (isIntType32(type1) && isIntType32(type2)) {
+                type = Typed::kInt32;
+            }
+            key << "b" << binop->fOpcode << "(" << num1 << "," << num2 << ")";
+            num = number(key.str(), fInvariant[num1] && fInvariant[num2], false, type);
+        }
+    } else if (CastInst* cast = dynamic_cast<CastInst*>(inst)) {
+        int num1 = number(cast->fInst);
+        if (num1 >= 0) {
+            key << "c" << cast->fType->getType() << "(" << num1 << ")";
+            num = number(key.str(), fInvariant[num1], false, cast->fType->getType());
+        }
+    } else if (BitcastInst* cast = dynamic_cast<BitcastInst*>(inst)) {
+        int num1 = number(cast->fInst);
+        if (num1 >= 0) {
+            key << "bc" << cast->fType->getType() << "(" << num1 << ")";
+            num = number(key.str(), fInvariant[num1], false, cast->fType->getType());
+        }
+    } else if (FunCallInst* fun_call = dynamic_cast<FunCallInst*>(inst)) {
+        // Functions are pure, as foreign functions are in the signal semantic
+        bool invariant = true;
+        bool numbered = !fun_call->fMethod && (fun_call->fArgs.size() > 0) && gGlobal->hasVarType(fun_call->fName);
+        key << "f" << fun_call->fName << "(";
+        for (list<ValueInst*>::iterator it = fun_call->fArgs.begin(); it != fun_call->fArgs.end(); it++) {
+            int arg = number(*it);
+            if (arg >= 0) {
+                key << arg << ",";
+                invariant &= fInvariant[arg];
+            } else {
+                numbered = false;
+            }
+        }
+        key << ")";
+        if (numbered) {
+            num = number(key.str(), invariant, false, gGlobal->getVarType(fun_call->fName));
+        }
+    }
+
+    fNumbers[inst] = num;
+    return num;
+}
+
+// Only scalar values of simple types are kept in variables
+bool ValueNumbering::isMovable(int num)
+{
+    return (num >= 0) && !fLeaf[num]
+        && (fTypes[num] == Typed::kInt32 || fTypes[num] == Typed::kFloat || fTypes[num] == Typed::kDouble);
+}
+
+void ValueNumbering::beginStatement(StatementInst* inst)
+{
+    fNumbers.clear();
+    if (isRewritable(inst)) {
+        if (getIndex(inst)) number(getIndex(inst));
+        number(getValue(inst));
+    }
+}
+
+void ValueNumbering::endStatement(StatementInst* inst)
+{
+    StoredVariables stored;
+    inst->accept(&stored);
+    for (set<string>::iterator it = stored.fNames.begin(); it != stored.fNames.end(); it++) {
+        fVersions[*it]++;
+    }
+    if (stored.fMemory) {
+        fMemory++;
+    }
+}
+
+void ValueNumbering::count(ValueInst* inst)
+{
+    int num = getNumber(inst);
+
+    // Hoisted or shared values are computed once, their sub-expressions are not counted
+    if (isMovable(num) && (fInvariant[num] || fCount[num]++ > 0)) {
+        return;
+    }
+
+    if (BinopInst* binop = dynamic_cast<BinopInst*>(inst)) {
+        count(binop->fInst1);
+        count(binop->fInst2);
+    } else if (CastInst* cast = dynamic_cast<CastInst*>(inst)) {
+        count(cast->fInst);
+    } else if (BitcastInst* cast = dynamic_cast<BitcastInst*>(inst)) {
+        count(cast->fInst);
+    } else if (FunCallInst* fun_call = dynamic_cast<FunCallInst*>(inst)) {
+        for (list<ValueInst*>::iterator it = fun_call->fArgs.begin(); it != fun_call->fArgs.end(); it++) {
+            count(*it);
+        }
+    }
+}
+
+ValueInst* ValueNumbering::rewrite(ValueInst* inst, BlockInst* before, BlockInst* pre_loop)
+{
+    BasicCloneVisitor cloner;
+    int num = getNumber(inst);
+    bool movable = isMovable(num);
+
+    if (movable) {
+        if (fHolders.find(num) != fHolders.end()) {
+            return InstBuilder::genLoadStackVar(fHolders[num]);
+        } else if (fInvariant[num]) {
+            string name = subst((isRealType(fTypes[num])) ? "f$0" : "i$0", gGlobal->getFreshID("Slow"));
+            pre_loop->pushBackInst(InstBuilder::genDecStackVar(name, InstBuilder::genBasicTyped(fTypes[num]), inst->clone(&cloner)));
+            fHolders[num] = name;
+            return InstBuilder::genLoadStackVar(name);
+        }
+    }
+
+    ValueInst* res;
+    if (BinopInst* binop = dynamic_cast<BinopInst*>(inst)) {
+        ValueInst* inst1 = rewrite(binop->fInst1, before, pre_loop);
+        ValueInst* inst2 = rewrite(binop->fInst2, before, pre_loop);
+        res = InstBuilder::genBinopInst(binop->fOpcode, inst1, inst2);
+    } else if (CastInst* cast = dynamic_cast<CastInst*>(inst)) {
+        res = new CastInst(rewrite(cast->fInst, before, pre_loop), cast->fType->clone(&cloner));
+    } else if (BitcastInst* cast = dynamic_cast<BitcastInst*>(inst)) {
+        res = new BitcastInst(rewrite(cast->fInst, before, pre_loop), cast->fType->clone(&cloner));
+    } else if (FunCallInst* fun_call = dynamic_cast<FunCallInst*>(inst)) {
+        list<ValueInst*> args;
+        for (list<ValueInst*>::iterator it = fun_call->fArgs.begin(); it != fun_call->fArgs.end(); it++) {
+            args.push_back(rewrite(*it, before, pre_loop));
+        }
+        res = InstBuilder::genFunCallInst(fun_call->fName, args, fun_call->fMethod);
+    } else {
+        res = inst->clone(&cloner);
+    }
+
+    if (movable && fCount[num] > 1) {
+        string name = subst((isRealType(fTypes[num])) ? "f$0" : "i$0", gGlobal->getFreshID("Temp"));
+        before->pushBackInst(InstBuilder::genDecStackVar(name, InstBuilder::genBasicTyped(fTypes[num]), res));
+        fHolders[num] = name;
+        return InstBuilder::genLoadStackVar(name);
+    } else {
+        return res;
+    }
+}
+
+BlockInst* ValueNumbering::getCode(BlockInst* body, BlockInst* pre_loop)
+{
+    if (!isOptimizable(body)) {
+        return body;
+    }
+
+    StoredVariables stored;
+    body->accept(&stored);
+    fStored = stored.fNames;
+
+    list<StatementInst*>::const_iterator it;
+
+    // Numbering and occurrences
+    for (it = body->fCode.begin(); it != body->fCode.end(); it++) {
+        beginStatement(*it);
+        if (isRewritable(*it)) {
+            if (getIndex(*it)) count(getIndex(*it));
+            count(getValue(*it));
+        }
+        endStatement(*it);
+    }
+
+    // Same numbering again, then rewriting
+    fVersions.clear();
+    fMemory = 0;
+    BasicCloneVisitor cloner;
+    BlockInst* res = InstBuilder::genBlockInst();
+
+    for (it = body->fCode.begin(); it != body->fCode.end(); it++) {
+        beginStatement(*it);
+        if (isRewritable(*it)) {
+            DeclareVarInst* dec_inst = dynamic_cast<DeclareVarInst*>(*it);
+            StoreVarInst* store_inst = dynamic_cast<StoreVarInst*>(*it);
+            if (dec_inst) {
+                ValueInst* value = rewrite(dec_inst->fValue, res, pre_loop);
+                res->pushBackInst(InstBuilder::genDeclareVarInst(dec_inst->fAddress->clone(&cloner), dec_inst->fType->clone(&cloner), value));
+            } else {
+                IndexedAddress* indexed = dynamic_cast<IndexedAddress*>(store_inst->fAddress);
+                Address* address = (indexed)
+                    ? InstBuilder::genIndexedAddress(indexed->fAddress->clone(&cloner), rewrite(indexed->fIndex, res, pre_loop))
+                    : store_inst->fAddress->clone(&cloner);
+                ValueInst* value = rewrite(store_inst->fValue, res, pre_loop);
+                res->pushBackInst(InstBuilder::genStoreVarInst(address, value));
+            }
+        } else {
+            res->pushBackInst((*it)->clone(&cloner));
+        }
+        endStatement(*it);
+    }
+
+    return res;
+}
@@ -601,4 +601,52 @@ struct CastRemover : public BasicTypingCloneVisitor {
     }
 };
 
+/*
+ Value numbering and loop-invariant code motion on the scalar DSP loop, done on FIR so that all backends benefit from it.
+
+ - pure expressions (arithmetic, casts, non method function calls) are given a number, loads being numbered with
+   the version of the variable (incremented at each store), so that equal numbers denote equal values
+ - expressions only depending on variables not stored in the loop are computed once before the loop, in 'fSlow' variables
+ - expressions computed several times in one iteration are computed once, in 'fTemp' variables
+
+ Only the top-level statements of the loop body are rewritten, nested statements (loops, if...) being kept as they are.
+*/
+
+struct ValueNumbering {
+
+    map<string, int> fValues;           // Expression key ==> number
+    map<ValueInst*, int> fNumbers;      // Numbered expressions of the current statement
+    vector<bool> fInvariant;            // By number
+    vector<bool> fLeaf;                 // Loads and constants are never moved
+    vector<Typed::VarType> fTypes;
+    vector<int> fCount;                 // Occurrences in the loop body, once shared sub-expressions are removed
+    map<int, string> fHolders;          // Variables keeping the already computed numbers
+
+    set<string> fStored;                // Variables stored in the loop body
+    map<string, int> fVersions;
+    int fMemory;                        // Version of buffers accessed by pointers (inputs/outputs may alias)
+
+    ValueNumbering():fMemory(0)
+    {}
+
+    // Returns false if the loop body cannot be optimized
+    static bool isOptimizable(BlockInst* body);
+
+    int getNumber(ValueInst* inst);
+    int number(ValueInst* inst);
+    int number(const string& key, bool invariant, bool leaf, Typed::VarType type);
+    bool isMovable(int num);
+
+    // Statements are numbered before being counted or rewritten, then versions are updated
+    void beginStatement(StatementInst* inst);
+    void endStatement(StatementInst* inst);
+
+    void count(ValueInst* inst);
+    ValueInst* rewrite(ValueInst* inst, BlockInst* before, BlockInst* pre_loop);
+
+    // Returns the optimized loop body, the hoisted computations being added at the end of 'pre_loop'
+    BlockInst* getCode(BlockInst* body, BlockInst* pre_loop);
+
+};
+
 #endif
@@ -34,11 +34,11 @@
 //          2: double precision float
 //          3: long double precision float
 
-const char* mathsuffix[4];    // suffix for math functions
-const char* numsuffix[4];     // suffix for numeric constants
-const char* floatname[4];     // float types
-const char* castname[4];      // float castings
-double floatmin[4];           // minimum float values before denormals
+thread_local const char* mathsuffix[4];    // suffix for math functions
+thread_local const char* numsuffix[4];     // suffix for numeric constants
+thread_local const char* floatname[4];     // float types
+thread_local const char* castname[4];      // float castings
+thread_local double floatmin[4];           // minimum float values before denormals
 
 const char* isuffix() { return mathsuffix[gGlobal->gFloatSize]; }   ///< suffix for math functions
 const char* inumix() { return numsuffix[gGlobal->gFloatSize]; }     ///< suffix for numeric constants
@@ -24,7 +24,7 @@
 #include "global.hh"
 #include "floats.hh"
 
-std::stack<BlockInst*> BasicCloneVisitor::fBlockStack;
+thread_local std::stack<BlockInst*> BasicCloneVisitor::fBlockStack;
 
 string Typed::gTypeString[] = {
     "kInt32", "kInt32ish", "kInt32_ptr", "kInt32_vec", "kInt32_vec_ptr",
@@ -1449,7 +1449,7 @@ class BasicCloneVisitor : public CloneVisitor {
     
     protected:
     
-        static std::stack<BlockInst*> fBlockStack;
+        static thread_local std::stack<BlockInst*> fBlockStack;
    
     public:
 
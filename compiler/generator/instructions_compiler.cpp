@@ -656,6 +656,28 @@ ValueInst* InstructionsCompiler::generateIota(Tree sig, Tree arg) { return InstB
  BINARY OPERATION
  *****************************************************************************/
 
+// True if the comparison of all values of 'i' with all values of 'j' gives the same result
+static bool isDecided(int opcode, const interval& i, const interval& j, bool& res)
+{
+    if (!i.valid || !j.valid) {
+        return false;
+    }
+    switch (opcode) {
+        case kLT:
+        case kGE:
+            if (i.lo >= j.hi) { res = (opcode == kGE); return true; }
+            if (i.hi < j.lo) { res = (opcode == kLT); return true; }
+            return false;
+        case kLE:
+        case kGT:
+            if (i.hi <= j.lo) { res = (opcode == kLE); return true; }
+            if (i.lo > j.hi) { res = (opcode == kGT); return true; }
+            return false;
+        default:
+            return false;
+    }
+}
+
 ValueInst* InstructionsCompiler::generateBinOp(Tree sig, int opcode, Tree a1, Tree a2)
 {
     int t1 = getCertifiedSigType(a1)->nature();
@@ -665,6 +687,7 @@ ValueInst* InstructionsCompiler::generateBinOp(Tree sig, int opcode, Tree a1, Tr
     ValueInst* res;
     ValueInst* v1 = CS(a1);
     ValueInst* v2 = CS(a2);
+    int n;
     
     interval i = getCertifiedSigType(a1)->getInterval();
     interval j = getCertifiedSigType(a2)->getInterval();
@@ -674,8 +697,15 @@ ValueInst* InstructionsCompiler::generateBinOp(Tree sig, int opcode, Tree a1, Tr
         //std::cerr << "WARNING : potential division by zero (" << i << "/" << j << ") in " << ppsig(sig) << std::endl;
     }
   
+    bool cmp;
+  
+    // Operations decided by the intervals
+    if ((opcode == kRem) && isSmaller(i, j)) {
+        res = (t3 == kReal) ? promote2real(t1, v1) : v1;
+    } else if (isBoolOpcode(opcode) && isDecided(opcode, i, j, cmp)) {
+        res = InstBuilder::genInt32NumInst(cmp);
     // Logical operations work on kInt32, so cast both operands here
-    if (isLogicalOpcode(opcode)) {
+    } else if (isLogicalOpcode(opcode)) {
         res = InstBuilder::genBinopInst(opcode, promote2int(t1, v1), promote2int(t2, v2));
         res = cast2real(t3, res);
     // Boolean operations work on kInt32 or kReal, result is kInt32
@@ -696,6 +726,9 @@ ValueInst* InstructionsCompiler::generateBinOp(Tree sig, int opcode, Tree a1, Tr
     } else if (opcode == kDiv) {
         // special handling for division, we always want a float division
         res = cast2int(t3, InstBuilder::genBinopInst(opcode, promote2real(t1, v1), promote2real(t2, v2)));
+    } else if ((opcode == kRem) && i.valid && (i.lo >= 0) && isSigInt(a2, &n) && (n > 0) && ((n & (n - 1)) == 0)) {
+        // Remainder of a positive value by a power of two
+        res = cast2real(t3, InstBuilder::genBinopInst(kAND, v1, InstBuilder::genInt32NumInst(n - 1)));
     } else {
         res = cast2real(t3, InstBuilder::genBinopInst(opcode, v1, v2));
     }
@@ -28,9 +28,17 @@
 #include <iostream>
 #include <sstream>
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
 
 #include "faust/gui/CGlue.h"
 #include "interpreter_bytecode.hh"
+#include "interpreter_register.hh"
+#include "interpreter_vector.hh"
+#include "interpreter_native.hh"
+#include "interpreter_profiler.hh"
+#include "interpreter_tasks.hh"
 #include "exception.hh"
 
 // Interpreter
@@ -65,10 +73,53 @@ class FIRInterpreter  {
         T** fInputs;
         T** fOutputs;
     
+        // Vector kernels of the executed flat code (the factory ones, unless the code is specialized)
+        FIRVectorCompiler<T>* fVectorCompiler;
+    
         int fIntrumentMode;
     
         std::map<int, long long> fRealStats;
     
+        // Opcode sequences profiling (mode 4), cumulated on all instances to profile a set of DSPs
+        static std::map<int, long long> gOpcodePairs;
+        static std::map<int, long long> gOpcodeTriples;
+        static long long gOpcodeCount;
+        FlatInstructionIT fProfileLast;
+        int fProfileOpcode1;
+        int fProfileOpcode2;
+    
+        // Sampling profiler (mode 5)
+        FIRProfiler<T>* fProfiler;
+    
+        // Worker threads executing the task groups of scheduler mode (-sch)
+        FIRTaskPool* fTaskPool;
+    
+        static int sequenceKey(int opcode1, int opcode2, int opcode3 = 0)
+        {
+            return (opcode1 << 20) | (opcode2 << 10) | opcode3;
+        }
+    
+        static void printSequences(std::map<int, long long>& sequences, int length, int max)
+        {
+            std::vector<std::pair<long long, int> > sorted;
+            for (std::map<int, long long>::iterator it = sequences.begin(); it != sequences.end(); it++) {
+                sorted.push_back(std::make_pair((*it).second, (*it).first));
+            }
+            std::sort(sorted.rbegin(), sorted.rend());
+            for (int i = 0; i < std::min(max, int(sorted.size())); i++) {
+                int key = sorted[i].second;
+                std::stringstream percent;
+                percent << std::fixed << std::setprecision(2) << std::setw(6) << (100. * sorted[i].first) / gOpcodeCount;
+                std::cout << std::setw(12) << sorted[i].first << " " << percent.str() << "% "
+                          << gFIRInstructionTable[(key >> 20) & 1023] << " "
+                          << gFIRInstructionTable[(key >> 10) & 1023];
+                if (length == 3) {
+                    std::cout << " " << gFIRInstructionTable[key & 1023];
+                }
+                std::cout << std::endl;
+            }
+        }
+    
         void printStats()
         {
             if (fIntrumentMode > 0) {
@@ -85,11 +136,28 @@ class FIRInterpreter  {
                     std::cout << "INTEGER_OVERFLOW: " << fRealStats[INTEGER_OVERFLOW] << std::endl;
                     std::cout << "DIV_BY_ZERO: " << fRealStats[DIV_BY_ZERO] << std::endl;
                 }
+                if (fIntrumentMode == 4) {
+                    std::cout << "Executed instructions (all instances): " << gOpcodeCount << std::endl;
+                    std::cout << "Hottest opcode pairs:" << std::endl;
+                    printSequences(gOpcodePairs, 2, 20);
+                    std::cout << "Hottest opcode triples:" << std::endl;
+                    printSequences(gOpcodeTriples, 3, 20);
+                }
+                if (fProfiler) {
+                    std::map<FIRFlatBlockInstruction<T>*, std::string> names;
+                    names[fFactory->fStaticInitFlatBlock] = "classInit";
+                    names[fFactory->fInitFlatBlock] = "instanceConstants";
+                    names[fFactory->fResetUIFlatBlock] = "instanceResetUserInterface";
+                    names[fFactory->fClearFlatBlock] = "instanceClear";
+                    names[fFactory->fComputeFlatBlock] = "compute (control)";
+                    names[fFactory->fComputeDSPFlatBlock] = "compute (DSP)";
+                    fProfiler->print(&std::cout, names, fFactory->fHeapNames);
+                }
                 std::cout << "-------------------------------"<< std::endl;
             }
         }
     
-        inline void warning_overflow(InstructionIT it)
+        inline void warning_overflow(FlatInstructionIT it)
         {
             if (fIntrumentMode >= 3) {
                 fRealStats[INTEGER_OVERFLOW]++;
@@ -101,7 +169,7 @@ class FIRInterpreter  {
         #endif
         }
     
-        inline void check_div_zero(InstructionIT it, T val)
+        inline void check_div_zero(FlatInstructionIT it, T val)
         {
             if ((fIntrumentMode >= 3) && (val == T(0))) {
                 fRealStats[DIV_BY_ZERO]++;
@@ -115,7 +183,7 @@ class FIRInterpreter  {
         #endif
         }
     
-        inline T check_real_aux(InstructionIT it, T val)
+        inline T check_real_aux(FlatInstructionIT it, T val)
         {
             if (fIntrumentMode == 0) {
                 // Nothing
@@ -183,16 +251,42 @@ class FIRInterpreter  {
 
         InterpreterTrace fTraceContext;
     
-        inline void traceInstruction(InstructionIT it)
+        inline void traceInstruction(FlatInstructionIT it)
         {
         #ifdef FULL_INTERPRETER_TRACE
             std::stringstream message;
-            (*it)->write(&message);
+            it->write(&message);
             fTraceContext.push(message.str());
         #endif
         }
     
-        inline int assert_audio_buffer(InstructionIT it, int index)
+        // Count the sequences of consecutive non-control instructions, the candidates for new fused instructions (mode 4),
+        // or sample the executed instructions (mode 5)
+        inline void profileInstruction(FlatInstructionIT it)
+        {
+            if (TRACE && fProfiler) {
+                fProfiler->count(it);
+            } else if (TRACE && fIntrumentMode == 4) {
+                gOpcodeCount++;
+                int opcode = it->fOpcode;
+                if (opcode >= FIRInstruction::kLoop) {
+                    fProfileOpcode1 = fProfileOpcode2 = -1;
+                } else if (it == fProfileLast + 1 && fProfileOpcode1 >= 0) {
+                    gOpcodePairs[sequenceKey(fProfileOpcode1, opcode)]++;
+                    if (fProfileOpcode2 >= 0) {
+                        gOpcodeTriples[sequenceKey(fProfileOpcode2, fProfileOpcode1, opcode)]++;
+                    }
+                    fProfileOpcode2 = fProfileOpcode1;
+                    fProfileOpcode1 = opcode;
+                } else {
+                    fProfileOpcode2 = -1;
+                    fProfileOpcode1 = opcode;
+                }
+                fProfileLast = it;
+            }
+        }
+    
+        inline int assert_audio_buffer(FlatInstructionIT it, int index)
         {
         #ifdef FULL_INTERPRETER_TRACE
             if ((index < 0) || (index >= fIntHeap[fFactory->fCountOffset])) {
@@ -209,7 +303,7 @@ class FIRInterpreter  {
         #endif
         }
         
-        inline int assert_int_heap(InstructionIT it, int index, int size = -1)
+        inline int assert_int_heap(FlatInstructionIT it, int index, int size = -1)
         {
         #ifdef FULL_INTERPRETER_TRACE
             if ((index < 0) || (index >= fFactory->fIntHeapSize) || (size > 0 && index >= size)) {
@@ -226,7 +320,7 @@ class FIRInterpreter  {
         #endif
         }
         
-        inline int assert_real_heap(InstructionIT it, int index, int size = -1)
+        inline int assert_real_heap(FlatInstructionIT it, int index, int size = -1)
         {
         #ifdef FULL_INTERPRETER_TRACE
             if ((index < 0) || (index >= fFactory->fRealHeapSize) || (size > 0 && index >= size)) {
@@ -243,7 +337,7 @@ class FIRInterpreter  {
         #endif
         }
     
-        inline T check_real(InstructionIT it, T val)
+        inline T check_real(FlatInstructionIT it, T val)
         {
             return (TRACE) ? check_real_aux(it, val) : val;
         }
@@ -329,7 +423,252 @@ class FIRInterpreter  {
             }
         }
     
-        inline void ExecuteBlock(FIRBlockInstruction<T>* block)
+        #define vec_reg(regs, reg) (&(regs)[(reg) * FIRVectorKernel<T>::kVectorSize])
+    
+        #define vec_unary(DT, dregs, AT, aregs, expr)  \
+        {                                              \
+            DT* d = vec_reg(dregs, it->fDst);          \
+            AT* a = vec_reg(aregs, it->fSrc1);         \
+            for (int i = 0; i < size; i++) {           \
+                d[i] = expr;                           \
+            }                                          \
+            break;                                     \
+        }
+    
+        #define vec_binary(DT, dregs, AT, aregs, expr) \
+        {                                              \
+            DT* d = vec_reg(dregs, it->fDst);          \
+            AT* a = vec_reg(aregs, it->fSrc1);         \
+            AT* b = vec_reg(aregs, it->fSrc2);         \
+            for (int i = 0; i < size; i++) {           \
+                d[i] = expr;                           \
+            }                                          \
+            break;                                     \
+        }
+    
+        // Execute vector instructions on 'size' samples, starting at loop variable 'index'
+        void ExecuteVectorInstructions(std::vector<FIRVecInstruction<T> >& code, int index, int size)
+        {
+            // Vector registers are kept after the heaps
+            T* real_regs = &fRealHeap[fFactory->fRealHeapSize];
+            int* int_regs = &fIntHeap[fFactory->fIntHeapSize];
+            
+            for (VecInstructionIT it = code.begin(); it != code.end(); it++) {
+                
+                // Position of the loop variable based accesses
+                int base = index + it->fIntValue + ((it->fOffset2 >= 0) ? fIntHeap[it->fOffset2] : 0);
+                
+                switch (it->fOpcode) {
+                        
+                    // Loop invariant values
+                    case FIRVectorInstruction::kBroadcastReal: {
+                        T* d = vec_reg(real_regs, it->fDst);
+                        std::fill(d, d + size, fRealHeap[it->fOffset1]);
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kBroadcastInt: {
+                        int* d = vec_reg(int_regs, it->fDst);
+                        std::fill(d, d + size, fIntHeap[it->fOffset1]);
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kBroadcastRealValue: {
+                        T* d = vec_reg(real_regs, it->fDst);
+                        std::fill(d, d + size, it->fRealValue);
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kBroadcastIntValue: {
+                        int* d = vec_reg(int_regs, it->fDst);
+                        std::fill(d, d + size, it->fIntValue);
+                        break;
+                    }
+                    
+                    // Loop variable
+                    case FIRVectorInstruction::kIndex: {
+                        int* d = vec_reg(int_regs, it->fDst);
+                        for (int i = 0; i < size; i++) {
+                            d[i] = base + i;
+                        }
+                        break;
+                    }
+                    
+                    // Memory
+                    case FIRVectorInstruction::kLoadReal: {
+                        T* d = vec_reg(real_regs, it->fDst);
+                        std::copy(&fRealHeap[it->fOffset1 + base], &fRealHeap[it->fOffset1 + base + size], d);
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kLoadInt: {
+                        int* d = vec_reg(int_regs, it->fDst);
+                        std::copy(&fIntHeap[it->fOffset1 + base], &fIntHeap[it->fOffset1 + base + size], d);
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kStoreReal: {
+                        T* a = vec_reg(real_regs, it->fSrc1);
+                        std::copy(a, a + size, &fRealHeap[it->fOffset1 + base]);
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kStoreInt: {
+                        int* a = vec_reg(int_regs, it->fSrc1);
+                        std::copy(a, a + size, &fIntHeap[it->fOffset1 + base]);
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kGatherReal: {
+                        T* d = vec_reg(real_regs, it->fDst);
+                        int* a = vec_reg(int_regs, it->fSrc1);
+                        for (int i = 0; i < size; i++) {
+                            d[i] = fRealHeap[it->fOffset1 + a[i]];
+                        }
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kGatherInt: {
+                        int* d = vec_reg(int_regs, it->fDst);
+                        int* a = vec_reg(int_regs, it->fSrc1);
+                        for (int i = 0; i < size; i++) {
+                            d[i] = fIntHeap[it->fOffset1 + a[i]];
+                        }
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kLoadInput: {
+                        T* d = vec_reg(real_regs, it->fDst);
+                        std::copy(&fInputs[it->fOffset1][base], &fInputs[it->fOffset1][base + size], d);
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kGatherInput: {
+                        T* d = vec_reg(real_regs, it->fDst);
+                        int* a = vec_reg(int_regs, it->fSrc1);
+                        for (int i = 0; i < size; i++) {
+                            d[i] = fInputs[it->fOffset1][a[i]];
+                        }
+                        break;
+                    }
+                    
+                    case FIRVectorInstruction::kStoreOutput: {
+                        T* a = vec_reg(real_regs, it->fSrc1);
+                        std::copy(a, a + size, &fOutputs[it->fOffset1][base]);
+                        break;
+                    }
+                    
+                    // Cast/bitcast
+                    case FIRVectorInstruction::kCastReal: vec_unary(T, real_regs, int, int_regs, T(a[i]))
+                    case FIRVectorInstruction::kCastInt: vec_unary(int, int_regs, T, real_regs, int(a[i]))
+                    case FIRVectorInstruction::kBitcastInt: vec_unary(int, int_regs, T, real_regs, *reinterpret_cast<int*>(&a[i]))
+                    case FIRVectorInstruction::kBitcastReal: vec_unary(T, real_regs, int, int_regs, *reinterpret_cast<T*>(&a[i]))
+                    
+                    // Standard math
+                    case FIRVectorInstruction::kAddReal: vec_binary(T, real_regs, T, real_regs, a[i] + b[i])
+                    case FIRVectorInstruction::kAddInt: vec_binary(int, int_regs, int, int_regs, a[i] + b[i])
+                    case FIRVectorInstruction::kSubReal: vec_binary(T, real_regs, T, real_regs, a[i] - b[i])
+                    case FIRVectorInstruction::kSubInt: vec_binary(int, int_regs, int, int_regs, a[i] - b[i])
+                    case FIRVectorInstruction::kMultReal: vec_binary(T, real_regs, T, real_regs, a[i] * b[i])
+                    case FIRVectorInstruction::kMultInt: vec_binary(int, int_regs, int, int_regs, a[i] * b[i])
+                    case FIRVectorInstruction::kDivReal: vec_binary(T, real_regs, T, real_regs, a[i] / b[i])
+                    case FIRVectorInstruction::kDivInt: vec_binary(int, int_regs, int, int_regs, a[i] / b[i])
+                    case FIRVectorInstruction::kRemReal: vec_binary(T, real_regs, T, real_regs, std::remainder(a[i], b[i]))
+                    case FIRVectorInstruction::kRemInt: vec_binary(int, int_regs, int, int_regs, a[i] % b[i])
+                    case FIRVectorInstruction::kLshInt: vec_binary(int, int_regs, int, int_regs, a[i] << b[i])
+                    case FIRVectorInstruction::kRshInt: vec_binary(int, int_regs, int, int_regs, a[i] >> b[i])
+                    case FIRVectorInstruction::kGTInt: vec_binary(int, int_regs, int, int_regs, a[i] > b[i])
+                    case FIRVectorInstruction::kLTInt: vec_binary(int, int_regs, int, int_regs, a[i] < b[i])
+                    case FIRVectorInstruction::kGEInt: vec_binary(int, int_regs, int, int_regs, a[i] >= b[i])
+                    case FIRVectorInstruction::kLEInt: vec_binary(int, int_regs, int, int_regs, a[i] <= b[i])
+                    case FIRVectorInstruction::kEQInt: vec_binary(int, int_regs, int, int_regs, a[i] == b[i])
+                    case FIRVectorInstruction::kNEInt: vec_binary(int, int_regs, int, int_regs, a[i] != b[i])
+                    case FIRVectorInstruction::kGTReal: vec_binary(int, int_regs, T, real_regs, a[i] > b[i])
+                    case FIRVectorInstruction::kLTReal: vec_binary(int, int_regs, T, real_regs, a[i] < b[i])
+                    case FIRVectorInstruction::kGEReal: vec_binary(int, int_regs, T, real_regs, a[i] >= b[i])
+                    case FIRVectorInstruction::kLEReal: vec_binary(int, int_regs, T, real_regs, a[i] <= b[i])
+                    case FIRVectorInstruction::kEQReal: vec_binary(int, int_regs, T, real_regs, a[i] == b[i])
+                    case FIRVectorInstruction::kNEReal: vec_binary(int, int_regs, T, real_regs, a[i] != b[i])
+                    case FIRVectorInstruction::kANDInt: vec_binary(int, int_regs, int, int_regs, a[i] & b[i])
+                    case FIRVectorInstruction::kORInt: vec_binary(int, int_regs, int, int_regs, a[i] | b[i])
+                    case FIRVectorInstruction::kXORInt: vec_binary(int, int_regs, int, int_regs, a[i] ^ b[i])
+                    
+                    // Extended unary math
+                    case FIRVectorInstruction::kAbs: vec_unary(int, int_regs, int, int_regs, std::abs(a[i]))
+                    case FIRVectorInstruction::kAbsf: vec_unary(T, real_regs, T, real_regs, std::fabs(a[i]))
+                    case FIRVectorInstruction::kAcosf: vec_unary(T, real_regs, T, real_regs, std::acos(a[i]))
+                    case FIRVectorInstruction::kAsinf: vec_unary(T, real_regs, T, real_regs, std::asin(a[i]))
+                    case FIRVectorInstruction::kAtanf: vec_unary(T, real_regs, T, real_regs, std::atan(a[i]))
+                    case FIRVectorInstruction::kCeilf: vec_unary(T, real_regs, T, real_regs, std::ceil(a[i]))
+                    case FIRVectorInstruction::kCosf: vec_unary(T, real_regs, T, real_regs, std::cos(a[i]))
+                    case FIRVectorInstruction::kCoshf: vec_unary(T, real_regs, T, real_regs, std::cosh(a[i]))
+                    case FIRVectorInstruction::kExpf: vec_unary(T, real_regs, T, real_regs, std::exp(a[i]))
+                    case FIRVectorInstruction::kFloorf: vec_unary(T, real_regs, T, real_regs, std::floor(a[i]))
+                    case FIRVectorInstruction::kLogf: vec_unary(T, real_regs, T, real_regs, std::log(a[i]))
+                    case FIRVectorInstruction::kLog10f: vec_unary(T, real_regs, T, real_regs, std::log10(a[i]))
+                    case FIRVectorInstruction::kRoundf: vec_unary(T, real_regs, T, real_regs, std::round(a[i]))
+                    case FIRVectorInstruction::kSinf: vec_unary(T, real_regs, T, real_regs, std::sin(a[i]))
+                    case FIRVectorInstruction::kSinhf: vec_unary(T, real_regs, T, real_regs, std::sinh(a[i]))
+                    case FIRVectorInstruction::kSqrtf: vec_unary(T, real_regs, T, real_regs, std::sqrt(a[i]))
+                    case FIRVectorInstruction::kTanf: vec_unary(T, real_regs, T, real_regs, std::tan(a[i]))
+                    case FIRVectorInstruction::kTanhf: vec_unary(T, real_regs, T, real_regs, std::tanh(a[i]))
+                    
+                    // Extended binary math
+                    case FIRVectorInstruction::kAtan2f: vec_binary(T, real_regs, T, real_regs, std::atan2(a[i], b[i]))
+                    case FIRVectorInstruction::kFmodf: vec_binary(T, real_regs, T, real_regs, std::fmod(a[i], b[i]))
+                    case FIRVectorInstruction::kPowf: vec_binary(T, real_regs, T, real_regs, std::pow(a[i], b[i]))
+                    case FIRVectorInstruction::kMax: vec_binary(int, int_regs, int, int_regs, std::max(a[i], b[i]))
+                    case FIRVectorInstruction::kMaxf: vec_binary(T, real_regs, T, real_regs, std::max(a[i], b[i]))
+                    case FIRVectorInstruction::kMin: vec_binary(int, int_regs, int, int_regs, std::min(a[i], b[i]))
+                    case FIRVectorInstruction::kMinf: vec_binary(T, real_regs, T, real_regs, std::min(a[i], b[i]))
+                }
+            }
+        }
+    
+        // Execute a loop compiled as a vector kernel, by chunks of kVectorSize samples
+        void ExecuteKernel(FIRVectorKernel<T>* kernel)
+        {
+            int start = kernel->fStart;
+            int end = (kernel->fEndOffset >= 0) ? fIntHeap[kernel->fEndOffset] : kernel->fEndValue;
+            // Loops are 'do/while' : at least one iteration
+            int count = std::max(1, end - start);
+            
+            ExecuteVectorInstructions(kernel->fInvariants, start, FIRVectorKernel<T>::kVectorSize);
+            for (int chunk = 0; chunk < count; chunk += FIRVectorKernel<T>::kVectorSize) {
+                ExecuteVectorInstructions(kernel->fInstructions, start + chunk, std::min(int(FIRVectorKernel<T>::kVectorSize), count - chunk));
+            }
+            
+            // Loop variable final value
+            fIntHeap[kernel->fLoopOffset] = start + count;
+        }
+    
+        struct TaskGroup {
+            FIRInterpreter* fInterpreter;
+            FlatInstructionIT fTasks;
+        };
+    
+        static void ExecuteTask(void* arg, int task)
+        {
+            TaskGroup* group = static_cast<TaskGroup*>(arg);
+            FlatInstructionIT it = group->fTasks + task;
+            group->fInterpreter->ExecuteBlock(0, false, it + it->fBranch1);
+        }
+    
+        // Execute a group of 'count' kTask instructions, on the worker threads if any (not in trace mode)
+        void ExecuteTasks(FlatInstructionIT tasks, int count)
+        {
+            TaskGroup group = { this, tasks };
+            if (fTaskPool) {
+                fTaskPool->execute(ExecuteTask, &group, count);
+            } else {
+                for (int task = 0; task < count; task++) {
+                    ExecuteTask(&group, task);
+                }
+            }
+        }
+    
+        // Execute a flat block, or the task starting at 'task' in a flat block (see ExecuteTasks)
+        inline void ExecuteBlock(FIRFlatBlockInstruction<T>* block, bool link = false, FlatInstructionIT task = 0)
         {
             static void* fDispatchTable[] = {
                 
@@ -477,44 +816,63 @@ class FIRInterpreter  {
                 &&do_kFmodfValueInvert,
                 &&do_kPowfValueInvert,
                 
+                // Fused sequences
+                &&do_kMultAddRealHeap,
+                &&do_kAddRealStackStore,
+                &&do_kLoadIndexedRealMask,
+                &&do_kStoreIndexedRealHeap,
+                &&do_kLoadInputHeap, &&do_kStoreOutputHeap,
+                
                 // Control
                 &&do_kLoop,
                 &&do_kReturn,
                 
                 // Select/if
                 &&do_kIf, &&do_kSelectReal, &&do_kSelectInt,
-                &&do_kCondBranch
+                &&do_kCondBranch,
+                
+                // Group of independent tasks
+                &&do_kTask
                 
             };
             
+            // Link mode : resolve the computed-goto labels of the flat code
+            if (link) {
+                block->link(fDispatchTable);
+                return;
+            }
+            
             int real_stack_index = 0;
             int int_stack_index = 0;
             int addr_stack_index = 0;
             
             T real_stack[fRealStackSize];
             int int_stack[fIntStackSize];
-            InstructionIT address_stack[64];
+            FlatInstructionIT address_stack[64];
           
-            #define dispatch_first() { traceInstruction(it); goto *fDispatchTable[(*it)->fOpcode]; }
-            #define dispatch_next() { traceInstruction(it); it++; goto *fDispatchTable[(*it)->fOpcode]; }
+            #define dispatch_first() { traceInstruction(it); profileInstruction(it); goto *it->fLabel; }
+            #define dispatch_next() { traceInstruction(it); it++; profileInstruction(it); goto *it->fLabel; }
             
-            #define dispatch_branch1() { it = (*it)->fBranch1->fInstructions.begin(); dispatch_first(); }
-            #define dispatch_branch2() { it = (*it)->fBranch2->fInstructions.begin(); dispatch_first(); }
+            #define dispatch_branch1() { it += it->fBranch1; dispatch_first(); }
+            #define dispatch_branch2() { it += it->fBranch2; dispatch_first(); }
             
-            #define push_branch1() { push_addr((*it)->fBranch1->fInstructions.begin()); }
-            #define push_branch2() { push_addr((*it)->fBranch2->fInstructions.begin()); }
+            #define push_branch1() { push_addr(it + it->fBranch1); }
+            #define push_branch2() { push_addr(it + it->fBranch2); }
             
             #define dispatch_return() { it = pop_addr(); dispatch_first(); }
             #define save_return() { push_addr(it + 1); }
             #define empty_return() (addr_stack_index == 0)
             
             // Check block coherency
-            InstructionIT it1 = block->fInstructions.end(); it1--;
-            faustassert((*it1)->fOpcode == FIRInstruction::kReturn);
+            faustassert(task || block->fLinked);
+            
+            if (TRACE && fProfiler && !task) {
+                fProfiler->begin(block);
+            }
             
             try {
                 
-                InstructionIT it = block->fInstructions.begin();
+                FlatInstructionIT it = (task) ? task : &block->fInstructions[0];
                 dispatch_first();
                 
                 while (true) {
@@ -522,13 +880,13 @@ class FIRInterpreter  {
                     // Number operations
                     do_kRealValue:
                     {
-                        push_real(it, (*it)->fRealValue);
+                        push_real(it, it->fRealValue);
                         dispatch_next();
                     }
                     
                     do_kInt32Value:
                     {
-                        push_int((*it)->fIntValue);
+                        push_int(it->fIntValue);
                         dispatch_next();
                     }
                         
@@ -536,9 +894,9 @@ class FIRInterpreter  {
                     do_kLoadReal:
                     {
                         if (TRACE) {
-                            push_real(it, fRealHeap[assert_real_heap(it, (*it)->fOffset1)]);
+                            push_real(it, fRealHeap[assert_real_heap(it, it->fOffset1)]);
                         } else {
-                            push_real(it, fRealHeap[(*it)->fOffset1]);
+                            push_real(it, fRealHeap[it->fOffset1]);
                         }
 
                         dispatch_next();
@@ -547,9 +905,9 @@ class FIRInterpreter  {
                     do_kLoadInt:
                     {
                         if (TRACE) {
-                            push_int(fIntHeap[assert_int_heap(it, (*it)->fOffset1)]);
+                            push_int(fIntHeap[assert_int_heap(it, it->fOffset1)]);
                         } else {
-                            push_int(fIntHeap[(*it)->fOffset1]);
+                            push_int(fIntHeap[it->fOffset1]);
                         }
                         dispatch_next();
                     }
@@ -557,9 +915,9 @@ class FIRInterpreter  {
                     do_kStoreReal:
                     {
                         if (TRACE) {
-                            fRealHeap[assert_real_heap(it, (*it)->fOffset1)] = pop_real(it);
+                            fRealHeap[assert_real_heap(it, it->fOffset1)] = pop_real(it);
                         } else {
-                            fRealHeap[(*it)->fOffset1] = pop_real(it);
+                            fRealHeap[it->fOffset1] = pop_real(it);
                         }
                         dispatch_next();
                     }
@@ -567,9 +925,9 @@ class FIRInterpreter  {
                     do_kStoreInt:
                     {
                         if (TRACE) {
-                            fIntHeap[assert_int_heap(it, (*it)->fOffset1)] = pop_int();
+                            fIntHeap[assert_int_heap(it, it->fOffset1)] = pop_int();
                         } else {
-                            fIntHeap[(*it)->fOffset1] = pop_int();
+                            fIntHeap[it->fOffset1] = pop_int();
                         }
                         dispatch_next();
                     }
@@ -578,9 +936,9 @@ class FIRInterpreter  {
                     do_kStoreRealValue:
                     {
                         if (TRACE) {
-                            fRealHeap[assert_real_heap(it, (*it)->fOffset1)] = (*it)->fRealValue;
+                            fRealHeap[assert_real_heap(it, it->fOffset1)] = it->fRealValue;
                         } else {
-                            fRealHeap[(*it)->fOffset1] = (*it)->fRealValue;
+                            fRealHeap[it->fOffset1] = it->fRealValue;
                         }
                         dispatch_next();
                     }
@@ -588,9 +946,9 @@ class FIRInterpreter  {
                     do_kStoreIntValue:
                     {
                         if (TRACE) {
-                            fIntHeap[assert_int_heap(it, (*it)->fOffset1)] = (*it)->fIntValue;
+                            fIntHeap[assert_int_heap(it, it->fOffset1)] = it->fIntValue;
                         } else {
-                            fIntHeap[(*it)->fOffset1] = (*it)->fIntValue;
+                            fIntHeap[it->fOffset1] = it->fIntValue;
                         }
                         dispatch_next();
                     }
@@ -598,9 +956,9 @@ class FIRInterpreter  {
                     do_kLoadIndexedReal:
                     {
                         if (TRACE) {
-                            push_real(it, fRealHeap[(*it)->fOffset1 + assert_real_heap(it, pop_int(), (*it)->fOffset2)]);
+                            push_real(it, fRealHeap[it->fOffset1 + assert_real_heap(it, pop_int(), it->fOffset2)]);
                         } else {
-                            push_real(it, fRealHeap[(*it)->fOffset1 + pop_int()]);
+                            push_real(it, fRealHeap[it->fOffset1 + pop_int()]);
                         }
                         
                         dispatch_next();
@@ -610,9 +968,9 @@ class FIRInterpreter  {
                     {
                         int offset = pop_int();
                         if (TRACE) {
-                            push_int(fIntHeap[(*it)->fOffset1 + assert_int_heap(it, offset, (*it)->fOffset2)]);
+                            push_int(fIntHeap[it->fOffset1 + assert_int_heap(it, offset, it->fOffset2)]);
                         } else {
-                            push_int(fIntHeap[(*it)->fOffset1 + offset]);
+                            push_int(fIntHeap[it->fOffset1 + offset]);
                         }
                         dispatch_next();
                     }
@@ -620,9 +978,9 @@ class FIRInterpreter  {
                     do_kStoreIndexedReal:
                     {
                         if (TRACE) {
-                            fRealHeap[(*it)->fOffset1 + assert_real_heap(it, pop_int(), (*it)->fOffset2)] = pop_real(it);
+                            fRealHeap[it->fOffset1 + assert_real_heap(it, pop_int(), it->fOffset2)] = pop_real(it);
                         } else {
-                            fRealHeap[(*it)->fOffset1 + pop_int()] = pop_real(it);
+                            fRealHeap[it->fOffset1 + pop_int()] = pop_real(it);
                         }
                         dispatch_next();
                     }
@@ -631,62 +989,60 @@ class FIRInterpreter  {
                     {
                         int offset = pop_int();
                         if (TRACE) {
-                            fIntHeap[(*it)->fOffset1 + assert_int_heap(it, offset, (*it)->fOffset2)] = pop_int();
+                            fIntHeap[it->fOffset1 + assert_int_heap(it, offset, it->fOffset2)] = pop_int();
                         } else {
-                            fIntHeap[(*it)->fOffset1 + offset] = pop_int();
+                            fIntHeap[it->fOffset1 + offset] = pop_int();
                         }
                         dispatch_next();
                     }
                     
                     do_kBlockStoreReal:
                     {
-                        FIRBlockStoreRealInstruction<T>* inst = dynamic_cast<FIRBlockStoreRealInstruction<T>*>(*it);
-                        faustassert(inst);
-                        for (int i = 0; i < inst->fOffset2; i++) {
-                            fRealHeap[inst->fOffset1 + i] = inst->fNumTable[i];
+                        // Values are kept in the block table, starting at fIntValue
+                        for (int i = 0; i < it->fOffset2; i++) {
+                            fRealHeap[it->fOffset1 + i] = block->fRealTable[it->fIntValue + i];
                         }
                         dispatch_next();
                     }
                     
                     do_kBlockStoreInt:
                     {
-                        FIRBlockStoreIntInstruction<T>* inst = dynamic_cast<FIRBlockStoreIntInstruction<T>*>(*it);
-                        faustassert(inst);
-                        for (int i = 0; i < inst->fOffset2; i++) {
-                            fIntHeap[inst->fOffset1 + i] = inst->fNumTable[i];
+                        // Values are kept in the block table, starting at fIntValue
+                        for (int i = 0; i < it->fOffset2; i++) {
+                            fIntHeap[it->fOffset1 + i] = block->fIntTable[it->fIntValue + i];
                         }
                         dispatch_next();
                     }
                     
                     do_kMoveReal:
                     {
-                        fRealHeap[(*it)->fOffset1] = fRealHeap[(*it)->fOffset2];
+                        fRealHeap[it->fOffset1] = fRealHeap[it->fOffset2];
                         dispatch_next();
                     }
                     
                     do_kMoveInt:
                     {
-                        fIntHeap[(*it)->fOffset1] = fIntHeap[(*it)->fOffset2];
+                        fIntHeap[it->fOffset1] = fIntHeap[it->fOffset2];
                         dispatch_next();
                     }
                     
                     do_kPairMoveReal:
                     {
-                        fRealHeap[(*it)->fOffset1] = fRealHeap[(*it)->fOffset1 - 1];
-                        fRealHeap[(*it)->fOffset2] = fRealHeap[(*it)->fOffset2 - 1];
+                        fRealHeap[it->fOffset1] = fRealHeap[it->fOffset1 - 1];
+                        fRealHeap[it->fOffset2] = fRealHeap[it->fOffset2 - 1];
                         dispatch_next();
                     }
                     
                     do_kPairMoveInt:
                     {
-                        fIntHeap[(*it)->fOffset1] = fIntHeap[(*it)->fOffset1 - 1];
-                        fIntHeap[(*it)->fOffset2] = fIntHeap[(*it)->fOffset2 - 1];
+                        fIntHeap[it->fOffset1] = fIntHeap[it->fOffset1 - 1];
+                        fIntHeap[it->fOffset2] = fIntHeap[it->fOffset2 - 1];
                         dispatch_next();
                     }
        
                     do_kBlockPairMoveReal:
                     {
-                        for (int i = (*it)->fOffset1; i < (*it)->fOffset2; i+=2) {
+                        for (int i = it->fOffset1; i < it->fOffset2; i+=2) {
                             fRealHeap[i+1] = fRealHeap[i];
                         }
                         dispatch_next();
@@ -694,7 +1050,7 @@ class FIRInterpreter  {
                     
                     do_kBlockPairMoveInt:
                     {
-                        for (int i = (*it)->fOffset1; i < (*it)->fOffset2; i+=2) {
+                        for (int i = it->fOffset1; i < it->fOffset2; i+=2) {
                             fIntHeap[i+1] = fIntHeap[i];
                         }
                         dispatch_next();
@@ -702,7 +1058,7 @@ class FIRInterpreter  {
                     
                     do_kBlockShiftReal:
                     {
-                        for (int i = (*it)->fOffset1; i > (*it)->fOffset2; i-=1) {
+                        for (int i = it->fOffset1; i > it->fOffset2; i-=1) {
                             fRealHeap[i] = fRealHeap[i-1];
                         }
                         dispatch_next();
@@ -710,7 +1066,7 @@ class FIRInterpreter  {
                     
                     do_kBlockShiftInt:
                     {
-                        for (int i = (*it)->fOffset1; i > (*it)->fOffset2; i-=1) {
+                        for (int i = it->fOffset1; i > it->fOffset2; i-=1) {
                             fIntHeap[i] = fIntHeap[i-1];
                         }
                         dispatch_next();
@@ -720,9 +1076,9 @@ class FIRInterpreter  {
                     do_kLoadInput:
                     {
                         if (TRACE) {
-                            push_real(it, fInputs[(*it)->fOffset1][assert_audio_buffer(it, pop_int())]);
+                            push_real(it, fInputs[it->fOffset1][assert_audio_buffer(it, pop_int())]);
                         } else {
-                            push_real(it, fInputs[(*it)->fOffset1][pop_int()]);
+                            push_real(it, fInputs[it->fOffset1][pop_int()]);
                         }
                         dispatch_next();
                     }
@@ -730,9 +1086,9 @@ class FIRInterpreter  {
                     do_kStoreOutput:
                     {
                         if (TRACE) {
-                            fOutputs[(*it)->fOffset1][assert_audio_buffer(it, pop_int())] = pop_real(it);
+                            fOutputs[it->fOffset1][assert_audio_buffer(it, pop_int())] = pop_real(it);
                         } else {
-                            fOutputs[(*it)->fOffset1][pop_int()] = pop_real(it);
+                            fOutputs[it->fOffset1][pop_int()] = pop_real(it);
                         }
                         dispatch_next();
                     }
@@ -746,7 +1102,7 @@ class FIRInterpreter  {
                     
                     do_kCastRealHeap:
                     {
-                        push_real(it, T(fIntHeap[(*it)->fOffset1]));
+                        push_real(it, T(fIntHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
@@ -758,7 +1114,7 @@ class FIRInterpreter  {
                     
                     do_kCastIntHeap:
                     {
-                        push_int(int(fRealHeap[(*it)->fOffset1]));
+                        push_int(int(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
@@ -1045,167 +1401,167 @@ class FIRInterpreter  {
                     
                     do_kAddRealHeap:
                     {
-                        push_real(it, fRealHeap[(*it)->fOffset1] + fRealHeap[(*it)->fOffset2]);
+                        push_real(it, fRealHeap[it->fOffset1] + fRealHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kAddIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] + fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] + fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kSubRealHeap:
                     {
-                        push_real(it, fRealHeap[(*it)->fOffset1] - fRealHeap[(*it)->fOffset2]);
+                        push_real(it, fRealHeap[it->fOffset1] - fRealHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kSubIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] - fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] - fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kMultRealHeap:
                     {
-                        push_real(it, fRealHeap[(*it)->fOffset1] * fRealHeap[(*it)->fOffset2]);
+                        push_real(it, fRealHeap[it->fOffset1] * fRealHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kMultIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] * fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] * fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kDivRealHeap:
                     {
-                        push_real(it, fRealHeap[(*it)->fOffset1] / fRealHeap[(*it)->fOffset2]);
+                        push_real(it, fRealHeap[it->fOffset1] / fRealHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kDivIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] / fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] / fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kRemRealHeap:
                     {
-                        push_real(it, std::remainder(fRealHeap[(*it)->fOffset1], fRealHeap[(*it)->fOffset2]));
+                        push_real(it, std::remainder(fRealHeap[it->fOffset1], fRealHeap[it->fOffset2]));
                         dispatch_next();
                     }
                     
                     do_kRemIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] % fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] % fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     // Shift operation
                     do_kLshIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] << fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] << fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kRshIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] >> fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] >> fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     // Comparaison Int
                     do_kGTIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] > fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] > fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kLTIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] < fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] < fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kGEIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] >= fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] >= fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kLEIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] <= fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] <= fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kEQIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] == fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] == fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kNEIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] != fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] != fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     // Comparaison Real
                     do_kGTRealHeap:
                     {
-                        push_int(fRealHeap[(*it)->fOffset1] > fRealHeap[(*it)->fOffset2]);
+                        push_int(fRealHeap[it->fOffset1] > fRealHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kLTRealHeap:
                     {
-                        push_int(fRealHeap[(*it)->fOffset1] < fRealHeap[(*it)->fOffset2]);
+                        push_int(fRealHeap[it->fOffset1] < fRealHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kGERealHeap:
                     {
-                        push_int(fRealHeap[(*it)->fOffset1] >= fRealHeap[(*it)->fOffset2]);
+                        push_int(fRealHeap[it->fOffset1] >= fRealHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kLERealHeap:
                     {
-                        push_int(fRealHeap[(*it)->fOffset1] <= fRealHeap[(*it)->fOffset2]);
+                        push_int(fRealHeap[it->fOffset1] <= fRealHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kEQRealHeap:
                     {
-                        push_int(fRealHeap[(*it)->fOffset1] == fRealHeap[(*it)->fOffset2]);
+                        push_int(fRealHeap[it->fOffset1] == fRealHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kNERealHeap:
                     {
-                        push_int(fRealHeap[(*it)->fOffset1] != fRealHeap[(*it)->fOffset2]);
+                        push_int(fRealHeap[it->fOffset1] != fRealHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     // Logical operations
                     do_kANDIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] & fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] & fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kORIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] | fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] | fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
                     do_kXORIntHeap:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] ^ fIntHeap[(*it)->fOffset2]);
+                        push_int(fIntHeap[it->fOffset1] ^ fIntHeap[it->fOffset2]);
                         dispatch_next();
                     }
                     
@@ -1216,70 +1572,70 @@ class FIRInterpreter  {
                     do_kAddRealStack:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, fRealHeap[(*it)->fOffset1] + v1);
+                        push_real(it, fRealHeap[it->fOffset1] + v1);
                         dispatch_next();
                     }
                     
                     do_kAddIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] + v1);
+                        push_int(fIntHeap[it->fOffset1] + v1);
                         dispatch_next();
                     }
                     
                     do_kSubRealStack:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, fRealHeap[(*it)->fOffset1] - v1);
+                        push_real(it, fRealHeap[it->fOffset1] - v1);
                         dispatch_next();
                     }
                     
                     do_kSubIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] - v1);
+                        push_int(fIntHeap[it->fOffset1] - v1);
                         dispatch_next();
                     }
                     
                     do_kMultRealStack:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, fRealHeap[(*it)->fOffset1] * v1);
+                        push_real(it, fRealHeap[it->fOffset1] * v1);
                         dispatch_next();
                     }
                     
                     do_kMultIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] * v1);
+                        push_int(fIntHeap[it->fOffset1] * v1);
                         dispatch_next();
                     }
                     
                     do_kDivRealStack:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, fRealHeap[(*it)->fOffset1] / v1);
+                        push_real(it, fRealHeap[it->fOffset1] / v1);
                         dispatch_next();
                     }
                     
                     do_kDivIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] / v1);
+                        push_int(fIntHeap[it->fOffset1] / v1);
                         dispatch_next();
                     }
                     
                     do_kRemRealStack:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::remainder(fRealHeap[(*it)->fOffset1], v1));
+                        push_real(it, std::remainder(fRealHeap[it->fOffset1], v1));
                         dispatch_next();
                     }
                     
                     do_kRemIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] % v1);
+                        push_int(fIntHeap[it->fOffset1] % v1);
                         dispatch_next();
                     }
                     
@@ -1287,14 +1643,14 @@ class FIRInterpreter  {
                     do_kLshIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] << v1);
+                        push_int(fIntHeap[it->fOffset1] << v1);
                         dispatch_next();
                     }
                     
                     do_kRshIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] >> v1);
+                        push_int(fIntHeap[it->fOffset1] >> v1);
                         dispatch_next();
                     }
                     
@@ -1302,42 +1658,42 @@ class FIRInterpreter  {
                     do_kGTIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] > v1);
+                        push_int(fIntHeap[it->fOffset1] > v1);
                         dispatch_next();
                     }
                     
                     do_kLTIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] < v1);
+                        push_int(fIntHeap[it->fOffset1] < v1);
                         dispatch_next();
                     }
                     
                     do_kGEIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] >= v1);
+                        push_int(fIntHeap[it->fOffset1] >= v1);
                         dispatch_next();
                     }
                     
                     do_kLEIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] <= v1);
+                        push_int(fIntHeap[it->fOffset1] <= v1);
                         dispatch_next();
                     }
                     
                     do_kEQIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] == v1);
+                        push_int(fIntHeap[it->fOffset1] == v1);
                         dispatch_next();
                     }
                     
                     do_kNEIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] != v1);
+                        push_int(fIntHeap[it->fOffset1] != v1);
                         dispatch_next();
                     }
                     
@@ -1345,42 +1701,42 @@ class FIRInterpreter  {
                     do_kGTRealStack:
                     {
                         T v1 = pop_real(it);
-                        push_int(fRealHeap[(*it)->fOffset1] > v1);
+                        push_int(fRealHeap[it->fOffset1] > v1);
                         dispatch_next();
                     }
                     
                     do_kLTRealStack:
                     {
                         T v1 = pop_real(it);
-                        push_int(fRealHeap[(*it)->fOffset1] < v1);
+                        push_int(fRealHeap[it->fOffset1] < v1);
                         dispatch_next();
                     }
                     
                     do_kGERealStack:
                     {
                         T v1 = pop_real(it);
-                        push_int(fRealHeap[(*it)->fOffset1] >= v1);
+                        push_int(fRealHeap[it->fOffset1] >= v1);
                         dispatch_next();
                     }
                     
                     do_kLERealStack:
                     {
                         T v1 = pop_real(it);
-                        push_int(fRealHeap[(*it)->fOffset1] <= v1);
+                        push_int(fRealHeap[it->fOffset1] <= v1);
                         dispatch_next();
                     }
                     
                     do_kEQRealStack:
                     {
                         T v1 = pop_real(it);
-                        push_int(fRealHeap[(*it)->fOffset1] == v1);
+                        push_int(fRealHeap[it->fOffset1] == v1);
                         dispatch_next();
                     }
                     
                     do_kNERealStack:
                     {
                         T v1 = pop_real(it);
-                        push_int(fRealHeap[(*it)->fOffset1] != v1);
+                        push_int(fRealHeap[it->fOffset1] != v1);
                         dispatch_next();
                     }
                     
@@ -1388,21 +1744,21 @@ class FIRInterpreter  {
                     do_kANDIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] & v1);
+                        push_int(fIntHeap[it->fOffset1] & v1);
                         dispatch_next();
                     }
                     
                     do_kORIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] | v1);
+                        push_int(fIntHeap[it->fOffset1] | v1);
                         dispatch_next();
                     }
                     
                     do_kXORIntStack:
                     {
                         int v1 = pop_int();
-                        push_int(fIntHeap[(*it)->fOffset1] ^ v1);
+                        push_int(fIntHeap[it->fOffset1] ^ v1);
                         dispatch_next();
                     }
                     
@@ -1413,70 +1769,70 @@ class FIRInterpreter  {
                     do_kAddRealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, (*it)->fRealValue + v1);
+                        push_real(it, it->fRealValue + v1);
                         dispatch_next();
                     }
                     
                     do_kAddIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue + v1);
+                        push_int(it->fIntValue + v1);
                         dispatch_next();
                     }
                     
                     do_kSubRealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, (*it)->fRealValue - v1);
+                        push_real(it, it->fRealValue - v1);
                         dispatch_next();
                     }
                     
                     do_kSubIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue - v1);
+                        push_int(it->fIntValue - v1);
                         dispatch_next();
                     }
                     
                     do_kMultRealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, (*it)->fRealValue * v1);
+                        push_real(it, it->fRealValue * v1);
                         dispatch_next();
                     }
                     
                     do_kMultIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue * v1);
+                        push_int(it->fIntValue * v1);
                         dispatch_next();
                     }
                     
                     do_kDivRealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, (*it)->fRealValue / v1);
+                        push_real(it, it->fRealValue / v1);
                         dispatch_next();
                     }
                     
                     do_kDivIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue / v1);
+                        push_int(it->fIntValue / v1);
                         dispatch_next();
                     }
                     
                     do_kRemRealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::remainder((*it)->fRealValue, v1));
+                        push_real(it, std::remainder(it->fRealValue, v1));
                         dispatch_next();
                     }
                     
                     do_kRemIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue % v1);
+                        push_int(it->fIntValue % v1);
                         dispatch_next();
                     }
                     
@@ -1484,14 +1840,14 @@ class FIRInterpreter  {
                     do_kLshIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue << v1);
+                        push_int(it->fIntValue << v1);
                         dispatch_next();
                     }
                     
                     do_kRshIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue >> v1);
+                        push_int(it->fIntValue >> v1);
                         dispatch_next();
                     }
                     
@@ -1499,42 +1855,42 @@ class FIRInterpreter  {
                     do_kGTIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue > v1);
+                        push_int(it->fIntValue > v1);
                         dispatch_next();
                     }
                     
                     do_kLTIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue < v1);
+                        push_int(it->fIntValue < v1);
                         dispatch_next();
                     }
                     
                     do_kGEIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue >= v1);
+                        push_int(it->fIntValue >= v1);
                         dispatch_next();
                     }
                     
                     do_kLEIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue <= v1);
+                        push_int(it->fIntValue <= v1);
                         dispatch_next();
                     }
                     
                     do_kEQIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue == v1);
+                        push_int(it->fIntValue == v1);
                         dispatch_next();
                     }
                     
                     do_kNEIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue != v1);
+                        push_int(it->fIntValue != v1);
                         dispatch_next();
                     }
                     
@@ -1542,42 +1898,42 @@ class FIRInterpreter  {
                     do_kGTRealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_int((*it)->fRealValue > v1);
+                        push_int(it->fRealValue > v1);
                         dispatch_next();
                     }
                     
                     do_kLTRealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_int((*it)->fRealValue < v1);
+                        push_int(it->fRealValue < v1);
                         dispatch_next();
                     }
                     
                     do_kGERealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_int((*it)->fRealValue >= v1);
+                        push_int(it->fRealValue >= v1);
                         dispatch_next();
                     }
                     
                     do_kLERealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_int((*it)->fRealValue <= v1);
+                        push_int(it->fRealValue <= v1);
                         dispatch_next();
                     }
                     
                     do_kEQRealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_int((*it)->fRealValue == v1);
+                        push_int(it->fRealValue == v1);
                         dispatch_next();
                     }
                     
                     do_kNERealStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_int((*it)->fRealValue != v1);
+                        push_int(it->fRealValue != v1);
                         dispatch_next();
                     }
                     
@@ -1585,21 +1941,21 @@ class FIRInterpreter  {
                     do_kANDIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue & v1);
+                        push_int(it->fIntValue & v1);
                         dispatch_next();
                     }
                     
                     do_kORIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue | v1);
+                        push_int(it->fIntValue | v1);
                         dispatch_next();
                     }
                     
                     do_kXORIntStackValue:
                     {
                         int v1 = pop_int();
-                        push_int((*it)->fIntValue ^ v1);
+                        push_int(it->fIntValue ^ v1);
                         dispatch_next();
                     }
           
@@ -1609,167 +1965,167 @@ class FIRInterpreter  {
                     
                     do_kAddRealValue:
                     {
-                        push_real(it, (*it)->fRealValue + fRealHeap[(*it)->fOffset1]);
+                        push_real(it, it->fRealValue + fRealHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kAddIntValue:
                     {
-                        push_int((*it)->fIntValue + fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue + fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kSubRealValue:
                     {
-                        push_real(it, (*it)->fRealValue - fRealHeap[(*it)->fOffset1]);
+                        push_real(it, it->fRealValue - fRealHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kSubIntValue:
                     {
-                        push_int((*it)->fIntValue - fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue - fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kMultRealValue:
                     {
-                        push_real(it, (*it)->fRealValue * fRealHeap[(*it)->fOffset1]);
+                        push_real(it, it->fRealValue * fRealHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kMultIntValue:
                     {
-                        push_int((*it)->fIntValue * fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue * fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kDivRealValue:
                     {
-                        push_real(it, (*it)->fRealValue / fRealHeap[(*it)->fOffset1]);
+                        push_real(it, it->fRealValue / fRealHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kDivIntValue:
                     {
-                        push_int((*it)->fIntValue / fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue / fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kRemRealValue:
                     {
-                        push_real(it, std::remainder((*it)->fRealValue, fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::remainder(it->fRealValue, fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
         
                     do_kRemIntValue:
                     {
-                        push_int((*it)->fIntValue % fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue % fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     // Shift operation
                     do_kLshIntValue:
                     {
-                        push_int((*it)->fIntValue << fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue << fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kRshIntValue:
                     {
-                        push_int((*it)->fIntValue >> fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue >> fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     // Comparaison Int
                     do_kGTIntValue:
                     {
-                        push_int((*it)->fIntValue > fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue > fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kLTIntValue:
                     {
-                        push_int((*it)->fIntValue < fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue < fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kGEIntValue:
                     {
-                        push_int((*it)->fIntValue >= fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue >= fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kLEIntValue:
                     {
-                        push_int((*it)->fIntValue <= fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue <= fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kEQIntValue:
                     {
-                        push_int((*it)->fIntValue == fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue == fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kNEIntValue:
                     {
-                        push_int((*it)->fIntValue != fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue != fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     // Comparaison Real
                     do_kGTRealValue:
                     {
-                        push_int((*it)->fRealValue > fRealHeap[(*it)->fOffset1]);
+                        push_int(it->fRealValue > fRealHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kLTRealValue:
                     {
-                        push_int((*it)->fRealValue < fRealHeap[(*it)->fOffset1]);
+                        push_int(it->fRealValue < fRealHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kGERealValue:
                     {
-                        push_int((*it)->fRealValue >= fRealHeap[(*it)->fOffset1]);
+                        push_int(it->fRealValue >= fRealHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kLERealValue:
                     {
-                        push_int((*it)->fRealValue <= fRealHeap[(*it)->fOffset1]);
+                        push_int(it->fRealValue <= fRealHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kEQRealValue:
                     {
-                        push_int((*it)->fRealValue == fRealHeap[(*it)->fOffset1]);
+                        push_int(it->fRealValue == fRealHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kNERealValue:
                     {
-                        push_int((*it)->fRealValue != fRealHeap[(*it)->fOffset1]);
+                        push_int(it->fRealValue != fRealHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     // Logical operations
                     do_kANDIntValue:
                     {
-                        push_int((*it)->fIntValue & fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue & fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kORIntValue:
                     {
-                        push_int((*it)->fIntValue | fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue | fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
                     do_kXORIntValue:
                     {
-                        push_int((*it)->fIntValue ^ fIntHeap[(*it)->fOffset1]);
+                        push_int(it->fIntValue ^ fIntHeap[it->fOffset1]);
                         dispatch_next();
                     }
                     
@@ -1780,100 +2136,100 @@ class FIRInterpreter  {
                     
                     do_kSubRealValueInvert:
                     {
-                        push_real(it, fRealHeap[(*it)->fOffset1] - (*it)->fRealValue);
+                        push_real(it, fRealHeap[it->fOffset1] - it->fRealValue);
                         dispatch_next();
                     }
                     
                     do_kSubIntValueInvert:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] - (*it)->fIntValue);
+                        push_int(fIntHeap[it->fOffset1] - it->fIntValue);
                         dispatch_next();
                     }
                     
                     do_kDivRealValueInvert:
                     {
-                        push_real(it, fRealHeap[(*it)->fOffset1] / (*it)->fRealValue);
+                        push_real(it, fRealHeap[it->fOffset1] / it->fRealValue);
                         dispatch_next();
                     }
                     
                     do_kDivIntValueInvert:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] / (*it)->fIntValue);
+                        push_int(fIntHeap[it->fOffset1] / it->fIntValue);
                         dispatch_next();
                     }
                     
                     do_kRemRealValueInvert:
                     {
-                        push_real(it, std::remainder(fRealHeap[(*it)->fOffset1], (*it)->fRealValue));
+                        push_real(it, std::remainder(fRealHeap[it->fOffset1], it->fRealValue));
                         dispatch_next();
                     }
                     
                     do_kRemIntValueInvert:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] % (*it)->fIntValue);
+                        push_int(fIntHeap[it->fOffset1] % it->fIntValue);
                         dispatch_next();
                     }
                     
                     // Shift operation
                     do_kLshIntValueInvert:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] << (*it)->fIntValue);
+                        push_int(fIntHeap[it->fOffset1] << it->fIntValue);
                         dispatch_next();
                     }
                     
                     do_kRshIntValueInvert:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] >> (*it)->fIntValue);
+                        push_int(fIntHeap[it->fOffset1] >> it->fIntValue);
                         dispatch_next();
                     }
                     
                     // Comparaison Int
                     do_kGTIntValueInvert:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] > (*it)->fIntValue);
+                        push_int(fIntHeap[it->fOffset1] > it->fIntValue);
                         dispatch_next();
                     }
                     
                     do_kLTIntValueInvert:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] < (*it)->fIntValue);
+                        push_int(fIntHeap[it->fOffset1] < it->fIntValue);
                         dispatch_next();
                     }
                     
                     do_kGEIntValueInvert:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] >= (*it)->fIntValue);
+                        push_int(fIntHeap[it->fOffset1] >= it->fIntValue);
                         dispatch_next();
                     }
                     
                     do_kLEIntValueInvert:
                     {
-                        push_int(fIntHeap[(*it)->fOffset1] <= (*it)->fIntValue);
+                        push_int(fIntHeap[it->fOffset1] <= it->fIntValue);
                         dispatch_next();
                     }
                     
                     // Comparaison Real
                     do_kGTRealValueInvert:
                     {
-                        push_int(fRealHeap[(*it)->fOffset1] > (*it)->fRealValue);
+                        push_int(fRealHeap[it->fOffset1] > it->fRealValue);
                         dispatch_next();
                     }
                     
                     do_kLTRealValueInvert:
                     {
-                        push_int(fRealHeap[(*it)->fOffset1] < (*it)->fRealValue);
+                        push_int(fRealHeap[it->fOffset1] < it->fRealValue);
                         dispatch_next();
                     }
                     
                     do_kGERealValueInvert:
                     {
-                        push_int(fRealHeap[(*it)->fOffset1] >= (*it)->fRealValue);
+                        push_int(fRealHeap[it->fOffset1] >= it->fRealValue);
                         dispatch_next();
                     }
                     
                     do_kLERealValueInvert:
                     {
-                        push_int(fRealHeap[(*it)->fOffset1] <= (*it)->fRealValue);
+                        push_int(fRealHeap[it->fOffset1] <= it->fRealValue);
                         dispatch_next();
                     }
            
@@ -2013,109 +2369,109 @@ class FIRInterpreter  {
                     
                     do_kAbsHeap:
                     {
-                        push_int(std::abs(fIntHeap[(*it)->fOffset1]));
+                        push_int(std::abs(fIntHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kAbsfHeap:
                     {
-                        push_real(it, std::fabs(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::fabs(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kAcosfHeap:
                     {
-                        push_real(it, std::acos(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::acos(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kAsinfHeap:
                     {
-                        push_real(it, std::asin(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::asin(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kAtanfHeap:
                     {
-                        push_real(it, std::atan(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::atan(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kCeilfHeap:
                     {
-                        push_real(it, std::ceil(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::ceil(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kCosfHeap:
                     {
-                        push_real(it, std::cos(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::cos(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kCoshfHeap:
                     {
-                        push_real(it, std::cosh(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::cosh(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kExpfHeap:
                     {
-                        push_real(it, std::exp(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::exp(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kFloorfHeap:
                     {
-                        push_real(it, std::floor(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::floor(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kLogfHeap:
                     {
-                        push_real(it, std::log(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::log(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kLog10fHeap:
                     {
-                        push_real(it, std::log10(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::log10(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kRoundfHeap:
                     {
-                        push_real(it, std::round(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::round(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kSinfHeap:
                     {
-                        push_real(it, std::sin(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::sin(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kSinhfHeap:
                     {
-                        push_real(it, std::sinh(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::sinh(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kSqrtfHeap:
                     {
-                        push_real(it, std::sqrt(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::sqrt(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kTanfHeap:
                     {
-                        push_real(it, std::tan(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::tan(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
                     do_kTanhfHeap:
                     {
-                        push_real(it, std::tanh(fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::tanh(fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
           
@@ -2185,43 +2541,43 @@ class FIRInterpreter  {
                     
                     do_kAtan2fHeap:
                     {
-                        push_real(it, std::atan2(fRealHeap[(*it)->fOffset1], fRealHeap[(*it)->fOffset2]));
+                        push_real(it, std::atan2(fRealHeap[it->fOffset1], fRealHeap[it->fOffset2]));
                         dispatch_next();
                     }
 
                     do_kFmodfHeap:
                     {
-                        push_real(it, std::fmod(fRealHeap[(*it)->fOffset1], fRealHeap[(*it)->fOffset2]));
+                        push_real(it, std::fmod(fRealHeap[it->fOffset1], fRealHeap[it->fOffset2]));
                         dispatch_next();
                     }
 
                     do_kPowfHeap:
                     {
-                        push_real(it, std::pow(fRealHeap[(*it)->fOffset1], fRealHeap[(*it)->fOffset2]));
+                        push_real(it, std::pow(fRealHeap[it->fOffset1], fRealHeap[it->fOffset2]));
                         dispatch_next();
                     }
 
                     do_kMaxHeap:
                     {
-                        push_int(std::max(fIntHeap[(*it)->fOffset1], fIntHeap[(*it)->fOffset2]));
+                        push_int(std::max(fIntHeap[it->fOffset1], fIntHeap[it->fOffset2]));
                         dispatch_next();
                     }
 
                     do_kMaxfHeap:
                     {
-                        push_real(it, std::max(fRealHeap[(*it)->fOffset1], fRealHeap[(*it)->fOffset2]));
+                        push_real(it, std::max(fRealHeap[it->fOffset1], fRealHeap[it->fOffset2]));
                         dispatch_next();
                     }
 
                     do_kMinHeap:
                     {
-                        push_int(std::min(fIntHeap[(*it)->fOffset1], fIntHeap[(*it)->fOffset2]));
+                        push_int(std::min(fIntHeap[it->fOffset1], fIntHeap[it->fOffset2]));
                         dispatch_next();
                     }
 
                     do_kMinfHeap:
                     {
-                        push_real(it, std::min(fRealHeap[(*it)->fOffset1], fRealHeap[(*it)->fOffset2]));
+                        push_real(it, std::min(fRealHeap[it->fOffset1], fRealHeap[it->fOffset2]));
                         dispatch_next();
                     }
                     
@@ -2232,49 +2588,49 @@ class FIRInterpreter  {
                     do_kAtan2fStack:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::atan2(fRealHeap[(*it)->fOffset1], v1));
+                        push_real(it, std::atan2(fRealHeap[it->fOffset1], v1));
                         dispatch_next();
                     }
                     
                     do_kFmodfStack:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::fmod(fRealHeap[(*it)->fOffset1], v1));
+                        push_real(it, std::fmod(fRealHeap[it->fOffset1], v1));
                         dispatch_next();
                     }
                     
                     do_kPowfStack:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::pow(fRealHeap[(*it)->fOffset1], v1));
+                        push_real(it, std::pow(fRealHeap[it->fOffset1], v1));
                         dispatch_next();
                     }
                     
                     do_kMaxStack:
                     {
                         int v1 = pop_int();
-                        push_int(std::max(fIntHeap[(*it)->fOffset1], v1));
+                        push_int(std::max(fIntHeap[it->fOffset1], v1));
                         dispatch_next();
                     }
                     
                     do_kMaxfStack:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::max(fRealHeap[(*it)->fOffset1], v1));
+                        push_real(it, std::max(fRealHeap[it->fOffset1], v1));
                         dispatch_next();
                     }
                     
                     do_kMinStack:
                     {
                         int v1 = pop_int();
-                        push_int(std::min(fIntHeap[(*it)->fOffset1], v1));
+                        push_int(std::min(fIntHeap[it->fOffset1], v1));
                         dispatch_next();
                     }
                     
                     do_kMinfStack:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::min(fRealHeap[(*it)->fOffset1], v1));
+                        push_real(it, std::min(fRealHeap[it->fOffset1], v1));
                         dispatch_next();
                     }
                     
@@ -2285,49 +2641,49 @@ class FIRInterpreter  {
                     do_kAtan2fStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::atan2((*it)->fRealValue, v1));
+                        push_real(it, std::atan2(it->fRealValue, v1));
                         dispatch_next();
                     }
                     
                     do_kFmodfStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::fmod((*it)->fRealValue, v1));
+                        push_real(it, std::fmod(it->fRealValue, v1));
                         dispatch_next();
                     }
                     
                     do_kPowfStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::pow((*it)->fRealValue, v1));
+                        push_real(it, std::pow(it->fRealValue, v1));
                         dispatch_next();
                     }
                     
                     do_kMaxStackValue:
                     {
                         int v1 = pop_int();
-                        push_int(std::max((*it)->fIntValue, v1));
+                        push_int(std::max(it->fIntValue, v1));
                         dispatch_next();
                     }
                     
                     do_kMaxfStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::max((*it)->fRealValue, v1));
+                        push_real(it, std::max(it->fRealValue, v1));
                         dispatch_next();
                     }
                     
                     do_kMinStackValue:
                     {
                         int v1 = pop_int();
-                        push_int(std::min((*it)->fIntValue, v1));
+                        push_int(std::min(it->fIntValue, v1));
                         dispatch_next();
                     }
                     
                     do_kMinfStackValue:
                     {
                         T v1 = pop_real(it);
-                        push_real(it, std::min((*it)->fRealValue, v1));
+                        push_real(it, std::min(it->fRealValue, v1));
                         dispatch_next();
                     }
 
@@ -2337,43 +2693,43 @@ class FIRInterpreter  {
 
                     do_kAtan2fValue:
                     {
-                        push_real(it, std::atan2((*it)->fRealValue, fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::atan2(it->fRealValue, fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
 
                     do_kFmodfValue:
                     {
-                        push_real(it, std::fmod((*it)->fRealValue, fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::fmod(it->fRealValue, fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
 
                     do_kPowfValue:
                     {
-                        push_real(it, std::pow((*it)->fRealValue, fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::pow(it->fRealValue, fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
 
                     do_kMaxValue:
                     {
-                        push_int(std::max((*it)->fIntValue, fIntHeap[(*it)->fOffset1]));
+                        push_int(std::max(it->fIntValue, fIntHeap[it->fOffset1]));
                         dispatch_next();
                     }
 
                     do_kMaxfValue:
                     {
-                        push_real(it, std::max((*it)->fRealValue, fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::max(it->fRealValue, fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
 
                     do_kMinValue:
                     {
-                        push_int(std::min((*it)->fIntValue, fIntHeap[(*it)->fOffset1]));
+                        push_int(std::min(it->fIntValue, fIntHeap[it->fOffset1]));
                         dispatch_next();
                     }
 
                     do_kMinfValue:
                     {
-                        push_real(it, std::min((*it)->fRealValue, fRealHeap[(*it)->fOffset1]));
+                        push_real(it, std::min(it->fRealValue, fRealHeap[it->fOffset1]));
                         dispatch_next();
                     }
                     
@@ -2383,19 +2739,88 @@ class FIRInterpreter  {
 
                     do_kAtan2fValueInvert:
                     {
-                        push_real(it, std::atan2(fRealHeap[(*it)->fOffset1], (*it)->fRealValue));
+                        push_real(it, std::atan2(fRealHeap[it->fOffset1], it->fRealValue));
                         dispatch_next();
                     }
 
                     do_kFmodfValueInvert:
                     {
-                        push_real(it, std::fmod(fRealHeap[(*it)->fOffset1], (*it)->fRealValue));
+                        push_real(it, std::fmod(fRealHeap[it->fOffset1], it->fRealValue));
                         dispatch_next();
                     }
 
                     do_kPowfValueInvert:
                     {
-                        push_real(it, std::pow(fRealHeap[(*it)->fOffset1], (*it)->fRealValue));
+                        push_real(it, std::pow(fRealHeap[it->fOffset1], it->fRealValue));
+                        dispatch_next();
+                    }
+
+                    //-----------------
+                    // Fused sequences
+                    //-----------------
+                    
+                    // kMultRealHeap + kAddReal
+                    do_kMultAddRealHeap:
+                    {
+                        T v1 = pop_real(it);
+                        push_real(it, fRealHeap[it->fOffset1] * fRealHeap[it->fOffset2] + v1);
+                        dispatch_next();
+                    }
+                    
+                    // kAddRealStack + kStoreReal
+                    do_kAddRealStackStore:
+                    {
+                        T v1 = pop_real(it);
+                        if (TRACE) {
+                            fRealHeap[assert_real_heap(it, it->fOffset2)] = check_real(it, fRealHeap[it->fOffset1] + v1);
+                        } else {
+                            fRealHeap[it->fOffset2] = fRealHeap[it->fOffset1] + v1;
+                        }
+                        dispatch_next();
+                    }
+                    
+                    // kANDIntStackValue + kLoadIndexedReal
+                    do_kLoadIndexedRealMask:
+                    {
+                        int offset = it->fIntValue & pop_int();
+                        if (TRACE) {
+                            push_real(it, fRealHeap[it->fOffset1 + assert_real_heap(it, offset, it->fOffset2)]);
+                        } else {
+                            push_real(it, fRealHeap[it->fOffset1 + offset]);
+                        }
+                        dispatch_next();
+                    }
+                    
+                    // kLoadInt + kStoreIndexedReal
+                    do_kStoreIndexedRealHeap:
+                    {
+                        if (TRACE) {
+                            fRealHeap[it->fOffset1 + assert_real_heap(it, fIntHeap[it->fIntValue], it->fOffset2)] = pop_real(it);
+                        } else {
+                            fRealHeap[it->fOffset1 + fIntHeap[it->fIntValue]] = pop_real(it);
+                        }
+                        dispatch_next();
+                    }
+                    
+                    // kLoadInt + kLoadInput
+                    do_kLoadInputHeap:
+                    {
+                        if (TRACE) {
+                            push_real(it, fInputs[it->fOffset1][assert_audio_buffer(it, fIntHeap[it->fOffset2])]);
+                        } else {
+                            push_real(it, fInputs[it->fOffset1][fIntHeap[it->fOffset2]]);
+                        }
+                        dispatch_next();
+                    }
+                    
+                    // kLoadInt + kStoreOutput
+                    do_kStoreOutputHeap:
+                    {
+                        if (TRACE) {
+                            fOutputs[it->fOffset1][assert_audio_buffer(it, fIntHeap[it->fOffset2])] = pop_real(it);
+                        } else {
+                            fOutputs[it->fOffset1][fIntHeap[it->fOffset2]] = pop_real(it);
+                        }
                         dispatch_next();
                     }
 
@@ -2420,12 +2845,12 @@ class FIRInterpreter  {
                         
                         if (pop_int()) {
                             // Execute new block
-                            faustassert((*it)->fBranch1);
+                            faustassert(it->fBranch1);
                             dispatch_branch1();
                             // No value (If)
                         } else {
                             // Execute new block
-                            faustassert((*it)->fBranch2);
+                            faustassert(it->fBranch2);
                             dispatch_branch2();
                             // No value (If)
                         }
@@ -2438,12 +2863,12 @@ class FIRInterpreter  {
                         
                         if (pop_int()) {
                             // Execute new block
-                            faustassert((*it)->fBranch1);
+                            faustassert(it->fBranch1);
                             dispatch_branch1();
                             // Real value
                         } else {
                             // Execute new block
-                            faustassert((*it)->fBranch2);
+                            faustassert(it->fBranch2);
                             dispatch_branch2();
                             // Real value
                         }
@@ -2456,12 +2881,12 @@ class FIRInterpreter  {
                         
                         if (pop_int()) {
                             // Execute new block
-                            faustassert((*it)->fBranch1);
+                            faustassert(it->fBranch1);
                             dispatch_branch1();
                             // Int value
                         } else {
                             // Execute new block
-                            faustassert((*it)->fBranch2);
+                            faustassert(it->fBranch2);
                             dispatch_branch2();
                             // Int value
                         }
@@ -2471,7 +2896,7 @@ class FIRInterpreter  {
                     {
                         // If condition is true, just branch back on the block beginning
                         if (pop_int()) {
-                            faustassert((*it)->fBranch1);
+                            faustassert(it->fBranch1);
                             dispatch_branch1();
                         } else {
                             // Just continue after 'loop block'
@@ -2481,17 +2906,31 @@ class FIRInterpreter  {
                     
                     do_kLoop:
                     {
+                        // Independent iterations : execute the vector kernel
+                        if (it->fIntValue >= 0) {
+                            ExecuteKernel(fVectorCompiler->getKernel(it->fIntValue));
+                            dispatch_next();
+                        }
+                        
                         // Keep next instruction
                         save_return();
                         
                         // Push branch2 (loop content)
-                        faustassert((*it)->fBranch2);
+                        faustassert(it->fBranch2);
                         push_branch2();
                         
                         // And start branch1 loop variable declaration block
-                        faustassert((*it)->fBranch1);
+                        faustassert(it->fBranch1);
                         dispatch_branch1();
                     }
+                    
+                    do_kTask:
+                    {
+                        // The group is made of this instruction and the following 'fOffset1 - 1' kTask ones
+                        ExecuteTasks(it, it->fOffset1);
+                        it += it->fOffset1 - 1;
+                        dispatch_next();
+                    }
                 }
                 
                 //printf("END real_stack_index = %d, int_stack_index = %d\n", real_stack_index, int_stack_index);
@@ -2503,6 +2942,560 @@ class FIRInterpreter  {
                 std::cout << e.Message();
             }
         }
+
+        /*
+         Register code execution : operands and results are directly accessed in the instance memory
+         (heap, registers and constants, see interpreter_register.hh). The 'trace' checks of the stack
+         version are not done here.
+        */
+        void ExecuteRegBlock(FIRRegBlockInstruction<T>* block, bool link = false)
+        {
+            static void* fRegDispatchTable[] = {
+                
+                // Memory
+                &&do_reg_kMoveReal, &&do_reg_kMoveInt,
+                &&do_reg_kLoadIndexedReal, &&do_reg_kLoadIndexedInt,
+                &&do_reg_kStoreIndexedReal, &&do_reg_kStoreIndexedInt,
+                &&do_reg_kBlockStoreReal, &&do_reg_kBlockStoreInt,
+                &&do_reg_kPairMoveReal, &&do_reg_kPairMoveInt,
+                &&do_reg_kBlockPairMoveReal, &&do_reg_kBlockPairMoveInt,
+                &&do_reg_kBlockShiftReal, &&do_reg_kBlockShiftInt,
+                &&do_reg_kLoadInput, &&do_reg_kStoreOutput,
+                
+                // Cast/Bitcast
+                &&do_reg_kCastReal, &&do_reg_kCastInt,
+                &&do_reg_kBitcastInt, &&do_reg_kBitcastReal,
+                
+                // Standard math
+                &&do_reg_kAddReal, &&do_reg_kAddInt, &&do_reg_kSubReal, &&do_reg_kSubInt,
+                &&do_reg_kMultReal, &&do_reg_kMultInt, &&do_reg_kDivReal, &&do_reg_kDivInt,
+                &&do_reg_kRemReal, &&do_reg_kRemInt, &&do_reg_kLshInt, &&do_reg_kRshInt, &&do_reg_kGTInt,
+                &&do_reg_kLTInt, &&do_reg_kGEInt, &&do_reg_kLEInt, &&do_reg_kEQInt, &&do_reg_kNEInt,
+                &&do_reg_kGTReal, &&do_reg_kLTReal, &&do_reg_kGEReal,
+                &&do_reg_kLEReal, &&do_reg_kEQReal, &&do_reg_kNEReal,
+                &&do_reg_kANDInt, &&do_reg_kORInt, &&do_reg_kXORInt,
+                
+                // Extended unary math
+                &&do_reg_kAbs, &&do_reg_kAbsf,
+                &&do_reg_kAcosf, &&do_reg_kAsinf,
+                &&do_reg_kAtanf,
+                &&do_reg_kCeilf,
+                &&do_reg_kCosf, &&do_reg_kCoshf,
+                &&do_reg_kExpf,
+                &&do_reg_kFloorf,
+                &&do_reg_kLogf, &&do_reg_kLog10f,
+                &&do_reg_kRoundf,
+                &&do_reg_kSinf, &&do_reg_kSinhf,
+                &&do_reg_kSqrtf,
+                &&do_reg_kTanf, &&do_reg_kTanhf,
+                
+                // Extended binary math
+                &&do_reg_kAtan2f,
+                &&do_reg_kFmodf,
+                &&do_reg_kPowf,
+                &&do_reg_kMax, &&do_reg_kMaxf,
+                &&do_reg_kMin, &&do_reg_kMinf,
+                
+                // Control
+                &&do_reg_kJump, &&do_reg_kCondJump,
+                &&do_reg_kReturn
+            };
+            
+            // Link mode : resolve the computed-goto labels of the register code
+            if (link) {
+                block->link(fRegDispatchTable);
+                return;
+            }
+            
+            #define reg_dispatch_first() { goto *it->fLabel; }
+            #define reg_dispatch_next() { it++; goto *it->fLabel; }
+            #define reg_dispatch_jump() { it += it->fBranch; goto *it->fLabel; }
+            
+            // Check block coherency
+            faustassert(block->fLinked);
+            
+            // Native version of the block
+            if (block->fNativeCode) {
+                reinterpret_cast<typename FIRNativeCompiler<T>::NativeCode>(block->fNativeCode)(fRealHeap, fIntHeap, fInputs, fOutputs);
+                return;
+            }
+            
+            T* real_mem = fRealHeap;
+            int* int_mem = fIntHeap;
+            RegInstructionIT it = &block->fInstructions[0];
+            reg_dispatch_first();
+            
+            while (true) {
+                
+                    // Memory operations
+                    do_reg_kMoveReal:
+                    {
+                        real_mem[it->fDst] = real_mem[it->fSrc1];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kMoveInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kLoadIndexedReal:
+                    {
+                        real_mem[it->fDst] = real_mem[it->fOffset1 + int_mem[it->fSrc1]];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kLoadIndexedInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fOffset1 + int_mem[it->fSrc1]];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kStoreIndexedReal:
+                    {
+                        real_mem[it->fOffset1 + int_mem[it->fSrc1]] = real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kStoreIndexedInt:
+                    {
+                        int_mem[it->fOffset1 + int_mem[it->fSrc1]] = int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kBlockStoreReal:
+                    {
+                        memcpy(&real_mem[it->fOffset1], &real_mem[it->fSrc1], it->fOffset2 * sizeof(T));
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kBlockStoreInt:
+                    {
+                        memcpy(&int_mem[it->fOffset1], &int_mem[it->fSrc1], it->fOffset2 * sizeof(int));
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kPairMoveReal:
+                    {
+                        real_mem[it->fOffset1] = real_mem[it->fOffset1 - 1];
+                        real_mem[it->fOffset2] = real_mem[it->fOffset2 - 1];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kPairMoveInt:
+                    {
+                        int_mem[it->fOffset1] = int_mem[it->fOffset1 - 1];
+                        int_mem[it->fOffset2] = int_mem[it->fOffset2 - 1];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kBlockPairMoveReal:
+                    {
+                        for (int i = it->fOffset1; i < it->fOffset2; i+=2) {
+                            real_mem[i+1] = real_mem[i];
+                        }
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kBlockPairMoveInt:
+                    {
+                        for (int i = it->fOffset1; i < it->fOffset2; i+=2) {
+                            int_mem[i+1] = int_mem[i];
+                        }
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kBlockShiftReal:
+                    {
+                        for (int i = it->fOffset1; i > it->fOffset2; i-=1) {
+                            real_mem[i] = real_mem[i-1];
+                        }
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kBlockShiftInt:
+                    {
+                        for (int i = it->fOffset1; i > it->fOffset2; i-=1) {
+                            int_mem[i] = int_mem[i-1];
+                        }
+                        reg_dispatch_next();
+                    }
+                    
+                    // Input/output access
+                    do_reg_kLoadInput:
+                    {
+                        real_mem[it->fDst] = fInputs[it->fOffset1][int_mem[it->fSrc1]];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kStoreOutput:
+                    {
+                        fOutputs[it->fOffset1][int_mem[it->fSrc1]] = real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    // Cast/bitcast operations
+                    do_reg_kCastReal:
+                    {
+                        real_mem[it->fDst] = T(int_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kCastInt:
+                    {
+                        int_mem[it->fDst] = int(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kBitcastInt:
+                    {
+                        int_mem[it->fDst] = *reinterpret_cast<int*>(&real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kBitcastReal:
+                    {
+                        real_mem[it->fDst] = *reinterpret_cast<T*>(&int_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    // Standard math operations
+                    do_reg_kAddReal:
+                    {
+                        real_mem[it->fDst] = real_mem[it->fSrc1] + real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kAddInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] + int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kSubReal:
+                    {
+                        real_mem[it->fDst] = real_mem[it->fSrc1] - real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kSubInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] - int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kMultReal:
+                    {
+                        real_mem[it->fDst] = real_mem[it->fSrc1] * real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kMultInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] * int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kDivReal:
+                    {
+                        real_mem[it->fDst] = real_mem[it->fSrc1] / real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kDivInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] / int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kRemReal:
+                    {
+                        real_mem[it->fDst] = std::remainder(real_mem[it->fSrc1], real_mem[it->fSrc2]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kRemInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] % int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kLshInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] << int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kRshInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] >> int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kGTInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] > int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kLTInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] < int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kGEInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] >= int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kLEInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] <= int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kEQInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] == int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kNEInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] != int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kGTReal:
+                    {
+                        int_mem[it->fDst] = real_mem[it->fSrc1] > real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kLTReal:
+                    {
+                        int_mem[it->fDst] = real_mem[it->fSrc1] < real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kGEReal:
+                    {
+                        int_mem[it->fDst] = real_mem[it->fSrc1] >= real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kLEReal:
+                    {
+                        int_mem[it->fDst] = real_mem[it->fSrc1] <= real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kEQReal:
+                    {
+                        int_mem[it->fDst] = real_mem[it->fSrc1] == real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kNEReal:
+                    {
+                        int_mem[it->fDst] = real_mem[it->fSrc1] != real_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kANDInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] & int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kORInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] | int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kXORInt:
+                    {
+                        int_mem[it->fDst] = int_mem[it->fSrc1] ^ int_mem[it->fSrc2];
+                        reg_dispatch_next();
+                    }
+                    
+                    // Extended unary math
+                    do_reg_kAbs:
+                    {
+                        int_mem[it->fDst] = std::abs(int_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kAbsf:
+                    {
+                        real_mem[it->fDst] = std::fabs(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kAcosf:
+                    {
+                        real_mem[it->fDst] = std::acos(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kAsinf:
+                    {
+                        real_mem[it->fDst] = std::asin(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kAtanf:
+                    {
+                        real_mem[it->fDst] = std::atan(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kCeilf:
+                    {
+                        real_mem[it->fDst] = std::ceil(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kCosf:
+                    {
+                        real_mem[it->fDst] = std::cos(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kCoshf:
+                    {
+                        real_mem[it->fDst] = std::cosh(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kExpf:
+                    {
+                        real_mem[it->fDst] = std::exp(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kFloorf:
+                    {
+                        real_mem[it->fDst] = std::floor(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kLogf:
+                    {
+                        real_mem[it->fDst] = std::log(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kLog10f:
+                    {
+                        real_mem[it->fDst] = std::log10(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kRoundf:
+                    {
+                        real_mem[it->fDst] = std::round(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kSinf:
+                    {
+                        real_mem[it->fDst] = std::sin(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kSinhf:
+                    {
+                        real_mem[it->fDst] = std::sinh(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kSqrtf:
+                    {
+                        real_mem[it->fDst] = std::sqrt(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kTanf:
+                    {
+                        real_mem[it->fDst] = std::tan(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kTanhf:
+                    {
+                        real_mem[it->fDst] = std::tanh(real_mem[it->fSrc1]);
+                        reg_dispatch_next();
+                    }
+                    
+                    // Extended binary math
+                    do_reg_kAtan2f:
+                    {
+                        real_mem[it->fDst] = std::atan2(real_mem[it->fSrc1], real_mem[it->fSrc2]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kFmodf:
+                    {
+                        real_mem[it->fDst] = std::fmod(real_mem[it->fSrc1], real_mem[it->fSrc2]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kPowf:
+                    {
+                        real_mem[it->fDst] = std::pow(real_mem[it->fSrc1], real_mem[it->fSrc2]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kMax:
+                    {
+                        int_mem[it->fDst] = std::max(int_mem[it->fSrc1], int_mem[it->fSrc2]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kMaxf:
+                    {
+                        real_mem[it->fDst] = std::max(real_mem[it->fSrc1], real_mem[it->fSrc2]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kMin:
+                    {
+                        int_mem[it->fDst] = std::min(int_mem[it->fSrc1], int_mem[it->fSrc2]);
+                        reg_dispatch_next();
+                    }
+                    
+                    do_reg_kMinf:
+                    {
+                        real_mem[it->fDst] = std::min(real_mem[it->fSrc1], real_mem[it->fSrc2]);
+                        reg_dispatch_next();
+                    }
+                    
+                    // Control
+                    do_reg_kJump:
+                    {
+                        reg_dispatch_jump();
+                    }
+                    
+                    do_reg_kCondJump:
+                    {
+                        if (int_mem[it->fSrc1]) {
+                            reg_dispatch_jump();
+                        } else {
+                            reg_dispatch_next();
+                        }
+                    }
+                    
+                    do_reg_kReturn:
+                    {
+                        break;
+                    }
+            }
+        }
   
     
     public:
@@ -2519,17 +3512,28 @@ class FIRInterpreter  {
             
             fFactory = factory;
             
+            // Code has to be prepared first, since register mode needs additional memory
+            fFactory->optimize();
+            int real_memory_size = fFactory->getRealMemorySize();
+            int int_memory_size = fFactory->getIntMemorySize();
+            fVectorCompiler = fFactory->fVectorCompiler;
+            
             if (fFactory->getMemoryManager()) {
-                fRealHeap = static_cast<T*>(fFactory->allocate(sizeof(T) * fFactory->fRealHeapSize));
-                fIntHeap = static_cast<int*>(fFactory->allocate(sizeof(T) * fFactory->fIntHeapSize));
+                fRealHeap = static_cast<T*>(fFactory->allocate(sizeof(T) * real_memory_size));
+                fIntHeap = static_cast<int*>(fFactory->allocate(sizeof(T) * int_memory_size));
             } else {
-                fRealHeap = new T[fFactory->fRealHeapSize];
-                fIntHeap = new int[fFactory->fIntHeapSize];
+                fRealHeap = new T[real_memory_size];
+                fIntHeap = new int[int_memory_size];
             }
             
             // Initialise HEAP with 0
-            memset(fRealHeap, 0, fFactory->fRealHeapSize * sizeof(T));
-            memset(fIntHeap, 0, fFactory->fIntHeapSize * sizeof(int));
+            memset(fRealHeap, 0, real_memory_size * sizeof(T));
+            memset(fIntHeap, 0, int_memory_size * sizeof(int));
+            
+            // Register mode constants
+            if (fFactory->fRegisterCompiler) {
+                fFactory->fRegisterCompiler->initMemory(fRealHeap, fIntHeap);
+            }
             
             // Stack
             fRealStackSize = 512;
@@ -2549,6 +3553,15 @@ class FIRInterpreter  {
             } else {
                 fIntrumentMode = 0;
             }
+            fProfileLast = 0;
+            fProfileOpcode1 = fProfileOpcode2 = -1;
+            if (TRACE && fIntrumentMode >= 5) {
+                const char* period = getenv("FAUST_INTERP_PROFILE_PERIOD");
+                fProfiler = new FIRProfiler<T>((period) ? atoi(period) : 1000);
+            } else {
+                fProfiler = 0;
+            }
+            fTaskPool = 0;
          }
     
         virtual ~FIRInterpreter()
@@ -2563,6 +3576,8 @@ class FIRInterpreter  {
             if (TRACE) {
                 printStats();
             }
+            delete fProfiler;
+            delete fTaskPool;
         }
     
         // Freeze values
@@ -2585,4 +3600,13 @@ class FIRInterpreter  {
  
 };
 
+template <class T, bool TRACE>
+std::map<int, long long> FIRInterpreter<T, TRACE>::gOpcodePairs;
+
+template <class T, bool TRACE>
+std::map<int, long long> FIRInterpreter<T, TRACE>::gOpcodeTriples;
+
+template <class T, bool TRACE>
+long long FIRInterpreter<T, TRACE>::gOpcodeCount = 0;
+
 #endif
@@ -175,6 +175,13 @@ struct FIRInstruction {
         kFmodfValueInvert,
         kPowfValueInvert,
         
+        // Fused sequences, selected by profiling the opcode sequences of the benchmark DSPs (trace mode 4)
+        kMultAddRealHeap,
+        kAddRealStackStore,
+        kLoadIndexedRealMask,
+        kStoreIndexedRealHeap,
+        kLoadInputHeap, kStoreOutputHeap,
+        
         //==========
         // Control
         //==========
@@ -185,6 +192,9 @@ struct FIRInstruction {
         kIf, kSelectReal, kSelectInt,
         kCondBranch,
         
+        // Group of independent tasks (scheduler mode)
+        kTask,
+        
         // User Interface 
         kOpenVerticalBox, kOpenHorizontalBox, kOpenTabBox, kCloseBox,
         kAddButton, kAddCheckButton, 
@@ -206,6 +216,8 @@ struct FIRInstruction {
                 || (opt == kLoadReal)
                 || (opt == kLoadIndexedReal)
                 || (opt == kLoadInput)
+                || (opt == kLoadIndexedRealMask)
+                || (opt == kLoadInputHeap)
         
                 || (opt == kCastReal)
                 || (opt == kBitcastReal)
@@ -217,6 +229,7 @@ struct FIRInstruction {
                 || (opt == kMultReal)
                 || (opt == kDivReal)
                 || (opt == kRemReal)
+                || (opt == kMultAddRealHeap)
         
                 || (opt == kAbsf)
                 || (opt == kAcosf)
@@ -395,6 +408,13 @@ static std::string gFIRInstructionTable[] = {
     "kAtan2fValueInvert",
     "kFmodfValueInvert",
     "kPowfValueInvert",
+    
+    // Fused sequences
+    "kMultAddRealHeap",
+    "kAddRealStackStore",
+    "kLoadIndexedRealMask",
+    "kStoreIndexedRealHeap",
+    "kLoadInputHeap", "kStoreOutputHeap",
 
     //==========
     // Control
@@ -406,6 +426,9 @@ static std::string gFIRInstructionTable[] = {
     // Select/if
     "kIf", "kSelectReal", "kSelectInt",
     "kCondBranch",
+    
+    // Group of independent tasks (scheduler mode)
+    "kTask",
  
     // User Interface
     "kOpenVerticalBox", "kOpenHorizontalBox", "kOpenTabBox", "kCloseBox",
@@ -417,6 +440,6 @@ static std::string gFIRInstructionTable[] = {
     "kNop"
 };
 
-#define INTERP_FILE_VERSION 4
+#define INTERP_FILE_VERSION 6
 
 #endif
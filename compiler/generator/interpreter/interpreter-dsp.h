@@ -197,14 +197,15 @@ std::vector<std::string> getAllInterpreterDSPFactories();
  * the same (reference counted) factory pointer. You will have to explicitly use deleteInterpreterDSPFactory to properly
  * decrement reference counter when the factory is no more needed.
  *
- * @param machine_code - the machine code string
+ * @param machine_code - the machine code string (binary image or textual format)
  *
  * @return the DSP factory on success, otherwise a null pointer.
  */
 interpreter_dsp_factory* readInterpreterDSPFactoryFromMachine(const std::string& machine_code);
 
 /**
- * Write a Faust DSP factory into a machine code string.
+ * Write a Faust DSP factory into a machine code string, as a binary image of the optimized code
+ * that is loaded without any parsing (the image depends on the machine architecture).
  *
  * @param factory - the DSP factory
  *
@@ -218,14 +219,14 @@ std::string writeInterpreterDSPFactoryToMachine(interpreter_dsp_factory* factory
  * the same (reference counted) factory pointer. You will have to explicitly use deleteInterpreterDSPFactory to properly
  * decrement reference counter when the factory is no more needed.
  *
- * @param machine_code_path - the machine code file pathname
+ * @param machine_code_path - the machine code file pathname (binary images are memory mapped)
  *
  * @return the DSP factory on success, otherwise a null pointer.
  */
 interpreter_dsp_factory* readInterpreterDSPFactoryFromMachineFile(const std::string& machine_code_path);
 
 /**
- * Write a Faust DSP factory into a machine code file.
+ * Write a Faust DSP factory into a machine code file, as a binary image of the optimized code.
  *
  * @param factory - the DSP factory
  * @param machine_code_path - the machine code file pathname
@@ -0,0 +1,204 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef _FIR_INTERPRETER_BINARY_H
+#define _FIR_INTERPRETER_BINARY_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <string.h>
+
+#include "exception.hh"
+
+/*
+ Binary image of an interpreter factory : a fixed size header followed by sections (strings, meta and UI items,
+ then the flat code blocks with their tables and the vector kernels) that are all aligned on 8 bytes.
+ Code sections are arrays of the structures used at execution time, so that loading only copies them as a whole
+ (or maps them) and resolves their computed-goto labels. The image is native : the header keeps the endianness
+ and the structure sizes of the writer, and a different layout is rejected.
+*/
+
+#define FIR_BINARY_MAGIC "FAUSTFBC"
+#define FIR_BINARY_ENDIANNESS 0x01020304
+#define FIR_BINARY_ALIGN 8
+
+struct FIRBinaryHeader {
+
+    char fMagic[8];
+    int fEndianness;
+    int fFileVersion;           // INTERP_FILE_VERSION
+    int fRealSize;              // sizeof(T)
+    int fFlatInstructionSize;   // sizeof(FIRFlatInstruction<T>)
+    int fVecInstructionSize;    // sizeof(FIRVecInstruction<T>)
+    int fNumInputs;
+    int fNumOutputs;
+    int fIntHeapSize;
+    int fRealHeapSize;
+    int fSROffset;
+    int fCountOffset;
+    int fIOTAOffset;
+    int fOptLevel;
+    int fNumKernels;
+
+    static bool isBinary(const char* buffer, size_t size)
+    {
+        return (size >= sizeof(FIRBinaryHeader)) && (memcmp(buffer, FIR_BINARY_MAGIC, 8) == 0);
+    }
+
+    // Size of the reals of the image, or 0 if not a binary image
+    static int getRealSize(const char* buffer, size_t size)
+    {
+        if (isBinary(buffer, size)) {
+            FIRBinaryHeader header;
+            memcpy(&header, buffer, sizeof(FIRBinaryHeader));
+            return header.fRealSize;
+        } else {
+            return 0;
+        }
+    }
+
+};
+
+class FIRBinaryWriter {
+
+    private:
+
+        std::ostream* fOut;
+        size_t fPosition;
+
+        void align()
+        {
+            static const char padding[FIR_BINARY_ALIGN] = { 0 };
+            size_t pad = (FIR_BINARY_ALIGN - (fPosition % FIR_BINARY_ALIGN)) % FIR_BINARY_ALIGN;
+            writeBytes(padding, pad);
+        }
+
+    public:
+
+        FIRBinaryWriter(std::ostream* out):fOut(out), fPosition(0)
+        {}
+
+        void writeBytes(const void* data, size_t size)
+        {
+            fOut->write(static_cast<const char*>(data), size);
+            fPosition += size;
+        }
+
+        void writeInt(int value) { writeBytes(&value, sizeof(int)); }
+
+        template <class T>
+        void writeReal(T value) { writeBytes(&value, sizeof(T)); }
+
+        void writeString(const std::string& str)
+        {
+            writeInt(int(str.size()));
+            writeBytes(str.c_str(), str.size());
+            align();
+        }
+
+        // Arrays are prefixed with their number of items, and start on an aligned position
+        template <class ITEM>
+        void writeArray(const std::vector<ITEM>& array)
+        {
+            writeInt(int(array.size()));
+            align();
+            if (array.size() > 0) {
+                writeBytes(&array[0], sizeof(ITEM) * array.size());
+            }
+            align();
+        }
+
+};
+
+class FIRBinaryReader {
+
+    private:
+
+        const char* fBuffer;
+        size_t fSize;
+        size_t fPosition;
+
+        void align()
+        {
+            skip((FIR_BINARY_ALIGN - (fPosition % FIR_BINARY_ALIGN)) % FIR_BINARY_ALIGN);
+        }
+
+        void skip(size_t size)
+        {
+            if (size > fSize - fPosition) {
+                throw faustexception("ERROR : truncated interpreter binary image\n");
+            }
+            fPosition += size;
+        }
+
+    public:
+
+        FIRBinaryReader(const char* buffer, size_t size):fBuffer(buffer), fSize(size), fPosition(0)
+        {}
+
+        const char* readBytes(size_t size)
+        {
+            const char* data = fBuffer + fPosition;
+            skip(size);
+            return data;
+        }
+
+        int readInt()
+        {
+            int value;
+            memcpy(&value, readBytes(sizeof(int)), sizeof(int));
+            return value;
+        }
+
+        template <class T>
+        T readReal()
+        {
+            T value;
+            memcpy(&value, readBytes(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        std::string readString()
+        {
+            int size = readInt();
+            std::string str(readBytes(size), size);
+            align();
+            return str;
+        }
+
+        // Arrays are copied as a whole
+        template <class ITEM>
+        void readArray(std::vector<ITEM>& array)
+        {
+            int size = readInt();
+            if (size < 0) {
+                throw faustexception("ERROR : incorrect interpreter binary image\n");
+            }
+            align();
+            const ITEM* data = reinterpret_cast<const ITEM*>(readBytes(sizeof(ITEM) * size_t(size)));
+            array.assign(data, data + size);
+            align();
+        }
+
+};
+
+#endif
@@ -24,6 +24,7 @@
 
 #include <vector>
 #include <string>
+#include <map>
 #include <math.h>
 #include <iostream>
 
@@ -435,14 +436,19 @@ struct FIRBlockInstruction : public FIRInstruction {
     
     void push(FIRBasicInstruction<T>* inst) { fInstructions.push_back(inst); }
     
+    // Move the instructions of 'block' at the end of this one, then delete 'block'
     void merge(FIRBlockInstruction<T>* block)
     {
         InstructionIT it;
         for (it = block->fInstructions.begin(); it != block->fInstructions.end(); it++) {
             if ((*it)->fOpcode != FIRInstruction::kReturn) { // kReturn must be removed...
                 fInstructions.push_back(*it);
+            } else {
+                delete (*it);
             }
         }
+        block->fInstructions.clear();
+        delete block;
     }
     
     virtual void write(std::ostream* out, bool binary, bool small = false)
@@ -497,4 +503,129 @@ struct FIRBlockInstruction : public FIRInstruction {
     bool isRealInst() { return isRealType(fInstructions.back()->fOpcode); }
 };
 
+/*
+ Flat bytecode : the tree of blocks produced by the compiler (and rewritten by the optimizer) is laid out
+ as a single contiguous array of fixed-size instructions. Sub-blocks are appended after their parent block,
+ branches are encoded as offsets relative to the branching instruction, the values of kBlockStoreReal/kBlockStoreInt
+ instructions are moved in shared tables, and the computed-goto label of each instruction is resolved once
+ at load time (see 'link').
+*/
+
+template <class T>
+struct FIRFlatInstruction {
+    
+    void* fLabel;       // Computed-goto label, resolved by 'link'
+    FIRInstruction::Opcode fOpcode;
+    int fIntValue;      // Also index in the block tables for kBlockStoreReal/kBlockStoreInt, or index of the vector kernel of kLoop (-1 if none)
+    T fRealValue;
+    int fOffset1;
+    int fOffset2;
+    int fBranch1;       // Relative offset of the first branch (or loop start for kCondBranch)
+    int fBranch2;       // Relative offset of the second branch
+    
+    void write(std::ostream* out)
+    {
+        *out << "opcode " << fOpcode << " "
+        << gFIRInstructionTable[fOpcode]
+        << " int " << fIntValue
+        << " real " << fRealValue
+        << " offset1 " << fOffset1
+        << " offset2 " << fOffset2
+        << " branch1 " << fBranch1
+        << " branch2 " << fBranch2
+        << std::endl;
+    }
+    
+};
+
+#define FlatInstructionIT FIRFlatInstruction<T>*
+
+template <class T>
+struct FIRFlatBlockInstruction {
+    
+    std::vector<FIRFlatInstruction<T> > fInstructions;
+    std::vector<T> fRealTable;
+    std::vector<int> fIntTable;
+    std::map<FIRBlockInstruction<T>*, int> fBlockStart;   // Start index of each laid out block
+    bool fLinked;
+    bool fHasTasks;     // Contains kTask instructions (known once linked)
+    
+    FIRFlatBlockInstruction(FIRBlockInstruction<T>* block):fLinked(false), fHasTasks(false)
+    {
+        flatten(block);
+    }
+    
+    // Empty block, filled from a binary image
+    FIRFlatBlockInstruction():fLinked(false), fHasTasks(false)
+    {}
+    
+    // Lay out 'block' at the end of the array, then its sub-blocks, and return its start index
+    int flatten(FIRBlockInstruction<T>* block)
+    {
+        int start = int(fInstructions.size());
+        fBlockStart[block] = start;
+        fInstructions.resize(start + block->fInstructions.size());
+        
+        for (size_t i = 0; i < block->fInstructions.size(); i++) {
+            FIRBasicInstruction<T>* inst = block->fInstructions[i];
+            int index = start + int(i);
+            
+            FIRFlatInstruction<T> flat;
+            flat.fLabel = 0;
+            flat.fOpcode = inst->fOpcode;
+            flat.fIntValue = inst->fIntValue;
+            flat.fRealValue = inst->fRealValue;
+            flat.fOffset1 = inst->fOffset1;
+            flat.fOffset2 = inst->fOffset2;
+            flat.fBranch1 = 0;
+            flat.fBranch2 = 0;
+            
+            if (inst->fOpcode == FIRInstruction::kBlockStoreReal) {
+                FIRBlockStoreRealInstruction<T>* store = static_cast<FIRBlockStoreRealInstruction<T>*>(inst);
+                flat.fIntValue = int(fRealTable.size());
+                fRealTable.insert(fRealTable.end(), store->fNumTable.begin(), store->fNumTable.end());
+            } else if (inst->fOpcode == FIRInstruction::kBlockStoreInt) {
+                FIRBlockStoreIntInstruction<T>* store = static_cast<FIRBlockStoreIntInstruction<T>*>(inst);
+                flat.fIntValue = int(fIntTable.size());
+                fIntTable.insert(fIntTable.end(), store->fNumTable.begin(), store->fNumTable.end());
+            } else if (inst->fOpcode == FIRInstruction::kCondBranch) {
+                // Loop back on an already laid out block (the loop block itself)
+                faustassert(fBlockStart.find(inst->fBranch1) != fBlockStart.end());
+                flat.fBranch1 = fBlockStart[inst->fBranch1] - index;
+            } else {
+                // 'flatten' may grow the array, so only use indexes here
+                if (inst->fBranch1) { flat.fBranch1 = flatten(inst->fBranch1) - index; }
+                if (inst->fBranch2) { flat.fBranch2 = flatten(inst->fBranch2) - index; }
+                // No vector kernel by default (see FIRVectorCompiler)
+                if (inst->fOpcode == FIRInstruction::kLoop) { flat.fIntValue = -1; }
+            }
+            
+            fInstructions[index] = flat;
+        }
+        
+        return start;
+    }
+    
+    // Resolve computed-goto labels using the interpreter dispatch table
+    void link(void** dispatch_table)
+    {
+        for (size_t i = 0; i < fInstructions.size(); i++) {
+            fInstructions[i].fLabel = dispatch_table[fInstructions[i].fOpcode];
+            fHasTasks |= (fInstructions[i].fOpcode == FIRInstruction::kTask);
+        }
+        fLinked = true;
+    }
+    
+    void write(std::ostream* out)
+    {
+        *out << "flat_block_size " << fInstructions.size() << std::endl;
+        for (size_t i = 0; i < fInstructions.size(); i++) {
+            fInstructions[i].write(out);
+        }
+    }
+    
+    int size() { return int(fInstructions.size()); }
+    
+};
+
 #endif
@@ -42,7 +42,7 @@ Interpreter backend description:
  TODO: in -mem mode, classInit and classDestroy will have to be called once at factory init and destroy time (after global memory allocation is implemented)
 */
 
-template <class T> map <string, FIRInstruction::Opcode> InterpreterInstVisitor<T>::gMathLibTable;
+template <class T> thread_local map <string, FIRInstruction::Opcode> InterpreterInstVisitor<T>::gMathLibTable;
 
 template <class T>
 static FIRBlockInstruction<T>* getCurrentBlock()
@@ -101,9 +101,9 @@ CodeContainer* InterpreterCodeContainer<T>::createContainer(const string& name,
     if (gGlobal->gOpenMPSwitch) {
         throw faustexception("ERROR : OpenMP not supported for Interpreter\n");
     } else if (gGlobal->gSchedulerSwitch) {
-        throw faustexception("ERROR : Scheduler mode not supported for Interpreter\n");
+        container = new InterpreterSchedulerCodeContainer<T>(name, numInputs, numOutputs);
     } else if (gGlobal->gVectorSwitch) {
-        throw faustexception("ERROR : Vector mode not supported for Interpreter\n");
+        container = new InterpreterVectorCodeContainer<T>(name, numInputs, numOutputs);
     } else {
         container = new InterpreterScalarCodeContainer<T>(name, numInputs, numOutputs, kInt);
     }
@@ -123,6 +123,61 @@ template <class T>
 InterpreterScalarCodeContainer<T>::~InterpreterScalarCodeContainer()
 {}
 
+// Vector
+template <class T>
+InterpreterVectorCodeContainer<T>::InterpreterVectorCodeContainer(const string& name, int numInputs, int numOutputs)
+    :VectorCodeContainer(numInputs, numOutputs), InterpreterCodeContainer<T>(name, numInputs, numOutputs)
+{
+    // No array on stack, move all of them in struct
+    gGlobal->gMachineMaxStackSize = -1;
+}
+
+template <class T>
+InterpreterVectorCodeContainer<T>::~InterpreterVectorCodeContainer()
+{}
+
+template <class T>
+dsp_factory_base* InterpreterVectorCodeContainer<T>::produceFactory()
+{
+    // Rewrite accesses done with pointers
+    InterpreterPointerRewriter rewriter;
+    rewriter.collect(fDeclarationInstructions);
+    rewriter.collect(fInitInstructions);
+    rewriter.collect(fComputeBlockInstructions);
+    rewriter.collect(fDAGBlock);
+    fDeclarationInstructions = static_cast<BlockInst*>(fDeclarationInstructions->clone(&rewriter));
+    fInitInstructions = static_cast<BlockInst*>(fInitInstructions->clone(&rewriter));
+    fComputeBlockInstructions = static_cast<BlockInst*>(fComputeBlockInstructions->clone(&rewriter));
+    fDAGBlock = static_cast<BlockInst*>(fDAGBlock->clone(&rewriter));
+    
+    return InterpreterCodeContainer<T>::produceFactory();
+}
+
+// Scheduler
+template <class T>
+void InterpreterSchedulerCodeContainer<T>::generateDAGLoop(BlockInst* block, DeclareVarInst* count)
+{
+    int loop_num = 0;
+    lclgraph G;
+    CodeLoop::sortGraph(this->fCurLoop, G);
+    
+    for (int l = G.size() - 1; l >= 0; l--) {
+        if (G[l].size() == 1) {
+            this->generateDAGLoopAux(*G[l].begin(), block, count, loop_num++);
+        } else {
+            // One task per loop
+            BlockInst* tasks = InstBuilder::genBlockInst();
+            tasks->pushBackInst(InstBuilder::genLabelInst(INTERP_TASKS_LABEL));
+            for (lclset::const_iterator p = G[l].begin(); p != G[l].end(); p++) {
+                BlockInst* task = InstBuilder::genBlockInst();
+                this->generateDAGLoopAux(*p, task, count, loop_num++);
+                tasks->pushBackInst(task);
+            }
+            block->pushBackInst(tasks);
+        }
+    }
+}
+
 template <class T>
 void InterpreterCodeContainer<T>::produceInternal()
 {
@@ -143,6 +198,9 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
     generateGlobalDeclarations(gGlobal->gInterpreterVisitor);
     generateDeclarations(gGlobal->gInterpreterVisitor);
     
+    // Keep "count" offset, since the name may be reused by local variables in compute (like in vector mode)
+    int count_offset = getInterpreterVisitor<T>()->getFieldOffset("count");
+    
     // After field declaration...
     generateSubContainers();
     
@@ -178,10 +236,8 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
     FIRBlockInstruction<T>* compute_control_block = getCurrentBlock<T>();
     setCurrentBlock<T>(new FIRBlockInstruction<T>);
 
-    // Generate one single scalar loop
-    ForLoopInst* loop = fCurLoop->generateScalarLoop(fFullCount);
-    
-    loop->accept(gGlobal->gInterpreterVisitor);
+    // Generate DSP loop
+    generateComputeDSP()->accept(gGlobal->gInterpreterVisitor);
     FIRBlockInstruction<T>* compute_dsp_block = getCurrentBlock<T>();
     
     // Generate metadata block and name
@@ -191,14 +247,14 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
     // Then create factory
     const char* trace = getenv("FAUST_INTERP_TRACE");
     if (trace && strcasecmp(trace, "on") == 0) {
-        return new interpreter_dsp_factory_aux<T, true>(name, "",
+        interpreter_dsp_factory_aux<T, true>* factory = new interpreter_dsp_factory_aux<T, true>(name, "",
                                                       gGlobal->gReader.listSrcFiles(),
                                                       INTERP_FILE_VERSION,
                                                       fNumInputs, fNumOutputs,
                                                       getInterpreterVisitor<T>()->fIntHeapOffset,
                                                       getInterpreterVisitor<T>()->fRealHeapOffset,
                                                       getInterpreterVisitor<T>()->getFieldOffset("fSamplingFreq"),
-                                                      getInterpreterVisitor<T>()->getFieldOffset("count"),
+                                                      count_offset,
                                                       getInterpreterVisitor<T>()->getFieldOffset("IOTA"),
                                                       INTER_MAX_OPT_LEVEL,
                                                       metadata_block,
@@ -208,16 +264,21 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
                                                       resetui_block,
                                                       clear_block,
                                                       compute_control_block,
-                                                      compute_dsp_block);
+                                                      compute_dsp_block,
+                                                      gGlobal->gInterpRegisterMode,
+                                                      gGlobal->gInterpNativeMode,
+                                                      gGlobal->gInterpSpecializeBuffers);
+        getInterpreterVisitor<T>()->getHeapNames(factory->fHeapNames);
+        return factory;
     } else {
-        return new interpreter_dsp_factory_aux<T, false>(name, "",
+        interpreter_dsp_factory_aux<T, false>* factory = new interpreter_dsp_factory_aux<T, false>(name, "",
                                                         gGlobal->gReader.listSrcFiles(),
                                                         INTERP_FILE_VERSION,
                                                         fNumInputs, fNumOutputs,
                                                         getInterpreterVisitor<T>()->fIntHeapOffset,
                                                         getInterpreterVisitor<T>()->fRealHeapOffset,
                                                         getInterpreterVisitor<T>()->getFieldOffset("fSamplingFreq"),
-                                                        getInterpreterVisitor<T>()->getFieldOffset("count"),
+                                                        count_offset,
                                                         getInterpreterVisitor<T>()->getFieldOffset("IOTA"),
                                                         INTER_MAX_OPT_LEVEL,
                                                         metadata_block,
@@ -227,7 +288,12 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
                                                         resetui_block,
                                                         clear_block,
                                                         compute_control_block,
-                                                        compute_dsp_block);
+                                                        compute_dsp_block,
+                                                        gGlobal->gInterpRegisterMode,
+                                                        gGlobal->gInterpNativeMode,
+                                                        gGlobal->gInterpSpecializeBuffers);
+        getInterpreterVisitor<T>()->getHeapNames(factory->fHeapNames);
+        return factory;
     }
 }
 
@@ -23,6 +23,7 @@
 #define _INTERPRETER_CODE_CONTAINER_H
 
 #include "code_container.hh"
+#include "vec_code_container.hh"
 #include "interpreter_dsp_aux.hh"
 #include "interpreter_instructions.hh"
 #include "instructions_compiler.hh"
@@ -44,6 +45,16 @@ class InterpreterCodeContainer : public virtual CodeContainer {
             if (!fGeneratedSR) {
                 pushDeclare(InstBuilder::genDecStructVar("fSamplingFreq", InstBuilder::genBasicTyped(Typed::kInt32)));
             }
+            // The rate is directly stored in the heap, unless instances always run at a fixed rate
+            if (gGlobal->gFixedSampleRate > 0) {
+                pushFrontInitMethod(InstBuilder::genStoreStructVar("fSamplingFreq", InstBuilder::genInt32NumInst(gGlobal->gFixedSampleRate)));
+            }
+        }
+    
+        // Returns the statement that computes the DSP samples
+        virtual StatementInst* generateComputeDSP()
+        {
+            return fCurLoop->generateScalarLoop(fFullCount);
         }
 
     public:
@@ -76,6 +87,128 @@ class InterpreterScalarCodeContainer : public InterpreterCodeContainer<T> {
 
 };
 
+template <class T>
+class InterpreterVectorCodeContainer : public VectorCodeContainer, public InterpreterCodeContainer<T> {
+
+    protected:
+    
+        virtual StatementInst* generateComputeDSP()
+        {
+            return this->fDAGBlock;
+        }
+
+    public:
+
+        InterpreterVectorCodeContainer(const string& name, int numInputs, int numOutputs);
+        virtual ~InterpreterVectorCodeContainer();
+    
+        virtual dsp_factory_base* produceFactory();
+
+};
+
+/*
+ Scheduler mode (-sch) : vector code where the loops of a same level of the loop graph, that do not depend
+ on each other, are grouped in a block of tasks (INTERP_TASKS_LABEL), compiled as kTask instructions
+ and executed in parallel by the instance workers (see FIRTaskPool).
+*/
+template <class T>
+class InterpreterSchedulerCodeContainer : public InterpreterVectorCodeContainer<T> {
+
+    protected:
+    
+        virtual void generateDAGLoop(BlockInst* loop_code, DeclareVarInst* count);
+
+    public:
+
+        InterpreterSchedulerCodeContainer(const string& name, int numInputs, int numOutputs)
+            :InterpreterVectorCodeContainer<T>(name, numInputs, numOutputs)
+        {}
+        virtual ~InterpreterSchedulerCodeContainer()
+        {}
+
+};
+
+/*
+ The interpreter has no pointer arithmetic : pointers used in vector mode, like 'fInput0 = &fInput0_ptr[index]'
+ or 'fRec0 = &fRec0_tmp[4]', are removed, and accesses like 'fRec0[i]' are rewritten as 'fRec0_tmp[4 + i]'.
+ Inputs/outputs are finally accessed as 'input0[index + i]' to be compiled with kLoadInput/kStoreOutput instructions.
+*/
+struct InterpreterPointerRewriter : public BasicCloneVisitor {
+    
+    // Table : pointer_name, address it points to
+    map<string, IndexedAddress*> fPointerTable;
+    
+    struct PointerCollector : public DispatchVisitor {
+        
+        map<string, IndexedAddress*>& fPointerTable;
+        
+        PointerCollector(map<string, IndexedAddress*>& table):fPointerTable(table)
+        {}
+        
+        void collect(Address* address, ValueInst* value)
+        {
+            LoadVarAddressInst* pointer = dynamic_cast<LoadVarAddressInst*>(value);
+            IndexedAddress* indexed = (pointer) ? dynamic_cast<IndexedAddress*>(pointer->fAddress) : NULL;
+            if (indexed) {
+                fPointerTable[address->getName()] = indexed;
+            }
+        }
+        
+        virtual void visit(DeclareVarInst* inst)
+        {
+            collect(inst->fAddress, inst->fValue);
+            DispatchVisitor::visit(inst);
+        }
+        
+        virtual void visit(StoreVarInst* inst)
+        {
+            collect(inst->fAddress, inst->fValue);
+            DispatchVisitor::visit(inst);
+        }
+    };
+    
+    void collect(BlockInst* block)
+    {
+        PointerCollector collector(fPointerTable);
+        block->accept(&collector);
+    }
+    
+    bool isPointer(const string& name)
+    {
+        return (fPointerTable.find(name) != fPointerTable.end()) || startWith(name, "fInput") || startWith(name, "fOutput");
+    }
+    
+    virtual StatementInst* visit(DeclareVarInst* inst)
+    {
+        return (isPointer(inst->fAddress->getName())) ? InstBuilder::genDropInst() : BasicCloneVisitor::visit(inst);
+    }
+    
+    virtual StatementInst* visit(StoreVarInst* inst)
+    {
+        return (dynamic_cast<NamedAddress*>(inst->fAddress) && isPointer(inst->fAddress->getName()))
+            ? InstBuilder::genDropInst() : BasicCloneVisitor::visit(inst);
+    }
+    
+    virtual Address* visit(IndexedAddress* indexed)
+    {
+        string name = indexed->getName();
+        string num;
+        if (fPointerTable.find(name) != fPointerTable.end()) {
+            IndexedAddress* pointed = fPointerTable[name];
+            return visit(InstBuilder::genIndexedAddress(pointed->fAddress, InstBuilder::genAdd(pointed->fIndex, indexed->fIndex)));
+        } else if (startWithRes(name, "fInput", num)) {
+            return InstBuilder::genIndexedAddress(InstBuilder::genNamedAddress("input" + num.substr(0, num.find("_ptr")), Address::kStack),
+                                                  indexed->fIndex->clone(this));
+        } else if (startWithRes(name, "fOutput", num)) {
+            return InstBuilder::genIndexedAddress(InstBuilder::genNamedAddress("output" + num.substr(0, num.find("_ptr")), Address::kStack),
+                                                  indexed->fIndex->clone(this));
+        } else {
+            return BasicCloneVisitor::visit(indexed);
+        }
+    }
+    
+};
+
 class InterpreterInstructionsCompiler : public virtual InstructionsCompiler {
 
     public:
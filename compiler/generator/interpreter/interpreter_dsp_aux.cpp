@@ -25,6 +25,13 @@
 #include "Text.hh"
 #include "libfaust.h"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 typedef class faust_smartptr<interpreter_dsp_factory> SDsp_factory;
@@ -80,12 +87,10 @@ EXPORT interpreter_dsp_factory* createInterpreterDSPFactoryFromString(const stri
         
         argv1[argc1] = 0;  // NULL terminated argv
         
-        dsp_factory_table<SDsp_factory>::factory_iterator it;
+        SDsp_factory sfactory;
         interpreter_dsp_factory* factory = 0;
         
-        if (gInterpreterFactoryTable.getFactory(sha_key, it)) {
-            SDsp_factory sfactory = (*it).first;
-            sfactory->addReference();
+        if (gInterpreterFactoryTable.getFactory(sha_key, sfactory)) {
             return sfactory;
         } else  {
             dsp_factory_base* dsp_factory_aux = compileFaustFactory(argc1, argv1,
@@ -96,9 +101,9 @@ EXPORT interpreter_dsp_factory* createInterpreterDSPFactoryFromString(const stri
             if (dsp_factory_aux) {
                 dsp_factory_aux->setName(name_app);
                 factory = new interpreter_dsp_factory(dsp_factory_aux);
-                gInterpreterFactoryTable.setFactory(factory);
                 factory->setSHAKey(sha_key);
                 factory->setDSPCode(expanded_dsp_content);
+                gInterpreterFactoryTable.setFactory(factory);
                 return factory;
             } else {
                 return NULL;
@@ -198,15 +203,43 @@ static interpreter_dsp_factory* readInterpreterDSPFactoryFromMachineAux(std::ist
     }
 }
 
+static interpreter_dsp_factory* readInterpreterDSPFactoryFromMachineBinary(const char* buffer, size_t size)
+{
+    try {
+        int real_size = FIRBinaryHeader::getRealSize(buffer, size);
+        dsp_factory_base* factory_aux = 0;
+        
+        if (real_size == sizeof(float)) {
+            factory_aux = interpreter_dsp_factory_aux<float, false>::readBinary(buffer, size);
+        } else if (real_size == sizeof(double)) {
+            factory_aux = interpreter_dsp_factory_aux<double, false>::readBinary(buffer, size);
+        } else {
+            faustassert(false);
+        }
+        
+        if (!factory_aux) return NULL;
+        interpreter_dsp_factory* factory = new interpreter_dsp_factory(factory_aux);
+        gInterpreterFactoryTable.setFactory(factory);
+        return factory;
+    } catch (faustexception& e) {
+        std::cerr << "Exception in readInterpreterDSPFactoryFromMachineBinary: " << e.Message();
+        return NULL;
+    }
+}
+
 EXPORT interpreter_dsp_factory* readInterpreterDSPFactoryFromMachine(const string& machine_code)
 {
-    stringstream reader(machine_code);
-    return readInterpreterDSPFactoryFromMachineAux(&reader);
+    if (FIRBinaryHeader::isBinary(machine_code.data(), machine_code.size())) {
+        return readInterpreterDSPFactoryFromMachineBinary(machine_code.data(), machine_code.size());
+    } else {
+        stringstream reader(machine_code);
+        return readInterpreterDSPFactoryFromMachineAux(&reader);
+    }
 }
 
 EXPORT string writeInterpreterDSPFactoryToMachine(interpreter_dsp_factory* factory)
 {
-    stringstream writer;
+    stringstream writer(stringstream::out|stringstream::binary);
     factory->write(&writer, true);
     return writer.str();
 }
@@ -217,10 +250,36 @@ EXPORT interpreter_dsp_factory* readInterpreterDSPFactoryFromMachineFile(const s
     size_t pos = machine_code_path.find(".fbc");
     
     if (pos != string::npos) {
+    #ifndef _WIN32
+        // Binary images are mapped and directly copied from the mapping
+        int fd = open(machine_code_path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat st;
+            interpreter_dsp_factory* factory = 0;
+            bool binary = false;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* buffer = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (buffer != MAP_FAILED) {
+                    binary = FIRBinaryHeader::isBinary(static_cast<const char*>(buffer), st.st_size);
+                    if (binary) {
+                        factory = readInterpreterDSPFactoryFromMachineBinary(static_cast<const char*>(buffer), st.st_size);
+                    }
+                    munmap(buffer, st.st_size);
+                }
+            }
+            close(fd);
+            if (binary) return factory;
+        }
+    #endif
         //ifstream reader(machine_code_path);
-        ifstream reader(machine_code_path.c_str());
+        ifstream reader(machine_code_path.c_str(), ifstream::in|ifstream::binary);
         if (reader.is_open()) {
+        #ifdef _WIN32
+            string machine_code((istreambuf_iterator<char>(reader)), istreambuf_iterator<char>());
+            return readInterpreterDSPFactoryFromMachine(machine_code);
+        #else
             return readInterpreterDSPFactoryFromMachineAux(&reader);
+        #endif
         } else {
             std::cerr << "Error opening file '" << machine_code_path << "'" << std::endl;
             return NULL;
@@ -233,7 +292,7 @@ EXPORT interpreter_dsp_factory* readInterpreterDSPFactoryFromMachineFile(const s
 
 EXPORT void writeInterpreterDSPFactoryToMachineFile(interpreter_dsp_factory* factory, const string& machine_code_path)
 {
-    ofstream writer(machine_code_path.c_str());
+    ofstream writer(machine_code_path.c_str(), ofstream::out|ofstream::binary);
     factory->write(&writer, true);
 }
 
@@ -265,16 +324,19 @@ int EXPORT interpreter_dsp::getNumOutputs()
 EXPORT void interpreter_dsp::init(int samplingRate)
 {
     fDSP->init(samplingRate);
+    dsp_factory_base::checkSampleRate(samplingRate, fDSP->getSampleRate());
 }
 
 EXPORT void interpreter_dsp::instanceInit(int samplingRate)
 {
     fDSP->instanceInit(samplingRate);
+    dsp_factory_base::checkSampleRate(samplingRate, fDSP->getSampleRate());
 }
 
 EXPORT void interpreter_dsp::instanceConstants(int samplingRate)
 {
     fDSP->instanceConstants(samplingRate);
+    dsp_factory_base::checkSampleRate(samplingRate, fDSP->getSampleRate());
 }
 
 EXPORT void interpreter_dsp::instanceResetUserInterface()
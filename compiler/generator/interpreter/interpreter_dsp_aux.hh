@@ -28,6 +28,9 @@
 #include <limits>
 #include <sstream>
 #include <fstream>
+#include <vector>
+#include <set>
+#include <algorithm>
 #include <stdlib.h>
 
 #include "faust/dsp/dsp.h"
@@ -37,8 +40,10 @@
 #include "fir_interpreter.hh"
 #include "interpreter_bytecode.hh"
 #include "interpreter_optimizer.hh"
+#include "interpreter_binary.hh"
 #include "dsp_aux.hh"
 #include "dsp_factory.hh"
+#include "TMutex.h"
 
 class interpreter_dsp_factory;
 
@@ -60,6 +65,11 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
     int fOptLevel;
     
     bool fOptimized;
+    bool fRegisterMode;
+    
+    // Instances can be created concurrently : the code is prepared and linked once, with this lock held
+    TLockAble fPrepareLock;
+    bool fNativeMode;
     
     FIRMetaBlockInstruction* fMetaBlock;
     FIRUserInterfaceBlockInstruction<T>* fUserInterfaceBlock;
@@ -70,6 +80,41 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
     FIRBlockInstruction<T>* fComputeBlock;
     FIRBlockInstruction<T>* fComputeDSPBlock;
     
+    // Flat versions of the code blocks, the ones actually executed
+    FIRFlatBlockInstruction<T>* fStaticInitFlatBlock;
+    FIRFlatBlockInstruction<T>* fInitFlatBlock;
+    FIRFlatBlockInstruction<T>* fResetUIFlatBlock;
+    FIRFlatBlockInstruction<T>* fClearFlatBlock;
+    FIRFlatBlockInstruction<T>* fComputeFlatBlock;
+    FIRFlatBlockInstruction<T>* fComputeDSPFlatBlock;
+    
+    // Register versions of the code blocks (owned by fRegisterCompiler), executed instead of the flat ones in register mode
+    FIRRegisterCompiler<T>* fRegisterCompiler;
+    FIRRegBlockInstruction<T>* fStaticInitRegBlock;
+    FIRRegBlockInstruction<T>* fInitRegBlock;
+    FIRRegBlockInstruction<T>* fResetUIRegBlock;
+    FIRRegBlockInstruction<T>* fClearRegBlock;
+    FIRRegBlockInstruction<T>* fComputeRegBlock;
+    FIRRegBlockInstruction<T>* fComputeDSPRegBlock;
+    
+    // Native versions of the register blocks (owned by fNativeCompiler)
+    FIRNativeCompiler<T>* fNativeCompiler;
+    
+    // Loops of the flat blocks executed as vector kernels
+    FIRVectorCompiler<T>* fVectorCompiler;
+    
+    // Automatic specialization of the instances for their stable controls (when fSpecializeBuffers > 0) :
+    // compute blocks at optimization level 1 and heap locations that they read but never write
+    int fSpecializeBuffers;
+    FIRBlockInstruction<T>* fSpecializeComputeBlock;
+    FIRBlockInstruction<T>* fSpecializeComputeDSPBlock;
+    std::vector<int> fSpecializeControls;       // Real offsets of the controls
+    std::vector<int> fSpecializeRealConstants;  // Real offsets only changed by the init functions
+    std::vector<int> fSpecializeIntConstants;   // Int offsets only changed by the init functions
+    
+    // Names of the heap fields, used by the sampling profiler (trace mode 5)
+    FIRHeapNames fHeapNames;
+    
     interpreter_dsp_factory_aux(const std::string& name,
                                 const std::string& sha_key,
                                 const std::vector<std::string>& pathname_list,
@@ -87,7 +132,10 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
                                 FIRBlockInstruction<T>* resetui,
                                 FIRBlockInstruction<T>* clear,
                                 FIRBlockInstruction<T>* compute_control,
-                                FIRBlockInstruction<T>* compute_dsp)
+                                FIRBlockInstruction<T>* compute_dsp,
+                                bool register_mode = false,
+                                bool native_mode = false,
+                                int specialize_buffers = 0)
     :dsp_factory_imp(name, sha_key, "", pathname_list),
     fVersion(version_num),
     fNumInputs(inputs),
@@ -99,6 +147,8 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
     fIOTAOffset(iota_offset),
     fOptLevel(opt_level),
     fOptimized(false),
+    fRegisterMode(register_mode || native_mode),
+    fNativeMode(native_mode),
     fMetaBlock(meta),
     fUserInterfaceBlock(interface),
     fStaticInitBlock(static_init),
@@ -106,7 +156,25 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
     fResetUIBlock(resetui),
     fClearBlock(clear),
     fComputeBlock(compute_control),
-    fComputeDSPBlock(compute_dsp)
+    fComputeDSPBlock(compute_dsp),
+    fStaticInitFlatBlock(0),
+    fInitFlatBlock(0),
+    fResetUIFlatBlock(0),
+    fClearFlatBlock(0),
+    fComputeFlatBlock(0),
+    fComputeDSPFlatBlock(0),
+    fRegisterCompiler(0),
+    fStaticInitRegBlock(0),
+    fInitRegBlock(0),
+    fResetUIRegBlock(0),
+    fClearRegBlock(0),
+    fComputeRegBlock(0),
+    fComputeDSPRegBlock(0),
+    fNativeCompiler(0),
+    fVectorCompiler(0),
+    fSpecializeBuffers(specialize_buffers),
+    fSpecializeComputeBlock(0),
+    fSpecializeComputeDSPBlock(0)
     {}
     
     virtual ~interpreter_dsp_factory_aux()
@@ -120,26 +188,189 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
         delete fClearBlock;
         delete fComputeBlock;
         delete fComputeDSPBlock;
+        
+        delete fStaticInitFlatBlock;
+        delete fInitFlatBlock;
+        delete fResetUIFlatBlock;
+        delete fClearFlatBlock;
+        delete fComputeFlatBlock;
+        delete fComputeDSPFlatBlock;
+        delete fVectorCompiler;
+        
+        delete fSpecializeComputeBlock;
+        delete fSpecializeComputeDSPBlock;
+        
+        deleteRegisterCode();
+    }
+    
+    void deleteRegisterCode()
+    {
+        delete fNativeCompiler;
+        fNativeCompiler = 0;
+        delete fRegisterCompiler;
+        fRegisterCompiler = 0;
+        fStaticInitRegBlock = fInitRegBlock = fResetUIRegBlock = 0;
+        fClearRegBlock = fComputeRegBlock = fComputeDSPRegBlock = 0;
+    }
+    
+    // Keep what the instances need to specialize their compute code (stack code only)
+    void prepareSpecialization()
+    {
+        fSpecializeComputeBlock = FIRInstructionOptimizer<T>::optimizeBlock(fComputeBlock->copy(), 1, 1);
+        fSpecializeComputeDSPBlock = FIRInstructionOptimizer<T>::optimizeBlock(fComputeDSPBlock->copy(), 1, 1);
+        
+        std::vector<int> real_loads(fRealHeapSize), int_loads(fIntHeapSize);
+        std::vector<int> real_stores(fRealHeapSize), int_stores(fIntHeapSize);
+        FIRInstructionOptimizer<T>::countHeapAccesses(fSpecializeComputeBlock, real_loads, int_loads, real_stores, int_stores);
+        FIRInstructionOptimizer<T>::countHeapAccesses(fSpecializeComputeDSPBlock, real_loads, int_loads, real_stores, int_stores);
+        
+        std::set<int> controls;
+        for (size_t i = 0; i < fUserInterfaceBlock->fInstructions.size(); i++) {
+            FIRUserInterfaceInstruction<T>* item = fUserInterfaceBlock->fInstructions[i];
+            if (item->fOpcode == FIRInstruction::kAddButton
+                || item->fOpcode == FIRInstruction::kAddCheckButton
+                || item->fOpcode == FIRInstruction::kAddHorizontalSlider
+                || item->fOpcode == FIRInstruction::kAddVerticalSlider
+                || item->fOpcode == FIRInstruction::kAddNumEntry) {
+                controls.insert(item->fOffset);
+            }
+        }
+        
+        for (int offset = 0; offset < fRealHeapSize; offset++) {
+            if (real_loads[offset] > 0 && real_stores[offset] == 0) {
+                if (controls.find(offset) != controls.end()) {
+                    fSpecializeControls.push_back(offset);
+                } else {
+                    fSpecializeRealConstants.push_back(offset);
+                }
+            }
+        }
+        // 'count' is set before each compute
+        for (int offset = 0; offset < fIntHeapSize; offset++) {
+            if (int_loads[offset] > 0 && int_stores[offset] == 0 && offset != fCountOffset) {
+                fSpecializeIntConstants.push_back(offset);
+            }
+        }
     }
     
     void optimize()
     {
+        TLock lock(&fPrepareLock);
         if (!fOptimized) {
             fOptimized = true;
-            // Bytecode optimization
+            if (fSpecializeBuffers > 0 && !fRegisterMode && !TRACE) {
+                prepareSpecialization();
+            }
+            // Bytecode optimization : register code directly uses heap and constant operands,
+            // so the 'heap/value' rewriting of levels 5 and 6 is not needed in register mode
+            int opt_level = (fRegisterMode) ? std::min(fOptLevel, 4) : fOptLevel;
         #ifndef INTERPRETER_TRACE
-            fStaticInitBlock = FIRInstructionOptimizer<T>::optimizeBlock(fStaticInitBlock, 1, fOptLevel);
-            fInitBlock = FIRInstructionOptimizer<T>::optimizeBlock(fInitBlock, 1, fOptLevel);
-            fResetUIBlock = FIRInstructionOptimizer<T>::optimizeBlock(fResetUIBlock, 1, fOptLevel);
-            fClearBlock = FIRInstructionOptimizer<T>::optimizeBlock(fClearBlock, 1, fOptLevel);
-            fComputeBlock = FIRInstructionOptimizer<T>::optimizeBlock(fComputeBlock, 1, fOptLevel);
-            fComputeDSPBlock = FIRInstructionOptimizer<T>::optimizeBlock(fComputeDSPBlock, 1, fOptLevel);
+            fStaticInitBlock = FIRInstructionOptimizer<T>::optimizeBlock(fStaticInitBlock, 1, opt_level);
+            fInitBlock = FIRInstructionOptimizer<T>::optimizeBlock(fInitBlock, 1, opt_level);
+            fResetUIBlock = FIRInstructionOptimizer<T>::optimizeBlock(fResetUIBlock, 1, opt_level);
+            fClearBlock = FIRInstructionOptimizer<T>::optimizeBlock(fClearBlock, 1, opt_level);
+            fComputeBlock = FIRInstructionOptimizer<T>::optimizeBlock(fComputeBlock, 1, opt_level);
+            fComputeDSPBlock = FIRInstructionOptimizer<T>::optimizeBlock(fComputeDSPBlock, 1, opt_level);
         #endif
+            if (fRegisterMode) {
+                // Translation in register code, sharing a single memory layout
+                try {
+                    fRegisterCompiler = new FIRRegisterCompiler<T>(fRealHeapSize, fIntHeapSize);
+                    fStaticInitRegBlock = fRegisterCompiler->compile(fStaticInitBlock);
+                    fInitRegBlock = fRegisterCompiler->compile(fInitBlock);
+                    fResetUIRegBlock = fRegisterCompiler->compile(fResetUIBlock);
+                    fClearRegBlock = fRegisterCompiler->compile(fClearBlock);
+                    fComputeRegBlock = fRegisterCompiler->compile(fComputeBlock);
+                    fComputeDSPRegBlock = fRegisterCompiler->compile(fComputeDSPBlock);
+                    fRegisterCompiler->finalize();
+                } catch (faustexception& e) {
+                    // Keep executing the stack code
+                    std::cerr << e.Message() << "WARNING : register mode is not used" << std::endl;
+                    deleteRegisterCode();
+                    fRegisterMode = false;
+                #ifndef INTERPRETER_TRACE
+                    // With the stack code levels, that also remove values left on the stack
+                    fStaticInitBlock = FIRInstructionOptimizer<T>::optimizeBlock(fStaticInitBlock, 5, fOptLevel);
+                    fInitBlock = FIRInstructionOptimizer<T>::optimizeBlock(fInitBlock, 5, fOptLevel);
+                    fResetUIBlock = FIRInstructionOptimizer<T>::optimizeBlock(fResetUIBlock, 5, fOptLevel);
+                    fClearBlock = FIRInstructionOptimizer<T>::optimizeBlock(fClearBlock, 5, fOptLevel);
+                    fComputeBlock = FIRInstructionOptimizer<T>::optimizeBlock(fComputeBlock, 5, fOptLevel);
+                    fComputeDSPBlock = FIRInstructionOptimizer<T>::optimizeBlock(fComputeDSPBlock, 5, fOptLevel);
+                #endif
+                }
+            }
+            if (fRegisterMode && fNativeMode && !TRACE) {
+                // Machine code stitched from the register code
+                FIRRegBlockInstruction<T>* blocks[] = { fStaticInitRegBlock, fInitRegBlock, fResetUIRegBlock,
+                                                        fClearRegBlock, fComputeRegBlock, fComputeDSPRegBlock };
+                try {
+                    fNativeCompiler = new FIRNativeCompiler<T>();
+                    for (int i = 0; i < 6; i++) {
+                        blocks[i]->fNativeCode = (void*)fNativeCompiler->compile(blocks[i]);
+                    }
+                } catch (faustexception& e) {
+                    // Keep executing the register code
+                    std::cerr << e.Message() << "WARNING : native code is not used" << std::endl;
+                    for (int i = 0; i < 6; i++) {
+                        blocks[i]->fNativeCode = 0;
+                    }
+                    delete fNativeCompiler;
+                    fNativeCompiler = 0;
+                }
+            }
+            if (!fRegisterMode) {
+                // Contiguous layout of the final code
+                fStaticInitFlatBlock = new FIRFlatBlockInstruction<T>(fStaticInitBlock);
+                fInitFlatBlock = new FIRFlatBlockInstruction<T>(fInitBlock);
+                fResetUIFlatBlock = new FIRFlatBlockInstruction<T>(fResetUIBlock);
+                fClearFlatBlock = new FIRFlatBlockInstruction<T>(fClearBlock);
+                fComputeFlatBlock = new FIRFlatBlockInstruction<T>(fComputeBlock);
+                fComputeDSPFlatBlock = new FIRFlatBlockInstruction<T>(fComputeDSPBlock);
+                
+                // Loops with independent iterations (no runtime checks in trace mode)
+                if (!TRACE) {
+                    fVectorCompiler = new FIRVectorCompiler<T>();
+                    fVectorCompiler->compile(fStaticInitBlock, fStaticInitFlatBlock);
+                    fVectorCompiler->compile(fInitBlock, fInitFlatBlock);
+                    fVectorCompiler->compile(fResetUIBlock, fResetUIFlatBlock);
+                    fVectorCompiler->compile(fClearBlock, fClearFlatBlock);
+                    fVectorCompiler->compile(fComputeBlock, fComputeFlatBlock);
+                    fVectorCompiler->compile(fComputeDSPBlock, fComputeDSPFlatBlock);
+                }
+            }
+        }
+    }
+    
+    // Size of the instance memories (heap, and registers/constants in register mode or vector registers)
+    int getRealMemorySize()
+    {
+        if (fRegisterCompiler) {
+            return fRegisterCompiler->getRealMemorySize();
+        } else {
+            return fRealHeapSize + ((fVectorCompiler) ? fVectorCompiler->getRealMemorySize() : 0);
+        }
+    }
+    int getIntMemorySize()
+    {
+        if (fRegisterCompiler) {
+            return fRegisterCompiler->getIntMemorySize();
+        } else {
+            return fIntHeapSize + ((fVectorCompiler) ? fVectorCompiler->getIntMemorySize() : 0);
         }
     }
     
     void write(std::ostream* out, bool binary = false, bool small = false)
     {
+        if (binary) {
+            writeBinary(out);
+            return;
+        }
+        
+        // A factory read from a binary image only keeps the flat code
+        if (!fComputeDSPBlock) {
+            throw faustexception("ERROR : textual format not available for an interpreter factory read from a binary image\n");
+        }
+        
         *out << std::setprecision(std::numeric_limits<T>::max_digits10);
         
         if (small) {
@@ -357,6 +588,223 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
                                                compute_dsp_block);
     }
     
+    // Binary image of the final code (see interpreter_binary.hh)
+    void writeBinary(std::ostream* out)
+    {
+        optimize();
+        
+        FIRFlatBlockInstruction<T>* blocks[] = { fStaticInitFlatBlock, fInitFlatBlock, fResetUIFlatBlock,
+                                                 fClearFlatBlock, fComputeFlatBlock, fComputeDSPFlatBlock };
+        FIRVectorCompiler<T>* vector_compiler = fVectorCompiler;
+        
+        // Register code is not kept in the image : the stack code of the factory is laid out instead
+        bool register_mode = (fStaticInitFlatBlock == 0);
+        if (register_mode) {
+            FIRBlockInstruction<T>* code[] = { fStaticInitBlock, fInitBlock, fResetUIBlock,
+                                               fClearBlock, fComputeBlock, fComputeDSPBlock };
+            vector_compiler = (TRACE) ? 0 : new FIRVectorCompiler<T>();
+            for (int i = 0; i < 6; i++) {
+                blocks[i] = new FIRFlatBlockInstruction<T>(code[i]);
+                if (vector_compiler) { vector_compiler->compile(code[i], blocks[i]); }
+            }
+        }
+        
+        FIRBinaryHeader header;
+        memset(&header, 0, sizeof(FIRBinaryHeader));
+        memcpy(header.fMagic, FIR_BINARY_MAGIC, 8);
+        header.fEndianness = FIR_BINARY_ENDIANNESS;
+        header.fFileVersion = INTERP_FILE_VERSION;
+        header.fRealSize = sizeof(T);
+        header.fFlatInstructionSize = sizeof(FIRFlatInstruction<T>);
+        header.fVecInstructionSize = sizeof(FIRVecInstruction<T>);
+        header.fNumInputs = fNumInputs;
+        header.fNumOutputs = fNumOutputs;
+        header.fIntHeapSize = fIntHeapSize;
+        header.fRealHeapSize = fRealHeapSize;
+        header.fSROffset = fSROffset;
+        header.fCountOffset = fCountOffset;
+        header.fIOTAOffset = fIOTAOffset;
+        header.fOptLevel = fOptLevel;
+        header.fNumKernels = (vector_compiler) ? vector_compiler->size() : 0;
+        
+        FIRBinaryWriter writer(out);
+        writer.writeBytes(&header, sizeof(FIRBinaryHeader));
+        writer.writeString(FAUSTVERSION);
+        writer.writeString(fName);
+        writer.writeString(fSHAKey);
+        
+        writer.writeInt(int(fMetaBlock->fInstructions.size()));
+        for (size_t i = 0; i < fMetaBlock->fInstructions.size(); i++) {
+            writer.writeString(fMetaBlock->fInstructions[i]->fKey);
+            writer.writeString(fMetaBlock->fInstructions[i]->fValue);
+        }
+        
+        writer.writeInt(int(fUserInterfaceBlock->fInstructions.size()));
+        for (size_t i = 0; i < fUserInterfaceBlock->fInstructions.size(); i++) {
+            FIRUserInterfaceInstruction<T>* item = fUserInterfaceBlock->fInstructions[i];
+            writer.writeInt(item->fOpcode);
+            writer.writeInt(item->fOffset);
+            writer.writeReal(item->fInit);
+            writer.writeReal(item->fMin);
+            writer.writeReal(item->fMax);
+            writer.writeReal(item->fStep);
+            writer.writeString(item->fLabel);
+            writer.writeString(item->fKey);
+            writer.writeString(item->fValue);
+        }
+        
+        for (int i = 0; i < 6; i++) {
+            // Labels are resolved at load time, and padding is cleared for the image to be reproducible
+            std::vector<FIRFlatInstruction<T> > code(blocks[i]->fInstructions.size());
+            if (code.size() > 0) { memset(&code[0], 0, sizeof(FIRFlatInstruction<T>) * code.size()); }
+            for (size_t j = 0; j < code.size(); j++) {
+                FIRFlatInstruction<T>& inst = blocks[i]->fInstructions[j];
+                code[j].fOpcode = inst.fOpcode;
+                code[j].fIntValue = inst.fIntValue;
+                code[j].fRealValue = inst.fRealValue;
+                code[j].fOffset1 = inst.fOffset1;
+                code[j].fOffset2 = inst.fOffset2;
+                code[j].fBranch1 = inst.fBranch1;
+                code[j].fBranch2 = inst.fBranch2;
+            }
+            writer.writeArray(code);
+            writer.writeArray(blocks[i]->fRealTable);
+            writer.writeArray(blocks[i]->fIntTable);
+        }
+        
+        for (int i = 0; i < header.fNumKernels; i++) {
+            FIRVectorKernel<T>* kernel = vector_compiler->getKernel(i);
+            writer.writeInt(kernel->fLoopOffset);
+            writer.writeInt(kernel->fStart);
+            writer.writeInt(kernel->fEndOffset);
+            writer.writeInt(kernel->fEndValue);
+            writer.writeInt(kernel->fRealRegisters);
+            writer.writeInt(kernel->fIntRegisters);
+            writer.writeArray(kernel->fInvariants);
+            writer.writeArray(kernel->fInstructions);
+        }
+        
+        if (register_mode) {
+            for (int i = 0; i < 6; i++) {
+                delete blocks[i];
+            }
+            delete vector_compiler;
+        }
+    }
+    
+    // Factory reader (binary image) : the code is ready to be executed once its labels are resolved
+    static interpreter_dsp_factory_aux<T, TRACE>* readBinary(const char* buffer, size_t size)
+    {
+        FIRBinaryReader reader(buffer, size);
+        
+        FIRBinaryHeader header;
+        memcpy(&header, reader.readBytes(sizeof(FIRBinaryHeader)), sizeof(FIRBinaryHeader));
+        
+        if (header.fFileVersion != INTERP_FILE_VERSION) {
+            std::cerr << "Interpreter file format version '" << header.fFileVersion
+            << "' different from compiled one '" << INTERP_FILE_VERSION << "'" << std::endl;
+            return 0;
+        }
+        
+        if (header.fEndianness != FIR_BINARY_ENDIANNESS
+            || header.fRealSize != int(sizeof(T))
+            || header.fFlatInstructionSize != int(sizeof(FIRFlatInstruction<T>))
+            || header.fVecInstructionSize != int(sizeof(FIRVecInstruction<T>))) {
+            std::cerr << "Interpreter binary image written on an incompatible architecture" << std::endl;
+            return 0;
+        }
+        
+        reader.readString();    // Faust version
+        std::string name = reader.readString();
+        std::string sha_key = reader.readString();
+        
+        FIRMetaBlockInstruction* meta_block = new FIRMetaBlockInstruction();
+        int meta_size = reader.readInt();
+        for (int i = 0; i < meta_size; i++) {
+            std::string key = reader.readString();
+            std::string value = reader.readString();
+            meta_block->push(new FIRMetaInstruction(key, value));
+        }
+        
+        FIRUserInterfaceBlockInstruction<T>* ui_block = new FIRUserInterfaceBlockInstruction<T>();
+        int ui_size = reader.readInt();
+        for (int i = 0; i < ui_size; i++) {
+            int opcode = reader.readInt();
+            int offset = reader.readInt();
+            T init = reader.readReal<T>();
+            T min = reader.readReal<T>();
+            T max = reader.readReal<T>();
+            T step = reader.readReal<T>();
+            std::string label = reader.readString();
+            std::string key = reader.readString();
+            std::string value = reader.readString();
+            ui_block->push(new FIRUserInterfaceInstruction<T>(FIRInstruction::Opcode(opcode), offset,
+                                                              label, key, value,
+                                                              init, min, max, step));
+        }
+        
+        std::vector<std::string> dummy_list;
+        interpreter_dsp_factory_aux<T, TRACE>* factory = new interpreter_dsp_factory_aux(name,
+                                                                                          sha_key,
+                                                                                          dummy_list,
+                                                                                          header.fFileVersion,
+                                                                                          header.fNumInputs,
+                                                                                          header.fNumOutputs,
+                                                                                          header.fIntHeapSize,
+                                                                                          header.fRealHeapSize,
+                                                                                          header.fSROffset,
+                                                                                          header.fCountOffset,
+                                                                                          header.fIOTAOffset,
+                                                                                          header.fOptLevel,
+                                                                                          meta_block,
+                                                                                          ui_block,
+                                                                                          0, 0, 0, 0, 0, 0);
+        
+        try {
+            FIRFlatBlockInstruction<T>** blocks[] = { &factory->fStaticInitFlatBlock, &factory->fInitFlatBlock,
+                                                      &factory->fResetUIFlatBlock, &factory->fClearFlatBlock,
+                                                      &factory->fComputeFlatBlock, &factory->fComputeDSPFlatBlock };
+            for (int i = 0; i < 6; i++) {
+                FIRFlatBlockInstruction<T>* block = new FIRFlatBlockInstruction<T>();
+                *blocks[i] = block;
+                reader.readArray(block->fInstructions);
+                reader.readArray(block->fRealTable);
+                reader.readArray(block->fIntTable);
+            }
+            
+            factory->fVectorCompiler = new FIRVectorCompiler<T>();
+            for (int i = 0; i < header.fNumKernels; i++) {
+                FIRVectorKernel<T>* kernel = new FIRVectorKernel<T>();
+                factory->fVectorCompiler->addKernel(kernel);
+                kernel->fLoopOffset = reader.readInt();
+                kernel->fStart = reader.readInt();
+                kernel->fEndOffset = reader.readInt();
+                kernel->fEndValue = reader.readInt();
+                kernel->fRealRegisters = reader.readInt();
+                kernel->fIntRegisters = reader.readInt();
+                reader.readArray(kernel->fInvariants);
+                reader.readArray(kernel->fInstructions);
+            }
+            
+            // Vector kernels are not executed in trace mode
+            if (TRACE) {
+                for (int i = 0; i < 6; i++) {
+                    std::vector<FIRFlatInstruction<T> >& code = (*blocks[i])->fInstructions;
+                    for (size_t j = 0; j < code.size(); j++) {
+                        if (code[j].fOpcode == FIRInstruction::kLoop) { code[j].fIntValue = -1; }
+                    }
+                }
+            }
+        } catch (faustexception&) {
+            delete factory;
+            throw;
+        }
+        
+        // Code is already optimized and laid out
+        factory->fOptimized = true;
+        return factory;
+    }
+    
     static std::string parseStringToken(std::stringstream* inst)
     {
         std::string token;
@@ -585,6 +1033,8 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
             } else if (opcode == FIRInstruction::kLoop) {
                 branch1 = readCodeBlock(in);  // consume 'in'
                 branch2 = readCodeBlock(in);  // consume 'in'
+            } else if (opcode == FIRInstruction::kTask) {
+                branch1 = readCodeBlock(in);  // consume 'in'
             }
             
             return new FIRBasicInstruction<T>(FIRInstruction::Opcode(opcode), val_int, val_real, offset1, offset2, branch1, branch2);
@@ -627,6 +1077,10 @@ struct interpreter_dsp_base : public dsp {
     
     virtual void instanceClear() {}
     
+    // Memory of a DSP field given by its name (to move the instance state to another backend, see tiered_dsp) :
+    // returns its address, number of items and items type (0 for int, sizeof(T) for reals), or NULL if unknown
+    virtual void* getField(const std::string& name, int& size, int& type) { return NULL; }
+    
     // Not implemented...
     virtual void compute(int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs) {}
     
@@ -651,6 +1105,133 @@ class interpreter_dsp_aux : public interpreter_dsp_base, public FIRInterpreter<T
         std::map<int, int> fIntMap;
         std::map<int, T> fRealMap;
     
+        // Automatic specialization for the stable controls (see interpreter_dsp_factory_aux::prepareSpecialization)
+        std::vector<T> fControlValues;      // Values of the controls at the previous buffer
+        std::vector<int> fControlStable;    // Number of buffers during which each control has kept its value
+        std::vector<bool> fControlFrozen;   // Controls that are constant in the specialized code
+        int fSpecializeCounter;             // Buffers computed since the specialized code has been dropped
+        FIRFlatBlockInstruction<T>* fSpecializedComputeFlatBlock;
+        FIRFlatBlockInstruction<T>* fSpecializedComputeDSPFlatBlock;
+        FIRVectorCompiler<T>* fSpecializedVectorCompiler;
+    
+        // Execute the register version of the code in register mode, or the flat one
+        inline void ExecuteCode(FIRFlatBlockInstruction<T>* block, FIRRegBlockInstruction<T>* reg_block)
+        {
+            if (reg_block) {
+                this->ExecuteRegBlock(reg_block);
+            } else {
+                this->ExecuteBlock(block);
+            }
+        }
+    
+        // Go back to the generic compute code
+        void deleteSpecialization()
+        {
+            delete fSpecializedComputeFlatBlock;
+            delete fSpecializedComputeDSPFlatBlock;
+            delete fSpecializedVectorCompiler;
+            fSpecializedComputeFlatBlock = 0;
+            fSpecializedComputeDSPFlatBlock = 0;
+            fSpecializedVectorCompiler = 0;
+            this->fVectorCompiler = this->fFactory->fVectorCompiler;
+            fSpecializeCounter = 0;
+            std::fill(fControlFrozen.begin(), fControlFrozen.end(), false);
+        }
+    
+        // Compute code specialized for the current values of the stable controls and of the constants
+        void specialize()
+        {
+            interpreter_dsp_factory_aux<T, TRACE>* factory = this->fFactory;
+            std::map<int, int> int_map;
+            std::map<int, T> real_map;
+            
+            for (size_t i = 0; i < factory->fSpecializeControls.size(); i++) {
+                fControlFrozen[i] = (fControlStable[i] >= factory->fSpecializeBuffers);
+                if (fControlFrozen[i]) {
+                    real_map[factory->fSpecializeControls[i]] = this->fRealHeap[factory->fSpecializeControls[i]];
+                }
+            }
+            for (size_t i = 0; i < factory->fSpecializeRealConstants.size(); i++) {
+                real_map[factory->fSpecializeRealConstants[i]] = this->fRealHeap[factory->fSpecializeRealConstants[i]];
+            }
+            for (size_t i = 0; i < factory->fSpecializeIntConstants.size(); i++) {
+                int_map[factory->fSpecializeIntConstants[i]] = this->fIntHeap[factory->fSpecializeIntConstants[i]];
+            }
+            
+            FIRBlockInstruction<T>* control = factory->fSpecializeComputeBlock->copy();
+            FIRBlockInstruction<T>* dsp = factory->fSpecializeComputeDSPBlock->copy();
+            FIRInstructionOptimizer<T>::specializeCompute(control, dsp, int_map, real_map,
+                                                          factory->fIntHeapSize, factory->fRealHeapSize);
+            control = FIRInstructionOptimizer<T>::optimizeBlock(control, 1, factory->fOptLevel);
+            dsp = FIRInstructionOptimizer<T>::optimizeBlock(dsp, 1, factory->fOptLevel);
+            
+            delete fSpecializedComputeFlatBlock;
+            delete fSpecializedComputeDSPFlatBlock;
+            delete fSpecializedVectorCompiler;
+            fSpecializedComputeFlatBlock = new FIRFlatBlockInstruction<T>(control);
+            fSpecializedComputeDSPFlatBlock = new FIRFlatBlockInstruction<T>(dsp);
+            fSpecializedVectorCompiler = 0;
+            
+            // Vector kernels, when their registers fit in the memory allocated for the factory ones
+            if (factory->fVectorCompiler) {
+                FIRVectorCompiler<T>* compiler = new FIRVectorCompiler<T>();
+                compiler->compile(control, fSpecializedComputeFlatBlock);
+                compiler->compile(dsp, fSpecializedComputeDSPFlatBlock);
+                if (compiler->getRealMemorySize() <= factory->fVectorCompiler->getRealMemorySize()
+                    && compiler->getIntMemorySize() <= factory->fVectorCompiler->getIntMemorySize()) {
+                    fSpecializedVectorCompiler = compiler;
+                } else {
+                    delete compiler;
+                    delete fSpecializedComputeFlatBlock;
+                    delete fSpecializedComputeDSPFlatBlock;
+                    fSpecializedComputeFlatBlock = new FIRFlatBlockInstruction<T>(control);
+                    fSpecializedComputeDSPFlatBlock = new FIRFlatBlockInstruction<T>(dsp);
+                }
+            }
+            delete control;
+            delete dsp;
+            
+            this->ExecuteBlock(fSpecializedComputeFlatBlock, true);
+            this->ExecuteBlock(fSpecializedComputeDSPFlatBlock, true);
+            this->fVectorCompiler = fSpecializedVectorCompiler;
+        }
+    
+        // Follow the controls before each buffer : specialize the code when the generic one has been used for
+        // fSpecializeBuffers buffers, or when more controls become stable, and drop it when a frozen control changes
+        void updateSpecialization()
+        {
+            interpreter_dsp_factory_aux<T, TRACE>* factory = this->fFactory;
+            bool frozen_changed = false;
+            bool stable = false;
+            
+            for (size_t i = 0; i < factory->fSpecializeControls.size(); i++) {
+                T value = this->fRealHeap[factory->fSpecializeControls[i]];
+                if (value == fControlValues[i]) {
+                    if (fControlStable[i] < factory->fSpecializeBuffers && ++fControlStable[i] == factory->fSpecializeBuffers) {
+                        stable = true;
+                    }
+                } else {
+                    fControlValues[i] = value;
+                    fControlStable[i] = 0;
+                    frozen_changed = frozen_changed || fControlFrozen[i];
+                }
+            }
+            
+            if (frozen_changed) {
+                deleteSpecialization();
+            } else if (fSpecializeCounter < factory->fSpecializeBuffers) {
+                fSpecializeCounter++;
+            }
+            
+            if (fSpecializedComputeFlatBlock) {
+                if (stable) {
+                    specialize();
+                }
+            } else if (fSpecializeCounter == factory->fSpecializeBuffers) {
+                specialize();
+            }
+        }
+    
     #ifdef INTERPRETER_TRACE
         bool fInitialized;
     #endif
@@ -668,8 +1249,35 @@ class interpreter_dsp_aux : public interpreter_dsp_base, public FIRInterpreter<T
                 this->fOutputs = new T*[this->fFactory->fNumOutputs];
             }
             
-            // Comment to allow specialization...
-            this->fFactory->optimize();
+            // Resolve the register or flat code labels (only once per factory)
+            {
+                TLock lock(&this->fFactory->fPrepareLock);
+                if (this->fFactory->fRegisterMode) {
+                    if (!this->fFactory->fComputeDSPRegBlock->fLinked) {
+                        this->ExecuteRegBlock(this->fFactory->fStaticInitRegBlock, true);
+                        this->ExecuteRegBlock(this->fFactory->fInitRegBlock, true);
+                        this->ExecuteRegBlock(this->fFactory->fResetUIRegBlock, true);
+                        this->ExecuteRegBlock(this->fFactory->fClearRegBlock, true);
+                        this->ExecuteRegBlock(this->fFactory->fComputeRegBlock, true);
+                        this->ExecuteRegBlock(this->fFactory->fComputeDSPRegBlock, true);
+                    }
+                } else if (!this->fFactory->fComputeDSPFlatBlock->fLinked) {
+                    this->ExecuteBlock(this->fFactory->fStaticInitFlatBlock, true);
+                    this->ExecuteBlock(this->fFactory->fInitFlatBlock, true);
+                    this->ExecuteBlock(this->fFactory->fResetUIFlatBlock, true);
+                    this->ExecuteBlock(this->fFactory->fClearFlatBlock, true);
+                    this->ExecuteBlock(this->fFactory->fComputeFlatBlock, true);
+                    this->ExecuteBlock(this->fFactory->fComputeDSPFlatBlock, true);
+                }
+            }
+            
+            // Scheduler mode : workers for the task groups, that are sequentially executed in trace mode
+            if (!this->fFactory->fRegisterMode && this->fFactory->fComputeDSPFlatBlock->fHasTasks && !TRACE) {
+                int workers = FIRTaskPool::getWorkers();
+                if (workers > 0) {
+                    this->fTaskPool = new FIRTaskPool(workers);
+                }
+            }
             
             /*
             fFactory->fStaticInitBlock->write(&std::cout, false);
@@ -692,6 +1300,15 @@ class interpreter_dsp_aux : public interpreter_dsp_base, public FIRInterpreter<T
         #ifdef INTERPRETER_TRACE
             this->fInitialized = false;
         #endif
+            
+            size_t controls = this->fFactory->fSpecializeControls.size();
+            this->fControlValues.assign(controls, T(0));
+            this->fControlStable.assign(controls, 0);
+            this->fControlFrozen.assign(controls, false);
+            this->fSpecializeCounter = 0;
+            this->fSpecializedComputeFlatBlock = 0;
+            this->fSpecializedComputeDSPFlatBlock = 0;
+            this->fSpecializedVectorCompiler = 0;
         }
     
         virtual ~interpreter_dsp_aux()
@@ -704,6 +1321,10 @@ class interpreter_dsp_aux : public interpreter_dsp_base, public FIRInterpreter<T
                 delete [] this->fOutputs;
             }
             
+            delete this->fSpecializedComputeFlatBlock;
+            delete this->fSpecializedComputeDSPFlatBlock;
+            delete this->fSpecializedVectorCompiler;
+            
             /*
             delete this->fStaticInitBlock;
             delete this->fInitBlock;
@@ -721,7 +1342,8 @@ class interpreter_dsp_aux : public interpreter_dsp_base, public FIRInterpreter<T
     
         virtual int getSampleRate()
         {
-            return this->fIntMap[this->fFactory->fSROffset];
+            // The 'init' code of a DSP compiled with '-sr' sets its own rate
+            return this->fIntHeap[this->fFactory->fSROffset];
         }
     
         // to be implemented by subclass
@@ -753,8 +1375,11 @@ class interpreter_dsp_aux : public interpreter_dsp_base, public FIRInterpreter<T
         
         virtual void classInit(int samplingRate)
         {
+            // Constants of the specialized code may change
+            this->deleteSpecialization();
+            
             // Execute static init instructions
-            this->ExecuteBlock(this->fFactory->fStaticInitBlock);
+            this->ExecuteCode(this->fFactory->fStaticInitFlatBlock, this->fFactory->fStaticInitRegBlock);
         }
         
         virtual void instanceConstants(int samplingRate)
@@ -765,20 +1390,40 @@ class interpreter_dsp_aux : public interpreter_dsp_base, public FIRInterpreter<T
             // Store samplingRate in 'fSamplingFreq' variable at correct offset in fIntHeap
             this->fIntHeap[this->fFactory->fSROffset] = samplingRate;
             
+            // Constants of the specialized code may change
+            this->deleteSpecialization();
+            
             // Execute state init instructions
-            this->ExecuteBlock(this->fFactory->fInitBlock);
+            this->ExecuteCode(this->fFactory->fInitFlatBlock, this->fFactory->fInitRegBlock);
         }
     
         virtual void instanceResetUserInterface()
         {
             // Execute reset UI instructions
-            this->ExecuteBlock(this->fFactory->fResetUIBlock);
+            this->ExecuteCode(this->fFactory->fResetUIFlatBlock, this->fFactory->fResetUIRegBlock);
         }
 
         virtual void instanceClear()
         {
+            this->deleteSpecialization();
+            
             // Execute clear instructions
-            this->ExecuteBlock(this->fFactory->fClearBlock);
+            this->ExecuteCode(this->fFactory->fClearFlatBlock, this->fFactory->fClearRegBlock);
+        }
+    
+        virtual void* getField(const std::string& name, int& size, int& type)
+        {
+            bool is_int;
+            int offset;
+            if (!this->fFactory->fHeapNames.findField(name, is_int, offset, size)) {
+                return NULL;
+            } else if (is_int) {
+                type = 0;
+                return &this->fIntHeap[offset];
+            } else {
+                type = sizeof(T);
+                return &this->fRealHeap[offset];
+            }
         }
     
         virtual void instanceInit(int samplingRate)
@@ -874,11 +1519,21 @@ class interpreter_dsp_aux : public interpreter_dsp_base, public FIRInterpreter<T
                 // Set count in 'count' variable at the correct offset in fIntHeap
                 this->fIntHeap[this->fFactory->fCountOffset] = count;
                 
-                // Executes the 'control' block
-                this->ExecuteBlock(this->fFactory->fComputeBlock);
+                if (this->fFactory->fSpecializeComputeBlock) {
+                    this->updateSpecialization();
+                }
                 
-                // Executes the 'DSP' block
-                this->ExecuteBlock(this->fFactory->fComputeDSPBlock);
+                if (this->fSpecializedComputeFlatBlock) {
+                    // Executes the specialized 'control' and 'DSP' blocks
+                    this->ExecuteBlock(this->fSpecializedComputeFlatBlock);
+                    this->ExecuteBlock(this->fSpecializedComputeDSPFlatBlock);
+                } else {
+                    // Executes the 'control' block
+                    this->ExecuteCode(this->fFactory->fComputeFlatBlock, this->fFactory->fComputeRegBlock);
+                    
+                    // Executes the 'DSP' block
+                    this->ExecuteCode(this->fFactory->fComputeDSPFlatBlock, this->fFactory->fComputeDSPRegBlock);
+                }
             }
         }
     
@@ -980,13 +1635,13 @@ class interpreter_dsp_aux_down : public interpreter_dsp_aux<T, TRACE> {
             }
             
             // Executes the 'control' block
-            this->ExecuteBlock(this->fFactory->fComputeBlock);
+            this->ExecuteCode(this->fFactory->fComputeFlatBlock, this->fFactory->fComputeRegBlock);
             
             // Set count in 'count' variable at the correct offset in fIntHeap
             this->fIntHeap[this->fCountOffset] = count / fDownSamplingFactor;
             
             // Executes the 'DSP' block
-            this->ExecuteBlock(this->fFactory->fComputeDSPBlock);
+            this->ExecuteCode(this->fFactory->fComputeDSPFlatBlock, this->fFactory->fComputeDSPRegBlock);
             
             // Upsample ouputs
             for (int i = 0; i < this->fFactory->fNumOutputs; i++) {
@@ -1030,6 +1685,8 @@ class EXPORT interpreter_dsp : public dsp {
     
         void operator delete(void* ptr);
     
+        interpreter_dsp_base* getDSP() { return fDSP; }
+    
         int getNumInputs();
     
         int getNumOutputs();
@@ -30,6 +30,9 @@
 
 using namespace std;
 
+// Label of the FIR blocks that group independent tasks (see InterpreterSchedulerCodeContainer)
+#define INTERP_TASKS_LABEL "/* Independent tasks */"
+
 template <class T>
 struct InterpreterInstVisitor : public DispatchVisitor {
 
@@ -37,7 +40,7 @@ struct InterpreterInstVisitor : public DispatchVisitor {
          Global functions names table as a static variable in the visitor
          so that each function prototype is generated as most once in the module.
         */
-        static map <string, FIRInstruction::Opcode> gMathLibTable;
+        static thread_local map <string, FIRInstruction::Opcode> gMathLibTable;
         
         int fRealHeapOffset;    // Offset in Real HEAP    
         int fIntHeapOffset;     // Offset in Integer HEAP
@@ -66,12 +69,21 @@ struct InterpreterInstVisitor : public DispatchVisitor {
             return (fFieldTable.find(name) != fFieldTable.end()) ? fFieldTable[name].fOffset : -1;
         }
     
+        void getHeapNames(FIRHeapNames& names)
+        {
+            for (map <string, MemoryDesc>::iterator it = fFieldTable.begin(); it != fFieldTable.end(); it++) {
+                names.addField((*it).second.fType == Typed::kInt32, (*it).second.fOffset, (*it).second.fSize, (*it).first);
+            }
+        }
+    
         void initMathTable()
         {
             // Integer version
             gMathLibTable["abs"] = FIRInstruction::kAbs;
             gMathLibTable["min_i"] = FIRInstruction::kMin;
             gMathLibTable["max_i"] = FIRInstruction::kMax;
+            // Used in the vector loop of -lv 1 mode
+            gMathLibTable["min"] = FIRInstruction::kMin;
             
             // Float version
             gMathLibTable["fabsf"] = FIRInstruction::kAbsf;
@@ -217,6 +229,35 @@ struct InterpreterInstVisitor : public DispatchVisitor {
         }
         
         virtual void visit(LabelInst* inst) {}
+    
+        // A block starting with the INTERP_TASKS_LABEL label contains one block per task
+        virtual void visit(BlockInst* inst)
+        {
+            LabelInst* label = (inst->fCode.size() > 0) ? dynamic_cast<LabelInst*>(inst->fCode.front()) : 0;
+            if (!label || label->fLabel != INTERP_TASKS_LABEL) {
+                DispatchVisitor::visit(inst);
+                return;
+            }
+            
+            // Keep current block
+            FIRBlockInstruction<T>* previous = fCurrentBlock;
+            
+            // Compile each task in a new block
+            int count = int(inst->fCode.size()) - 1;
+            list<StatementInst*>::const_iterator it = inst->fCode.begin();
+            for (it++; it != inst->fCode.end(); it++, count--) {
+                FIRBlockInstruction<T>* task_block = new FIRBlockInstruction<T>();
+                fCurrentBlock = task_block;
+                (*it)->accept(this);
+                // Add kReturn in block
+                task_block->push(new FIRBasicInstruction<T>(FIRInstruction::kReturn));
+                // 'fOffset1' is the number of tasks from this one to the end of the group
+                previous->push(new FIRBasicInstruction<T>(FIRInstruction::kTask, 0, 0, count, 0, task_block, 0));
+            }
+            
+            // Restore current block
+            fCurrentBlock = previous;
+        }
 
         // Declarations
         virtual void visit(DeclareVarInst* inst) 
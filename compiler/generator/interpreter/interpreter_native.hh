@@ -0,0 +1,686 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef _FIR_INTERPRETER_NATIVE_H
+#define _FIR_INTERPRETER_NATIVE_H
+
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+#include <string.h>
+
+#include "interpreter_register.hh"
+#include "exception.hh"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define FIR_NATIVE_CODE 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+ Native code : register blocks (see interpreter_register.hh) are translated in x86-64 machine code by copy and patch.
+ Each register opcode has a stencil, a machine code template built once, with holes for the memory displacements of
+ its operands and for its jump target. A block is compiled by copying the stencils of its instructions one after the
+ other in an executable buffer, then patching the holes with the instruction operands.
+
+ The generated function is called as 'code(real_mem, int_mem, inputs, outputs)' and keeps in callee-saved registers:
+
+    rbx : real memory, rbp : int memory, r13 : inputs, r14 : outputs
+
+ Operations are done in rax/rcx/rdx and xmm0/xmm1, with the same semantic as the handlers of 'ExecuteRegBlock'.
+ Extended math and block moves call helper functions (the stack is kept aligned by the prologue).
+*/
+
+template <class T>
+struct FIRNativeStencil {
+
+    // Kind of the hole value : instruction field, or jump target
+    enum Kind { kDst, kSrc1, kSrc2, kOffset1, kOffset2, kBranch };
+
+    struct Hole {
+        int fPosition;  // Position of the 32 bits value in the stencil
+        Kind fKind;
+        int fAddend;    // Patched value is (field + addend) * scale
+        int fScale;
+    };
+
+    std::vector<unsigned char> fCode;
+    std::vector<Hole> fHoles;
+
+    void byte(int b) { fCode.push_back((unsigned char)b); }
+
+    void bytes(int b1, int b2) { byte(b1); byte(b2); }
+    void bytes(int b1, int b2, int b3) { byte(b1); byte(b2); byte(b3); }
+    void bytes(int b1, int b2, int b3, int b4) { byte(b1); byte(b2); byte(b3); byte(b4); }
+
+    void hole(Kind kind, int scale, int addend = 0)
+    {
+        Hole hole = { int(fCode.size()), kind, addend, scale };
+        fHoles.push_back(hole);
+        for (int i = 0; i < 4; i++) byte(0);
+    }
+
+    void imm64(void* ptr)
+    {
+        unsigned long long val = (unsigned long long)ptr;
+        for (int i = 0; i < 8; i++) byte(int((val >> (8 * i)) & 0xFF));
+    }
+
+};
+
+template <class T>
+class FIRNativeCompiler {
+
+    public:
+
+        typedef void (*NativeCode)(T* real_mem, int* int_mem, T** inputs, T** outputs);
+
+    private:
+
+        typedef FIRNativeStencil<T> Stencil;
+
+        std::vector<std::pair<void*, size_t> > fBuffers;   // Executable buffers, owned by the compiler
+
+        // SSE scalar prefix, size and SIB scale of reals
+        static int prefix() { return (sizeof(T) == 8) ? 0xF2 : 0xF3; }
+        static int scale() { return (sizeof(T) == 8) ? 3 : 2; }
+        static bool isDouble() { return sizeof(T) == 8; }
+
+        // Helpers called by the native code
+        static T nativeAcos(T x) { return std::acos(x); }
+        static T nativeAsin(T x) { return std::asin(x); }
+        static T nativeAtan(T x) { return std::atan(x); }
+        static T nativeCeil(T x) { return std::ceil(x); }
+        static T nativeCos(T x) { return std::cos(x); }
+        static T nativeCosh(T x) { return std::cosh(x); }
+        static T nativeExp(T x) { return std::exp(x); }
+        static T nativeFloor(T x) { return std::floor(x); }
+        static T nativeLog(T x) { return std::log(x); }
+        static T nativeLog10(T x) { return std::log10(x); }
+        static T nativeRound(T x) { return std::round(x); }
+        static T nativeSin(T x) { return std::sin(x); }
+        static T nativeSinh(T x) { return std::sinh(x); }
+        static T nativeTan(T x) { return std::tan(x); }
+        static T nativeTanh(T x) { return std::tanh(x); }
+        static T nativeAtan2(T x, T y) { return std::atan2(x, y); }
+        static T nativeFmod(T x, T y) { return std::fmod(x, y); }
+        static T nativePow(T x, T y) { return std::pow(x, y); }
+        static T nativeRemainder(T x, T y) { return std::remainder(x, y); }
+
+        template <class TYPE>
+        static void nativeBlockStore(TYPE* mem, int dst, int src, int size)
+        {
+            memcpy(&mem[dst], &mem[src], size * sizeof(TYPE));
+        }
+
+        template <class TYPE>
+        static void nativeBlockPairMove(TYPE* mem, int from, int to)
+        {
+            for (int i = from; i < to; i += 2) {
+                mem[i + 1] = mem[i];
+            }
+        }
+
+        template <class TYPE>
+        static void nativeBlockShift(TYPE* mem, int from, int to)
+        {
+            for (int i = from; i > to; i -= 1) {
+                mem[i] = mem[i - 1];
+            }
+        }
+
+        // Stencil building blocks : reals are accessed at [rbx + disp32], ints at [rbp + disp32]
+        static void loadReal(Stencil& s, int xmm, typename Stencil::Kind kind, int addend = 0)
+        {
+            s.bytes(prefix(), 0x0F, 0x10, 0x83 | (xmm << 3));
+            s.hole(kind, sizeof(T), addend);
+        }
+
+        static void storeReal(Stencil& s, typename Stencil::Kind kind, int xmm, int addend = 0)
+        {
+            s.bytes(prefix(), 0x0F, 0x11, 0x83 | (xmm << 3));
+            s.hole(kind, sizeof(T), addend);
+        }
+
+        static void opReal(Stencil& s, int opcode, typename Stencil::Kind kind)
+        {
+            s.bytes(prefix(), 0x0F, opcode, 0x83);
+            s.hole(kind, sizeof(T));
+        }
+
+        static void loadInt(Stencil& s, int reg, typename Stencil::Kind kind, int addend = 0)
+        {
+            s.bytes(0x8B, 0x85 | (reg << 3));
+            s.hole(kind, sizeof(int), addend);
+        }
+
+        static void storeInt(Stencil& s, typename Stencil::Kind kind, int reg, int addend = 0)
+        {
+            s.bytes(0x89, 0x85 | (reg << 3));
+            s.hole(kind, sizeof(int), addend);
+        }
+
+        static void opInt(Stencil& s, int opcode, typename Stencil::Kind kind)
+        {
+            s.bytes(opcode, 0x85);
+            s.hole(kind, sizeof(int));
+        }
+
+        // Real value moved as an integer of the same size (rax)
+        static void moveReal(Stencil& s, typename Stencil::Kind dst, int dst_addend, typename Stencil::Kind src, int src_addend)
+        {
+            if (isDouble()) s.byte(0x48);
+            s.bytes(0x8B, 0x83);
+            s.hole(src, sizeof(T), src_addend);
+            if (isDouble()) s.byte(0x48);
+            s.bytes(0x89, 0x83);
+            s.hole(dst, sizeof(T), dst_addend);
+        }
+
+        static void moveInt(Stencil& s, typename Stencil::Kind dst, int dst_addend, typename Stencil::Kind src, int src_addend)
+        {
+            loadInt(s, 0, src, src_addend);
+            storeInt(s, dst, 0, dst_addend);
+        }
+
+        // movsxd rax, [rbp + disp32]
+        static void loadIndex(Stencil& s, typename Stencil::Kind kind)
+        {
+            s.bytes(0x48, 0x63, 0x85);
+            s.hole(kind, sizeof(int));
+        }
+
+        // mov rax, imm64 ; call rax
+        static void call(Stencil& s, void* fun)
+        {
+            s.bytes(0x48, 0xB8);
+            s.imm64(fun);
+            s.bytes(0xFF, 0xD0);
+        }
+
+        static void setInt(Stencil& s, int setcc)
+        {
+            s.bytes(0x0F, setcc, 0xC0);     // setcc al
+            s.bytes(0x0F, 0xB6, 0xC0);      // movzx eax, al
+            storeInt(s, Stencil::kDst, 0);
+        }
+
+        static Stencil binaryReal(int opcode)
+        {
+            Stencil s;
+            loadReal(s, 0, Stencil::kSrc1);
+            opReal(s, opcode, Stencil::kSrc2);
+            storeReal(s, Stencil::kDst, 0);
+            return s;
+        }
+
+        static Stencil binaryInt(int opcode, bool two_bytes = false)
+        {
+            Stencil s;
+            loadInt(s, 0, Stencil::kSrc1);
+            if (two_bytes) s.byte(0x0F);
+            opInt(s, opcode, Stencil::kSrc2);
+            storeInt(s, Stencil::kDst, 0);
+            return s;
+        }
+
+        static Stencil divInt(int result_reg)
+        {
+            Stencil s;
+            loadInt(s, 0, Stencil::kSrc1);
+            s.byte(0x99);                   // cdq
+            s.bytes(0xF7, 0xBD);            // idiv dword [rbp + disp32]
+            s.hole(Stencil::kSrc2, sizeof(int));
+            storeInt(s, Stencil::kDst, result_reg);
+            return s;
+        }
+
+        static Stencil shiftInt(int modrm)
+        {
+            Stencil s;
+            loadInt(s, 0, Stencil::kSrc1);
+            loadInt(s, 1, Stencil::kSrc2);
+            s.bytes(0xD3, modrm);           // shl/sar eax, cl
+            storeInt(s, Stencil::kDst, 0);
+            return s;
+        }
+
+        static Stencil compareInt(int setcc)
+        {
+            Stencil s;
+            loadInt(s, 0, Stencil::kSrc1);
+            opInt(s, 0x3B, Stencil::kSrc2); // cmp eax, [rbp + disp32]
+            setInt(s, setcc);
+            return s;
+        }
+
+        // ucomis is false on unordered values with 'above' conditions, so 'lower' conditions swap their operands
+        static Stencil compareReal(int setcc, bool swap)
+        {
+            Stencil s;
+            loadReal(s, 0, (swap) ? Stencil::kSrc2 : Stencil::kSrc1);
+            if (isDouble()) s.byte(0x66);
+            s.bytes(0x0F, 0x2E, 0x83);
+            s.hole((swap) ? Stencil::kSrc1 : Stencil::kSrc2, sizeof(T));
+            setInt(s, setcc);
+            return s;
+        }
+
+        // Equality needs the parity flag (unordered values)
+        static Stencil equalReal(bool equal)
+        {
+            Stencil s;
+            loadReal(s, 0, Stencil::kSrc1);
+            if (isDouble()) s.byte(0x66);
+            s.bytes(0x0F, 0x2E, 0x83);
+            s.hole(Stencil::kSrc2, sizeof(T));
+            if (equal) {
+                s.bytes(0x0F, 0x94, 0xC0);  // sete al
+                s.bytes(0x0F, 0x9B, 0xC1);  // setnp cl
+                s.bytes(0x20, 0xC8);        // and al, cl
+            } else {
+                s.bytes(0x0F, 0x95, 0xC0);  // setne al
+                s.bytes(0x0F, 0x9A, 0xC1);  // setp cl
+                s.bytes(0x08, 0xC8);        // or al, cl
+            }
+            s.bytes(0x0F, 0xB6, 0xC0);      // movzx eax, al
+            storeInt(s, Stencil::kDst, 0);
+            return s;
+        }
+
+        static Stencil unaryCall(T (*fun)(T))
+        {
+            Stencil s;
+            loadReal(s, 0, Stencil::kSrc1);
+            call(s, (void*)fun);
+            storeReal(s, Stencil::kDst, 0);
+            return s;
+        }
+
+        static Stencil binaryCall(T (*fun)(T, T))
+        {
+            Stencil s;
+            loadReal(s, 0, Stencil::kSrc1);
+            loadReal(s, 1, Stencil::kSrc2);
+            call(s, (void*)fun);
+            storeReal(s, Stencil::kDst, 0);
+            return s;
+        }
+
+        // std::max(a, b) is (a < b) ? b : a, and maxs returns (dst > src) ? dst : src (same for min)
+        static Stencil minMaxReal(int opcode)
+        {
+            Stencil s;
+            loadReal(s, 0, Stencil::kSrc2);
+            opReal(s, opcode, Stencil::kSrc1);
+            storeReal(s, Stencil::kDst, 0);
+            return s;
+        }
+
+        static Stencil minMaxInt(int cmov)
+        {
+            Stencil s;
+            loadInt(s, 0, Stencil::kSrc1);
+            loadInt(s, 1, Stencil::kSrc2);
+            s.bytes(0x39, 0xC8);            // cmp eax, ecx
+            s.bytes(0x0F, cmov, 0xC1);      // cmovl/cmovg eax, ecx
+            storeInt(s, Stencil::kDst, 0);
+            return s;
+        }
+
+        // Helper call with the memory in rdi, and offset1, src1/offset2, offset2 in esi, edx, ecx
+        static Stencil blockCall(bool real, void* fun, typename Stencil::Kind arg2, bool arg3)
+        {
+            Stencil s;
+            s.bytes(0x48, 0x89, (real) ? 0xDF : 0xEF);  // mov rdi, rbx/rbp
+            s.byte(0xBE); s.hole(Stencil::kOffset1, 1); // mov esi, imm32
+            s.byte(0xBA); s.hole(arg2, 1);              // mov edx, imm32
+            if (arg3) { s.byte(0xB9); s.hole(Stencil::kOffset2, 1); }  // mov ecx, imm32
+            call(s, fun);
+            return s;
+        }
+
+        static std::vector<Stencil> buildStencils()
+        {
+            std::vector<Stencil> stencils(FIRRegisterInstruction::kReturn + 1);
+            Stencil s;
+
+            // Memory
+            s = Stencil(); moveReal(s, Stencil::kDst, 0, Stencil::kSrc1, 0);
+            stencils[FIRRegisterInstruction::kMoveReal] = s;
+            s = Stencil(); moveInt(s, Stencil::kDst, 0, Stencil::kSrc1, 0);
+            stencils[FIRRegisterInstruction::kMoveInt] = s;
+
+            s = Stencil();
+            loadIndex(s, Stencil::kSrc1);
+            s.bytes(prefix(), 0x0F, 0x10, 0x84); s.byte((scale() << 6) | 0x03);     // movs xmm0, [rbx + rax * size + disp32]
+            s.hole(Stencil::kOffset1, sizeof(T));
+            storeReal(s, Stencil::kDst, 0);
+            stencils[FIRRegisterInstruction::kLoadIndexedReal] = s;
+
+            s = Stencil();
+            loadIndex(s, Stencil::kSrc1);
+            s.bytes(0x8B, 0x84, 0x85);                                              // mov eax, [rbp + rax * 4 + disp32]
+            s.hole(Stencil::kOffset1, sizeof(int));
+            storeInt(s, Stencil::kDst, 0);
+            stencils[FIRRegisterInstruction::kLoadIndexedInt] = s;
+
+            s = Stencil();
+            loadIndex(s, Stencil::kSrc1);
+            loadReal(s, 0, Stencil::kSrc2);
+            s.bytes(prefix(), 0x0F, 0x11, 0x84); s.byte((scale() << 6) | 0x03);     // movs [rbx + rax * size + disp32], xmm0
+            s.hole(Stencil::kOffset1, sizeof(T));
+            stencils[FIRRegisterInstruction::kStoreIndexedReal] = s;
+
+            s = Stencil();
+            loadIndex(s, Stencil::kSrc1);
+            loadInt(s, 1, Stencil::kSrc2);
+            s.bytes(0x89, 0x8C, 0x85);                                              // mov [rbp + rax * 4 + disp32], ecx
+            s.hole(Stencil::kOffset1, sizeof(int));
+            stencils[FIRRegisterInstruction::kStoreIndexedInt] = s;
+
+            stencils[FIRRegisterInstruction::kBlockStoreReal] = blockCall(true, (void*)&nativeBlockStore<T>, Stencil::kSrc1, true);
+            stencils[FIRRegisterInstruction::kBlockStoreInt] = blockCall(false, (void*)&nativeBlockStore<int>, Stencil::kSrc1, true);
+
+            s = Stencil();
+            moveReal(s, Stencil::kOffset1, 0, Stencil::kOffset1, -1);
+            moveReal(s, Stencil::kOffset2, 0, Stencil::kOffset2, -1);
+            stencils[FIRRegisterInstruction::kPairMoveReal] = s;
+            s = Stencil();
+            moveInt(s, Stencil::kOffset1, 0, Stencil::kOffset1, -1);
+            moveInt(s, Stencil::kOffset2, 0, Stencil::kOffset2, -1);
+            stencils[FIRRegisterInstruction::kPairMoveInt] = s;
+
+            stencils[FIRRegisterInstruction::kBlockPairMoveReal] = blockCall(true, (void*)&nativeBlockPairMove<T>, Stencil::kOffset2, false);
+            stencils[FIRRegisterInstruction::kBlockPairMoveInt] = blockCall(false, (void*)&nativeBlockPairMove<int>, Stencil::kOffset2, false);
+            stencils[FIRRegisterInstruction::kBlockShiftReal] = blockCall(true, (void*)&nativeBlockShift<T>, Stencil::kOffset2, false);
+            stencils[FIRRegisterInstruction::kBlockShiftInt] = blockCall(false, (void*)&nativeBlockShift<int>, Stencil::kOffset2, false);
+
+            s = Stencil();
+            s.bytes(0x49, 0x8B, 0x8D); s.hole(Stencil::kOffset1, sizeof(T*));       // mov rcx, [r13 + disp32]
+            loadIndex(s, Stencil::kSrc1);
+            s.bytes(prefix(), 0x0F, 0x10, 0x04); s.byte((scale() << 6) | 0x01);     // movs xmm0, [rcx + rax * size]
+            storeReal(s, Stencil::kDst, 0);
+            stencils[FIRRegisterInstruction::kLoadInput] = s;
+
+            s = Stencil();
+            s.bytes(0x49, 0x8B, 0x8E); s.hole(Stencil::kOffset1, sizeof(T*));       // mov rcx, [r14 + disp32]
+            loadIndex(s, Stencil::kSrc1);
+            loadReal(s, 0, Stencil::kSrc2);
+            s.bytes(prefix(), 0x0F, 0x11, 0x04); s.byte((scale() << 6) | 0x01);     // movs [rcx + rax * size], xmm0
+            stencils[FIRRegisterInstruction::kStoreOutput] = s;
+
+            // Cast/Bitcast
+            s = Stencil();
+            s.bytes(prefix(), 0x0F, 0x2A, 0x85); s.hole(Stencil::kSrc1, sizeof(int));  // cvtsi2s xmm0, [rbp + disp32]
+            storeReal(s, Stencil::kDst, 0);
+            stencils[FIRRegisterInstruction::kCastReal] = s;
+
+            s = Stencil();
+            s.bytes(prefix(), 0x0F, 0x2C, 0x83); s.hole(Stencil::kSrc1, sizeof(T));    // cvtts2si eax, [rbx + disp32]
+            storeInt(s, Stencil::kDst, 0);
+            stencils[FIRRegisterInstruction::kCastInt] = s;
+
+            s = Stencil();
+            s.bytes(0x8B, 0x83); s.hole(Stencil::kSrc1, sizeof(T));                    // mov eax, [rbx + disp32]
+            storeInt(s, Stencil::kDst, 0);
+            stencils[FIRRegisterInstruction::kBitcastInt] = s;
+
+            s = Stencil();
+            if (isDouble()) s.byte(0x48);
+            s.bytes(0x8B, 0x85); s.hole(Stencil::kSrc1, sizeof(int));                  // mov rax/eax, [rbp + disp32]
+            if (isDouble()) s.byte(0x48);
+            s.bytes(0x89, 0x83); s.hole(Stencil::kDst, sizeof(T));                     // mov [rbx + disp32], rax/eax
+            stencils[FIRRegisterInstruction::kBitcastReal] = s;
+
+            // Standard math
+            stencils[FIRRegisterInstruction::kAddReal] = binaryReal(0x58);
+            stencils[FIRRegisterInstruction::kAddInt] = binaryInt(0x03);
+            stencils[FIRRegisterInstruction::kSubReal] = binaryReal(0x5C);
+            stencils[FIRRegisterInstruction::kSubInt] = binaryInt(0x2B);
+            stencils[FIRRegisterInstruction::kMultReal] = binaryReal(0x59);
+            stencils[FIRRegisterInstruction::kMultInt] = binaryInt(0xAF, true);
+            stencils[FIRRegisterInstruction::kDivReal] = binaryReal(0x5E);
+            stencils[FIRRegisterInstruction::kDivInt] = divInt(0);
+            stencils[FIRRegisterInstruction::kRemReal] = binaryCall(nativeRemainder);
+            stencils[FIRRegisterInstruction::kRemInt] = divInt(2);
+            stencils[FIRRegisterInstruction::kLshInt] = shiftInt(0xE0);
+            stencils[FIRRegisterInstruction::kRshInt] = shiftInt(0xF8);
+            stencils[FIRRegisterInstruction::kGTInt] = compareInt(0x9F);
+            stencils[FIRRegisterInstruction::kLTInt] = compareInt(0x9C);
+            stencils[FIRRegisterInstruction::kGEInt] = compareInt(0x9D);
+            stencils[FIRRegisterInstruction::kLEInt] = compareInt(0x9E);
+            stencils[FIRRegisterInstruction::kEQInt] = compareInt(0x94);
+            stencils[FIRRegisterInstruction::kNEInt] = compareInt(0x95);
+            stencils[FIRRegisterInstruction::kGTReal] = compareReal(0x97, false);
+            stencils[FIRRegisterInstruction::kLTReal] = compareReal(0x97, true);
+            stencils[FIRRegisterInstruction::kGEReal] = compareReal(0x93, false);
+            stencils[FIRRegisterInstruction::kLEReal] = compareReal(0x93, true);
+            stencils[FIRRegisterInstruction::kEQReal] = equalReal(true);
+            stencils[FIRRegisterInstruction::kNEReal] = equalReal(false);
+            stencils[FIRRegisterInstruction::kANDInt] = binaryInt(0x23);
+            stencils[FIRRegisterInstruction::kORInt] = binaryInt(0x0B);
+            stencils[FIRRegisterInstruction::kXORInt] = binaryInt(0x33);
+
+            // Extended unary math
+            s = Stencil();
+            loadInt(s, 0, Stencil::kSrc1);
+            s.byte(0x99);                   // cdq
+            s.bytes(0x31, 0xD0);            // xor eax, edx
+            s.bytes(0x29, 0xD0);            // sub eax, edx
+            storeInt(s, Stencil::kDst, 0);
+            stencils[FIRRegisterInstruction::kAbs] = s;
+
+            s = Stencil();
+            if (isDouble()) {
+                s.bytes(0x48, 0x8B, 0x83); s.hole(Stencil::kSrc1, sizeof(T));  // mov rax, [rbx + disp32]
+                s.bytes(0x48, 0x0F, 0xBA, 0xF0); s.byte(63);                    // btr rax, 63
+                s.bytes(0x48, 0x89, 0x83); s.hole(Stencil::kDst, sizeof(T));    // mov [rbx + disp32], rax
+            } else {
+                s.bytes(0x8B, 0x83); s.hole(Stencil::kSrc1, sizeof(T));         // mov eax, [rbx + disp32]
+                s.bytes(0x25, 0xFF, 0xFF, 0xFF); s.byte(0x7F);                  // and eax, 0x7FFFFFFF
+                s.bytes(0x89, 0x83); s.hole(Stencil::kDst, sizeof(T));          // mov [rbx + disp32], eax
+            }
+            stencils[FIRRegisterInstruction::kAbsf] = s;
+
+            stencils[FIRRegisterInstruction::kAcosf] = unaryCall(nativeAcos);
+            stencils[FIRRegisterInstruction::kAsinf] = unaryCall(nativeAsin);
+            stencils[FIRRegisterInstruction::kAtanf] = unaryCall(nativeAtan);
+            stencils[FIRRegisterInstruction::kCeilf] = unaryCall(nativeCeil);
+            stencils[FIRRegisterInstruction::kCosf] = unaryCall(nativeCos);
+            stencils[FIRRegisterInstruction::kCoshf] = unaryCall(nativeCosh);
+            stencils[FIRRegisterInstruction::kExpf] = unaryCall(nativeExp);
+            stencils[FIRRegisterInstruction::kFloorf] = unaryCall(nativeFloor);
+            stencils[FIRRegisterInstruction::kLogf] = unaryCall(nativeLog);
+            stencils[FIRRegisterInstruction::kLog10f] = unaryCall(nativeLog10);
+            stencils[FIRRegisterInstruction::kRoundf] = unaryCall(nativeRound);
+            stencils[FIRRegisterInstruction::kSinf] = unaryCall(nativeSin);
+            stencils[FIRRegisterInstruction::kSinhf] = unaryCall(nativeSinh);
+
+            s = Stencil();
+            opReal(s, 0x51, Stencil::kSrc1); // sqrts xmm0, [rbx + disp32]
+            storeReal(s, Stencil::kDst, 0);
+            stencils[FIRRegisterInstruction::kSqrtf] = s;
+
+            stencils[FIRRegisterInstruction::kTanf] = unaryCall(nativeTan);
+            stencils[FIRRegisterInstruction::kTanhf] = unaryCall(nativeTanh);
+
+            // Extended binary math
+            stencils[FIRRegisterInstruction::kAtan2f] = binaryCall(nativeAtan2);
+            stencils[FIRRegisterInstruction::kFmodf] = binaryCall(nativeFmod);
+            stencils[FIRRegisterInstruction::kPowf] = binaryCall(nativePow);
+            stencils[FIRRegisterInstruction::kMax] = minMaxInt(0x4C);
+            stencils[FIRRegisterInstruction::kMaxf] = minMaxReal(0x5F);
+            stencils[FIRRegisterInstruction::kMin] = minMaxInt(0x4F);
+            stencils[FIRRegisterInstruction::kMinf] = minMaxReal(0x5D);
+
+            // Control
+            s = Stencil();
+            s.byte(0xE9); s.hole(Stencil::kBranch, 1);                  // jmp rel32
+            stencils[FIRRegisterInstruction::kJump] = s;
+
+            s = Stencil();
+            loadInt(s, 0, Stencil::kSrc1);
+            s.bytes(0x85, 0xC0);                                        // test eax, eax
+            s.bytes(0x0F, 0x85); s.hole(Stencil::kBranch, 1);           // jnz rel32
+            stencils[FIRRegisterInstruction::kCondJump] = s;
+
+            s = Stencil();
+            s.bytes(0x41, 0x5E);            // pop r14
+            s.bytes(0x41, 0x5D);            // pop r13
+            s.bytes(0x41, 0x5C);            // pop r12
+            s.byte(0x5D);                   // pop rbp
+            s.byte(0x5B);                   // pop rbx
+            s.byte(0xC3);                   // ret
+            stencils[FIRRegisterInstruction::kReturn] = s;
+
+            return stencils;
+        }
+
+        static Stencil buildPrologue()
+        {
+            Stencil s;
+            s.byte(0x53);                   // push rbx
+            s.byte(0x55);                   // push rbp
+            s.bytes(0x41, 0x54);            // push r12 (keeps the stack aligned for calls)
+            s.bytes(0x41, 0x55);            // push r13
+            s.bytes(0x41, 0x56);            // push r14
+            s.bytes(0x48, 0x89, 0xFB);      // mov rbx, rdi
+            s.bytes(0x48, 0x89, 0xF5);      // mov rbp, rsi
+            s.bytes(0x49, 0x89, 0xD5);      // mov r13, rdx
+            s.bytes(0x49, 0x89, 0xCE);      // mov r14, rcx
+            return s;
+        }
+
+        static std::vector<Stencil>& getStencils()
+        {
+            static std::vector<Stencil> stencils = buildStencils();
+            return stencils;
+        }
+
+        static int field(const FIRRegInstruction<T>& inst, typename Stencil::Kind kind)
+        {
+            switch (kind) {
+                case Stencil::kDst: return inst.fDst;
+                case Stencil::kSrc1: return inst.fSrc1;
+                case Stencil::kSrc2: return inst.fSrc2;
+                case Stencil::kOffset1: return inst.fOffset1;
+                case Stencil::kOffset2: return inst.fOffset2;
+                default: return 0;
+            }
+        }
+
+        static void patch(std::vector<unsigned char>& code, int position, long long value)
+        {
+            if (value < INT32_MIN || value > INT32_MAX) {
+                throw faustexception("ERROR : native code displacement out of range\n");
+            }
+            int val = int(value);
+            memcpy(&code[position], &val, sizeof(int));
+        }
+
+    public:
+
+        FIRNativeCompiler()
+        {}
+
+        virtual ~FIRNativeCompiler()
+        {
+        #ifdef FIR_NATIVE_CODE
+            for (size_t i = 0; i < fBuffers.size(); i++) {
+                munmap(fBuffers[i].first, fBuffers[i].second);
+            }
+        #endif
+        }
+
+        static bool isSupported()
+        {
+        #ifdef FIR_NATIVE_CODE
+            return true;
+        #else
+            return false;
+        #endif
+        }
+
+        // Copy and patch the stencils of the block instructions, and return the executable code
+        NativeCode compile(FIRRegBlockInstruction<T>* block)
+        {
+        #ifdef FIR_NATIVE_CODE
+            if (block->fInstructions.empty() || block->fInstructions.back().fOpcode != FIRRegisterInstruction::kReturn) {
+                throw faustexception("ERROR : register code does not end with kReturn\n");
+            }
+            
+            std::vector<Stencil>& stencils = getStencils();
+            Stencil prologue = buildPrologue();
+            std::vector<unsigned char> code(prologue.fCode);
+
+            // Start of each instruction, and jumps to patch once all starts are known
+            std::vector<int> starts(block->fInstructions.size());
+            std::vector<std::pair<int, int> > jumps;
+
+            for (size_t i = 0; i < block->fInstructions.size(); i++) {
+                const FIRRegInstruction<T>& inst = block->fInstructions[i];
+                const Stencil& stencil = stencils[inst.fOpcode];
+                int start = int(code.size());
+                starts[i] = start;
+                code.insert(code.end(), stencil.fCode.begin(), stencil.fCode.end());
+
+                for (size_t h = 0; h < stencil.fHoles.size(); h++) {
+                    const typename Stencil::Hole& hole = stencil.fHoles[h];
+                    if (hole.fKind == Stencil::kBranch) {
+                        int target = int(i) + inst.fBranch;
+                        if (target < 0 || target >= int(block->fInstructions.size())) {
+                            throw faustexception("ERROR : incorrect jump in register code\n");
+                        }
+                        jumps.push_back(std::make_pair(start + hole.fPosition, target));
+                    } else {
+                        patch(code, start + hole.fPosition, ((long long)field(inst, hole.fKind) + hole.fAddend) * hole.fScale);
+                    }
+                }
+            }
+
+            for (size_t j = 0; j < jumps.size(); j++) {
+                patch(code, jumps[j].first, (long long)starts[jumps[j].second] - (jumps[j].first + 4));
+            }
+
+            // Executable buffer, written before being made executable
+            size_t page = size_t(sysconf(_SC_PAGESIZE));
+            size_t size = ((code.size() + page - 1) / page) * page;
+            void* buffer = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (buffer == MAP_FAILED) {
+                throw faustexception("ERROR : cannot allocate native code memory\n");
+            }
+            memcpy(buffer, &code[0], code.size());
+            if (mprotect(buffer, size, PROT_READ | PROT_EXEC) != 0) {
+                munmap(buffer, size);
+                throw faustexception("ERROR : cannot make native code executable\n");
+            }
+            fBuffers.push_back(std::make_pair(buffer, size));
+            return reinterpret_cast<NativeCode>(buffer);
+        #else
+            throw faustexception("ERROR : native code is only available on x86-64 Linux\n");
+        #endif
+        }
+
+};
+
+#endif
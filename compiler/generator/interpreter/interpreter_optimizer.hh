@@ -25,25 +25,26 @@
 #include <string>
 #include <iostream>
 #include <map>
+#include <vector>
 
 #include "interpreter_bytecode.hh"
 #include "exception.hh"
 
-#define INTER_MAX_OPT_LEVEL 6
+#define INTER_MAX_OPT_LEVEL 7
 
 // Tables for math optimization
 
-static std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRMath2Heap;
-static std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRMath2Stack;
-static std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRMath2StackValue;
-static std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRMath2Value;
-static std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRMath2ValueInvert;
+static thread_local std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRMath2Heap;
+static thread_local std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRMath2Stack;
+static thread_local std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRMath2StackValue;
+static thread_local std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRMath2Value;
+static thread_local std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRMath2ValueInvert;
 
-static std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRExtendedMath2Heap;
-static std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRExtendedMath2Stack;
-static std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRExtendedMath2StackValue;
-static std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRExtendedMath2Value;
-static std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRExtendedMath2ValueInvert;
+static thread_local std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRExtendedMath2Heap;
+static thread_local std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRExtendedMath2Stack;
+static thread_local std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRExtendedMath2StackValue;
+static thread_local std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRExtendedMath2Value;
+static thread_local std::map<FIRInstruction::Opcode, FIRInstruction::Opcode> gFIRExtendedMath2ValueInvert;
 
 //=======================
 // Optimization
@@ -565,6 +566,61 @@ struct FIRInstructionMathOptimizer : public FIRInstructionOptimizer<T> {
     }
 };
 
+/*
+ Rewrite the hottest remaining sequences as fused instructions. The sequences have been selected by running
+ the benchmark DSPs with the interpreter in trace mode 4 (see tools/benchmark/faustprofile-interp.cpp)
+ on the code produced by the previous optimization levels.
+*/
+template <class T>
+struct FIRInstructionSuperOptimizer : public FIRInstructionOptimizer<T> {
+    
+    FIRInstructionSuperOptimizer()
+    {
+        //std::cout << "FIRInstructionSuperOptimizer" << std::endl;
+    }
+    
+    virtual ~FIRInstructionSuperOptimizer() {}
+    
+    FIRBasicInstruction<T>* rewrite(InstructionIT cur, InstructionIT& end)
+    {
+        FIRBasicInstruction<T>* inst1 = *cur;
+        FIRBasicInstruction<T>* inst2 = *(cur + 1);
+        
+        // Multiply-accumulate : heap * heap + stack
+        if (inst1->fOpcode == FIRInstruction::kMultRealHeap && inst2->fOpcode == FIRInstruction::kAddReal) {
+            end = cur + 2;
+            return new FIRBasicInstruction<T>(FIRInstruction::kMultAddRealHeap, 0, 0, inst1->fOffset1, inst1->fOffset2);
+            
+        // Accumulation in a heap variable
+        } else if (inst1->fOpcode == FIRInstruction::kAddRealStack && inst2->fOpcode == FIRInstruction::kStoreReal) {
+            end = cur + 2;
+            return new FIRBasicInstruction<T>(FIRInstruction::kAddRealStackStore, 0, 0, inst1->fOffset1, inst2->fOffset1);
+            
+        // Read in a delay line with a masked index : mask in fIntValue
+        } else if (inst1->fOpcode == FIRInstruction::kANDIntStackValue && inst2->fOpcode == FIRInstruction::kLoadIndexedReal) {
+            end = cur + 2;
+            return new FIRBasicInstruction<T>(FIRInstruction::kLoadIndexedRealMask, inst1->fIntValue, 0, inst2->fOffset1, inst2->fOffset2);
+            
+        // Write in an array with an index read in the heap : index offset in fIntValue
+        } else if (inst1->fOpcode == FIRInstruction::kLoadInt && inst2->fOpcode == FIRInstruction::kStoreIndexedReal) {
+            end = cur + 2;
+            return new FIRBasicInstruction<T>(FIRInstruction::kStoreIndexedRealHeap, inst1->fOffset1, 0, inst2->fOffset1, inst2->fOffset2);
+            
+        // Audio inputs/outputs accessed with the loop index
+        } else if (inst1->fOpcode == FIRInstruction::kLoadInt && inst2->fOpcode == FIRInstruction::kLoadInput) {
+            end = cur + 2;
+            return new FIRBasicInstruction<T>(FIRInstruction::kLoadInputHeap, 0, 0, inst2->fOffset1, inst1->fOffset1);
+        } else if (inst1->fOpcode == FIRInstruction::kLoadInt && inst2->fOpcode == FIRInstruction::kStoreOutput) {
+            end = cur + 2;
+            return new FIRBasicInstruction<T>(FIRInstruction::kStoreOutputHeap, 0, 0, inst2->fOffset1, inst1->fOffset1);
+            
+        } else {
+            end = cur + 1;
+            return (*cur)->copy();
+        }
+    }
+};
+
 //============================================
 // Partial evaluation by constant propagation
 //============================================
@@ -593,7 +649,8 @@ struct FIRInstructionConstantValueMap2Heap : public FIRInstructionOptimizer<T> {
             return new FIRBasicInstruction<T>(FIRInstruction::kInt32Value, fIntMap[inst->fOffset1], 0);
         } else if (inst->fOpcode == FIRInstruction::kLoadReal && fRealMap.find(inst->fOffset1) != fRealMap.end()) {
             end = cur + 1;
-            return new FIRBasicInstruction<T>(FIRInstruction::kRealValue, 0, fRealMap[inst->fOffset1]);
+            // The value keeps its heap offset (see FIRInstructionConstantValueReload)
+            return new FIRBasicInstruction<T>(FIRInstruction::kRealValue, 0, fRealMap[inst->fOffset1], inst->fOffset1, -1);
         } else {
             end = cur + 1;
             return (*cur)->copy();
@@ -601,6 +658,31 @@ struct FIRInstructionConstantValueMap2Heap : public FIRInstructionOptimizer<T> {
     }
 };
     
+// Constant Values Optimizer : load again the Real values propagated from the heap that have not been folded,
+// since the 'heap' versions of the operations are the ones fused by the super optimizer
+template <class T>
+struct FIRInstructionConstantValueReload : public FIRInstructionOptimizer<T> {
+    
+    FIRInstructionConstantValueReload()
+    {
+        //std::cout << "FIRInstructionConstantValueReload" << std::endl;
+    }
+    
+    virtual ~FIRInstructionConstantValueReload() {}
+    
+    virtual FIRBasicInstruction<T>* rewrite(InstructionIT cur, InstructionIT& end)
+    {
+        FIRBasicInstruction<T>* inst = *cur;
+        end = cur + 1;
+        
+        if (inst->fOpcode == FIRInstruction::kRealValue && inst->fOffset1 >= 0) {
+            return new FIRBasicInstruction<T>(FIRInstruction::kLoadReal, 0, 0, inst->fOffset1, 0);
+        } else {
+            return (*cur)->copy();
+        }
+    }
+};
+    
 // Constant Values Optimizer : propagate Int and Real constant values
 template <class T>
 struct FIRInstructionConstantValueHeap2Map : public FIRInstructionOptimizer<T> {
@@ -875,9 +957,9 @@ struct FIRInstructionMathSpecializer : public FIRInstructionOptimizer<T> {
                 
             case FIRInstruction::kMultInt:
                 if (inst1->fIntValue == 1) {        // neutral
-                    new FIRBasicInstruction<T>(FIRInstruction::kLoadInt, 0, 0, inst2->fOffset1, 0);
+                    return new FIRBasicInstruction<T>(FIRInstruction::kLoadInt, 0, 0, inst2->fOffset1, 0);
                 } else if (inst1->fIntValue == 0) { // absorbant
-                    new FIRBasicInstruction<T>(FIRInstruction::kInt32Value, 0, 0);
+                    return new FIRBasicInstruction<T>(FIRInstruction::kInt32Value, 0, 0);
                 } else {
                     return nullptr;
                 }
@@ -887,23 +969,16 @@ struct FIRInstructionMathSpecializer : public FIRInstructionOptimizer<T> {
                 ? new FIRBasicInstruction<T>(FIRInstruction::kLoadInt, 0, 0, inst2->fOffset1, 0)
                 : nullptr;
                 
+            // Bitwise operations : 1 is neither neutral nor absorbant
             case FIRInstruction::kANDInt:
-                if (inst1->fIntValue == 1) {        // neutral
-                    new FIRBasicInstruction<T>(FIRInstruction::kLoadInt, 0, 0, inst2->fOffset1, 0);
-                } else if (inst1->fIntValue == 0) { // absorbant
-                    new FIRBasicInstruction<T>(FIRInstruction::kInt32Value, 0, 0);
-                } else {
-                    return nullptr;
-                }
+                return (inst1->fIntValue == 0)      // absorbant
+                ? new FIRBasicInstruction<T>(FIRInstruction::kInt32Value, 0, 0)
+                : nullptr;
                 
             case FIRInstruction::kORInt:
-                if (inst1->fIntValue == 1) {        // absorbant
-                    new FIRBasicInstruction<T>(FIRInstruction::kInt32Value, 1, 0);
-                } else if (inst1->fIntValue == 0) { // neutral
-                    new FIRBasicInstruction<T>(FIRInstruction::kLoadInt, 0, 0, inst2->fOffset1, 0);
-                } else {
-                    return nullptr;
-                }
+                return (inst1->fIntValue == 0)      // neutral
+                ? new FIRBasicInstruction<T>(FIRInstruction::kLoadInt, 0, 0, inst2->fOffset1, 0)
+                : nullptr;
          
             default:
                 return nullptr;
@@ -1103,6 +1178,12 @@ struct FIRInstructionMathSpecializer : public FIRInstructionOptimizer<T> {
                    && inst2->fOpcode == FIRInstruction::kInt32Value
                    && FIRInstruction::isMath(inst3->fOpcode)) {
             
+            // Division by zero is kept (the code may never be executed)
+            if ((inst3->fOpcode == FIRInstruction::kDivInt || inst3->fOpcode == FIRInstruction::kRemInt)
+                && inst1->fIntValue == 0) {
+                end = cur + 1;
+                return (*cur)->copy();
+            }
             end = cur + 3;
             return rewriteBinaryIntMath(inst1, inst2, inst3);
             
@@ -1199,12 +1280,11 @@ struct FIRInstructionOptimizer {
             // Specialization
             if (inst1->fOpcode == FIRInstruction::kInt32Value && FIRInstruction::isChoice(inst2->fOpcode)) {
                 
-                if (inst1->fIntValue == 1) {
+                // Any non zero condition is 'true', as when executed
+                if (inst1->fIntValue != 0) {
                     new_block->merge(optimize_aux(inst2->fBranch1, optimizer));
-                } else if (inst1->fIntValue == 0) {
-                    new_block->merge(optimize_aux(inst2->fBranch2, optimizer));
                 } else {
-                    faustassert(false);
+                    new_block->merge(optimize_aux(inst2->fBranch2, optimizer));
                 }
                 cur += 2;
                     
@@ -1222,6 +1302,12 @@ struct FIRInstructionOptimizer {
                                                            optimize_aux(inst1->fBranch1, optimizer),
                                                            optimize_aux(inst1->fBranch2, optimizer)));
                 cur++;
+            } else if (inst1->fOpcode == FIRInstruction::kTask) {
+                new_block->push(new FIRBasicInstruction<T>(inst1->fOpcode,
+                                                           inst1->fIntValue, inst1->fRealValue,
+                                                           inst1->fOffset1, inst1->fOffset2,
+                                                           optimize_aux(inst1->fBranch1, optimizer), 0));
+                cur++;
             } else if (inst1->fOpcode == FIRInstruction::kCondBranch) {
                 // Special case for loops : branch to new_block
                 new_block->push(new FIRBasicInstruction<T>(FIRInstruction::kCondBranch, 0, 0, 0, 0, new_block, 0));
@@ -1330,6 +1416,212 @@ struct FIRInstructionOptimizer {
         return res_block;
     }
    
+    // Count the heap accesses of a block (and of its sub-blocks) at optimization level 0 or 1 : direct loads of each location,
+    // and instructions that possibly write it (indexed stores are counted on the whole array)
+    static void countHeapAccesses(FIRBlockInstruction<T>* block,
+                                  std::vector<int>& real_loads, std::vector<int>& int_loads,
+                                  std::vector<int>& real_stores, std::vector<int>& int_stores)
+    {
+        InstructionIT it;
+        for (it = block->fInstructions.begin(); it != block->fInstructions.end(); it++) {
+            FIRBasicInstruction<T>* inst = *it;
+            switch (inst->fOpcode) {
+                case FIRInstruction::kLoadReal:
+                    real_loads[inst->fOffset1]++;
+                    break;
+                case FIRInstruction::kLoadInt:
+                    int_loads[inst->fOffset1]++;
+                    break;
+                case FIRInstruction::kStoreReal:
+                case FIRInstruction::kStoreRealValue:
+                case FIRInstruction::kMoveReal:
+                    real_stores[inst->fOffset1]++;
+                    break;
+                case FIRInstruction::kStoreInt:
+                case FIRInstruction::kStoreIntValue:
+                case FIRInstruction::kMoveInt:
+                    int_stores[inst->fOffset1]++;
+                    break;
+                case FIRInstruction::kPairMoveReal:
+                    real_stores[inst->fOffset1]++;
+                    real_stores[inst->fOffset2]++;
+                    break;
+                case FIRInstruction::kPairMoveInt:
+                    int_stores[inst->fOffset1]++;
+                    int_stores[inst->fOffset2]++;
+                    break;
+                case FIRInstruction::kStoreIndexedReal:
+                case FIRInstruction::kBlockStoreReal:
+                    for (int i = 0; i < inst->fOffset2; i++) { real_stores[inst->fOffset1 + i]++; }
+                    break;
+                case FIRInstruction::kStoreIndexedInt:
+                case FIRInstruction::kBlockStoreInt:
+                    for (int i = 0; i < inst->fOffset2; i++) { int_stores[inst->fOffset1 + i]++; }
+                    break;
+                case FIRInstruction::kBlockPairMoveReal:
+                    for (int i = inst->fOffset1; i < inst->fOffset2; i += 2) { real_stores[i + 1]++; }
+                    break;
+                case FIRInstruction::kBlockPairMoveInt:
+                    for (int i = inst->fOffset1; i < inst->fOffset2; i += 2) { int_stores[i + 1]++; }
+                    break;
+                case FIRInstruction::kBlockShiftReal:
+                    for (int i = inst->fOffset1; i > inst->fOffset2; i--) { real_stores[i]++; }
+                    break;
+                case FIRInstruction::kBlockShiftInt:
+                    for (int i = inst->fOffset1; i > inst->fOffset2; i--) { int_stores[i]++; }
+                    break;
+                default:
+                    break;
+            }
+            // kCondBranch branches back on its own block
+            if (inst->fBranch1 && inst->fOpcode != FIRInstruction::kCondBranch) {
+                countHeapAccesses(inst->fBranch1, real_loads, int_loads, real_stores, int_stores);
+            }
+            if (inst->fBranch2) {
+                countHeapAccesses(inst->fBranch2, real_loads, int_loads, real_stores, int_stores);
+            }
+        }
+    }
+    
+    // Whether an instruction (or its sub-blocks) possibly reads the real or int heap location 'offset'
+    static bool isHeapRead(FIRBasicInstruction<T>* inst, bool real, int offset)
+    {
+        bool read = false;
+        switch (inst->fOpcode) {
+            case FIRInstruction::kLoadReal:
+                read = real && (inst->fOffset1 == offset);
+                break;
+            case FIRInstruction::kLoadInt:
+                read = !real && (inst->fOffset1 == offset);
+                break;
+            case FIRInstruction::kMoveReal:
+                read = real && (inst->fOffset2 == offset);
+                break;
+            case FIRInstruction::kMoveInt:
+                read = !real && (inst->fOffset2 == offset);
+                break;
+            case FIRInstruction::kPairMoveReal:
+                read = real && (inst->fOffset1 - 1 == offset || inst->fOffset2 - 1 == offset);
+                break;
+            case FIRInstruction::kPairMoveInt:
+                read = !real && (inst->fOffset1 - 1 == offset || inst->fOffset2 - 1 == offset);
+                break;
+            case FIRInstruction::kLoadIndexedReal:
+                read = real && (offset >= inst->fOffset1 && offset < inst->fOffset1 + inst->fOffset2);
+                break;
+            case FIRInstruction::kLoadIndexedInt:
+                read = !real && (offset >= inst->fOffset1 && offset < inst->fOffset1 + inst->fOffset2);
+                break;
+            case FIRInstruction::kBlockPairMoveReal:
+                read = real && (offset >= inst->fOffset1 && offset < inst->fOffset2);
+                break;
+            case FIRInstruction::kBlockPairMoveInt:
+                read = !real && (offset >= inst->fOffset1 && offset < inst->fOffset2);
+                break;
+            case FIRInstruction::kBlockShiftReal:
+                read = real && (offset >= inst->fOffset2 && offset < inst->fOffset1);
+                break;
+            case FIRInstruction::kBlockShiftInt:
+                read = !real && (offset >= inst->fOffset2 && offset < inst->fOffset1);
+                break;
+            default:
+                break;
+        }
+        if (read) {
+            return true;
+        }
+        
+        FIRBlockInstruction<T>* branches[] = { (inst->fOpcode != FIRInstruction::kCondBranch) ? inst->fBranch1 : 0, inst->fBranch2 };
+        for (int i = 0; i < 2; i++) {
+            if (branches[i]) {
+                InstructionIT it;
+                for (it = branches[i]->fInstructions.begin(); it != branches[i]->fInstructions.end(); it++) {
+                    if (isHeapRead(*it, real, offset)) return true;
+                }
+            }
+        }
+        return false;
+    }
+    
+    // Propagate the constant values of the maps in a block, then fold the resulting constant expressions (the block is deleted)
+    static FIRBlockInstruction<T>* foldValues(FIRBlockInstruction<T>* cur_block, std::map<int, int>& int_map, std::map<int, T>& real_map)
+    {
+        FIRInstructionConstantValueMap2Heap<T> map_2_heap(int_map, real_map);
+        FIRInstructionCastSpecializer<T> cast_specializer;
+        FIRInstructionMathSpecializer<T> math_specializer;
+        
+        int cur_block_size = cur_block->size();
+        int new_block_size = cur_block->size();
+        
+        do {
+            cur_block_size = new_block_size;
+            cur_block = optimize(cur_block, map_2_heap);
+            cur_block = specialize(cur_block, cast_specializer);
+            cur_block = specialize(cur_block, math_specializer);
+            new_block_size = cur_block->size();
+        } while (new_block_size < cur_block_size);
+        
+        return cur_block;
+    }
+    
+    /*
+     Specialize the 'control' and 'DSP' compute blocks (at optimization level 0 or 1) for heap locations known to be constant
+     while they are executed (frozen controls for instance) : their loads are replaced by the values of the maps and folded.
+     Values stored at the top level of the 'control' block (that is executed first, and once) become constant in turn,
+     if nothing else writes them and if they are not read before : they are added in the maps and propagated in both blocks.
+     Stores are kept, so that the heap is the same as with the original code, and Real values that are not folded are loaded again.
+     The blocks are replaced by their specialized version.
+    */
+    static void specializeCompute(FIRBlockInstruction<T>*& control, FIRBlockInstruction<T>*& dsp,
+                                  std::map<int, int>& int_map, std::map<int, T>& real_map,
+                                  int int_heap_size, int real_heap_size)
+    {
+        std::vector<int> real_loads(real_heap_size), int_loads(int_heap_size);
+        std::vector<int> real_stores(real_heap_size), int_stores(int_heap_size);
+        countHeapAccesses(control, real_loads, int_loads, real_stores, int_stores);
+        countHeapAccesses(dsp, real_loads, int_loads, real_stores, int_stores);
+        
+        bool propagated;
+        do {
+            control = foldValues(control, int_map, real_map);
+            propagated = false;
+            
+            for (size_t i = 0; i + 1 < control->fInstructions.size(); i++) {
+                FIRBasicInstruction<T>* inst1 = control->fInstructions[i];
+                FIRBasicInstruction<T>* inst2 = control->fInstructions[i + 1];
+                bool real = (inst1->fOpcode == FIRInstruction::kRealValue && inst2->fOpcode == FIRInstruction::kStoreReal);
+                bool integer = (inst1->fOpcode == FIRInstruction::kInt32Value && inst2->fOpcode == FIRInstruction::kStoreInt);
+                int offset = inst2->fOffset1;
+                
+                if (!(real || integer)
+                    || (real && (real_stores[offset] != 1 || real_map.find(offset) != real_map.end()))
+                    || (integer && (int_stores[offset] != 1 || int_map.find(offset) != int_map.end()))) {
+                    continue;
+                }
+                
+                bool read = false;
+                for (size_t j = 0; j < i && !read; j++) {
+                    read = isHeapRead(control->fInstructions[j], real, offset);
+                }
+                if (!read) {
+                    if (real) {
+                        real_map[offset] = inst1->fRealValue;
+                    } else {
+                        int_map[offset] = inst1->fIntValue;
+                    }
+                    propagated = true;
+                }
+            }
+            
+        } while (propagated);
+        
+        dsp = foldValues(dsp, int_map, real_map);
+        
+        FIRInstructionConstantValueReload<T> reload;
+        control = optimize(control, reload);
+        dsp = optimize(dsp, reload);
+    }
+    
     static FIRBlockInstruction<T>* optimizeBlock(FIRBlockInstruction<T>* block, int min_level, int max_level)
     {
         //std::cout << "optimizeBlock = " << block->size() << std::endl;
@@ -1382,6 +1674,14 @@ struct FIRInstructionOptimizer {
             //block->write(&std::cout);
         }
         
+        if (min_level <= 7 && 7 <= max_level) {
+            // 7) optimize the hottest sequences in fused instructions
+            FIRInstructionSuperOptimizer<T> opt7;
+            block = FIRInstructionOptimizer<T>::optimize(block, opt7);
+            //std::cout << "FIRInstructionSuperOptimizer block size = " << block->size() << std::endl;
+            //block->write(&std::cout);
+        }
+        
         return block;
     }
 };
@@ -0,0 +1,412 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef _FIR_INTERPRETER_PROFILER_H
+#define _FIR_INTERPRETER_PROFILER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+#include "interpreter_bytecode.hh"
+
+/*
+ Names of the DSP fields in the heaps, kept by the factories compiled from a DSP source
+ (the ones read from a text or binary image only know the heap offsets). Used by the sampling profiler
+ and to move the state of an instance to another backend (see tiered_dsp).
+*/
+
+struct FIRHeapNames {
+
+    // Start offset of each field : name and size
+    std::map<int, std::pair<std::string, int> > fRealFields;
+    std::map<int, std::pair<std::string, int> > fIntFields;
+
+    void addField(bool is_int, int offset, int size, const std::string& name)
+    {
+        (is_int ? fIntFields : fRealFields)[offset] = std::make_pair(name, size);
+    }
+
+    // Location of a field given by its name, false if unknown
+    bool findField(const std::string& name, bool& is_int, int& offset, int& size) const
+    {
+        for (int i = 0; i < 2; i++) {
+            const std::map<int, std::pair<std::string, int> >& fields = (i == 0) ? fIntFields : fRealFields;
+            std::map<int, std::pair<std::string, int> >::const_iterator it;
+            for (it = fields.begin(); it != fields.end(); it++) {
+                if ((*it).second.first == name) {
+                    is_int = (i == 0);
+                    offset = (*it).first;
+                    size = (*it).second.second;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Name of the field containing 'offset' : 'fRec0[1]' for a given array item, 'fVec0[...]' for an indexed access
+    std::string getName(bool is_int, int offset, bool indexed = false) const
+    {
+        const std::map<int, std::pair<std::string, int> >& fields = (is_int ? fIntFields : fRealFields);
+        std::map<int, std::pair<std::string, int> >::const_iterator it = fields.upper_bound(offset);
+        std::stringstream name;
+        if (it != fields.begin() && offset < (--it)->first + (*it).second.second) {
+            name << (*it).second.first;
+            if (indexed) {
+                name << "[...]";
+            } else if ((*it).second.second > 1) {
+                name << "[" << (offset - (*it).first) << "]";
+            }
+        } else {
+            name << (is_int ? "int_heap[" : "real_heap[") << offset << "]";
+        }
+        return name.str();
+    }
+
+};
+
+/*
+ Sampling profiler of the flat code (trace mode 5) : every 'period' executed instructions (randomly jittered
+ to avoid aliasing with the loops), the duration of the next executed instruction is measured, from its
+ dispatch to the dispatch of the following one. Counts and durations are kept per instruction of each flat block,
+ then reported by block, by sub-block (loops and branches) and by statement, a statement being the sequence
+ of instructions that ends by storing a given heap location or output.
+*/
+
+template <class T>
+class FIRProfiler {
+
+    private:
+
+        struct BlockProfile {
+            FlatInstructionIT fBase;
+            std::vector<long long> fSamples;
+            std::vector<long long> fTicks;
+        };
+
+        // Sub-block of a flat block
+        struct Range {
+            int fStart;
+            int fEnd;
+            int fParent;
+            std::string fName;
+            long long fSamples;
+            long long fTicks;
+        };
+
+        struct Statement {
+            std::string fName;
+            long long fSamples;
+            long long fTicks;
+            bool operator<(const Statement& other) const { return fTicks > other.fTicks; }
+        };
+
+        std::map<FIRFlatBlockInstruction<T>*, BlockProfile> fProfiles;
+        BlockProfile* fCurrent;
+
+        int fPeriod;
+        int fCountdown;
+        int fPending;           // Index of the measured instruction, or -1
+        unsigned long long fStart;
+        unsigned long long fOverhead;
+        unsigned int fSeed;
+
+        static inline unsigned long long readTicks()
+        {
+        #if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+        #else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        #endif
+        }
+
+        static const char* ticksUnit()
+        {
+        #if defined(__x86_64__) || defined(__i386__)
+            return "cycles";
+        #else
+            return "ns";
+        #endif
+        }
+
+        int nextPeriod()
+        {
+            fSeed = fSeed * 1103515245 + 12345;
+            return fPeriod / 2 + int((fSeed >> 8) % unsigned(fPeriod)) + 1;
+        }
+
+        // Destination of the statements ended by 'inst', or empty if 'inst' does not end a statement
+        static std::string getDestination(const FIRFlatInstruction<T>& inst, const FIRHeapNames& names)
+        {
+            switch (inst.fOpcode) {
+
+                case FIRInstruction::kStoreReal:
+                case FIRInstruction::kStoreRealValue:
+                case FIRInstruction::kMoveReal:
+                case FIRInstruction::kPairMoveReal:
+                    return names.getName(false, inst.fOffset1);
+
+                case FIRInstruction::kStoreInt:
+                case FIRInstruction::kStoreIntValue:
+                case FIRInstruction::kMoveInt:
+                case FIRInstruction::kPairMoveInt:
+                    return names.getName(true, inst.fOffset1);
+
+                case FIRInstruction::kAddRealStackStore:
+                    return names.getName(false, inst.fOffset2);
+
+                case FIRInstruction::kStoreIndexedReal:
+                case FIRInstruction::kStoreIndexedRealHeap:
+                case FIRInstruction::kBlockStoreReal:
+                case FIRInstruction::kBlockPairMoveReal:
+                case FIRInstruction::kBlockShiftReal:
+                    return names.getName(false, inst.fOffset1, true);
+
+                case FIRInstruction::kStoreIndexedInt:
+                case FIRInstruction::kBlockStoreInt:
+                case FIRInstruction::kBlockPairMoveInt:
+                case FIRInstruction::kBlockShiftInt:
+                    return names.getName(true, inst.fOffset1, true);
+
+                case FIRInstruction::kStoreOutput:
+                case FIRInstruction::kStoreOutputHeap: {
+                    std::stringstream name;
+                    name << "output" << inst.fOffset1;
+                    return name.str();
+                }
+
+                case FIRInstruction::kLoop:
+                    return "(loop)";
+
+                case FIRInstruction::kIf:
+                    return "(if)";
+
+                case FIRInstruction::kCondBranch:
+                    return "(loop condition)";
+
+                default:
+                    return "";
+            }
+        }
+
+        // Name of a loop, from the loop variable set by its first block
+        static std::string getLoopName(FIRFlatBlockInstruction<T>* block, int start, const FIRHeapNames& names)
+        {
+            for (int i = start; i < block->size(); i++) {
+                std::string dst = getDestination(block->fInstructions[i], names);
+                if (dst != "") {
+                    return "loop " + dst;
+                }
+            }
+            return "loop";
+        }
+
+        // Sub-blocks are laid out contiguously after their parent block : their start indexes delimit them
+        static void getRanges(FIRFlatBlockInstruction<T>* block, const std::string& name, const FIRHeapNames& names, std::vector<Range>& ranges)
+        {
+            std::map<int, std::pair<int, std::string> > starts;
+            starts[0] = std::make_pair(-1, name);
+            for (int i = 0; i < block->size(); i++) {
+                const FIRFlatInstruction<T>& inst = block->fInstructions[i];
+                if (inst.fOpcode == FIRInstruction::kLoop) {
+                    std::string loop = getLoopName(block, i + inst.fBranch1, names);
+                    starts[i + inst.fBranch1] = std::make_pair(i, loop + " (init)");
+                    starts[i + inst.fBranch2] = std::make_pair(i, loop);
+                } else if (inst.fOpcode == FIRInstruction::kIf
+                           || inst.fOpcode == FIRInstruction::kSelectReal
+                           || inst.fOpcode == FIRInstruction::kSelectInt) {
+                    std::string kind = (inst.fOpcode == FIRInstruction::kIf) ? "if" : "select";
+                    if (inst.fBranch1) { starts[i + inst.fBranch1] = std::make_pair(i, kind + " (then)"); }
+                    if (inst.fBranch2) { starts[i + inst.fBranch2] = std::make_pair(i, kind + " (else)"); }
+                }
+            }
+
+            // Parents are given as instruction indexes, then resolved as range indexes
+            for (std::map<int, std::pair<int, std::string> >::iterator it = starts.begin(); it != starts.end(); it++) {
+                Range range;
+                range.fStart = (*it).first;
+                range.fParent = (*it).second.first;
+                range.fName = (*it).second.second;
+                range.fSamples = range.fTicks = 0;
+                ranges.push_back(range);
+            }
+            for (size_t r = 0; r < ranges.size(); r++) {
+                ranges[r].fEnd = (r + 1 < ranges.size()) ? ranges[r + 1].fStart : block->size();
+            }
+            for (size_t r = 0; r < ranges.size(); r++) {
+                if (ranges[r].fParent >= 0) {
+                    int parent = findRange(ranges, ranges[r].fParent);
+                    ranges[r].fParent = parent;
+                    ranges[r].fName = ranges[parent].fName + " / " + ranges[r].fName;
+                }
+            }
+        }
+
+        static int findRange(const std::vector<Range>& ranges, int index)
+        {
+            int r = 0;
+            while (r + 1 < int(ranges.size()) && ranges[r + 1].fStart <= index) { r++; }
+            return r;
+        }
+
+        static std::string percent(long long value, long long total)
+        {
+            std::stringstream res;
+            res << std::fixed << std::setprecision(2) << std::setw(6) << ((total > 0) ? (100. * value) / total : 0.) << "%";
+            return res.str();
+        }
+
+    public:
+
+        FIRProfiler(int period):fCurrent(0), fPeriod(std::max(1, period)), fPending(-1), fStart(0), fSeed(1)
+        {
+            fCountdown = nextPeriod();
+
+            // Cost of the measure itself
+            fOverhead = (unsigned long long)-1;
+            for (int i = 0; i < 64; i++) {
+                unsigned long long start = readTicks();
+                fOverhead = std::min(fOverhead, readTicks() - start);
+            }
+        }
+
+        // Called when the execution of 'block' starts
+        void begin(FIRFlatBlockInstruction<T>* block)
+        {
+            BlockProfile& profile = fProfiles[block];
+            if (profile.fSamples.size() == 0) {
+                profile.fBase = &block->fInstructions[0];
+                profile.fSamples.resize(block->size(), 0);
+                profile.fTicks.resize(block->size(), 0);
+            }
+            fCurrent = &profile;
+            // A measure that did not end in the previous block is dropped
+            fPending = -1;
+        }
+
+        // Called before the execution of each instruction
+        inline void count(FlatInstructionIT it)
+        {
+            if (--fCountdown == 0) {
+                sample(it);
+            }
+        }
+
+        void sample(FlatInstructionIT it)
+        {
+            unsigned long long now = readTicks();
+            if (fPending >= 0) {
+                // End of the measured instruction
+                unsigned long long ticks = now - fStart;
+                fCurrent->fSamples[fPending]++;
+                fCurrent->fTicks[fPending] += (ticks > fOverhead) ? (ticks - fOverhead) : 0;
+                fPending = -1;
+                fCountdown = nextPeriod();
+            } else {
+                // Measure the instruction that is going to be executed
+                fPending = int(it - fCurrent->fBase);
+                fCountdown = 1;
+                fStart = readTicks();
+            }
+        }
+
+        void print(std::ostream* out, const std::map<FIRFlatBlockInstruction<T>*, std::string>& block_names, const FIRHeapNames& names)
+        {
+            std::vector<Range> all_ranges;
+            std::vector<Statement> statements;
+            long long total_samples = 0;
+            long long total_ticks = 0;
+
+            typename std::map<FIRFlatBlockInstruction<T>*, std::string>::const_iterator name_it;
+            for (name_it = block_names.begin(); name_it != block_names.end(); name_it++) {
+                FIRFlatBlockInstruction<T>* block = (*name_it).first;
+                if (!block || fProfiles.find(block) == fProfiles.end()) continue;
+                BlockProfile& profile = fProfiles[block];
+
+                std::vector<Range> ranges;
+                getRanges(block, (*name_it).second, names, ranges);
+
+                for (size_t r = 0; r < ranges.size(); r++) {
+                    Statement statement = { "", 0, 0 };
+                    for (int i = ranges[r].fStart; i < ranges[r].fEnd; i++) {
+                        statement.fSamples += profile.fSamples[i];
+                        statement.fTicks += profile.fTicks[i];
+                        std::string dst = getDestination(block->fInstructions[i], names);
+                        if (dst != "" || i == ranges[r].fEnd - 1) {
+                            statement.fName = ranges[r].fName + " : " + ((dst != "") ? dst : "(return)");
+                            if (statement.fSamples > 0) {
+                                statements.push_back(statement);
+                            }
+                            ranges[r].fSamples += statement.fSamples;
+                            ranges[r].fTicks += statement.fTicks;
+                            statement.fSamples = statement.fTicks = 0;
+                        }
+                    }
+                    total_samples += ranges[r].fSamples;
+                    total_ticks += ranges[r].fTicks;
+                }
+
+                // Cumulate sub-blocks in their parents (sub-blocks follow their parent)
+                for (int r = int(ranges.size()) - 1; r > 0; r--) {
+                    ranges[ranges[r].fParent].fSamples += ranges[r].fSamples;
+                    ranges[ranges[r].fParent].fTicks += ranges[r].fTicks;
+                }
+                all_ranges.insert(all_ranges.end(), ranges.begin(), ranges.end());
+            }
+
+            *out << "Sampling profile : 1 instruction measured every " << fPeriod << " executed instructions" << std::endl;
+            *out << "Samples: " << total_samples << ", estimated executed instructions: " << total_samples * fPeriod
+                 << ", measured " << ticksUnit() << ": " << total_ticks << std::endl;
+            if (total_samples == 0) {
+                return;
+            }
+
+            *out << "Blocks (" << ticksUnit() << " and executed instructions, sub-blocks included, above 0.05%):" << std::endl;
+            for (size_t r = 0; r < all_ranges.size(); r++) {
+                if (all_ranges[r].fTicks * 2000 >= total_ticks || all_ranges[r].fSamples * 2000 >= total_samples) {
+                    *out << percent(all_ranges[r].fTicks, total_ticks) << " " << percent(all_ranges[r].fSamples, total_samples)
+                         << " " << all_ranges[r].fName << std::endl;
+                }
+            }
+
+            std::sort(statements.begin(), statements.end());
+            *out << "Hottest statements (" << ticksUnit() << " and executed instructions):" << std::endl;
+            for (size_t s = 0; s < std::min(size_t(30), statements.size()); s++) {
+                *out << percent(statements[s].fTicks, total_ticks) << " " << percent(statements[s].fSamples, total_samples)
+                     << " " << statements[s].fName << std::endl;
+            }
+        }
+
+};
+
+#endif
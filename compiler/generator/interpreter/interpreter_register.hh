@@ -0,0 +1,742 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef _FIR_INTERPRETER_REGISTER_H
+#define _FIR_INTERPRETER_REGISTER_H
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <iostream>
+
+#include "interpreter_bytecode.hh"
+#include "exception.hh"
+
+/*
+ Register bytecode : the stack bytecode is translated in 'three address' instructions that directly name
+ their operands and result. Each DSP instance uses a single memory per type, laid out as:
+
+    [heap | registers | constants]
+
+ so that heap variables, registers and constants can all be used as operands without any load/store.
+ The translation simulates the stack: values pushed by the stack code are kept as operand locations, and
+ the register used for a result is the stack slot the stack machine would have used. Structured control
+ (kIf, kSelectReal/kSelectInt, kLoop) is translated in linear code with relative jumps.
+*/
+
+struct FIRRegisterInstruction {
+
+    enum Opcode {
+
+        // Memory
+        kMoveReal, kMoveInt,
+        kLoadIndexedReal, kLoadIndexedInt,
+        kStoreIndexedReal, kStoreIndexedInt,
+        kBlockStoreReal, kBlockStoreInt,
+        kPairMoveReal, kPairMoveInt,
+        kBlockPairMoveReal, kBlockPairMoveInt,
+        kBlockShiftReal, kBlockShiftInt,
+        kLoadInput, kStoreOutput,
+
+        // Cast/Bitcast
+        kCastReal, kCastInt,
+        kBitcastInt, kBitcastReal,
+
+        // Standard math (same order as FIRInstruction)
+        kAddReal, kAddInt, kSubReal, kSubInt,
+        kMultReal, kMultInt, kDivReal, kDivInt,
+        kRemReal, kRemInt, kLshInt, kRshInt, kGTInt,
+        kLTInt, kGEInt, kLEInt, kEQInt, kNEInt,
+        kGTReal, kLTReal, kGEReal,
+        kLEReal, kEQReal, kNEReal,
+        kANDInt, kORInt, kXORInt,
+
+        // Extended unary math (same order as FIRInstruction)
+        kAbs, kAbsf,
+        kAcosf, kAsinf,
+        kAtanf,
+        kCeilf,
+        kCosf, kCoshf,
+        kExpf,
+        kFloorf,
+        kLogf, kLog10f,
+        kRoundf,
+        kSinf, kSinhf,
+        kSqrtf,
+        kTanf, kTanhf,
+
+        // Extended binary math (same order as FIRInstruction)
+        kAtan2f,
+        kFmodf,
+        kPowf,
+        kMax, kMaxf,
+        kMin, kMinf,
+
+        // Control
+        kJump, kCondJump,
+        kReturn
+    };
+
+};
+
+static std::string gFIRRegisterInstructionTable[] = {
+
+    // Memory
+    "kMoveReal", "kMoveInt",
+    "kLoadIndexedReal", "kLoadIndexedInt",
+    "kStoreIndexedReal", "kStoreIndexedInt",
+    "kBlockStoreReal", "kBlockStoreInt",
+    "kPairMoveReal", "kPairMoveInt",
+    "kBlockPairMoveReal", "kBlockPairMoveInt",
+    "kBlockShiftReal", "kBlockShiftInt",
+    "kLoadInput", "kStoreOutput",
+
+    // Cast/Bitcast
+    "kCastReal", "kCastInt",
+    "kBitcastInt", "kBitcastReal",
+
+    // Standard math
+    "kAddReal", "kAddInt", "kSubReal", "kSubInt",
+    "kMultReal", "kMultInt", "kDivReal", "kDivInt",
+    "kRemReal", "kRemInt", "kLshInt", "kRshInt", "kGTInt",
+    "kLTInt", "kGEInt", "kLEInt", "kEQInt", "kNEInt",
+    "kGTReal", "kLTReal", "kGEReal",
+    "kLEReal", "kEQReal", "kNEReal",
+    "kANDInt", "kORInt", "kXORInt",
+
+    // Extended unary math
+    "kAbs", "kAbsf",
+    "kAcosf", "kAsinf",
+    "kAtanf",
+    "kCeilf",
+    "kCosf", "kCoshf",
+    "kExpf",
+    "kFloorf",
+    "kLogf", "kLog10f",
+    "kRoundf",
+    "kSinf", "kSinhf",
+    "kSqrtf",
+    "kTanf", "kTanhf",
+
+    // Extended binary math
+    "kAtan2f",
+    "kFmodf",
+    "kPowf",
+    "kMax", "kMaxf",
+    "kMin", "kMinf",
+
+    // Control
+    "kJump", "kCondJump",
+    "kReturn"
+};
+
+template <class T>
+struct FIRRegInstruction {
+
+    void* fLabel;       // Computed-goto label, resolved by 'link'
+    FIRRegisterInstruction::Opcode fOpcode;
+    int fDst;           // Result location
+    int fSrc1;          // First operand location (the top of stack value in the stack code)
+    int fSrc2;          // Second operand location
+    int fOffset1;       // Array offset, input/output channel, or first offset of block moves
+    int fOffset2;       // Second offset of block moves, or size of block stores
+    int fBranch;        // Relative offset of the jump target
+
+    void write(std::ostream* out)
+    {
+        *out << "opcode " << fOpcode << " "
+        << gFIRRegisterInstructionTable[fOpcode]
+        << " dst " << fDst
+        << " src1 " << fSrc1
+        << " src2 " << fSrc2
+        << " offset1 " << fOffset1
+        << " offset2 " << fOffset2
+        << " branch " << fBranch
+        << std::endl;
+    }
+
+};
+
+#define RegInstructionIT FIRRegInstruction<T>*
+
+template <class T>
+struct FIRRegBlockInstruction {
+
+    std::vector<FIRRegInstruction<T> > fInstructions;
+    bool fLinked;
+    void* fNativeCode;  // Native version of the block (see interpreter_native.hh), or 0
+
+    FIRRegBlockInstruction():fLinked(false), fNativeCode(0)
+    {}
+
+    // Resolve computed-goto labels using the interpreter dispatch table
+    void link(void** dispatch_table)
+    {
+        for (size_t i = 0; i < fInstructions.size(); i++) {
+            fInstructions[i].fLabel = dispatch_table[fInstructions[i].fOpcode];
+        }
+        fLinked = true;
+    }
+
+    void write(std::ostream* out)
+    {
+        *out << "reg_block_size " << fInstructions.size() << std::endl;
+        for (size_t i = 0; i < fInstructions.size(); i++) {
+            fInstructions[i].write(out);
+        }
+    }
+
+    int size() { return int(fInstructions.size()); }
+
+};
+
+// Translation of the stack bytecode in register bytecode
+
+template <class T>
+class FIRRegisterCompiler {
+
+    private:
+
+        // Constants are tagged until their final location is known (see 'finalize')
+        enum { kRealConstantTag = 1 << 29, kIntConstantTag = 1 << 30, kConstantMask = kRealConstantTag - 1 };
+        enum { kNoResult, kRealResult, kIntResult };
+
+        int fRealHeapSize;
+        int fIntHeapSize;
+        int fRealRegisters;
+        int fIntRegisters;
+
+        std::vector<T> fRealConstants;
+        std::vector<int> fIntConstants;
+        std::map<T, int> fRealConstantsMap;
+        std::map<int, int> fIntConstantsMap;
+
+        std::vector<FIRRegBlockInstruction<T>*> fBlocks;  // Compiled blocks, owned by the compiler
+
+        // Translation state of the current block
+        FIRRegBlockInstruction<T>* fCode;
+        std::vector<int> fRealStack;
+        std::vector<int> fIntStack;
+        std::map<FIRBlockInstruction<T>*, int> fLoopStart;
+        int fLastResult;
+
+        int realRegister(int slot)
+        {
+            fRealRegisters = std::max(fRealRegisters, slot + 1);
+            return fRealHeapSize + slot;
+        }
+
+        int intRegister(int slot)
+        {
+            fIntRegisters = std::max(fIntRegisters, slot + 1);
+            return fIntHeapSize + slot;
+        }
+
+        int realConstant(T val)
+        {
+            // NaN cannot be used as a map key, and -0.0 would be merged with 0.0
+            if ((val != val) || ((val == T(0)) && std::signbit(val))) {
+                fRealConstants.push_back(val);
+                return kRealConstantTag | int(fRealConstants.size() - 1);
+            }
+            if (fRealConstantsMap.find(val) == fRealConstantsMap.end()) {
+                fRealConstantsMap[val] = int(fRealConstants.size());
+                fRealConstants.push_back(val);
+            }
+            return kRealConstantTag | fRealConstantsMap[val];
+        }
+
+        int intConstant(int val)
+        {
+            if (fIntConstantsMap.find(val) == fIntConstantsMap.end()) {
+                fIntConstantsMap[val] = int(fIntConstants.size());
+                fIntConstants.push_back(val);
+            }
+            return kIntConstantTag | fIntConstantsMap[val];
+        }
+
+        bool isRealHeap(int location) { return !(location & kRealConstantTag) && (location < fRealHeapSize); }
+        bool isIntHeap(int location) { return !(location & kIntConstantTag) && (location < fIntHeapSize); }
+
+        int emit(FIRRegisterInstruction::Opcode opcode, int dst, int src1, int src2, int offset1 = 0, int offset2 = 0)
+        {
+            FIRRegInstruction<T> inst;
+            inst.fLabel = 0;
+            inst.fOpcode = opcode;
+            inst.fDst = dst;
+            inst.fSrc1 = src1;
+            inst.fSrc2 = src2;
+            inst.fOffset1 = offset1;
+            inst.fOffset2 = offset2;
+            inst.fBranch = 0;
+            fCode->fInstructions.push_back(inst);
+            fLastResult = kNoResult;
+            return int(fCode->fInstructions.size() - 1);
+        }
+
+        // Jump targets are the next emitted instruction
+        void label(int jump)
+        {
+            fCode->fInstructions[jump].fBranch = int(fCode->fInstructions.size()) - jump;
+            fLastResult = kNoResult;
+        }
+
+        int popReal()
+        {
+            if (fRealStack.size() == 0) {
+                throw faustexception("ERROR : unbalanced stack code cannot be translated in register mode\n");
+            }
+            int location = fRealStack.back();
+            fRealStack.pop_back();
+            return location;
+        }
+
+        int popInt()
+        {
+            if (fIntStack.size() == 0) {
+                throw faustexception("ERROR : unbalanced stack code cannot be translated in register mode\n");
+            }
+            int location = fIntStack.back();
+            fIntStack.pop_back();
+            return location;
+        }
+
+        void pushReal(FIRRegisterInstruction::Opcode opcode, int src1, int src2 = 0, int offset1 = 0)
+        {
+            int reg = realRegister(int(fRealStack.size()));
+            emit(opcode, reg, src1, src2, offset1);
+            fRealStack.push_back(reg);
+            fLastResult = kRealResult;
+        }
+
+        void pushInt(FIRRegisterInstruction::Opcode opcode, int src1, int src2 = 0, int offset1 = 0)
+        {
+            int reg = intRegister(int(fIntStack.size()));
+            emit(opcode, reg, src1, src2, offset1);
+            fIntStack.push_back(reg);
+            fLastResult = kIntResult;
+        }
+
+        // Pending heap operands are copied in their register before the heap location is written
+        // (offset = -1 means any location) or before control flow splits
+        void materializeReal(int offset)
+        {
+            for (size_t i = 0; i < fRealStack.size(); i++) {
+                if (isRealHeap(fRealStack[i]) && (offset == -1 || fRealStack[i] == offset)) {
+                    int reg = realRegister(int(i));
+                    emit(FIRRegisterInstruction::kMoveReal, reg, fRealStack[i], 0);
+                    fRealStack[i] = reg;
+                }
+            }
+        }
+
+        void materializeInt(int offset)
+        {
+            for (size_t i = 0; i < fIntStack.size(); i++) {
+                if (isIntHeap(fIntStack[i]) && (offset == -1 || fIntStack[i] == offset)) {
+                    int reg = intRegister(int(i));
+                    emit(FIRRegisterInstruction::kMoveInt, reg, fIntStack[i], 0);
+                    fIntStack[i] = reg;
+                }
+            }
+        }
+
+        void materializeAll()
+        {
+            materializeReal(-1);
+            materializeInt(-1);
+        }
+
+        bool isPending(const std::vector<int>& stack, int offset)
+        {
+            return std::find(stack.begin(), stack.end(), offset) != stack.end();
+        }
+
+        void storeReal(int offset, int value)
+        {
+            if (!isPending(fRealStack, offset)
+                && (fLastResult == kRealResult)
+                && (fCode->fInstructions.back().fDst == value)) {
+                // The value has just been computed : directly write it at its final location
+                fCode->fInstructions.back().fDst = offset;
+            } else {
+                materializeReal(offset);
+                emit(FIRRegisterInstruction::kMoveReal, offset, value, 0);
+            }
+            fLastResult = kNoResult;
+        }
+
+        void storeInt(int offset, int value)
+        {
+            if (!isPending(fIntStack, offset)
+                && (fLastResult == kIntResult)
+                && (fCode->fInstructions.back().fDst == value)) {
+                // The value has just been computed : directly write it at its final location
+                fCode->fInstructions.back().fDst = offset;
+            } else {
+                materializeInt(offset);
+                emit(FIRRegisterInstruction::kMoveInt, offset, value, 0);
+            }
+            fLastResult = kNoResult;
+        }
+
+        // The value of each branch of a select is moved in the register of the select result
+        void selectResult(bool real, int slot)
+        {
+            if (real) {
+                int reg = realRegister(slot);
+                int value = popReal();
+                if (value != reg) {
+                    emit(FIRRegisterInstruction::kMoveReal, reg, value, 0);
+                }
+            } else {
+                int reg = intRegister(slot);
+                int value = popInt();
+                if (value != reg) {
+                    emit(FIRRegisterInstruction::kMoveInt, reg, value, 0);
+                }
+            }
+        }
+
+        static bool hasRealArguments(FIRInstruction::Opcode opcode)
+        {
+            return (opcode == FIRInstruction::kAddReal)
+                || (opcode == FIRInstruction::kSubReal)
+                || (opcode == FIRInstruction::kMultReal)
+                || (opcode == FIRInstruction::kDivReal)
+                || (opcode == FIRInstruction::kRemReal)
+                || (opcode == FIRInstruction::kGTReal)
+                || (opcode == FIRInstruction::kLTReal)
+                || (opcode == FIRInstruction::kGEReal)
+                || (opcode == FIRInstruction::kLEReal)
+                || (opcode == FIRInstruction::kEQReal)
+                || (opcode == FIRInstruction::kNEReal)
+                || (FIRInstruction::isExtendedUnaryMath(opcode) && (opcode != FIRInstruction::kAbs))
+                || (FIRInstruction::isExtendedBinaryMath(opcode) && (opcode != FIRInstruction::kMax) && (opcode != FIRInstruction::kMin));
+        }
+
+        void compileMath(FIRInstruction::Opcode opcode, FIRRegisterInstruction::Opcode reg_opcode, bool binary)
+        {
+            bool real_args = hasRealArguments(opcode);
+            int v1 = (real_args) ? popReal() : popInt();
+            int v2 = (binary) ? ((real_args) ? popReal() : popInt()) : 0;
+            if (FIRInstruction::isRealType(opcode)) {
+                pushReal(reg_opcode, v1, v2);
+            } else {
+                pushInt(reg_opcode, v1, v2);
+            }
+        }
+
+        void compileChoice(FIRBasicInstruction<T>* inst)
+        {
+            bool real = (inst->fOpcode == FIRInstruction::kSelectReal);
+            int cond = popInt();
+            materializeAll();
+            int slot = (real) ? int(fRealStack.size()) : int(fIntStack.size());
+
+            // 'else' code first, 'then' code is the jump target
+            int then_jump = emit(FIRRegisterInstruction::kCondJump, 0, cond, 0);
+            compileBlock(inst->fBranch2);
+            if (inst->fOpcode != FIRInstruction::kIf) { selectResult(real, slot); }
+            int end_jump = emit(FIRRegisterInstruction::kJump, 0, 0, 0);
+
+            label(then_jump);
+            compileBlock(inst->fBranch1);
+            if (inst->fOpcode != FIRInstruction::kIf) { selectResult(real, slot); }
+            label(end_jump);
+
+            if (inst->fOpcode == FIRInstruction::kSelectReal) {
+                fRealStack.push_back(realRegister(slot));
+            } else if (inst->fOpcode == FIRInstruction::kSelectInt) {
+                fIntStack.push_back(intRegister(slot));
+            }
+        }
+
+        void compileBlock(FIRBlockInstruction<T>* block)
+        {
+            for (InstructionIT it = block->fInstructions.begin(); it != block->fInstructions.end(); it++) {
+                FIRBasicInstruction<T>* inst = *it;
+                FIRInstruction::Opcode opcode = inst->fOpcode;
+
+                switch (opcode) {
+
+                    // Numbers and heap values are only kept as operand locations
+                    case FIRInstruction::kRealValue:
+                        fRealStack.push_back(realConstant(inst->fRealValue));
+                        break;
+
+                    case FIRInstruction::kInt32Value:
+                        fIntStack.push_back(intConstant(inst->fIntValue));
+                        break;
+
+                    case FIRInstruction::kLoadReal:
+                        fRealStack.push_back(inst->fOffset1);
+                        break;
+
+                    case FIRInstruction::kLoadInt:
+                        fIntStack.push_back(inst->fOffset1);
+                        break;
+
+                    case FIRInstruction::kStoreReal:
+                        storeReal(inst->fOffset1, popReal());
+                        break;
+
+                    case FIRInstruction::kStoreInt:
+                        storeInt(inst->fOffset1, popInt());
+                        break;
+
+                    case FIRInstruction::kStoreRealValue:
+                        storeReal(inst->fOffset1, realConstant(inst->fRealValue));
+                        break;
+
+                    case FIRInstruction::kStoreIntValue:
+                        storeInt(inst->fOffset1, intConstant(inst->fIntValue));
+                        break;
+
+                    case FIRInstruction::kLoadIndexedReal:
+                        pushReal(FIRRegisterInstruction::kLoadIndexedReal, popInt(), 0, inst->fOffset1);
+                        break;
+
+                    case FIRInstruction::kLoadIndexedInt:
+                        pushInt(FIRRegisterInstruction::kLoadIndexedInt, popInt(), 0, inst->fOffset1);
+                        break;
+
+                    case FIRInstruction::kStoreIndexedReal: {
+                        int index = popInt();
+                        int value = popReal();
+                        materializeReal(-1);
+                        emit(FIRRegisterInstruction::kStoreIndexedReal, 0, index, value, inst->fOffset1);
+                        break;
+                    }
+
+                    case FIRInstruction::kStoreIndexedInt: {
+                        int index = popInt();
+                        int value = popInt();
+                        materializeInt(-1);
+                        emit(FIRRegisterInstruction::kStoreIndexedInt, 0, index, value, inst->fOffset1);
+                        break;
+                    }
+
+                    case FIRInstruction::kBlockStoreReal: {
+                        // Values are kept in the constants area
+                        FIRBlockStoreRealInstruction<T>* store = static_cast<FIRBlockStoreRealInstruction<T>*>(inst);
+                        int start = kRealConstantTag | int(fRealConstants.size());
+                        fRealConstants.insert(fRealConstants.end(), store->fNumTable.begin(), store->fNumTable.end());
+                        materializeReal(-1);
+                        emit(FIRRegisterInstruction::kBlockStoreReal, 0, start, 0, inst->fOffset1, inst->fOffset2);
+                        break;
+                    }
+
+                    case FIRInstruction::kBlockStoreInt: {
+                        // Values are kept in the constants area
+                        FIRBlockStoreIntInstruction<T>* store = static_cast<FIRBlockStoreIntInstruction<T>*>(inst);
+                        int start = kIntConstantTag | int(fIntConstants.size());
+                        fIntConstants.insert(fIntConstants.end(), store->fNumTable.begin(), store->fNumTable.end());
+                        materializeInt(-1);
+                        emit(FIRRegisterInstruction::kBlockStoreInt, 0, start, 0, inst->fOffset1, inst->fOffset2);
+                        break;
+                    }
+
+                    case FIRInstruction::kMoveReal:
+                        materializeReal(inst->fOffset1);
+                        emit(FIRRegisterInstruction::kMoveReal, inst->fOffset1, inst->fOffset2, 0);
+                        break;
+
+                    case FIRInstruction::kMoveInt:
+                        materializeInt(inst->fOffset1);
+                        emit(FIRRegisterInstruction::kMoveInt, inst->fOffset1, inst->fOffset2, 0);
+                        break;
+
+                    case FIRInstruction::kPairMoveReal:
+                    case FIRInstruction::kBlockPairMoveReal:
+                    case FIRInstruction::kBlockShiftReal:
+                        materializeReal(-1);
+                        emit(FIRRegisterInstruction::Opcode(FIRRegisterInstruction::kPairMoveReal + (opcode - FIRInstruction::kPairMoveReal)),
+                             0, 0, 0, inst->fOffset1, inst->fOffset2);
+                        break;
+
+                    case FIRInstruction::kPairMoveInt:
+                    case FIRInstruction::kBlockPairMoveInt:
+                    case FIRInstruction::kBlockShiftInt:
+                        materializeInt(-1);
+                        emit(FIRRegisterInstruction::Opcode(FIRRegisterInstruction::kPairMoveReal + (opcode - FIRInstruction::kPairMoveReal)),
+                             0, 0, 0, inst->fOffset1, inst->fOffset2);
+                        break;
+
+                    case FIRInstruction::kLoadInput:
+                        pushReal(FIRRegisterInstruction::kLoadInput, popInt(), 0, inst->fOffset1);
+                        break;
+
+                    case FIRInstruction::kStoreOutput: {
+                        int index = popInt();
+                        int value = popReal();
+                        emit(FIRRegisterInstruction::kStoreOutput, 0, index, value, inst->fOffset1);
+                        break;
+                    }
+
+                    case FIRInstruction::kCastReal:
+                        pushReal(FIRRegisterInstruction::kCastReal, popInt());
+                        break;
+
+                    case FIRInstruction::kCastInt:
+                        pushInt(FIRRegisterInstruction::kCastInt, popReal());
+                        break;
+
+                    case FIRInstruction::kBitcastInt:
+                        pushInt(FIRRegisterInstruction::kBitcastInt, popReal());
+                        break;
+
+                    case FIRInstruction::kBitcastReal:
+                        pushReal(FIRRegisterInstruction::kBitcastReal, popInt());
+                        break;
+
+                    case FIRInstruction::kIf:
+                    case FIRInstruction::kSelectReal:
+                    case FIRInstruction::kSelectInt:
+                        compileChoice(inst);
+                        break;
+
+                    case FIRInstruction::kLoop:
+                        // Loop variable declaration block, then loop block (ended by kCondBranch)
+                        materializeAll();
+                        compileBlock(inst->fBranch1);
+                        fLoopStart[inst->fBranch2] = int(fCode->fInstructions.size());
+                        fLastResult = kNoResult;
+                        compileBlock(inst->fBranch2);
+                        break;
+
+                    case FIRInstruction::kCondBranch: {
+                        faustassert(fLoopStart.find(inst->fBranch1) != fLoopStart.end());
+                        int cond = popInt();
+                        materializeAll();
+                        int jump = emit(FIRRegisterInstruction::kCondJump, 0, cond, 0);
+                        fCode->fInstructions[jump].fBranch = fLoopStart[inst->fBranch1] - jump;
+                        break;
+                    }
+
+                    case FIRInstruction::kReturn:
+                    case FIRInstruction::kNop:
+                        break;
+                    
+                    case FIRInstruction::kTask:
+                        // Tasks would share the registers
+                        throw faustexception("ERROR : task groups (scheduler mode) cannot be translated in register mode\n");
+
+                    default:
+                        if (FIRInstruction::isMath(opcode)) {
+                            compileMath(opcode,
+                                        FIRRegisterInstruction::Opcode(FIRRegisterInstruction::kAddReal + (opcode - FIRInstruction::kAddReal)),
+                                        true);
+                        } else if (FIRInstruction::isExtendedUnaryMath(opcode)) {
+                            compileMath(opcode,
+                                        FIRRegisterInstruction::Opcode(FIRRegisterInstruction::kAbs + (opcode - FIRInstruction::kAbs)),
+                                        false);
+                        } else if (FIRInstruction::isExtendedBinaryMath(opcode)) {
+                            compileMath(opcode,
+                                        FIRRegisterInstruction::Opcode(FIRRegisterInstruction::kAtan2f + (opcode - FIRInstruction::kAtan2f)),
+                                        true);
+                        } else {
+                            std::stringstream error;
+                            error << "ERROR : instruction " << gFIRInstructionTable[opcode] << " not supported in register mode" << std::endl;
+                            throw faustexception(error.str());
+                        }
+                        break;
+                }
+            }
+        }
+
+        int relocate(int location)
+        {
+            if (location & kRealConstantTag) {
+                return fRealHeapSize + fRealRegisters + (location & kConstantMask);
+            } else if (location & kIntConstantTag) {
+                return fIntHeapSize + fIntRegisters + (location & kConstantMask);
+            } else {
+                return location;
+            }
+        }
+
+    public:
+
+        FIRRegisterCompiler(int real_heap_size, int int_heap_size)
+            :fRealHeapSize(real_heap_size), fIntHeapSize(int_heap_size),
+            fRealRegisters(0), fIntRegisters(0), fCode(0), fLastResult(kNoResult)
+        {
+            faustassert(real_heap_size < kRealConstantTag && int_heap_size < kRealConstantTag);
+        }
+        
+        virtual ~FIRRegisterCompiler()
+        {
+            for (size_t i = 0; i < fBlocks.size(); i++) {
+                delete fBlocks[i];
+            }
+        }
+
+        // Translate a stack code block (only using the opcodes produced by the optimizer up to level 4)
+        FIRRegBlockInstruction<T>* compile(FIRBlockInstruction<T>* block)
+        {
+            fCode = new FIRRegBlockInstruction<T>();
+            fBlocks.push_back(fCode);
+            fRealStack.clear();
+            fIntStack.clear();
+            fLoopStart.clear();
+            fLastResult = kNoResult;
+
+            compileBlock(block);
+            emit(FIRRegisterInstruction::kReturn, 0, 0, 0);
+            if (fRealStack.size() > 0 || fIntStack.size() > 0) {
+                throw faustexception("ERROR : unbalanced stack code cannot be translated in register mode\n");
+            }
+
+            return fCode;
+        }
+
+        // Constants are placed after the registers, whose number is only known when all blocks are compiled
+        void finalize()
+        {
+            for (size_t i = 0; i < fBlocks.size(); i++) {
+                for (size_t j = 0; j < fBlocks[i]->fInstructions.size(); j++) {
+                    FIRRegInstruction<T>& inst = fBlocks[i]->fInstructions[j];
+                    inst.fSrc1 = relocate(inst.fSrc1);
+                    inst.fSrc2 = relocate(inst.fSrc2);
+                }
+            }
+        }
+
+        int getRealMemorySize() { return fRealHeapSize + fRealRegisters + int(fRealConstants.size()); }
+        int getIntMemorySize() { return fIntHeapSize + fIntRegisters + int(fIntConstants.size()); }
+
+        // Copy constants in the memory of a DSP instance
+        void initMemory(T* real_memory, int* int_memory)
+        {
+            for (size_t i = 0; i < fRealConstants.size(); i++) {
+                real_memory[fRealHeapSize + fRealRegisters + i] = fRealConstants[i];
+            }
+            for (size_t i = 0; i < fIntConstants.size(); i++) {
+                int_memory[fIntHeapSize + fIntRegisters + i] = fIntConstants[i];
+            }
+        }
+
+};
+
+#endif
@@ -0,0 +1,166 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef _FIR_INTERPRETER_TASKS_H
+#define _FIR_INTERPRETER_TASKS_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ Worker threads of an instance compiled in scheduler mode (-sch) : the loops of the vector code that do not depend
+ on each other are compiled in groups of tasks (kTask instructions), executed by the thread running 'compute'
+ together with the workers. The number of workers is given by FAUST_INTERP_THREADS (by default, the number of cores - 1).
+ A group only lasts a few loops on a vector of samples, so the workers spin a while on the next group before sleeping.
+*/
+class FIRTaskPool {
+
+    public:
+
+        typedef void (*TaskFun)(void* arg, int task);
+
+    private:
+
+        std::vector<std::thread> fThreads;
+        std::mutex fMutex;
+        std::condition_variable fCond;
+
+        // Current group, changed under fMutex
+        std::atomic<int> fGeneration;
+        TaskFun fFun;
+        void* fArg;
+        int fCount;
+        int fNext;
+        bool fStop;
+
+        // Finished tasks of the current group
+        std::atomic<int> fDone;
+
+        static const int kSpinCount = 10000;
+
+        static inline void pause()
+        {
+        #if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+        #endif
+        }
+
+        // Take the next task of group 'generation', if any
+        bool nextTask(int generation, TaskFun& fun, void*& arg, int& task)
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            if (generation != fGeneration || fNext >= fCount) {
+                return false;
+            }
+            fun = fFun;
+            arg = fArg;
+            task = fNext++;
+            return true;
+        }
+
+        void runTasks(int generation)
+        {
+            TaskFun fun;
+            void* arg;
+            int task;
+            while (nextTask(generation, fun, arg, task)) {
+                fun(arg, task);
+                fDone++;
+            }
+        }
+
+        void worker()
+        {
+            int generation = 0;
+            while (true) {
+                for (int i = 0; i < kSpinCount && fGeneration == generation; i++) {
+                    pause();
+                }
+                {
+                    std::unique_lock<std::mutex> lock(fMutex);
+                    while (fGeneration == generation && !fStop) {
+                        fCond.wait(lock);
+                    }
+                    if (fStop) return;
+                    generation = fGeneration;
+                }
+                runTasks(generation);
+            }
+        }
+
+    public:
+
+        FIRTaskPool(int workers):fGeneration(0), fFun(0), fArg(0), fCount(0), fNext(0), fStop(false), fDone(0)
+        {
+            for (int i = 0; i < workers; i++) {
+                fThreads.push_back(std::thread(&FIRTaskPool::worker, this));
+            }
+        }
+
+        virtual ~FIRTaskPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(fMutex);
+                fStop = true;
+            }
+            fCond.notify_all();
+            for (size_t i = 0; i < fThreads.size(); i++) {
+                fThreads[i].join();
+            }
+        }
+
+        // Execute 'count' tasks, and return when all of them are done
+        void execute(TaskFun fun, void* arg, int count)
+        {
+            int generation;
+            {
+                std::lock_guard<std::mutex> lock(fMutex);
+                fFun = fun;
+                fArg = arg;
+                fCount = count;
+                fNext = 0;
+                fDone = 0;
+                generation = ++fGeneration;
+            }
+            fCond.notify_all();
+            runTasks(generation);
+            while (fDone < count) {
+                pause();
+            }
+        }
+
+        static int getWorkers()
+        {
+            const char* threads = getenv("FAUST_INTERP_THREADS");
+            return (threads) ? atoi(threads) : int(std::thread::hardware_concurrency()) - 1;
+        }
+
+};
+
+#endif
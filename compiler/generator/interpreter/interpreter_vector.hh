@@ -0,0 +1,922 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef _FIR_INTERPRETER_VECTOR_H
+#define _FIR_INTERPRETER_VECTOR_H
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+
+#include "interpreter_bytecode.hh"
+#include "exception.hh"
+
+/*
+ Vector kernels : a loop whose iterations are independent (typically the non-recursive loops of the -vec mode)
+ is executed opcode by opcode on chunks of samples, each kernel instruction being a simple loop over the chunk.
+
+ The loop body is translated by simulating the stack : values pushed by the stack code become vector registers,
+ loop invariant values (numbers and heap variables) are broadcasted once before the first chunk, and array or
+ input/output accesses indexed by the loop variable become contiguous loads/stores. A loop is kept in stack code
+ (and executed sample by sample) as soon as its iterations cannot be proved independent : stores in scalar
+ variables, arrays written and accessed with different indexes, control flow or nested loops in the body...
+*/
+
+struct FIRVectorInstruction {
+
+    enum Opcode {
+
+        // Loop invariant values
+        kBroadcastReal, kBroadcastInt,
+        kBroadcastRealValue, kBroadcastIntValue,
+
+        // Loop variable
+        kIndex,
+
+        // Memory
+        kLoadReal, kLoadInt,
+        kStoreReal, kStoreInt,
+        kGatherReal, kGatherInt,
+        kLoadInput, kGatherInput, kStoreOutput,
+
+        // Cast/bitcast
+        kCastReal, kCastInt,
+        kBitcastInt, kBitcastReal,
+
+        // Standard math (same order as in FIRInstruction)
+        kAddReal, kAddInt, kSubReal, kSubInt,
+        kMultReal, kMultInt, kDivReal, kDivInt,
+        kRemReal, kRemInt, kLshInt, kRshInt, kGTInt,
+        kLTInt, kGEInt, kLEInt, kEQInt, kNEInt,
+        kGTReal, kLTReal, kGEReal,
+        kLEReal, kEQReal, kNEReal,
+        kANDInt, kORInt, kXORInt,
+
+        // Extended unary math (same order as in FIRInstruction)
+        kAbs, kAbsf,
+        kAcosf, kAsinf,
+        kAtanf,
+        kCeilf,
+        kCosf, kCoshf,
+        kExpf,
+        kFloorf,
+        kLogf, kLog10f,
+        kRoundf,
+        kSinf, kSinhf,
+        kSqrtf,
+        kTanf, kTanhf,
+
+        // Extended binary math (same order as in FIRInstruction)
+        kAtan2f,
+        kFmodf,
+        kPowf,
+        kMax, kMaxf,
+        kMin, kMinf
+    };
+
+};
+
+static std::string gFIRVectorInstructionTable[] = {
+
+    // Loop invariant values
+    "kBroadcastReal", "kBroadcastInt",
+    "kBroadcastRealValue", "kBroadcastIntValue",
+
+    // Loop variable
+    "kIndex",
+
+    // Memory
+    "kLoadReal", "kLoadInt",
+    "kStoreReal", "kStoreInt",
+    "kGatherReal", "kGatherInt",
+    "kLoadInput", "kGatherInput", "kStoreOutput",
+
+    // Cast/bitcast
+    "kCastReal", "kCastInt",
+    "kBitcastInt", "kBitcastReal",
+
+    // Standard math
+    "kAddReal", "kAddInt", "kSubReal", "kSubInt",
+    "kMultReal", "kMultInt", "kDivReal", "kDivInt",
+    "kRemReal", "kRemInt", "kLshInt", "kRshInt", "kGTInt",
+    "kLTInt", "kGEInt", "kLEInt", "kEQInt", "kNEInt",
+    "kGTReal", "kLTReal", "kGEReal",
+    "kLEReal", "kEQReal", "kNEReal",
+    "kANDInt", "kORInt", "kXORInt",
+
+    // Extended unary math
+    "kAbs", "kAbsf",
+    "kAcosf", "kAsinf",
+    "kAtanf",
+    "kCeilf",
+    "kCosf", "kCoshf",
+    "kExpf",
+    "kFloorf",
+    "kLogf", "kLog10f",
+    "kRoundf",
+    "kSinf", "kSinhf",
+    "kSqrtf",
+    "kTanf", "kTanhf",
+
+    // Extended binary math
+    "kAtan2f",
+    "kFmodf",
+    "kPowf",
+    "kMax", "kMaxf",
+    "kMin", "kMinf"
+};
+
+template <class T>
+struct FIRVecInstruction {
+
+    FIRVectorInstruction::Opcode fOpcode;
+    int fDst;           // Result register
+    int fSrc1;          // First operand register (the top of stack value in the stack code), or index register of gathers
+    int fSrc2;          // Second operand register
+    int fOffset1;       // Heap offset (variable or array start), or input/output channel
+    int fOffset2;       // Heap offset of a loop invariant integer added to the loop variable, or -1
+    int fIntValue;      // Integer value, or constant added to the loop variable
+    T fRealValue;
+
+    void write(std::ostream* out)
+    {
+        *out << "opcode " << fOpcode << " "
+        << gFIRVectorInstructionTable[fOpcode]
+        << " dst " << fDst
+        << " src1 " << fSrc1
+        << " src2 " << fSrc2
+        << " offset1 " << fOffset1
+        << " offset2 " << fOffset2
+        << " int " << fIntValue
+        << " real " << fRealValue
+        << std::endl;
+    }
+
+};
+
+#define VecInstructionIT typename std::vector<FIRVecInstruction<T> >::iterator
+
+template <class T>
+struct FIRVectorKernel {
+
+    enum { kVectorSize = 32 };  // Number of samples of a chunk
+
+    std::vector<FIRVecInstruction<T> > fInvariants;     // Executed once before the first chunk
+    std::vector<FIRVecInstruction<T> > fInstructions;   // Executed on each chunk
+
+    int fLoopOffset;    // Loop variable
+    int fStart;         // Initial value of the loop variable
+    int fEndOffset;     // Heap offset of the loop bound, or -1
+    int fEndValue;      // Loop bound when constant
+    int fRealRegisters;
+    int fIntRegisters;
+
+    FIRVectorKernel()
+        :fLoopOffset(-1), fStart(0), fEndOffset(-1), fEndValue(0), fRealRegisters(0), fIntRegisters(0)
+    {}
+
+    void write(std::ostream* out)
+    {
+        *out << "kernel loop " << fLoopOffset
+        << " start " << fStart
+        << " end_offset " << fEndOffset
+        << " end_value " << fEndValue
+        << " real_registers " << fRealRegisters
+        << " int_registers " << fIntRegisters
+        << std::endl;
+        for (size_t i = 0; i < fInvariants.size(); i++) {
+            fInvariants[i].write(out);
+        }
+        for (size_t i = 0; i < fInstructions.size(); i++) {
+            fInstructions[i].write(out);
+        }
+    }
+
+};
+
+// Translation of the loops of the stack bytecode in vector kernels
+
+template <class T>
+class FIRVectorCompiler {
+
+    private:
+
+        // Symbolic value of a stack slot
+        struct Value {
+
+            enum Kind { kNumber, kHeap, kIndex, kRegister };
+
+            Kind fKind;
+            bool fReal;
+            T fRealValue;       // kNumber
+            int fIntValue;      // kNumber, or constant added to the loop variable for kIndex
+            int fOffset;        // kHeap, or heap offset of the loop invariant added to the loop variable for kIndex (or -1)
+            int fRegister;      // kRegister
+            bool fTemporary;    // kRegister : freed when used
+
+            Value(Kind kind = kNumber, bool real = false)
+                :fKind(kind), fReal(real), fRealValue(0), fIntValue(0), fOffset(-1), fRegister(-1), fTemporary(false)
+            {}
+        };
+
+        // Array (or input/output when fOffset is -1) access done in the loop
+        struct Access {
+
+            bool fReal;
+            int fOffset;
+            int fSize;
+            bool fWrite;
+            bool fIndexed;      // Indexed by the loop variable : fIntValue + fIndexOffset + loop variable
+            int fIntValue;
+            int fIndexOffset;
+
+        };
+
+        std::vector<FIRVectorKernel<T>*> fKernels;  // Compiled kernels, owned by the compiler
+
+        // Translation state of the current loop
+        FIRVectorKernel<T>* fKernel;
+        std::vector<Value> fRealStack;
+        std::vector<Value> fIntStack;
+        std::vector<int> fRealFree;
+        std::vector<int> fIntFree;
+        std::map<int, int> fRealBroadcast;
+        std::map<int, int> fIntBroadcast;
+        std::vector<Access> fAccesses;
+        std::vector<int> fRealReads;
+        std::vector<int> fIntReads;
+
+        static void unsupported()
+        {
+            throw faustexception("ERROR : loop cannot be executed as a vector kernel\n");
+        }
+
+        Value popReal()
+        {
+            if (fRealStack.size() == 0) { unsupported(); }
+            Value value = fRealStack.back();
+            fRealStack.pop_back();
+            return value;
+        }
+
+        Value popInt()
+        {
+            if (fIntStack.size() == 0) { unsupported(); }
+            Value value = fIntStack.back();
+            fIntStack.pop_back();
+            return value;
+        }
+
+        Value pop(bool real) { return (real) ? popReal() : popInt(); }
+
+        void push(const Value& value)
+        {
+            if (value.fReal) {
+                fRealStack.push_back(value);
+            } else {
+                fIntStack.push_back(value);
+            }
+        }
+
+        Value number(bool real, FIRBasicInstruction<T>* inst)
+        {
+            Value value(Value::kNumber, real);
+            value.fRealValue = inst->fRealValue;
+            value.fIntValue = inst->fIntValue;
+            return value;
+        }
+
+        // The loop variable is the only heap variable written in the loop, other ones are loop invariant
+        Value heap(bool real, int offset)
+        {
+            if (!real && offset == fKernel->fLoopOffset) {
+                return Value(Value::kIndex, false);
+            }
+            if (real) {
+                fRealReads.push_back(offset);
+            } else {
+                fIntReads.push_back(offset);
+            }
+            Value value(Value::kHeap, real);
+            value.fOffset = offset;
+            return value;
+        }
+
+        // Registers set by the loop invariant code are always new ones, since they must not be reused in the loop
+        int allocate(bool real, bool invariant = false)
+        {
+            std::vector<int>& free = (real) ? fRealFree : fIntFree;
+            int& count = (real) ? fKernel->fRealRegisters : fKernel->fIntRegisters;
+            if (!invariant && free.size() > 0) {
+                int reg = free.back();
+                free.pop_back();
+                return reg;
+            } else {
+                return count++;
+            }
+        }
+
+        void release(const Value& value)
+        {
+            if (value.fKind == Value::kRegister && value.fTemporary) {
+                ((value.fReal) ? fRealFree : fIntFree).push_back(value.fRegister);
+            }
+        }
+
+        FIRVecInstruction<T> instruction(FIRVectorInstruction::Opcode opcode, int dst = -1, int src1 = -1, int src2 = -1)
+        {
+            FIRVecInstruction<T> inst;
+            inst.fOpcode = opcode;
+            inst.fDst = dst;
+            inst.fSrc1 = src1;
+            inst.fSrc2 = src2;
+            inst.fOffset1 = -1;
+            inst.fOffset2 = -1;
+            inst.fIntValue = 0;
+            inst.fRealValue = 0;
+            return inst;
+        }
+
+        // Loop invariant values are broadcasted once in a register that is never freed
+        int broadcast(const Value& value)
+        {
+            FIRVecInstruction<T> inst = instruction(FIRVectorInstruction::kBroadcastReal);
+            int key;
+            if (value.fKind == Value::kHeap) {
+                inst.fOpcode = (value.fReal) ? FIRVectorInstruction::kBroadcastReal : FIRVectorInstruction::kBroadcastInt;
+                inst.fOffset1 = value.fOffset;
+                key = value.fOffset;
+            } else {
+                // Numbers are not shared
+                inst.fOpcode = (value.fReal) ? FIRVectorInstruction::kBroadcastRealValue : FIRVectorInstruction::kBroadcastIntValue;
+                inst.fRealValue = value.fRealValue;
+                inst.fIntValue = value.fIntValue;
+                key = -1;
+            }
+            std::map<int, int>& table = (value.fReal) ? fRealBroadcast : fIntBroadcast;
+            if (key >= 0 && table.find(key) != table.end()) {
+                return table[key];
+            }
+            inst.fDst = allocate(value.fReal, true);
+            fKernel->fInvariants.push_back(inst);
+            if (key >= 0) {
+                table[key] = inst.fDst;
+            }
+            return inst.fDst;
+        }
+
+        // Give a register to a value
+        Value materialize(const Value& value)
+        {
+            if (value.fKind == Value::kRegister) {
+                return value;
+            }
+            Value res(Value::kRegister, value.fReal);
+            if (value.fKind == Value::kIndex) {
+                FIRVecInstruction<T> inst = instruction(FIRVectorInstruction::kIndex, allocate(false));
+                inst.fIntValue = value.fIntValue;
+                inst.fOffset2 = value.fOffset;
+                fKernel->fInstructions.push_back(inst);
+                res.fRegister = inst.fDst;
+                res.fTemporary = true;
+            } else {
+                res.fRegister = broadcast(value);
+            }
+            return res;
+        }
+
+        void emit(FIRVectorInstruction::Opcode opcode, bool real, const Value& v1, const Value* v2 = 0)
+        {
+            Value arg1 = materialize(v1);
+            Value arg2 = (v2) ? materialize(*v2) : Value();
+            // Operand registers can be reused for the result
+            release(arg1);
+            release(arg2);
+            Value res(Value::kRegister, real);
+            res.fRegister = allocate(real);
+            res.fTemporary = true;
+            fKernel->fInstructions.push_back(instruction(opcode, res.fRegister, arg1.fRegister, arg2.fRegister));
+            push(res);
+        }
+
+        static bool hasRealArguments(FIRInstruction::Opcode opcode)
+        {
+            return (opcode == FIRInstruction::kAddReal)
+                || (opcode == FIRInstruction::kSubReal)
+                || (opcode == FIRInstruction::kMultReal)
+                || (opcode == FIRInstruction::kDivReal)
+                || (opcode == FIRInstruction::kRemReal)
+                || (opcode == FIRInstruction::kGTReal)
+                || (opcode == FIRInstruction::kLTReal)
+                || (opcode == FIRInstruction::kGEReal)
+                || (opcode == FIRInstruction::kLEReal)
+                || (opcode == FIRInstruction::kEQReal)
+                || (opcode == FIRInstruction::kNEReal)
+                || (FIRInstruction::isExtendedUnaryMath(opcode) && (opcode != FIRInstruction::kAbs))
+                || (FIRInstruction::isExtendedBinaryMath(opcode) && (opcode != FIRInstruction::kMax) && (opcode != FIRInstruction::kMin));
+        }
+
+        // Integer additions of the loop variable with a number or a loop invariant stay symbolic
+        bool compileIndex(FIRInstruction::Opcode opcode, const Value& v1, const Value& v2)
+        {
+            Value res(Value::kIndex, false);
+            if (opcode == FIRInstruction::kAddInt && v2.fKind == Value::kIndex) {
+                return compileIndex(opcode, v2, v1);
+            } else if (v1.fKind != Value::kIndex) {
+                return false;
+            } else if ((opcode == FIRInstruction::kAddInt || opcode == FIRInstruction::kSubInt) && v2.fKind == Value::kNumber) {
+                res.fIntValue = (opcode == FIRInstruction::kAddInt) ? (v1.fIntValue + v2.fIntValue) : (v1.fIntValue - v2.fIntValue);
+                res.fOffset = v1.fOffset;
+            } else if (opcode == FIRInstruction::kAddInt && v2.fKind == Value::kHeap && v1.fOffset == -1) {
+                res.fIntValue = v1.fIntValue;
+                res.fOffset = v2.fOffset;
+            } else {
+                return false;
+            }
+            push(res);
+            return true;
+        }
+
+        // Math instructions, with the operands of the 'heap', 'stack' and 'value' versions made explicit
+        void compileMath(FIRBasicInstruction<T>* inst)
+        {
+            static FIRInstruction::Opcode gInvertTable[] = {
+                FIRInstruction::kSubReal, FIRInstruction::kSubInt,
+                FIRInstruction::kDivReal, FIRInstruction::kDivInt,
+                FIRInstruction::kRemReal, FIRInstruction::kRemInt,
+                FIRInstruction::kLshInt, FIRInstruction::kRshInt,
+                FIRInstruction::kGTInt, FIRInstruction::kLTInt,
+                FIRInstruction::kGEInt, FIRInstruction::kLEInt,
+                FIRInstruction::kGTReal, FIRInstruction::kLTReal,
+                FIRInstruction::kGEReal, FIRInstruction::kLEReal
+            };
+
+            int opcode = inst->fOpcode;
+            FIRInstruction::Opcode base;
+            // 0 : stack, 1 : heap (fOffset1), 2 : heap (fOffset2), 3 : value
+            int arg1, arg2;
+            bool binary = true;
+
+            if (FIRInstruction::isMath(inst->fOpcode)) {
+                base = inst->fOpcode; arg1 = 0; arg2 = 0;
+            } else if (opcode >= FIRInstruction::kAddRealHeap && opcode <= FIRInstruction::kXORIntHeap) {
+                base = FIRInstruction::Opcode(opcode - FIRInstruction::kAddRealHeap + FIRInstruction::kAddReal); arg1 = 1; arg2 = 2;
+            } else if (opcode >= FIRInstruction::kAddRealStack && opcode <= FIRInstruction::kXORIntStack) {
+                base = FIRInstruction::Opcode(opcode - FIRInstruction::kAddRealStack + FIRInstruction::kAddReal); arg1 = 1; arg2 = 0;
+            } else if (opcode >= FIRInstruction::kAddRealStackValue && opcode <= FIRInstruction::kXORIntStackValue) {
+                base = FIRInstruction::Opcode(opcode - FIRInstruction::kAddRealStackValue + FIRInstruction::kAddReal); arg1 = 3; arg2 = 0;
+            } else if (opcode >= FIRInstruction::kAddRealValue && opcode <= FIRInstruction::kXORIntValue) {
+                base = FIRInstruction::Opcode(opcode - FIRInstruction::kAddRealValue + FIRInstruction::kAddReal); arg1 = 3; arg2 = 1;
+            } else if (opcode >= FIRInstruction::kSubRealValueInvert && opcode <= FIRInstruction::kLERealValueInvert) {
+                base = gInvertTable[opcode - FIRInstruction::kSubRealValueInvert]; arg1 = 1; arg2 = 3;
+            } else if (FIRInstruction::isExtendedUnaryMath(inst->fOpcode)) {
+                base = inst->fOpcode; arg1 = 0; arg2 = 0; binary = false;
+            } else if (opcode >= FIRInstruction::kAbsHeap && opcode <= FIRInstruction::kTanhfHeap) {
+                base = FIRInstruction::Opcode(opcode - FIRInstruction::kAbsHeap + FIRInstruction::kAbs); arg1 = 1; arg2 = 0; binary = false;
+            } else if (FIRInstruction::isExtendedBinaryMath(inst->fOpcode)) {
+                base = inst->fOpcode; arg1 = 0; arg2 = 0;
+            } else if (opcode >= FIRInstruction::kAtan2fHeap && opcode <= FIRInstruction::kMinfHeap) {
+                base = FIRInstruction::Opcode(opcode - FIRInstruction::kAtan2fHeap + FIRInstruction::kAtan2f); arg1 = 1; arg2 = 2;
+            } else if (opcode >= FIRInstruction::kAtan2fStack && opcode <= FIRInstruction::kMinfStack) {
+                base = FIRInstruction::Opcode(opcode - FIRInstruction::kAtan2fStack + FIRInstruction::kAtan2f); arg1 = 1; arg2 = 0;
+            } else if (opcode >= FIRInstruction::kAtan2fStackValue && opcode <= FIRInstruction::kMinfStackValue) {
+                base = FIRInstruction::Opcode(opcode - FIRInstruction::kAtan2fStackValue + FIRInstruction::kAtan2f); arg1 = 3; arg2 = 0;
+            } else if (opcode >= FIRInstruction::kAtan2fValue && opcode <= FIRInstruction::kMinfValue) {
+                base = FIRInstruction::Opcode(opcode - FIRInstruction::kAtan2fValue + FIRInstruction::kAtan2f); arg1 = 3; arg2 = 1;
+            } else if (opcode >= FIRInstruction::kAtan2fValueInvert && opcode <= FIRInstruction::kPowfValueInvert) {
+                base = FIRInstruction::Opcode(opcode - FIRInstruction::kAtan2fValueInvert + FIRInstruction::kAtan2f); arg1 = 1; arg2 = 3;
+            } else {
+                unsupported();
+                return;
+            }
+
+            bool real_args = hasRealArguments(base);
+            Value v1 = argument(inst, real_args, arg1);
+            Value v2 = (binary) ? argument(inst, real_args, arg2) : Value();
+            bool real_res = FIRInstruction::isRealType(base);
+
+            if (!real_args && compileIndex(base, v1, v2)) {
+                return;
+            }
+
+            if (FIRInstruction::isMath(base)) {
+                emit(FIRVectorInstruction::Opcode(FIRVectorInstruction::kAddReal + (base - FIRInstruction::kAddReal)), real_res, v1, &v2);
+            } else if (FIRInstruction::isExtendedUnaryMath(base)) {
+                emit(FIRVectorInstruction::Opcode(FIRVectorInstruction::kAbs + (base - FIRInstruction::kAbs)), real_res, v1);
+            } else {
+                emit(FIRVectorInstruction::Opcode(FIRVectorInstruction::kAtan2f + (base - FIRInstruction::kAtan2f)), real_res, v1, &v2);
+            }
+        }
+
+        Value argument(FIRBasicInstruction<T>* inst, bool real, int kind)
+        {
+            switch (kind) {
+                case 0: return pop(real);
+                case 1: return heap(real, inst->fOffset1);
+                case 2: return heap(real, inst->fOffset2);
+                default: return number(real, inst);
+            }
+        }
+
+        void access(bool real, int offset, int size, bool write, const Value& index)
+        {
+            Access access;
+            access.fReal = real;
+            access.fOffset = offset;
+            access.fSize = size;
+            access.fWrite = write;
+            access.fIndexed = (index.fKind == Value::kIndex);
+            access.fIntValue = index.fIntValue;
+            access.fIndexOffset = index.fOffset;
+            fAccesses.push_back(access);
+        }
+
+        void compileLoad(bool real, int offset, int size, const Value& index)
+        {
+            access(real, offset, size, false, index);
+            if (index.fKind == Value::kNumber && offset >= 0) {
+                // Constant index : loop invariant
+                push(heap(real, offset + index.fIntValue));
+            } else if (index.fKind == Value::kIndex) {
+                Value res(Value::kRegister, real);
+                res.fRegister = allocate(real);
+                res.fTemporary = true;
+                FIRVecInstruction<T> inst = instruction((offset < 0) ? FIRVectorInstruction::kLoadInput
+                                                        : ((real) ? FIRVectorInstruction::kLoadReal : FIRVectorInstruction::kLoadInt),
+                                                        res.fRegister);
+                inst.fOffset1 = (offset < 0) ? size : offset;
+                inst.fOffset2 = index.fOffset;
+                inst.fIntValue = index.fIntValue;
+                fKernel->fInstructions.push_back(inst);
+                push(res);
+            } else {
+                Value reg = materialize(index);
+                release(reg);
+                Value res(Value::kRegister, real);
+                res.fRegister = allocate(real);
+                res.fTemporary = true;
+                FIRVecInstruction<T> inst = instruction((offset < 0) ? FIRVectorInstruction::kGatherInput
+                                                        : ((real) ? FIRVectorInstruction::kGatherReal : FIRVectorInstruction::kGatherInt),
+                                                        res.fRegister, reg.fRegister);
+                inst.fOffset1 = (offset < 0) ? size : offset;
+                fKernel->fInstructions.push_back(inst);
+                push(res);
+            }
+        }
+
+        // Stores are only done at the loop variable position (possibly shifted)
+        void compileStore(bool real, int offset, int size, const Value& index, const Value& value)
+        {
+            if (index.fKind != Value::kIndex) {
+                unsupported();
+            }
+            access(real, offset, size, true, index);
+            Value reg = materialize(value);
+            release(reg);
+            FIRVecInstruction<T> inst = instruction((offset < 0) ? FIRVectorInstruction::kStoreOutput
+                                                    : ((real) ? FIRVectorInstruction::kStoreReal : FIRVectorInstruction::kStoreInt),
+                                                    -1, reg.fRegister);
+            inst.fOffset1 = (offset < 0) ? size : offset;
+            inst.fOffset2 = index.fOffset;
+            inst.fIntValue = index.fIntValue;
+            fKernel->fInstructions.push_back(inst);
+        }
+
+        static bool overlap(const Access& a1, int offset, int size)
+        {
+            return (a1.fOffset < offset + size) && (offset < a1.fOffset + a1.fSize);
+        }
+
+        // Iterations are independent if each written array (or the inputs/outputs if one output is written)
+        // is always accessed at the same position relative to the loop variable
+        void checkAccesses()
+        {
+            for (size_t i = 0; i < fAccesses.size(); i++) {
+                const Access& written = fAccesses[i];
+                if (!written.fWrite) { continue; }
+                bool io = (written.fOffset < 0);
+                for (size_t j = 0; j < fAccesses.size(); j++) {
+                    const Access& other = fAccesses[j];
+                    bool same = (io) ? (other.fOffset < 0)
+                        : ((other.fOffset >= 0) && (other.fReal == written.fReal) && overlap(other, written.fOffset, written.fSize));
+                    if (same && (!other.fIndexed || other.fIntValue != written.fIntValue || other.fIndexOffset != written.fIndexOffset)) {
+                        unsupported();
+                    }
+                }
+                if (io) { continue; }
+                std::vector<int>& reads = (written.fReal) ? fRealReads : fIntReads;
+                for (size_t j = 0; j < reads.size(); j++) {
+                    if (overlap(written, reads[j], 1)) {
+                        unsupported();
+                    }
+                }
+            }
+        }
+
+        // The loop variable declaration block only sets the initial value
+        void compileInit(FIRBlockInstruction<T>* block)
+        {
+            std::vector<FIRBasicInstruction<T>*>& code = block->fInstructions;
+            if (code.size() == 3
+                && code[0]->fOpcode == FIRInstruction::kInt32Value
+                && code[1]->fOpcode == FIRInstruction::kStoreInt
+                && code[2]->fOpcode == FIRInstruction::kReturn) {
+                fKernel->fStart = code[0]->fIntValue;
+                fKernel->fLoopOffset = code[1]->fOffset1;
+            } else if (code.size() == 2
+                && code[0]->fOpcode == FIRInstruction::kStoreIntValue
+                && code[1]->fOpcode == FIRInstruction::kReturn) {
+                fKernel->fStart = code[0]->fIntValue;
+                fKernel->fLoopOffset = code[0]->fOffset1;
+            } else {
+                unsupported();
+            }
+        }
+
+        // Loop test : 'loop variable < bound' with a loop invariant bound
+        void compileTest(FIRBasicInstruction<T>** code, int size)
+        {
+            int loop = fKernel->fLoopOffset;
+            if (size == 1 && code[0]->fOpcode == FIRInstruction::kLTIntHeap && code[0]->fOffset1 == loop) {
+                fKernel->fEndOffset = code[0]->fOffset2;
+            } else if (size == 1 && code[0]->fOpcode == FIRInstruction::kLTIntValueInvert && code[0]->fOffset1 == loop) {
+                fKernel->fEndValue = code[0]->fIntValue;
+            } else if ((size == 2 && code[1]->fOpcode == FIRInstruction::kLTIntStack && code[1]->fOffset1 == loop)
+                       || (size == 3
+                           && code[1]->fOpcode == FIRInstruction::kLoadInt && code[1]->fOffset1 == loop
+                           && code[2]->fOpcode == FIRInstruction::kLTInt)) {
+                if (code[0]->fOpcode == FIRInstruction::kLoadInt) {
+                    fKernel->fEndOffset = code[0]->fOffset1;
+                } else if (code[0]->fOpcode == FIRInstruction::kInt32Value) {
+                    fKernel->fEndValue = code[0]->fIntValue;
+                } else {
+                    unsupported();
+                }
+            } else {
+                unsupported();
+            }
+            if (fKernel->fEndOffset == loop) {
+                unsupported();
+            } else if (fKernel->fEndOffset >= 0) {
+                fIntReads.push_back(fKernel->fEndOffset);
+            }
+        }
+
+        void compileBody(FIRBlockInstruction<T>* block)
+        {
+            std::vector<FIRBasicInstruction<T>*>& code = block->fInstructions;
+            int size = int(code.size());
+
+            // The block ends with : increment, test, kCondBranch (on the block itself), kReturn
+            if (size < 3
+                || code[size - 1]->fOpcode != FIRInstruction::kReturn
+                || code[size - 2]->fOpcode != FIRInstruction::kCondBranch
+                || code[size - 2]->fBranch1 != block) {
+                unsupported();
+            }
+
+            for (int i = 0; i < size - 2; i++) {
+                FIRBasicInstruction<T>* inst = code[i];
+
+                switch (inst->fOpcode) {
+
+                    case FIRInstruction::kRealValue:
+                        push(number(true, inst));
+                        break;
+
+                    case FIRInstruction::kInt32Value:
+                        push(number(false, inst));
+                        break;
+
+                    case FIRInstruction::kLoadReal:
+                        push(heap(true, inst->fOffset1));
+                        break;
+
+                    case FIRInstruction::kLoadInt:
+                        push(heap(false, inst->fOffset1));
+                        break;
+
+                    case FIRInstruction::kStoreInt: {
+                        // Only the loop variable increment, followed by the test
+                        Value value = popInt();
+                        if (inst->fOffset1 != fKernel->fLoopOffset
+                            || value.fKind != Value::kIndex || value.fIntValue != 1 || value.fOffset != -1
+                            || fRealStack.size() > 0 || fIntStack.size() > 0) {
+                            unsupported();
+                        }
+                        compileTest(&code[i + 1], size - 3 - i);
+                        checkAccesses();
+                        return;
+                    }
+
+                    case FIRInstruction::kLoadIndexedReal:
+                        compileLoad(true, inst->fOffset1, inst->fOffset2, popInt());
+                        break;
+
+                    case FIRInstruction::kLoadIndexedInt:
+                        compileLoad(false, inst->fOffset1, inst->fOffset2, popInt());
+                        break;
+
+                    case FIRInstruction::kStoreIndexedReal: {
+                        Value index = popInt();
+                        compileStore(true, inst->fOffset1, inst->fOffset2, index, popReal());
+                        break;
+                    }
+
+                    case FIRInstruction::kStoreIndexedInt: {
+                        Value index = popInt();
+                        compileStore(false, inst->fOffset1, inst->fOffset2, index, popInt());
+                        break;
+                    }
+
+                    // Inputs/outputs are identified with a -1 offset, their channel being kept as 'size'
+                    case FIRInstruction::kLoadInput:
+                        compileLoad(true, -1, inst->fOffset1, popInt());
+                        break;
+
+                    case FIRInstruction::kStoreOutput: {
+                        Value index = popInt();
+                        compileStore(true, -1, inst->fOffset1, index, popReal());
+                        break;
+                    }
+
+                    // Fused sequences are translated as their components
+                    case FIRInstruction::kMultAddRealHeap: {
+                        Value value = popReal();
+                        Value arg2 = heap(true, inst->fOffset2);
+                        emit(FIRVectorInstruction::kMultReal, true, heap(true, inst->fOffset1), &arg2);
+                        Value product = popReal();
+                        emit(FIRVectorInstruction::kAddReal, true, product, &value);
+                        break;
+                    }
+
+                    case FIRInstruction::kLoadIndexedRealMask: {
+                        Value index = popInt();
+                        emit(FIRVectorInstruction::kANDInt, false, number(false, inst), &index);
+                        compileLoad(true, inst->fOffset1, inst->fOffset2, popInt());
+                        break;
+                    }
+
+                    case FIRInstruction::kStoreIndexedRealHeap:
+                        compileStore(true, inst->fOffset1, inst->fOffset2, heap(false, inst->fIntValue), popReal());
+                        break;
+
+                    case FIRInstruction::kLoadInputHeap:
+                        compileLoad(true, -1, inst->fOffset1, heap(false, inst->fOffset2));
+                        break;
+
+                    case FIRInstruction::kStoreOutputHeap:
+                        compileStore(true, -1, inst->fOffset1, heap(false, inst->fOffset2), popReal());
+                        break;
+
+                    case FIRInstruction::kCastReal:
+                        emit(FIRVectorInstruction::kCastReal, true, popInt());
+                        break;
+
+                    case FIRInstruction::kCastRealHeap:
+                        emit(FIRVectorInstruction::kCastReal, true, heap(false, inst->fOffset1));
+                        break;
+
+                    case FIRInstruction::kCastInt:
+                        emit(FIRVectorInstruction::kCastInt, false, popReal());
+                        break;
+
+                    case FIRInstruction::kCastIntHeap:
+                        emit(FIRVectorInstruction::kCastInt, false, heap(true, inst->fOffset1));
+                        break;
+
+                    case FIRInstruction::kBitcastInt:
+                        emit(FIRVectorInstruction::kBitcastInt, false, popReal());
+                        break;
+
+                    case FIRInstruction::kBitcastReal:
+                        emit(FIRVectorInstruction::kBitcastReal, true, popInt());
+                        break;
+
+                    default:
+                        compileMath(inst);
+                        break;
+                }
+            }
+
+            // No loop variable increment
+            unsupported();
+        }
+
+        FIRVectorKernel<T>* compileLoop(FIRBasicInstruction<T>* loop)
+        {
+            fKernel = new FIRVectorKernel<T>();
+            fRealStack.clear();
+            fIntStack.clear();
+            fRealFree.clear();
+            fIntFree.clear();
+            fRealBroadcast.clear();
+            fIntBroadcast.clear();
+            fAccesses.clear();
+            fRealReads.clear();
+            fIntReads.clear();
+
+            try {
+                compileInit(loop->fBranch1);
+                compileBody(loop->fBranch2);
+                return fKernel;
+            } catch (faustexception& e) {
+                // Kept in stack code
+                delete fKernel;
+                return 0;
+            }
+        }
+
+    public:
+
+        FIRVectorCompiler():fKernel(0)
+        {}
+
+        virtual ~FIRVectorCompiler()
+        {
+            for (size_t i = 0; i < fKernels.size(); i++) {
+                delete fKernels[i];
+            }
+        }
+
+        // Compile the loops of a block (and of its sub-blocks) and set the kernel index of their flat version
+        void compile(FIRBlockInstruction<T>* block, FIRFlatBlockInstruction<T>* flat)
+        {
+            int start = flat->fBlockStart[block];
+
+            for (size_t i = 0; i < block->fInstructions.size(); i++) {
+                FIRBasicInstruction<T>* inst = block->fInstructions[i];
+
+                // Tasks may be executed at the same time, but the kernels of an instance share the vector registers
+                if (inst->fOpcode == FIRInstruction::kTask) {
+                    continue;
+                }
+                
+                if (inst->fOpcode == FIRInstruction::kLoop) {
+                    FIRVectorKernel<T>* kernel = compileLoop(inst);
+                    if (kernel) {
+                        flat->fInstructions[start + i].fIntValue = int(fKernels.size());
+                        fKernels.push_back(kernel);
+                        continue;
+                    }
+                }
+
+                // kCondBranch branches back on its own block
+                if (inst->fBranch1 && inst->fOpcode != FIRInstruction::kCondBranch) { compile(inst->fBranch1, flat); }
+                if (inst->fBranch2) { compile(inst->fBranch2, flat); }
+            }
+        }
+
+        // Add an already compiled kernel (read from a binary image) and return its index
+        int addKernel(FIRVectorKernel<T>* kernel)
+        {
+            fKernels.push_back(kernel);
+            return int(fKernels.size()) - 1;
+        }
+
+        FIRVectorKernel<T>* getKernel(int index) { return fKernels[index]; }
+
+        int size() { return int(fKernels.size()); }
+
+        // Memory needed by the vector registers (shared by all kernels)
+        int getRealMemorySize()
+        {
+            int registers = 0;
+            for (size_t i = 0; i < fKernels.size(); i++) {
+                registers = std::max(registers, fKernels[i]->fRealRegisters);
+            }
+            return registers * FIRVectorKernel<T>::kVectorSize;
+        }
+
+        int getIntMemorySize()
+        {
+            int registers = 0;
+            for (size_t i = 0; i < fKernels.size(); i++) {
+                registers = std::max(registers, fKernels[i]->fIntRegisters);
+            }
+            return registers * FIRVectorKernel<T>::kVectorSize;
+        }
+
+};
+
+#endif
@@ -35,8 +35,8 @@ class JAVAInstVisitor : public TextInstVisitor {
          Global functions names table as a static variable in the visitor
          so that each function prototype is generated as most once in the module.
          */
-        static map <string, bool> gFunctionSymbolTable;
-        static map <string, string> gMathLibTable;
+        static thread_local map <string, bool> gFunctionSymbolTable;
+        static thread_local map <string, string> gMathLibTable;
     
         TypingVisitor fTypingVisitor;
    
@@ -47,9 +47,15 @@
 #include "ppsig.hh"
 #include "recursivness.hh"
 
-static int gTaskCount = 0;
+static thread_local int gTaskCount = 0;
 
-bool Klass::fNeedPowerDef = false;
+thread_local bool Klass::fNeedPowerDef = false;
+
+// With a fixed sample rate, instances always run at this rate
+static string samplingFreqValue()
+{
+    return (gGlobal->gFixedSampleRate > 0) ? T(gGlobal->gFixedSampleRate) : "samplingFreq";
+}
 
 /**
  * Store the loop used to compute a signal
@@ -792,7 +798,7 @@ void Klass::println(int n, ostream& fout)
     }
 
     tab(n+1,fout); fout << "virtual void instanceConstants(int samplingFreq) {";
-        tab(n+2,fout); fout << "fSamplingFreq = samplingFreq;";
+        tab(n+2,fout); fout << "fSamplingFreq = " << samplingFreqValue() << ";";
         printlines(n+2, fInitCode, fout);
     tab(n+1,fout); fout << "}";
     
@@ -1208,7 +1214,7 @@ void SigIntGenKlass::println(int n, ostream& fout)
 						<< "return " << fNumOutputs << "; }";
 
 		tab(n+1,fout); fout << "void init(int samplingFreq) {";
-			tab(n+2,fout); fout << "fSamplingFreq = samplingFreq;";
+			tab(n+2,fout); fout << "fSamplingFreq = " << samplingFreqValue() << ";";
             printlines(n+2, fInitCode, fout);
             printlines(n+2, fClearCode, fout);
 		tab(n+1,fout); fout << "}";
@@ -1248,7 +1254,7 @@ void SigFloatGenKlass::println(int n, ostream& fout)
 						<< "return " << fNumOutputs << "; }";
 
 		tab(n+1,fout); fout << "void init(int samplingFreq) {";
-			tab(n+2,fout); fout << "fSamplingFreq = samplingFreq;";
+			tab(n+2,fout); fout << "fSamplingFreq = " << samplingFreqValue() << ";";
 			printlines(n+2, fInitCode, fout);
             printlines(n+2, fClearCode, fout);
 		tab(n+1,fout); fout << "}";
@@ -226,6 +226,155 @@ bool startMTDSPFactories();
  */ 
 void stopMTDSPFactories();
 
+/**
+ * Set a directory where the machine code of the factories compiled by createDSPFactoryFromString/File is kept,
+ * so that the next creation of the same factory (same SHA key, target and optimization level), possibly in another
+ * process, skips the LLVM compilation. The directory can be shared by several processes.
+ * When the cache exceeds 'max_size', the least recently used factories are removed.
+ *
+ * @param directory - the cache directory, created if needed (using an empty string disables the cache)
+ * @param max_size - the maximum size of the cache in bytes (0 means no limit)
+ *
+ * @return true if the cache directory can be used.
+ */
+bool setDSPFactoryCacheDirectory(const std::string& directory, size_t max_size = 0);
+
+/**
+ * Set the memory budget of the factories : the memory of a factory is the size of its JIT compiled code and data
+ * plus the size of its instances. When deleteDSPFactory releases the last reference of a factory, the factory
+ * is kept 'idle' (and returned again by the creation functions or getDSPFactoryFromSHAKey) as long as the memory
+ * of all factories stays within the budget, the least recently used idle factories being otherwise deleted.
+ *
+ * @param budget - the memory budget in bytes (0, the default, means that factories are deleted when their last reference is released)
+ */
+void setDSPFactoriesMemoryBudget(size_t budget);
+
+/**
+ * Return the memory of all factories (used or idle) and of their instances.
+ *
+ * @return the memory in bytes.
+ */
+size_t getDSPFactoriesMemorySize();
+
+/**
+ * Called on a worker thread with the result of an asynchronous compilation.
+ *
+ * @param factory - the DSP factory (to be deleted with deleteDSPFactory), or a null pointer in case of failure
+ * @param error_msg - the error string
+ * @param arg - the argument given with the compilation request
+ */
+typedef void (*llvmFactoryCallback)(llvm_dsp_factory* factory, const char* error_msg, void* arg);
+
+/**
+ * Start the asynchronous compilation mode : requests are compiled by a pool of worker threads, by decreasing
+ * priority then in the order they were made. The Faust compilation itself stays serialized (the compiler state
+ * being global), the LLVM optimizations and code generation are done concurrently. Multi-thread access mode
+ * is started. If not explicitly started, the first request starts it with one worker per core and 256 waiting requests.
+ *
+ * @param workers - the number of worker threads
+ * @param max_waiting - the maximum number of requests waiting for a worker
+ *
+ * @return true if the asynchronous compilation mode is started.
+ */
+bool startAsyncDSPFactories(int workers, int max_waiting);
+
+/**
+ * Stop the asynchronous compilation mode : waiting requests are cancelled, the running ones are finished
+ * (and their callbacks called). Ignored when called from a callback.
+ */
+void stopAsyncDSPFactories();
+
+/**
+ * Request the asynchronous creation of a Faust DSP factory from a DSP source code as a file.
+ * See createDSPFactoryFromFile and createAsyncDSPFactoryFromString.
+ *
+ * @return the request number, or -1 if the request cannot be queued.
+ */
+int createAsyncDSPFactoryFromFile(const std::string& filename,
+                                  int argc, const char* argv[],
+                                  const std::string& target,
+                                  llvmFactoryCallback callback, void* arg,
+                                  int opt_level = -1, int priority = 0);
+
+/**
+ * Request the asynchronous creation of a Faust DSP factory from a DSP source code as a string.
+ * The function returns immediately, the callback being later called on a worker thread.
+ *
+ * @param name_app - the name of the Faust program
+ * @param dsp_content - the Faust program as a string
+ * @param argc - the number of parameters in argv array
+ * @param argv - the array of parameters (copied)
+ * @param target - the LLVM machine target (using empty string will take current machine settings)
+ * @param callback - the function called with the result
+ * @param arg - the argument given to the callback
+ * @param opt_level - LLVM IR to IR optimization level (from -1 to 4, -1 means 'maximum possible value'
+ * since the maximum value may change with new LLVM versions)
+ * @param priority - requests with a higher priority are compiled first
+ *
+ * @return the request number, or -1 if the request cannot be queued (too many waiting requests).
+ */
+int createAsyncDSPFactoryFromString(const std::string& name_app, const std::string& dsp_content,
+                                    int argc, const char* argv[],
+                                    const std::string& target,
+                                    llvmFactoryCallback callback, void* arg,
+                                    int opt_level = -1, int priority = 0);
+
+/**
+ * Cancel an asynchronous compilation request. A waiting request is removed, the result of a running one
+ * is deleted when its compilation ends.
+ *
+ * @param request - the request number
+ *
+ * @return true if the callback of the request will not be called.
+ */
+bool cancelAsyncDSPFactory(int request);
+
+/**
+ * Create a Faust DSP factory from a DSP source code as a file, instrumented for profile guided compilation.
+ * See createInstrumentedDSPFactoryFromString.
+ *
+ * @return a valid DSP factory on success, otherwise a null pointer.
+ */
+llvm_dsp_factory* createInstrumentedDSPFactoryFromFile(const std::string& filename,
+                                                       int argc, const char* argv[],
+                                                       const std::string& target,
+                                                       std::string& error_msg, int opt_level = -1);
+
+/**
+ * Create a Faust DSP factory from a DSP source code as a string, instrumented for profile guided compilation :
+ * the DSP instances of this factory count how many times each branch (if, loop, select2) is taken.
+ * The instances are then to be run with representative audio and controls, before calling createProfiledDSPFactory.
+ * The instrumented factory is distinct from the one returned by createDSPFactoryFromString, and is not kept
+ * in the machine code cache.
+ *
+ * @param name_app - the name of the Faust program
+ * @param dsp_content - the Faust program as a string
+ * @param argc - the number of parameters in argv array
+ * @param argv - the array of parameters (copied)
+ * @param target - the LLVM machine target (using empty string will take current machine settings)
+ * @param error_msg - the error string to be filled
+ * @param opt_level - LLVM IR to IR optimization level (from -1 to 4, -1 means 'maximum possible value'
+ * since the maximum value may change with new LLVM versions)
+ *
+ * @return a valid DSP factory on success, otherwise a null pointer.
+ */
+llvm_dsp_factory* createInstrumentedDSPFactoryFromString(const std::string& name_app, const std::string& dsp_content,
+                                                         int argc, const char* argv[],
+                                                         const std::string& target,
+                                                         std::string& error_msg, int opt_level = -1);
+
+/**
+ * Create a Faust DSP factory by compiling again the DSP of an instrumented factory, the branches counted
+ * by its instances so far being given to the LLVM optimizations. The result is a normal factory, whose machine code
+ * can be kept with writeDSPFactoryToMachine/File.
+ *
+ * @param factory - the instrumented DSP factory
+ * @param error_msg - the error string to be filled
+ *
+ * @return a valid DSP factory on success, otherwise a null pointer.
+ */
+llvm_dsp_factory* createProfiledDSPFactory(llvm_dsp_factory* factory, std::string& error_msg);
+
 /**
  * Create a Faust DSP factory from a base64 encoded LLVM bitcode string. Note that the library keeps an internal cache of all 
  * allocated factories so that the compilation of the same DSP code (that is the same LLVM bitcode string) will return 
@@ -330,6 +479,8 @@ void writeDSPFactoryToIRFile(llvm_dsp_factory* factory, const std::string& ir_co
  * allocated factories so that the compilation of the same DSP code (that is the same machine code string) will return 
  * the same (reference counted) factory pointer. You will have to explicitly use deleteDSPFactory to properly 
  * decrement reference counter when the factory is no more needed.
+ * The machine code can also be a bundle (see writeDSPFactoryToMachineBundle) : the variant for 'target' is then used,
+ * or the best one for the host CPU when 'target' is empty.
  * 
  * @param machine_code - the machine code string
  * @param target - the LLVM machine target (using empty string will takes current machine settings)
@@ -353,6 +504,8 @@ std::string writeDSPFactoryToMachine(llvm_dsp_factory* factory, const std::strin
  * allocated factories so that the compilation of the same DSP code (that is the same machine code file) will return 
  * the same (reference counted) factory pointer. You will have to explicitly use deleteDSPFactory to properly 
  * decrement reference counter when the factory is no more needed.
+ * The machine code can also be a bundle (see writeDSPFactoryToMachineBundle) : the variant for 'target' is then used,
+ * or the best one for the host CPU when 'target' is empty.
  * 
  * @param machine_code_path - the machine code file pathname
  * @param target - the LLVM machine target (using empty string will takes current machine settings)
@@ -371,6 +524,30 @@ llvm_dsp_factory* readDSPFactoryFromMachineFile(const std::string& machine_code_
  */
 void writeDSPFactoryToMachineFile(llvm_dsp_factory* factory, const std::string& machine_code_path, const std::string& target);
 
+/**
+ * Write a Faust DSP factory into a base64 encoded machine code bundle string, containing the machine code for several
+ * targets (for instance "x86_64-apple-darwin15.6.0:haswell" and "x86_64-apple-darwin15.6.0:sandybridge").
+ * The LLVM module is optimized once, then the code is generated for each target.
+ * When read with readDSPFactoryFromMachine and an empty target, the variant using the most CPU features
+ * available on the host is chosen.
+ *
+ * @param factory - the DSP factory
+ * @param targets - the LLVM machine targets (using empty string will takes current machine settings)
+ *
+ * @return the machine code bundle as a string.
+ */
+std::string writeDSPFactoryToMachineBundle(llvm_dsp_factory* factory, const std::vector<std::string>& targets);
+
+/**
+ * Write a Faust DSP factory into a machine code bundle file, see writeDSPFactoryToMachineBundle.
+ *
+ * @param factory - the DSP factory
+ * @param machine_code_path - the machine code bundle file pathname
+ * @param targets - the LLVM machine targets (using empty string will takes current machine settings)
+ *
+ */
+void writeDSPFactoryToMachineBundleFile(llvm_dsp_factory* factory, const std::string& machine_code_path, const std::vector<std::string>& targets);
+
 /**
  * Call global declarations with the given meta object.
  * 
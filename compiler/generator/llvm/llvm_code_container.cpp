@@ -25,6 +25,13 @@
 #include "exception.hh"
 #include "global.hh"
 
+#if defined(LLVM_140)
+    #include <llvm/MC/TargetRegistry.h>
+#else
+    #include <llvm/Support/TargetRegistry.h>
+#endif
+#include <llvm/MC/MCSubtargetInfo.h>
+
 using namespace std;
 
 /*
@@ -35,7 +42,7 @@ using namespace std;
  TODO: in -mem mode, classInit and classDestroy will have to be called once at factory init and destroy time
 */
 
-#if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #define ModulePTR std::unique_ptr<Module>
     #define MovePTR(ptr) std::move(ptr)
 #else
@@ -48,7 +55,7 @@ bool linkModules(Module* dst, ModulePTR src, char* error_msg);
 ModulePTR loadModule(const string& module_name, llvm::LLVMContext* context);
 Module* linkAllModules(llvm::LLVMContext* context, Module* dst, char* error);
 
-list <string> LLVMInstVisitor::gMathLibTable;
+thread_local list <string> LLVMInstVisitor::gMathLibTable;
 
 CodeContainer* LLVMCodeContainer::createScalarContainer(const string& name, int sub_container_type)
 {
@@ -66,11 +73,17 @@ LLVMCodeContainer::LLVMCodeContainer(const string& name, int numInputs, int numO
 #endif
     fBuilder = new IRBuilder<>(getContext());
     
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50))
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140))
     // Set "-fast-math"
     FastMathFlags FMF;
+#if defined(LLVM_140)
+    // 'setUnsafeAlgebra' did not allow approximated functions, which change some outputs
+    FMF.setFast();
+    FMF.setApproxFunc(false);
+#else
     FMF.setUnsafeAlgebra();
-#if (defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50))
+#endif
+#if (defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140))
     fBuilder->setFastMathFlags(FMF);
 #else
     fBuilder->SetFastMathFlags(FMF);
@@ -93,11 +106,17 @@ LLVMCodeContainer::LLVMCodeContainer(const string& name, int numInputs, int numO
     fContext = context;
     fBuilder = new IRBuilder<>(getContext());
     
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50))
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140))
     // Set "-fast-math"
     FastMathFlags FMF;
+#if defined(LLVM_140)
+    // 'setUnsafeAlgebra' did not allow approximated functions, which change some outputs
+    FMF.setFast();
+    FMF.setApproxFunc(false);
+#else
     FMF.setUnsafeAlgebra();
-#if (defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50))
+#endif
+#if (defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140))
     fBuilder->setFastMathFlags(FMF);
 #else
     fBuilder->SetFastMathFlags(FMF);
@@ -115,6 +134,36 @@ LLVMCodeContainer::~LLVMCodeContainer()
 
 LLVMContext& LLVMCodeContainer::getContext() { return *fContext; }
 
+// Number of samples in a SIMD register of the target ('triple:cpu'), used as -vls when not given
+int LLVMCodeContainer::getVectorLoopSize(const string& target, int float_size, int vec_size)
+{
+    size_t pos = target.find_first_of(':');
+    string triple = target.substr(0, pos);
+    string cpu = (pos != string::npos) ? target.substr(pos + 1) : "";
+    int bits = 128;
+    
+#if defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
+    // The host target has to be registered when used from the command line
+    InitializeNativeTarget();
+    string error_msg;
+    const Target* the_target = TargetRegistry::lookupTarget(triple, error_msg);
+    if (the_target) {
+        std::unique_ptr<MCSubtargetInfo> info(the_target->createMCSubtargetInfo(triple, cpu, ""));
+        if (info->checkFeatures("+avx512f")) {
+            bits = 512;
+        } else if (info->checkFeatures("+avx")) {
+            bits = 256;
+        }
+    }
+#endif
+    
+    int size = bits / ((float_size == 1) ? 32 : 64);
+    while (size > vec_size) {
+        size /= 2;
+    }
+    return size;
+}
+
 CodeContainer* LLVMCodeContainer::createContainer(const string& name, int numInputs, int numOutputs)
 {
     gGlobal->gDSPStruct = true;
@@ -138,6 +187,11 @@ CodeContainer* LLVMCodeContainer::createContainer(const string& name, int numInp
     } else if (gGlobal->gSchedulerSwitch) {
         container = new LLVMWorkStealingCodeContainer(name, numInputs, numOutputs);
     } else if (gGlobal->gVectorSwitch) {
+        // Non recursive loops are generated with explicit vector types
+        if (gGlobal->gVecLoopSize == 0) {
+            gGlobal->gVecLoopSize = getVectorLoopSize(llvm::sys::getDefaultTargetTriple() + ":" + string(llvm::sys::getHostCPUName()),
+                                                      gGlobal->gFloatSize, gGlobal->gVecSize);
+        }
         container = new LLVMVectorCodeContainer(name, numInputs, numOutputs);
     } else {
         container = new LLVMScalarCodeContainer(name, numInputs, numOutputs);
@@ -213,8 +267,8 @@ void LLVMCodeContainer::generateComputeBegin(const string& counter)
     Function* llvm_compute = Function::Create(llvm_compute_type, GlobalValue::ExternalLinkage, "compute" + fKlassName, fModule);
     llvm_compute->setCallingConv(CallingConv::C);
 
-#if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
-#if !defined(LLVM_50)
+#if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
+#if !defined(LLVM_50) && !defined(LLVM_140)
     llvm_compute->setDoesNotAlias(3U);
     llvm_compute->setDoesNotAlias(4U);
 #endif
@@ -285,12 +339,12 @@ void LLVMCodeContainer::generateGetSampleRate(int field_index)
 
     BasicBlock* block = BasicBlock::Create(getContext(), "entry_block", sr_fun);
     fBuilder->SetInsertPoint(block);
-#if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
-    Value* zone_ptr = fBuilder->CreateStructGEP(0, dsp, field_index);
+#if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
+    Value* zone_ptr = CREATE_STRUCT_GEP(dsp, field_index);
 #else
     Value* zone_ptr = fBuilder->CreateStructGEP(dsp, field_index);
 #endif
-    Value* load_ptr = fBuilder->CreateLoad(zone_ptr);
+    Value* load_ptr = CREATE_LOAD(zone_ptr);
 
     ReturnInst::Create(getContext(), load_ptr, block); 
     
@@ -614,14 +668,14 @@ void LLVMCodeContainer::generateMetadata(llvm::PointerType* meta_type_ptr)
     Value* idx0[2];
     idx0[0] = genInt64(0);
     idx0[1] = genInt32(0);
-    Value* meta_ptr = fBuilder->CreateGEP(meta, MAKE_IXD(idx0, idx0+2));
-    LoadInst* load_meta_ptr = fBuilder->CreateLoad(meta_ptr);
+    Value* meta_ptr = CREATE_GEP(meta, MAKE_IXD(idx0, idx0+2));
+    LoadInst* load_meta_ptr = CREATE_LOAD(meta_ptr);
 
     Value* idx1[2];
     idx1[0] = genInt64(0);
     idx1[1] = genInt32(1);
-    Value* mth_ptr = fBuilder->CreateGEP(meta, MAKE_IXD(idx1, idx1+2));
-    LoadInst* mth = fBuilder->CreateLoad(mth_ptr);
+    Value* mth_ptr = CREATE_GEP(meta, MAKE_IXD(idx1, idx1+2));
+    LoadInst* mth = CREATE_LOAD(mth_ptr);
 
     for (MetaDataSet::iterator i = gGlobal->gMetaDataSet.begin(); i != gGlobal->gMetaDataSet.end(); i++) {
         GlobalVariable* llvm_label1 = 0;
@@ -647,14 +701,14 @@ void LLVMCodeContainer::generateMetadata(llvm::PointerType* meta_type_ptr)
 
         Value* idx2[3];
         idx2[0] = load_meta_ptr;
-    #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+    #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
         idx2[1] = fBuilder->CreateConstGEP2_32(type_def1, llvm_label1, 0, 0);
         idx2[2] = fBuilder->CreateConstGEP2_32(type_def2, llvm_label2, 0, 0);
     #else
         idx2[1] = fBuilder->CreateConstGEP2_32(llvm_label1, 0, 0);
         idx2[2] = fBuilder->CreateConstGEP2_32(llvm_label2, 0, 0);
     #endif
-        CallInst* call_inst = fBuilder->CreateCall(mth, MAKE_IXD(idx2, idx2+3));
+        CallInst* call_inst = CREATE_CALL(mth, MAKE_IXD(idx2, idx2+3));
         call_inst->setCallingConv(CallingConv::C);
     }
 
@@ -889,7 +943,29 @@ dsp_factory_base* LLVMCodeContainer::produceFactory()
         throw faustexception(llvm_error.str());
     }
     
-    return new llvm_dsp_factory_aux("", gGlobal->gReader.listSrcFiles(), fModule, fContext, "", -1);
+    // Keep the DSP structure layout, so that the state of an instance of another backend can be moved in an LLVM instance (see tiered_dsp)
+    std::map<string, llvm_field_desc> fields_layout;
+    for (std::map<string, int>::iterator it = fields_names.begin(); it != fields_names.end(); it++) {
+        LLVM_TYPE type = fTypeBuilder.getFieldType((*it).second);
+        LLVM_TYPE item_type = (type->isArrayTy()) ? type->getArrayElementType() : type;
+        llvm_field_desc desc;
+        desc.fOffset = fTypeBuilder.getFieldOffset(fStructDSP, (*it).second);
+        desc.fSize = (type->isArrayTy()) ? int(type->getArrayNumElements()) : 1;
+        if (item_type->isIntegerTy(32)) {
+            desc.fType = 0;
+        } else if (item_type->isFloatTy()) {
+            desc.fType = sizeof(float);
+        } else if (item_type->isDoubleTy()) {
+            desc.fType = sizeof(double);
+        } else {
+            desc.fType = -1;
+        }
+        fields_layout[(*it).first] = desc;
+    }
+    
+    llvm_dsp_factory_aux* factory = new llvm_dsp_factory_aux("", gGlobal->gReader.listSrcFiles(), fModule, fContext, "", -1);
+    factory->setFieldLayout(fields_layout);
+    return factory;
 }
 
 // Scalar
@@ -1208,7 +1284,7 @@ void LLVMWorkStealingCodeContainer::generateComputeThreadExternal()
 
     Function* llvm_computethreadInternal = fModule->getFunction("computeThread");
     faustassert(llvm_computethreadInternal);
-#if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     Value* fun_args[] = { fBuilder->CreateBitCast(arg1, fStructDSP), arg2 };
     CallInst* call_inst = fBuilder->CreateCall(llvm_computethreadInternal, fun_args);
 #else
@@ -25,9 +25,14 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 
 #include "compatibility.hh"
 #include "llvm_dsp_aux.hh"
+#include "llvm_code_container.hh"
+#include "llvm_dsp_cache.hh"
+#include "llvm_dsp_queue.hh"
+#include "llvm_dsp_profile.hh"
 #include "faust/gui/CGlue.h"
 #include "dsp_aux.hh"
 #include "timing.hh"
@@ -45,7 +50,7 @@
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <llvm/Support/Threading.h>
 
-#if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #include <llvm/IR/Module.h>
     #include <llvm/IR/LLVMContext.h>
     #include <llvm/IRReader/IRReader.h>
@@ -54,17 +59,22 @@
     #include <llvm/Support/SourceMgr.h>
     #include <llvm/Support/MemoryBuffer.h>
     #include <llvm/ADT/Triple.h>
+    #if defined(LLVM_140)
+    #include <llvm/MC/TargetRegistry.h>
+    #else
     #include <llvm/Support/TargetRegistry.h>
+    #endif
     #include <llvm-c/Core.h>
     #include <llvm/Support/Host.h>
     #include <llvm/MC/SubtargetFeature.h>
+    #include <llvm/MC/MCSubtargetInfo.h>
 #else
     #include <llvm/Module.h>
     #include <llvm/LLVMContext.h>
     #include <llvm/Support/IRReader.h>
 #endif
 
-#if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #include <llvm/Analysis/TargetLibraryInfo.h>
     #include <llvm/Analysis/TargetTransformInfo.h>
     #include <llvm/IR/PassManager.h>
@@ -78,10 +88,13 @@
     #define FUNCTION_PASS_MANAGER FunctionPassManager
 #endif
 
-#if defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #include <llvm/Bitcode/BitcodeWriter.h>
     #include <llvm/Bitcode/BitcodeReader.h>
     #include <llvm/Transforms/IPO/AlwaysInliner.h>
+#if defined(LLVM_140)
+    #include <llvm/InitializePasses.h>
+#endif
 #elif defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39)
     #include <llvm/Bitcode/ReaderWriter.h>
 #endif
@@ -92,20 +105,20 @@
  */
 #if defined(LLVM_32)
     #include <llvm/DataLayout.h>
-#elif !defined(LLVM_33) && !defined(LLVM_34) && !defined(LLVM_35) && !defined(LLVM_36) && !defined(LLVM_37) && !defined(LLVM_38) && !defined(LLVM_39) && !defined(LLVM_40) && !defined(LLVM_50)
+#elif !defined(LLVM_33) && !defined(LLVM_34) && !defined(LLVM_35) && !defined(LLVM_36) && !defined(LLVM_37) && !defined(LLVM_38) && !defined(LLVM_39) && !defined(LLVM_40) && !defined(LLVM_50) && !defined(LLVM_140)
     #ifndef _WIN32
     #include <llvm/Target/TargetData.h>
     #endif
 #endif
 
-#if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #include <llvm/ExecutionEngine/MCJIT.h>
     #include <llvm/ExecutionEngine/ObjectCache.h>
 #else
     #include <llvm/ExecutionEngine/JIT.h>
 #endif
 
-#if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #include <llvm/IR/LegacyPassNameParser.h>
     #include <llvm/Linker/Linker.h>
     #include <llvm/IR/IRPrintingPasses.h>
@@ -125,11 +138,14 @@
     #define GET_CPU_NAME llvm::sys::getHostCPUName()
 #endif
 
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
     #include "llvm/ExecutionEngine/ObjectCache.h"
+    #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #endif
 
-#if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_140)
+    #define sysfs_binary_flag sys::fs::OF_None
+#elif defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
     #define sysfs_binary_flag sys::fs::F_None
 #elif defined(LLVM_34)
     #define sysfs_binary_flag sys::fs::F_Binary
@@ -137,7 +153,13 @@
     #define sysfs_binary_flag raw_fd_ostream::F_Binary
 #endif
 
-#if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_140)
+    #define WRITE_BITCODE(module, out) WriteBitcodeToFile(*module, out)
+#else
+    #define WRITE_BITCODE(module, out) WriteBitcodeToFile(module, out)
+#endif
+
+#if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #define STREAM_ERROR std::error_code
     #define MEMORY_BUFFER MemoryBufferRef
     #define MEMORY_BUFFER_GET(buffer) (buffer.getBuffer())
@@ -151,7 +173,7 @@
     #define MEMORY_BUFFER_CREATE(stringref) (MemoryBuffer::getMemBuffer(stringref))
 #endif
 
-#if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #define ModulePTR std::unique_ptr<Module>
     #define MovePTR(ptr) std::move(ptr)
 #else
@@ -164,12 +186,22 @@ using namespace llvm;
 // Factories instances management
 int llvm_dsp_factory_aux::gInstance = 0;
 
+// Not gDSPFactoriesLock : factories are created in the compilation thread, which the caller holding gDSPFactoriesLock waits for
+static TLockAble gInstanceLock;
+
 typedef class faust_smartptr<llvm_dsp_factory> SDsp_factory;
 static dsp_factory_table<SDsp_factory> gLLVMFactoryTable;
 
 // Global API access lock
 static TLockAble* gDSPFactoriesLock = 0;
 
+// Machine code of the factories compiled from a DSP source, kept on disk when a cache directory is set
+static llvm_dsp_cache gLLVMCache;
+
+// Asynchronous compilations, the queue being created by startAsyncDSPFactories or the first request
+static llvm_dsp_queue* gAsyncQueue = 0;
+static TLockAble gAsyncLock;
+
 static void splitTarget(const string& target, string& triple, string& cpu)
 {
     size_t pos1 = target.find_first_of(':');
@@ -179,6 +211,53 @@ static void splitTarget(const string& target, string& triple, string& cpu)
     }
 }
 
+/*
+ Machine code bundle : the machine code of the same factory for several targets, as a header line with
+ the number of variants, then for each variant a line with its target and code size, followed by the code.
+*/
+#define MACHINE_BUNDLE_HEADER "FAUST_MACHINE_BUNDLE"
+
+typedef vector<pair<string, string> > machine_variants;   // (target, machine code)
+
+static bool isMachineBundle(const string& machine_code)
+{
+    return machine_code.compare(0, strlen(MACHINE_BUNDLE_HEADER), MACHINE_BUNDLE_HEADER) == 0;
+}
+
+static string writeMachineBundle(const machine_variants& variants)
+{
+    stringstream out;
+    out << MACHINE_BUNDLE_HEADER << " " << variants.size() << "\n";
+    for (size_t i = 0; i < variants.size(); i++) {
+        out << variants[i].first << " " << variants[i].second.size() << "\n";
+        out.write(variants[i].second.data(), variants[i].second.size());
+    }
+    return out.str();
+}
+
+static bool readMachineBundle(const string& machine_code, machine_variants& variants)
+{
+    stringstream in(machine_code);
+    string header;
+    int count;
+    in >> header >> count;
+    
+    for (int i = 0; i < count && in.good(); i++) {
+        string target, code;
+        size_t size;
+        in >> target >> size;
+        in.get();
+        code.resize(size);
+        in.read(&code[0], size);
+        if (size_t(in.gcount()) != size) {
+            return false;
+        }
+        variants.push_back(make_pair(target, code));
+    }
+    
+    return (header == MACHINE_BUNDLE_HEADER) && (int(variants.size()) == count);
+}
+
 static string getParam(int argc, const char* argv[], const string& param, const string& def)
 {
     for (int i = 0; i < argc; i++) {
@@ -234,7 +313,7 @@ class FaustObjectCache : public ObjectCache {
 };
 #endif
 
-#if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
 
 /*
 static std::string getFeaturesStr()
@@ -290,6 +369,48 @@ class FaustObjectCache : public ObjectCache {
 };
 #endif
 
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+// Counts the memory of the code and data sections of a JIT compiled factory
+class FaustSectionMemoryManager : public SectionMemoryManager {
+    
+    private:
+    
+        size_t fSize;
+    
+    public:
+    
+        FaustSectionMemoryManager():fSize(0)
+        {}
+    
+        virtual uint8_t* allocateCodeSection(uintptr_t size, unsigned alignment, unsigned section_id, StringRef section_name)
+        {
+            fSize += size;
+            return SectionMemoryManager::allocateCodeSection(size, alignment, section_id, section_name);
+        }
+    
+        virtual uint8_t* allocateDataSection(uintptr_t size, unsigned alignment, unsigned section_id, StringRef section_name, bool read_only)
+        {
+            fSize += size;
+            return SectionMemoryManager::allocateDataSection(size, alignment, section_id, section_name, read_only);
+        }
+    
+        size_t getSize() { return fSize; }
+    
+};
+
+// The memory manager is owned by the JIT
+static FaustSectionMemoryManager* setSectionMemoryManager(EngineBuilder& builder)
+{
+    FaustSectionMemoryManager* manager = new FaustSectionMemoryManager();
+#if defined(LLVM_34) || defined(LLVM_35)
+    builder.setMCJITMemoryManager(manager);
+#else
+    builder.setMCJITMemoryManager(unique_ptr<RTDyldMemoryManager>(manager));
+#endif
+    return manager;
+}
+#endif
+
 #if defined(LLVM_35) || defined(LLVM_36)
 // LLVM 3.5 has parseBitcodeFile(). Must emulate ParseBitcodeFile. -ag
 static Module* ParseBitcodeFile(MEMORY_BUFFER Buffer,
@@ -308,7 +429,7 @@ static Module* ParseBitcodeFile(MEMORY_BUFFER Buffer,
 }
 #endif
 
-#if defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
 
 static Module* ParseBitcodeFile(MEMORY_BUFFER Buffer,
                                 LLVMContext& Context,
@@ -344,7 +465,7 @@ static Module* ParseBitcodeFile(MEMORY_BUFFER Buffer,
 
 void* llvm_dsp_factory_aux::loadOptimize(const string& function)
 {
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
     void* fun = (void*)fJIT->getFunctionAddress(function);
     if (fun) {
         return fun;
@@ -366,7 +487,7 @@ string llvm_dsp_factory_aux::writeDSPFactoryToBitcode()
 {
     string res;
     raw_string_ostream out(res);
-    WriteBitcodeToFile(fModule, out);
+    WRITE_BITCODE(fModule, out);
     out.flush();
     return base64_encode(res);
 }
@@ -375,7 +496,7 @@ void llvm_dsp_factory_aux::writeDSPFactoryToBitcodeFile(const string& bit_code_p
 {
     STREAM_ERROR err;
     raw_fd_ostream out(bit_code_path.c_str(), err, sysfs_binary_flag);
-    WriteBitcodeToFile(fModule, out);
+    WRITE_BITCODE(fModule, out);
 }
 
 // IR
@@ -402,7 +523,7 @@ void llvm_dsp_factory_aux::writeDSPFactoryToIRFile(const string& ir_code_path)
 
 bool llvm_dsp_factory_aux::crossCompile(const string& target)
 {
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
     delete fObjectCache;
     fObjectCache = new FaustObjectCache();
     setTarget(target);
@@ -413,9 +534,38 @@ bool llvm_dsp_factory_aux::crossCompile(const string& target)
 #endif
 }
 
+bool llvm_dsp_factory_aux::readProfile(vector<uint64_t>& profile)
+{
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+    if (fProfileMode != kProfileGen || !fJIT) {
+        return false;
+    }
+    profile.clear();
+    if (fProfileSites > 0) {
+        uint64_t* counters = reinterpret_cast<uint64_t*>(fJIT->getGlobalValueAddress(PROFILE_COUNTERS));
+        if (!counters) {
+            return false;
+        }
+        profile.assign(counters, counters + 2 * fProfileSites);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t llvm_dsp_factory_aux::getCodeSize()
+{
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+    return (fSectionMemoryManager) ? fSectionMemoryManager->getSize() : 0;
+#else
+    return 0;
+#endif
+}
+
 string llvm_dsp_factory_aux::writeDSPFactoryToMachineAux(const string& target)
 { 
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
     if (target == "" || target == getTarget()) {
         return fObjectCache->getMachineCode();
     } else {
@@ -433,6 +583,55 @@ string llvm_dsp_factory_aux::writeDSPFactoryToMachineAux(const string& target)
 #endif
 }
 
+string llvm_dsp_factory_aux::writeDSPFactoryToMachineBundleAux(const vector<string>& targets)
+{
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+    machine_variants variants;
+    string old_target = getTarget();
+    
+    // Code of the current target is already there
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (targets[i] == "" || targets[i] == old_target) {
+            variants.push_back(make_pair(old_target, fObjectCache->getMachineCode()));
+            break;
+        }
+    }
+    
+    // Each other target is compiled from the already optimized module
+    bool recompiled = false;
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (targets[i] != "" && targets[i] != old_target) {
+            recompiled = true;
+            if (!crossCompile(targets[i])) {
+                crossCompile(old_target);
+                return "";
+            }
+            variants.push_back(make_pair(targets[i], fObjectCache->getMachineCode()));
+        }
+    }
+    
+    if (recompiled) {
+        crossCompile(old_target);   // Restore old target
+    }
+    return writeMachineBundle(variants);
+#else
+    return "";
+#endif
+}
+
+string llvm_dsp_factory_aux::writeDSPFactoryToMachineBundle(const vector<string>& targets)
+{
+    return base64_encode(writeDSPFactoryToMachineBundleAux(targets));
+}
+
+void llvm_dsp_factory_aux::writeDSPFactoryToMachineBundleFile(const string& machine_code_path, const vector<string>& targets)
+{
+    STREAM_ERROR err;
+    raw_fd_ostream out(machine_code_path.c_str(), err, sysfs_binary_flag);
+    out << writeDSPFactoryToMachineBundleAux(targets);
+    out.flush();
+}
+
 string llvm_dsp_factory_aux::writeDSPFactoryToMachine(const string& target)
 { 
     return base64_encode(writeDSPFactoryToMachineAux(target));
@@ -448,12 +647,14 @@ void llvm_dsp_factory_aux::writeDSPFactoryToMachineFile(const string& machine_co
 
 void llvm_dsp_factory_aux::startLLVMLibrary()
 {
+    // Factories may be created by concurrent compilations
+    TLock lock(&gInstanceLock);
     if (llvm_dsp_factory_aux::gInstance++ == 0) {
         // Install a LLVM error handler
-    #if defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+    #if defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
         LLVMInstallFatalErrorHandler(llvm_dsp_factory_aux::LLVMFatalErrorHandler);
     #endif
-    #if (!defined(LLVM_35) && !defined(LLVM_36) && !defined(LLVM_37) && !defined(LLVM_38) && !defined(LLVM_39) && !defined(LLVM_40) && !defined(LLVM_50)) // In LLVM 3.5 this is gone.
+    #if (!defined(LLVM_35) && !defined(LLVM_36) && !defined(LLVM_37) && !defined(LLVM_38) && !defined(LLVM_39) && !defined(LLVM_40) && !defined(LLVM_50) && !defined(LLVM_140)) // In LLVM 3.5 this is gone.
         if (!llvm_start_multithreaded()) {
             std::cerr << "llvm_start_multithreaded error...\n";
         }
@@ -463,19 +664,21 @@ void llvm_dsp_factory_aux::startLLVMLibrary()
 
 void llvm_dsp_factory_aux::stopLLVMLibrary()
 {
+    TLock lock(&gInstanceLock);
     if (--llvm_dsp_factory_aux::gInstance == 0) {
-    #if  (!defined(LLVM_35)) && (!defined(LLVM_36)) && (!defined(LLVM_37)) && (!defined(LLVM_38)) && (!defined(LLVM_39)) && (!defined(LLVM_40)) && (!defined(LLVM_50)) // In LLVM 3.5 this is gone.
+    #if  (!defined(LLVM_35)) && (!defined(LLVM_36)) && (!defined(LLVM_37)) && (!defined(LLVM_38)) && (!defined(LLVM_39)) && (!defined(LLVM_40)) && (!defined(LLVM_50)) && (!defined(LLVM_140)) // In LLVM 3.5 this is gone.
         llvm_stop_multithreaded();
     #endif
-    #if defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+    #if defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
         LLVMResetFatalErrorHandler();
     #endif
     }
 }
 
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
-llvm_dsp_factory_aux::llvm_dsp_factory_aux(const string& sha_key, const string& machine_code, const string& target)
-    :dsp_factory_imp("MachineDSP", sha_key, "")
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+llvm_dsp_factory_aux::llvm_dsp_factory_aux(const string& sha_key, const string& machine_code, const string& target,
+                                           const std::vector<std::string>& pathname_list)
+    :dsp_factory_imp("MachineDSP", sha_key, "", pathname_list)
 {
     startLLVMLibrary();
     
@@ -510,14 +713,14 @@ llvm_dsp_factory_aux::llvm_dsp_factory_aux(const string& sha_key,
     fModule = module;
     fContext = context;
     
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
     fObjectCache = nullptr;
 #endif
 }
 
 llvm_dsp_factory_aux::~llvm_dsp_factory_aux()
 {
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
     delete fObjectCache;
 #endif
     if (fJIT) {
@@ -529,7 +732,7 @@ llvm_dsp_factory_aux::~llvm_dsp_factory_aux()
     stopLLVMLibrary();
 }
 
-#if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
 void llvm_dsp_factory_aux::LLVMFatalErrorHandler(const char* reason)
 {
     throw faustexception(reason);
@@ -558,6 +761,11 @@ void llvm_dsp_factory_aux::init(const string& type_name, const string& dsp_name)
     fExpandedDSP = "";
     fOptLevel = 0;
     fTarget = "";
+    fProfileMode = kNoProfile;
+    fProfileSites = 0;
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+    fSectionMemoryManager = 0;
+#endif
 }
 
 int llvm_dsp_factory_aux::getOptlevel()
@@ -579,7 +787,7 @@ int llvm_dsp_factory_aux::getOptlevel()
     return -1;
 }
 
-#if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
 /// AddOptimizationPasses - This routine adds optimization passes
 /// based on selected optimization level, OptLevel. This routine
 /// duplicates llvm-gcc behaviour.
@@ -608,7 +816,7 @@ static void AddOptimizationPasses(PassManagerBase &MPM,
         }
         Builder.Inliner = createFunctionInliningPass(Threshold);
     } else {
-    #if defined(LLVM_40) || defined(LLVM_50)
+    #if defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
         Builder.Inliner = createAlwaysInlinerLegacyPass();
     #else
         Builder.Inliner = createAlwaysInlinerPass();
@@ -620,21 +828,17 @@ static void AddOptimizationPasses(PassManagerBase &MPM,
     Builder.DisableSimplifyLibCalls = false;
 #endif
     
-    // Add auto-vectorization passes
-    if (OptLevel > 3) {
-        Builder.LoopVectorize = true;
-        Builder.SLPVectorize = true;
-    }
+    // Add auto-vectorization passes (only at level 4, whatever the PassManagerBuilder default is)
+    Builder.LoopVectorize = (OptLevel > 3);
+    Builder.SLPVectorize = (OptLevel > 3);
     
     Builder.populateFunctionPassManager(FPM);
     Builder.populateModulePassManager(MPM);
 }
 
-bool llvm_dsp_factory_aux::initJIT(string& error_msg)
+// Registration of the targets, to be done before any JIT compilation
+static void initTargets()
 {
-    startTiming("initJIT");
-    
-    //std::cout << "getFeaturesStr : " << getFeaturesStr() << std::endl;
 #ifdef LLVM_BUILD_UNIVERSAL
     // For multiple target support
     InitializeAllTargets();
@@ -649,24 +853,33 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
     InitializeNativeTargetAsmParser();
     
     // For ObjectCache to work...
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
     LLVMLinkInMCJIT();
 #endif
+}
+
+bool llvm_dsp_factory_aux::initJIT(string& error_msg)
+{
+    startTiming("initJIT");
+    
+    //std::cout << "getFeaturesStr : " << getFeaturesStr() << std::endl;
+    initTargets();
     
     // Restoring from machine code
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
     if (fObjectCache) {
     
         // JIT
-    #if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+    #if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
         EngineBuilder builder((unique_ptr<Module>(fModule)));
     #else
         EngineBuilder builder(fModule);
     #endif
         builder.setEngineKind(EngineKind::JIT);
-    #if !defined(LLVM_36) && !defined(LLVM_37) && !defined(LLVM_38) && !defined(LLVM_39) && !defined(LLVM_40) && !defined(LLVM_50)
+    #if !defined(LLVM_36) && !defined(LLVM_37) && !defined(LLVM_38) && !defined(LLVM_39) && !defined(LLVM_40) && !defined(LLVM_50) && !defined(LLVM_140)
         builder.setUseMCJIT(true);
     #endif
+        fSectionMemoryManager = setSectionMemoryManager(builder);
         TargetMachine* tm = builder.selectTarget();
         fJIT = builder.create(tm);
         fJIT->setObjectCache(fObjectCache);
@@ -679,6 +892,14 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
             return false;
         }
     
+        // Profile guided compilation : done once, on the module generated by the Faust compiler
+        if (fProfileMode == kProfileGen && !fModule->getGlobalVariable(PROFILE_COUNTERS)) {
+            fProfileSites = instrumentDSPModule(fModule);
+        } else if (fProfileMode == kProfileUse && fProfile.size() > 0) {
+            annotateDSPModule(fModule, fProfile);
+            fProfile.clear();
+        }
+    
         // Initialize passes
         PassRegistry &Registry = *PassRegistry::getPassRegistry();
         
@@ -689,7 +910,7 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
         initializeVectorization(Registry);
         initializeIPO(Registry);
         initializeAnalysis(Registry);
-    #if !defined(LLVM_38) && !defined(LLVM_39) && !defined(LLVM_40) && !defined(LLVM_50)
+    #if !defined(LLVM_38) && !defined(LLVM_39) && !defined(LLVM_40) && !defined(LLVM_50) && !defined(LLVM_140)
         initializeIPA(Registry);
     #endif
         initializeTransformUtils(Registry);
@@ -697,14 +918,16 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
         initializeInstrumentation(Registry);
         initializeTarget(Registry);
        
-    #if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+    #if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
         EngineBuilder builder((unique_ptr<Module>(fModule)));
     #else
         EngineBuilder builder(fModule);
     #endif
         builder.setOptLevel(CodeGenOpt::Aggressive);
         builder.setEngineKind(EngineKind::JIT);
+    #if !defined(LLVM_140)
         builder.setCodeModel(CodeModel::JITDefault);
+    #endif
         
         string buider_error;
         builder.setErrorStr(&buider_error);
@@ -712,7 +935,7 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
         // MCJIT does not work correctly (incorrect float numbers ?) when used with dynamic libLLVM
     #if (defined(LLVM_34) || defined(LLVM_35)) && !defined(_MSC_VER)
         builder.setUseMCJIT(true);
-    #elif !defined(LLVM_36) && !defined(LLVM_37) && !defined(LLVM_38) && !defined(LLVM_39) && !defined(LLVM_40) && !defined(LLVM_50)
+    #elif !defined(LLVM_36) && !defined(LLVM_37) && !defined(LLVM_38) && !defined(LLVM_39) && !defined(LLVM_40) && !defined(LLVM_50) && !defined(LLVM_140)
         builder.setUseMCJIT(false);
     #endif
     
@@ -743,8 +966,8 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
         
         // -fastmath is activated at IR level, and needs to be setup at JIT level also
         
-    #if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
-    #if !defined(LLVM_50)
+    #if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
+    #if !defined(LLVM_50) && !defined(LLVM_140)
         targetOptions.LessPreciseFPMADOption = true;
     #endif
         targetOptions.AllowFPOpFusion = FPOpFusion::Fast;
@@ -754,7 +977,10 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
         targetOptions.GuaranteedTailCallOpt = true;
     #endif
     
-    #if defined(LLVM_40) || defined(LLVM_50)
+    #if defined(LLVM_140)
+        targetOptions.NoTrappingFPMath = true;
+        targetOptions.setFPDenormalMode(DenormalMode::getIEEE());
+    #elif defined(LLVM_40) || defined(LLVM_50)
         targetOptions.NoTrappingFPMath = true;
         targetOptions.FPDenormalMode = FPDenormal::IEEE;
     #endif
@@ -762,11 +988,16 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
         targetOptions.GuaranteedTailCallOpt = true;
         string debug_var = (getenv("FAUST_DEBUG")) ? string(getenv("FAUST_DEBUG")) : "";
         
+    #if !defined(LLVM_140)
         if ((debug_var != "") && (debug_var.find("FAUST_LLVM3") != string::npos)) {
            targetOptions.PrintMachineCode = true;
         }
+    #endif
         
         builder.setTargetOptions(targetOptions);
+    #if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+        fSectionMemoryManager = setSectionMemoryManager(builder);
+    #endif
         TargetMachine* tm = builder.selectTarget();
         
         fJIT = builder.create(tm);
@@ -782,7 +1013,7 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
             PASS_MANAGER pm;
             FUNCTION_PASS_MANAGER fpm(fModule);
             
-        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) // Code taken from opt.cpp
+        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140) // Code taken from opt.cpp
             TargetLibraryInfoImpl TLII(Triple(fModule->getTargetTriple()));
             pm.add(new TargetLibraryInfoWrapperPass(TLII));
         #else
@@ -791,7 +1022,7 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
             pm.add(tli);
         #endif
 
-        #if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+        #if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
             fModule->setDataLayout(fJIT->getDataLayout());
         #elif defined(LLVM_37) // Code taken from opt.cpp
             fModule->setDataLayout(*fJIT->getDataLayout());
@@ -805,7 +1036,7 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
         #endif
           
             // Add internal analysis passes from the target machine (mandatory for vectorization to work)
-        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) // Code taken from opt.cpp
+        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140) // Code taken from opt.cpp
             pm.add(createTargetTransformInfoWrapperPass(tm->getTargetIRAnalysis()));
         #else
             tm->addAnalysisPasses(pm);
@@ -816,7 +1047,11 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
             }
             
             if ((debug_var != "") && (debug_var.find("FAUST_LLVM1") != string::npos)) {
+            #if defined(LLVM_140)
+                TargetRegistry::printRegisteredTargetsForVersion(outs());
+            #else
                 TargetRegistry::printRegisteredTargetsForVersion();
+            #endif
                 DUMP(fModule);
             }
            
@@ -829,7 +1064,7 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
             pm.add(createVerifierPass());
             
             if ((debug_var != "") && (debug_var.find("FAUST_LLVM4") != string::npos)) {
-            #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+            #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
                 // TODO
             #else
                 tm->addPassesToEmitFile(pm, fouts(), TargetMachine::CGFT_AssemblyFile, true);
@@ -844,7 +1079,7 @@ bool llvm_dsp_factory_aux::initJIT(string& error_msg)
             }
         }
         
-    #if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+    #if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
         fObjectCache = new FaustObjectCache();
         fJIT->setObjectCache(fObjectCache);
     }
@@ -1005,7 +1240,7 @@ void llvm_dsp_factory_aux::write(std::ostream* out, bool binary, bool small)
     string res;
     raw_string_ostream out_str(res);
     if (binary) {
-        WriteBitcodeToFile(fModule, out_str);
+        WRITE_BITCODE(fModule, out_str);
     } else {
         out_str << *fModule;
     }
@@ -1088,16 +1323,19 @@ int llvm_dsp::getNumOutputs()
 void llvm_dsp::init(int samplingRate)
 {
     fFactory->getFactory()->fInit(fDSP, samplingRate);
+    dsp_factory_base::checkSampleRate(samplingRate, fFactory->getFactory()->fGetSampleRate(fDSP));
 }
 
 void llvm_dsp::instanceInit(int samplingRate)
 {
     fFactory->getFactory()->fInstanceInit(fDSP, samplingRate);
+    dsp_factory_base::checkSampleRate(samplingRate, fFactory->getFactory()->fGetSampleRate(fDSP));
 }
 
 void llvm_dsp::instanceConstants(int samplingRate)
 {
     fFactory->getFactory()->fInstanceConstants(fDSP, samplingRate);
+    dsp_factory_base::checkSampleRate(samplingRate, fFactory->getFactory()->fGetSampleRate(fDSP));
 }
 
 void llvm_dsp::instanceResetUserInterface()
@@ -1158,6 +1396,23 @@ EXPORT void stopMTDSPFactories()
     gDSPFactoriesLock = 0;
 }
 
+EXPORT bool setDSPFactoryCacheDirectory(const string& directory, size_t max_size)
+{
+    TLock lock(gDSPFactoriesLock);
+    return gLLVMCache.setDirectory(directory, max_size);
+}
+
+EXPORT void setDSPFactoriesMemoryBudget(size_t budget)
+{
+    TLock lock(gDSPFactoriesLock);
+    gLLVMFactoryTable.setMemoryBudget(budget);
+}
+
+EXPORT size_t getDSPFactoriesMemorySize()
+{
+    return gLLVMFactoryTable.getMemorySize();
+}
+
 EXPORT llvm_dsp_factory* createDSPFactoryFromFile(const string& filename,
                                                 int argc, const char* argv[], 
                                                 const string& target, 
@@ -1174,81 +1429,225 @@ EXPORT llvm_dsp_factory* createDSPFactoryFromFile(const string& filename,
     } 
 }
 
-EXPORT llvm_dsp_factory* createDSPFactoryFromString(const string& name_app, const string& dsp_content,
-                                                    int argc, const char* argv[], 
-                                                    const string& target, 
-                                                    string& error_msg, int opt_level)
+// A factory being created from a DSP source
+struct llvm_dsp_compilation {
+    
+    llvm_dsp_factory_aux* fFactory;     // Still to be JIT compiled
+    string fSHAKey;
+    string fExpandedDSP;
+    string fCacheKey;                   // Set when the machine code has to be written in the cache
+    llvm_dsp_cache_entry fCacheEntry;
+    int fProfileMode;
+    vector<uint64_t> fProfile;          // When compiled with a profile
+    
+    llvm_dsp_compilation():fFactory(nullptr), fProfileMode(llvm_dsp_factory_aux::kNoProfile)
+    {}
+    
+};
+
+// Last step of the creation of a factory from a DSP source, once JIT compiled (to be called with gDSPFactoriesLock held)
+static llvm_dsp_factory* endDSPFactory(llvm_dsp_compilation& compilation)
 {
-    TLock lock(gDSPFactoriesLock);
+    SDsp_factory sfactory;
     
-    string expanded_dsp_content, sha_key;
+    // The same factory may have been created by another thread in the meantime
+    if (gLLVMFactoryTable.getFactory(compilation.fSHAKey, sfactory)) {
+        delete compilation.fFactory;
+        compilation.fFactory = nullptr;
+        compilation.fCacheKey = "";
+        return sfactory;
+    }
     
-    if ((expanded_dsp_content = expandDSPFromString(name_app, dsp_content, argc, argv, sha_key, error_msg)) == "") {
-        return nullptr; 
-    } else {
+    llvm_dsp_factory* factory = new llvm_dsp_factory(compilation.fFactory);
+    factory->setSHAKey(compilation.fSHAKey);
+    factory->setDSPCode(compilation.fExpandedDSP);
+    gLLVMFactoryTable.setFactory(factory, compilation.fFactory->getCodeSize());
+    
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+    // Written by writeDSPFactoryCache once gDSPFactoriesLock is released
+    if (compilation.fCacheKey != "") {
+        compilation.fCacheEntry.fPathnameList = compilation.fFactory->getDSPFactoryLibraryList();
+        compilation.fCacheEntry.fFieldLayout = compilation.fFactory->getFieldLayout();
+        compilation.fCacheEntry.fMachineCode = compilation.fFactory->writeDSPFactoryToMachineAux("");
+    }
+#endif
+    compilation.fFactory = nullptr;
+    return factory;
+}
+
+// Machine code of a new factory written in the cache (to be called without gDSPFactoriesLock held, the file
+// being written by the caller thread)
+static void writeDSPFactoryCache(const llvm_dsp_compilation& compilation)
+{
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+    if (compilation.fCacheKey != "" && compilation.fCacheEntry.fMachineCode != "") {
+        gLLVMCache.write(compilation.fCacheKey, compilation.fCacheEntry);
+    }
+#endif
+}
+
+/*
+ First step of the creation of a factory from a DSP source : returns the factory if it already exists or can be
+ read from the cache, otherwise 'compilation.fFactory' is set to the compiled Faust code, which still has to be
+ JIT compiled. gDSPFactoriesLock is only taken to access the shared tables : the compiler state being thread local,
+ the Faust compilation itself can run concurrently.
+*/
+static llvm_dsp_factory* startDSPFactory(const string& name_app, const string& dsp_content,
+                                         int argc, const char* argv[],
+                                         const string& target,
+                                         string& error_msg, int opt_level,
+                                         llvm_dsp_compilation& compilation)
+{
+    if ((compilation.fExpandedDSP = expandDSPFromString(name_app, dsp_content, argc, argv, compilation.fSHAKey, error_msg)) == "") {
+        return nullptr;
+    }
+    
+    // Instrumented and profiled factories are distinct from the default one
+    if (compilation.fProfileMode == llvm_dsp_factory_aux::kProfileGen) {
+        compilation.fSHAKey = generateSHA1(compilation.fSHAKey + " instrumented");
+    } else if (compilation.fProfileMode == llvm_dsp_factory_aux::kProfileUse) {
+        compilation.fSHAKey = generateSHA1(compilation.fSHAKey + " profile " + writeDSPProfile(compilation.fProfile));
+    }
         
-        int argc1 = 0;
-        const char* argv1[64];
+    int argc1 = 0;
+    const char* argv1[64];
+    
+    argv1[argc1++] = "faust";
+    argv1[argc1++] = "-lang";
+    //argv1[2] = "cllvm";
+    argv1[argc1++] = "llvm";
+    argv1[argc1++] = "-o";
+    argv1[argc1++] = "string";
+    
+    // Filter arguments
+    for (int i = 0; i < argc; i++) {
+        if (!(strcmp(argv[i],"-tg") == 0 ||
+              strcmp(argv[i],"-sg") == 0 ||
+              strcmp(argv[i],"-ps") == 0 ||
+              strcmp(argv[i],"-svg") == 0 ||
+              strcmp(argv[i],"-mdoc") == 0 ||
+              strcmp(argv[i],"-mdlang") == 0 ||
+              strcmp(argv[i],"-stripdoc") == 0 ||
+              strcmp(argv[i],"-sd") == 0 ||
+              strcmp(argv[i],"-xml") == 0 ||
+              strcmp(argv[i],"-json") == 0))
+        {
+            argv1[argc1++] = argv[i];
+        }
+    }
+    
+    // Vector loops sized for the SIMD registers of the factory target, not the ones of the host
+    string vec_loop_size;
+    if ((isParam(argc, argv, "-vec") || isParam(argc, argv, "--vectorize"))
+        && !(isParam(argc, argv, "-vls") || isParam(argc, argv, "--vec-loop-size"))) {
+        vec_loop_size = to_string(LLVMCodeContainer::getVectorLoopSize((target == "") ? getDSPMachineTarget() : target,
+                                                                       isParam(argc, argv, "-double") ? 2 : 1,
+                                                                       atoi(getParam(argc, argv, "-vs", "32").c_str())));
+        argv1[argc1++] = "-vls";
+        argv1[argc1++] = vec_loop_size.c_str();
+    }
+    
+    argv1[argc1] = 0;  // NULL terminated argv
+    
+    compilation.fCacheEntry.fName = name_app;
+    compilation.fCacheEntry.fClassName = getParam(argc, argv, "-cn", "mydsp");
+    compilation.fCacheEntry.fIsDouble = isParam(argc, argv, "-double");
+    
+    {
+        TLock lock(gDSPFactoriesLock);
         
-        argv1[argc1++] = "faust";
-        argv1[argc1++] = "-lang";
-        //argv1[2] = "cllvm";
-        argv1[argc1++] = "llvm";
-        argv1[argc1++] = "-o";
-        argv1[argc1++] = "string";
+        SDsp_factory sfactory;
         
-        // Filter arguments
-        for (int i = 0; i < argc; i++) {
-            if (!(strcmp(argv[i],"-tg") == 0 ||
-                  strcmp(argv[i],"-sg") == 0 ||
-                  strcmp(argv[i],"-ps") == 0 ||
-                  strcmp(argv[i],"-svg") == 0 ||
-                  strcmp(argv[i],"-mdoc") == 0 ||
-                  strcmp(argv[i],"-mdlang") == 0 ||
-                  strcmp(argv[i],"-stripdoc") == 0 ||
-                  strcmp(argv[i],"-sd") == 0 ||
-                  strcmp(argv[i],"-xml") == 0 ||
-                  strcmp(argv[i],"-json") == 0))
-            {
-                argv1[argc1++] = argv[i];
-            }
+        if (gLLVMFactoryTable.getFactory(compilation.fSHAKey, sfactory)) {
+            return sfactory;
         }
         
-        argv1[argc1] = 0;  // NULL terminated argv
-        
-        dsp_factory_table<SDsp_factory>::factory_iterator it;
-        llvm_dsp_factory* factory = 0;
+        // Done here once, JIT compilations may then run without holding gDSPFactoriesLock
+        initTargets();
         
-        if (gLLVMFactoryTable.getFactory(sha_key, it)) {
-            SDsp_factory sfactory = (*it).first;
-            sfactory->addReference();
-            return sfactory;
-        } else {
-            llvm_dsp_factory_aux* factory_aux = static_cast<llvm_dsp_factory_aux*>(compileFaustFactory(argc1, argv1,
-                                                                                                        name_app.c_str(),
-                                                                                                        dsp_content.c_str(),
-                                                                                                        error_msg,
-                                                                                                        true));
-            if (!factory_aux) { return nullptr; }
-            
-            factory_aux->setTarget(target);
-            factory_aux->setOptlevel(opt_level);
-            factory_aux->setClassName(getParam(argc, argv, "-cn", "mydsp"));
-            factory_aux->setName(name_app);
-            factory_aux->setIsDouble(isParam(argc, argv, "-double"));
-          
-            if (factory_aux->initJIT(error_msg)) {
-                factory = new llvm_dsp_factory(factory_aux);
-                gLLVMFactoryTable.setFactory(factory);
-                factory->setSHAKey(sha_key);
-                factory->setDSPCode(expanded_dsp_content);
-                return factory;
-            } else {
-                delete factory_aux;
-                return nullptr;
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+        // Machine code kept by a previous compilation (possibly in another process)
+        if (gLLVMCache.isEnabled() && compilation.fProfileMode == llvm_dsp_factory_aux::kNoProfile) {
+            compilation.fCacheKey = gLLVMCache.getKey(compilation.fSHAKey, (target == "") ? getDSPMachineTarget() : target, opt_level);
+            llvm_dsp_cache_entry entry;
+            if (gLLVMCache.read(compilation.fCacheKey, entry)) {
+                llvm_dsp_factory_aux* factory_aux = new llvm_dsp_factory_aux(compilation.fSHAKey, entry.fMachineCode, target, entry.fPathnameList);
+                factory_aux->setClassName(entry.fClassName);
+                factory_aux->setName(entry.fName);
+                factory_aux->setIsDouble(entry.fIsDouble);
+                factory_aux->setFieldLayout(entry.fFieldLayout);
+                string cache_error;
+                if (factory_aux->initJIT(cache_error)) {
+                    compilation.fFactory = factory_aux;
+                    compilation.fCacheKey = "";
+                    return endDSPFactory(compilation);
+                } else {
+                    // Unusable machine code : compile again, the entry will be replaced
+                    delete factory_aux;
+                }
             }
         }
+#endif
+    }
+    
+    llvm_dsp_factory_aux* factory_aux = static_cast<llvm_dsp_factory_aux*>(compileFaustFactory(argc1, argv1,
+                                                                                                name_app.c_str(),
+                                                                                                dsp_content.c_str(),
+                                                                                                error_msg,
+                                                                                                true));
+    if (factory_aux) {
+        factory_aux->setTarget(target);
+        factory_aux->setOptlevel(opt_level);
+        factory_aux->setClassName(compilation.fCacheEntry.fClassName);
+        factory_aux->setName(name_app);
+        factory_aux->setIsDouble(compilation.fCacheEntry.fIsDouble);
+        factory_aux->setProfile(compilation.fProfileMode, compilation.fProfile);
+        if (compilation.fProfileMode == llvm_dsp_factory_aux::kProfileGen) {
+            llvm_dsp_source source;
+            source.fName = name_app;
+            source.fDSPContent = dsp_content;
+            source.fArgv = vector<string>(argv, argv + argc);
+            source.fTarget = target;
+            source.fOptLevel = opt_level;
+            factory_aux->setProfileSource(source);
+        }
+        compilation.fFactory = factory_aux;
+    }
+    return nullptr;
+}
+
+// Creation of a factory from a DSP source (to be called with gDSPFactoriesLock held)
+static llvm_dsp_factory* createDSPFactoryAux(const string& name_app, const string& dsp_content,
+                                             int argc, const char* argv[],
+                                             const string& target,
+                                             string& error_msg, int opt_level,
+                                             llvm_dsp_compilation& compilation)
+{
+    llvm_dsp_factory* factory = startDSPFactory(name_app, dsp_content, argc, argv, target, error_msg, opt_level, compilation);
+    
+    if (!compilation.fFactory) {
+        return factory;
+    } else if (compilation.fFactory->initJIT(error_msg)) {
+        return endDSPFactory(compilation);
+    } else {
+        delete compilation.fFactory;
+        return nullptr;
     }
+}
+
+EXPORT llvm_dsp_factory* createDSPFactoryFromString(const string& name_app, const string& dsp_content,
+                                                    int argc, const char* argv[], 
+                                                    const string& target, 
+                                                    string& error_msg, int opt_level)
+{
+    llvm_dsp_compilation compilation;
+    llvm_dsp_factory* factory;
+    {
+        TLock lock(gDSPFactoriesLock);
+        factory = createDSPFactoryAux(name_app, dsp_content, argc, argv, target, error_msg, opt_level, compilation);
+    }
+    writeDSPFactoryCache(compilation);
+    return factory;
     
     /*
     string sha_key = generateSHA1(reorganize_compilation_options(argc, argv) + dsp_content);
@@ -1267,6 +1666,159 @@ EXPORT llvm_dsp_factory* createDSPFactoryFromString(const string& name_app, cons
     }*/
 }
 
+llvm_dsp_factory* createDSPFactoryFromStringConcurrent(const string& name_app, const string& dsp_content,
+                                                       int argc, const char* argv[],
+                                                       const string& target,
+                                                       string& error_msg, int opt_level)
+{
+    // Both the Faust compilation and the JIT compilation are done concurrently
+    llvm_dsp_compilation compilation;
+    llvm_dsp_factory* factory = startDSPFactory(name_app, dsp_content, argc, argv, target, error_msg, opt_level, compilation);
+    
+    if (!compilation.fFactory) {
+        return factory;
+    } else if (compilation.fFactory->initJIT(error_msg)) {
+        {
+            TLock lock(gDSPFactoriesLock);
+            factory = endDSPFactory(compilation);
+        }
+        writeDSPFactoryCache(compilation);
+        return factory;
+    } else {
+        delete compilation.fFactory;
+        return nullptr;
+    }
+}
+
+EXPORT bool startAsyncDSPFactories(int workers, int max_waiting)
+{
+    TLock lock(&gAsyncLock);
+    if (gAsyncQueue || workers <= 0 || max_waiting <= 0 || !startMTDSPFactories()) {
+        return false;
+    } else {
+        gAsyncQueue = new llvm_dsp_queue(workers, max_waiting);
+        return true;
+    }
+}
+
+EXPORT void stopAsyncDSPFactories()
+{
+    llvm_dsp_queue* queue;
+    {
+        TLock lock(&gAsyncLock);
+        // A worker (that is a callback) cannot wait for itself to be finished
+        if (!gAsyncQueue || gAsyncQueue->isWorker()) return;
+        queue = gAsyncQueue;
+        gAsyncQueue = 0;
+    }
+    // Workers are joined without gAsyncLock, since their callbacks may create or cancel requests
+    delete queue;
+}
+
+EXPORT int createAsyncDSPFactoryFromFile(const string& filename,
+                                         int argc, const char* argv[],
+                                         const string& target,
+                                         llvmFactoryCallback callback, void* arg,
+                                         int opt_level, int priority)
+{
+    string base = basename((char*)filename.c_str());
+    size_t pos = filename.find(".dsp");
+    
+    if (pos != string::npos) {
+        return createAsyncDSPFactoryFromString(base.substr(0, pos), pathToContent(filename), argc, argv, target, callback, arg, opt_level, priority);
+    } else {
+        return -1;
+    }
+}
+
+EXPORT int createAsyncDSPFactoryFromString(const string& name_app, const string& dsp_content,
+                                           int argc, const char* argv[],
+                                           const string& target,
+                                           llvmFactoryCallback callback, void* arg,
+                                           int opt_level, int priority)
+{
+    TLock lock(&gAsyncLock);
+    
+    if (!gAsyncQueue) {
+        int workers = std::max(1, int(sysconf(_SC_NPROCESSORS_ONLN)));
+        if (!startMTDSPFactories()) return -1;
+        gAsyncQueue = new llvm_dsp_queue(workers, 256);
+    }
+    
+    llvm_dsp_request* request = new llvm_dsp_request();
+    request->fPriority = priority;
+    request->fNameApp = name_app;
+    request->fDSPContent = dsp_content;
+    for (int i = 0; i < argc; i++) {
+        request->fArgv.push_back(argv[i]);
+    }
+    request->fTarget = target;
+    request->fOptLevel = opt_level;
+    request->fCallback = callback;
+    request->fArg = arg;
+    
+    int id = gAsyncQueue->push(request);
+    if (id < 0) delete request;
+    return id;
+}
+
+EXPORT bool cancelAsyncDSPFactory(int request)
+{
+    TLock lock(&gAsyncLock);
+    return (gAsyncQueue) ? gAsyncQueue->cancel(request) : false;
+}
+
+EXPORT llvm_dsp_factory* createInstrumentedDSPFactoryFromFile(const string& filename,
+                                                              int argc, const char* argv[],
+                                                              const string& target,
+                                                              string& error_msg, int opt_level)
+{
+    string base = basename((char*)filename.c_str());
+    size_t pos = filename.find(".dsp");
+    
+    if (pos != string::npos) {
+        return createInstrumentedDSPFactoryFromString(base.substr(0, pos), pathToContent(filename), argc, argv, target, error_msg, opt_level);
+    } else {
+        error_msg = "File Extension is not the one expected (.dsp expected)";
+        return nullptr;
+    }
+}
+
+EXPORT llvm_dsp_factory* createInstrumentedDSPFactoryFromString(const string& name_app, const string& dsp_content,
+                                                                int argc, const char* argv[],
+                                                                const string& target,
+                                                                string& error_msg, int opt_level)
+{
+    TLock lock(gDSPFactoriesLock);
+    
+    llvm_dsp_compilation compilation;
+    compilation.fProfileMode = llvm_dsp_factory_aux::kProfileGen;
+    return createDSPFactoryAux(name_app, dsp_content, argc, argv, target, error_msg, opt_level, compilation);
+}
+
+EXPORT llvm_dsp_factory* createProfiledDSPFactory(llvm_dsp_factory* factory, string& error_msg)
+{
+    TLock lock(gDSPFactoriesLock);
+    
+    llvm_dsp_compilation compilation;
+    compilation.fProfileMode = llvm_dsp_factory_aux::kProfileUse;
+    if (!factory || !factory->getFactory()->readProfile(compilation.fProfile)) {
+        error_msg = "ERROR : not an instrumented factory";
+        return nullptr;
+    }
+    
+    // Compiled again from the same DSP source
+    const llvm_dsp_source& source = factory->getFactory()->getProfileSource();
+    vector<const char*> argv;
+    for (size_t i = 0; i < source.fArgv.size(); i++) {
+        argv.push_back(source.fArgv[i].c_str());
+    }
+    argv.push_back(0);  // NULL terminated argv
+    
+    return createDSPFactoryAux(source.fName, source.fDSPContent, int(source.fArgv.size()), &argv[0],
+                               source.fTarget, error_msg, source.fOptLevel, compilation);
+}
+
 EXPORT llvm_dsp_factory* getDSPFactoryFromSHAKey(const string& sha_key)
 {
     TLock lock(gDSPFactoriesLock);
@@ -1312,11 +1864,9 @@ EXPORT void deleteAllDSPFactories()
 static llvm_dsp_factory* readDSPFactoryFromBitcodeAux(MEMORY_BUFFER buffer, const string& target, int opt_level)
 {
     string sha_key = generateSHA1(MEMORY_BUFFER_GET(buffer).str());
-    dsp_factory_table<SDsp_factory>::factory_iterator it;
+    SDsp_factory sfactory;
     
-    if (gLLVMFactoryTable.getFactory(sha_key, it)) {
-        SDsp_factory sfactory = (*it).first;
-        sfactory->addReference();
+    if (gLLVMFactoryTable.getFactory(sha_key, sfactory)) {
         return sfactory;
     } else {
         string error_msg;
@@ -1329,8 +1879,8 @@ static llvm_dsp_factory* readDSPFactoryFromBitcodeAux(MEMORY_BUFFER buffer, cons
         
         if (factory_aux->initJIT(error_msg)) {
             llvm_dsp_factory* factory = new llvm_dsp_factory(factory_aux);
-            gLLVMFactoryTable.setFactory(factory);
             factory->setSHAKey(sha_key);
+            gLLVMFactoryTable.setFactory(factory, factory_aux->getCodeSize());
             return factory;
         } else {
             std::cerr << "readDSPFactoryFromBitcode failed : " << error_msg << std::endl;
@@ -1357,7 +1907,7 @@ EXPORT llvm_dsp_factory* readDSPFactoryFromBitcodeFile(const string& bit_code_pa
 {
     TLock lock(gDSPFactoriesLock);
   
-#if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     ErrorOr<OwningPtr<MemoryBuffer>> buffer = MemoryBuffer::getFileOrSTDIN(bit_code_path);
     if (error_code ec = buffer.getError()) {
         std::cerr << "readDSPFactoryFromBitcodeFile failed : " << ec.message() << std::endl;
@@ -1389,18 +1939,16 @@ EXPORT void writeDSPFactoryToBitcodeFile(llvm_dsp_factory* factory, const string
 static llvm_dsp_factory* readDSPFactoryFromIRAux(MEMORY_BUFFER buffer, const string& target, int opt_level)
 {
     string sha_key = generateSHA1(MEMORY_BUFFER_GET(buffer).str());
-    dsp_factory_table<SDsp_factory>::factory_iterator it;
+    SDsp_factory sfactory;
     
-    if (gLLVMFactoryTable.getFactory(sha_key, it)) {
-        SDsp_factory sfactory = (*it).first;
-        sfactory->addReference();
+    if (gLLVMFactoryTable.getFactory(sha_key, sfactory)) {
         return sfactory;
     } else {
         char* tmp_local = setlocale(LC_ALL, NULL);
         setlocale(LC_ALL, "C");
         LLVMContext* context = new LLVMContext();
         SMDiagnostic err;
-    #if defined(LLVM_36) || defined(LLVM_37) ||defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+    #if defined(LLVM_36) || defined(LLVM_37) ||defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
         Module* module = parseIR(buffer, err, *context).release();  // parseIR takes ownership of the given buffer, so don't delete it
     #else
         Module* module = ParseIR(buffer, err, *context);            // ParseIR takes ownership of the given buffer, so don't delete it
@@ -1414,8 +1962,8 @@ static llvm_dsp_factory* readDSPFactoryFromIRAux(MEMORY_BUFFER buffer, const str
         
         if (factory_aux->initJIT(error_msg)) {
             llvm_dsp_factory* factory = new llvm_dsp_factory(factory_aux);
-            gLLVMFactoryTable.setFactory(factory);
             factory->setSHAKey(sha_key);
+            gLLVMFactoryTable.setFactory(factory, factory_aux->getCodeSize());
             return factory;
         } else {
             std::cerr << "readDSPFactoryFromBitcode failed : " << error_msg << std::endl;
@@ -1442,7 +1990,7 @@ EXPORT llvm_dsp_factory* readDSPFactoryFromIRFile(const string& ir_code_path, co
 {
     TLock lock(gDSPFactoriesLock);
  
- #if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+ #if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     ErrorOr<OwningPtr<MemoryBuffer>> buffer = MemoryBuffer::getFileOrSTDIN(ir_code_path);
     if (error_code ec = buffer.getError()) {
         std::cerr << "readDSPFactoryFromIRFile failed : " << ec.message() << std::endl;
@@ -1470,16 +2018,95 @@ EXPORT void writeDSPFactoryToIRFile(llvm_dsp_factory* factory, const string& ir_
     }
 }
 
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
     
+static int countFeatures(uint64_t bits)
+{
+    int count = 0;
+    for (; bits; bits &= bits - 1) count++;
+    return count;
+}
+
+template <class BITS>
+static int countFeatures(const BITS& bits)
+{
+    return int(bits.count());
+}
+
+/*
+ Choose the variant of a machine code bundle to be used on the host : among the variants for the host architecture
+ and OS whose CPU features are all available on the host CPU, the one using the most features.
+*/
+static int selectMachineVariant(const machine_variants& variants)
+{
+    initTargets();
+    
+    string error_msg;
+    Triple host_triple(llvm::sys::getDefaultTargetTriple());
+    const Target* target = TargetRegistry::lookupTarget(host_triple.str(), error_msg);
+    if (!target) {
+        return -1;
+    }
+    
+    SubtargetFeatures features;
+    StringMap<bool> host_features;
+    if (llvm::sys::getHostCPUFeatures(host_features)) {
+        for (StringMap<bool>::iterator it = host_features.begin(); it != host_features.end(); it++) {
+            features.AddFeature(it->first(), it->second);
+        }
+    }
+    std::unique_ptr<MCSubtargetInfo> host(target->createMCSubtargetInfo(host_triple.str(), GET_CPU_NAME, features.getString()));
+    
+    int best = -1;
+    int best_count = -1;
+    for (size_t i = 0; i < variants.size(); i++) {
+        string triple, cpu;
+        splitTarget(variants[i].first, triple, cpu);
+        Triple variant_triple(triple);
+        if (variant_triple.getArch() != host_triple.getArch() || variant_triple.getOS() != host_triple.getOS()) {
+            continue;
+        }
+        std::unique_ptr<MCSubtargetInfo> variant(target->createMCSubtargetInfo(triple, cpu, ""));
+        if ((variant->getFeatureBits() & host->getFeatureBits()) == variant->getFeatureBits()) {
+            int count = countFeatures(variant->getFeatureBits());
+            if (count > best_count) {
+                best = int(i);
+                best_count = count;
+            }
+        }
+    }
+    return best;
+}
+
 static llvm_dsp_factory* readDSPFactoryFromMachineAux(MEMORY_BUFFER buffer, const string& target)
 {
+    // Bundle : the variant of the given target, or the best one for the host
+    if (isMachineBundle(MEMORY_BUFFER_GET(buffer).str())) {
+        machine_variants variants;
+        if (!readMachineBundle(MEMORY_BUFFER_GET(buffer).str(), variants)) {
+            std::cerr << "readDSPFactoryFromMachine failed : incorrect machine code bundle" << std::endl;
+            return nullptr;
+        }
+        int variant = -1;
+        if (target == "") {
+            variant = selectMachineVariant(variants);
+        } else {
+            for (size_t i = 0; i < variants.size() && variant < 0; i++) {
+                if (variants[i].first == target) variant = int(i);
+            }
+        }
+        if (variant < 0) {
+            std::cerr << "readDSPFactoryFromMachine failed : no variant of the machine code bundle for target "
+                      << ((target == "") ? getDSPMachineTarget() : target) << std::endl;
+            return nullptr;
+        }
+        return readDSPFactoryFromMachineAux(MEMORY_BUFFER_CREATE(StringRef(variants[variant].second)), variants[variant].first);
+    }
+    
     string sha_key = generateSHA1(MEMORY_BUFFER_GET(buffer).str());
-    dsp_factory_table<SDsp_factory>::factory_iterator it;
+    SDsp_factory sfactory;
     
-    if (gLLVMFactoryTable.getFactory(sha_key, it)) {
-        SDsp_factory sfactory = (*it).first;
-        sfactory->addReference();
+    if (gLLVMFactoryTable.getFactory(sha_key, sfactory)) {
         return sfactory;
     } else {
         string error_msg;
@@ -1488,8 +2115,8 @@ static llvm_dsp_factory* readDSPFactoryFromMachineAux(MEMORY_BUFFER buffer, cons
         
         if (factory_aux->initJIT(error_msg)) {
             llvm_dsp_factory* factory = new llvm_dsp_factory(factory_aux);
-            gLLVMFactoryTable.setFactory(factory);
             factory->setSHAKey(sha_key);
+            gLLVMFactoryTable.setFactory(factory, factory_aux->getCodeSize());
             return factory;
         } else {
             std::cerr << "readDSPFactoryFromMachine failed : " << error_msg << std::endl;
@@ -1517,7 +2144,7 @@ EXPORT llvm_dsp_factory* readDSPFactoryFromMachineFile(const string& machine_cod
 {
     TLock lock(gDSPFactoriesLock);
     
-#if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     ErrorOr<OwningPtr<MemoryBuffer>> buffer = MemoryBuffer::getFileOrSTDIN(machine_code_path);
     if (error_code ec = buffer.getError()) {
         std::cerr << "readDSPFactoryFromMachineFile failed : " << ec.message() << std::endl;
@@ -1544,6 +2171,21 @@ EXPORT void writeDSPFactoryToMachineFile(llvm_dsp_factory* factory, const string
     }
 }
 
+// machine bundle ==> string/file
+EXPORT string writeDSPFactoryToMachineBundle(llvm_dsp_factory* factory, const vector<string>& targets)
+{
+    TLock lock(gDSPFactoriesLock);
+    return factory->writeDSPFactoryToMachineBundle(targets);
+}
+
+EXPORT void writeDSPFactoryToMachineBundleFile(llvm_dsp_factory* factory, const string& machine_code_path, const vector<string>& targets)
+{
+    TLock lock(gDSPFactoriesLock);
+    if (factory) {
+        factory->writeDSPFactoryToMachineBundleFile(machine_code_path, targets);
+    }
+}
+
 #else
 
 EXPORT llvm_dsp_factory_aux* readDSPFactoryFromMachine(const string& machine_code)
@@ -1569,6 +2211,17 @@ EXPORT void writeDSPFactoryToMachineFile(llvm_dsp_factory_aux* factory, const st
     std::cerr << "writeDSPFactoryToMachineFile not implemented" << std::endl;
 }
 
+EXPORT string writeDSPFactoryToMachineBundle(llvm_dsp_factory* factory, const vector<string>& targets)
+{
+    std::cerr << "writeDSPFactoryToMachineBundle not implemented" << std::endl;
+    return "";
+}
+
+EXPORT void writeDSPFactoryToMachineBundleFile(llvm_dsp_factory* factory, const string& machine_code_path, const vector<string>& targets)
+{
+    std::cerr << "writeDSPFactoryToMachineBundleFile not implemented" << std::endl;
+}
+
 #endif
         
 // Instance
@@ -1576,7 +2229,7 @@ EXPORT void writeDSPFactoryToMachineFile(llvm_dsp_factory_aux* factory, const st
 EXPORT llvm_dsp* llvm_dsp_factory::createDSPInstance()
 {
     dsp* dsp = fFactory->createDSPInstance(this);
-    gLLVMFactoryTable.addDSP(this, dsp);
+    if (dsp) gLLVMFactoryTable.addDSP(this, dsp, sizeof(llvm_dsp) + fFactory->getDSPSize());
     return reinterpret_cast<llvm_dsp*>(dsp);
 }
 
@@ -1639,6 +2292,66 @@ EXPORT bool startMTCDSPFactories() { return startMTDSPFactories(); }
 
 EXPORT void stopMTCDSPFactories() { stopMTDSPFactories(); }
 
+EXPORT bool setCDSPFactoryCacheDirectory(const char* directory, size_t max_size) { return setDSPFactoryCacheDirectory(directory, max_size); }
+
+EXPORT void setCDSPFactoriesMemoryBudget(size_t budget) { setDSPFactoriesMemoryBudget(budget); }
+
+EXPORT size_t getCDSPFactoriesMemorySize() { return getDSPFactoriesMemorySize(); }
+
+EXPORT bool startAsyncCDSPFactories(int workers, int max_waiting) { return startAsyncDSPFactories(workers, max_waiting); }
+
+EXPORT void stopAsyncCDSPFactories() { stopAsyncDSPFactories(); }
+
+EXPORT int createAsyncCDSPFactoryFromFile(const char* filename,
+                                          int argc, const char* argv[],
+                                          const char* target,
+                                          llvmFactoryCallback callback, void* arg,
+                                          int opt_level, int priority)
+{
+    return createAsyncDSPFactoryFromFile(filename, argc, argv, target, callback, arg, opt_level, priority);
+}
+
+EXPORT int createAsyncCDSPFactoryFromString(const char* name_app, const char* dsp_content,
+                                            int argc, const char* argv[],
+                                            const char* target,
+                                            llvmFactoryCallback callback, void* arg,
+                                            int opt_level, int priority)
+{
+    return createAsyncDSPFactoryFromString(name_app, dsp_content, argc, argv, target, callback, arg, opt_level, priority);
+}
+
+EXPORT bool cancelAsyncCDSPFactory(int request) { return cancelAsyncDSPFactory(request); }
+
+EXPORT llvm_dsp_factory* createInstrumentedCDSPFactoryFromFile(const char* filename,
+                                                               int argc, const char* argv[],
+                                                               const char* target,
+                                                               char* error_msg, int opt_level)
+{
+    string error_msg_aux;
+    llvm_dsp_factory* factory = createInstrumentedDSPFactoryFromFile(filename, argc, argv, target, error_msg_aux, opt_level);
+    strncpy(error_msg, error_msg_aux.c_str(), 4096);
+    return factory;
+}
+
+EXPORT llvm_dsp_factory* createInstrumentedCDSPFactoryFromString(const char* name_app, const char* dsp_content,
+                                                                 int argc, const char* argv[],
+                                                                 const char* target,
+                                                                 char* error_msg, int opt_level)
+{
+    string error_msg_aux;
+    llvm_dsp_factory* factory = createInstrumentedDSPFactoryFromString(name_app, dsp_content, argc, argv, target, error_msg_aux, opt_level);
+    strncpy(error_msg, error_msg_aux.c_str(), 4096);
+    return factory;
+}
+
+EXPORT llvm_dsp_factory* createProfiledCDSPFactory(llvm_dsp_factory* factory, char* error_msg)
+{
+    string error_msg_aux;
+    llvm_dsp_factory* profiled = createProfiledDSPFactory(factory, error_msg_aux);
+    strncpy(error_msg, error_msg_aux.c_str(), 4096);
+    return profiled;
+}
+
 EXPORT bool deleteCDSPFactory(llvm_dsp_factory* factory)
 {
     return deleteDSPFactory(factory);
@@ -1758,7 +2471,7 @@ EXPORT void writeCDSPFactoryToIRFile(llvm_dsp_factory* factory, const char* ir_c
     }
 }
 
-#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
 EXPORT llvm_dsp_factory* readCDSPFactoryFromMachine(const char* machine_code, const char* target)
 {
     return readDSPFactoryFromMachine(machine_code, target);
@@ -1780,6 +2493,27 @@ EXPORT void writeCDSPFactoryToMachineFile(llvm_dsp_factory* factory, const char*
         writeDSPFactoryToMachineFile(factory, machine_code_path, target);
     }
 }
+
+static vector<string> getTargets(const char** targets)
+{
+    vector<string> res;
+    for (int i = 0; targets && targets[i]; i++) {
+        res.push_back(targets[i]);
+    }
+    return res;
+}
+
+EXPORT char* writeCDSPFactoryToMachineBundle(llvm_dsp_factory* factory, const char** targets)
+{
+    return (factory) ? strdup(writeDSPFactoryToMachineBundle(factory, getTargets(targets)).c_str()) : nullptr;
+}
+
+EXPORT void writeCDSPFactoryToMachineBundleFile(llvm_dsp_factory* factory, const char* machine_code_path, const char** targets)
+{
+    if (factory) {
+        writeDSPFactoryToMachineBundleFile(factory, machine_code_path, getTargets(targets));
+    }
+}
 #else
 EXPORT llvm_dsp_factory* readCDSPFactoryFromMachine(const char* machine_code)
 {
@@ -1798,6 +2532,14 @@ EXPORT llvm_dsp_factory* readCDSPFactoryFromMachineFile(const char* machine_code
 
 EXPORT void writeCDSPFactoryToMachineFile(llvm_dsp_factory* factory, const char* machine_code_path, const string& target)
 {}
+
+EXPORT char* writeCDSPFactoryToMachineBundle(llvm_dsp_factory* factory, const char** targets)
+{
+    return nullptr;
+}
+
+EXPORT void writeCDSPFactoryToMachineBundleFile(llvm_dsp_factory* factory, const char* machine_code_path, const char** targets)
+{}
 #endif
 
 EXPORT void metadataCDSPInstance(llvm_dsp* dsp, MetaGlue* glue)
@@ -1900,7 +2642,7 @@ EXPORT void deleteCDSPInstance(llvm_dsp* dsp)
 ModulePTR loadSingleModule(const string filename, LLVMContext* context)
 {
     SMDiagnostic err;
-#if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     ModulePTR module = parseIRFile(filename, err, *context);
 #elif defined(LLVM_36) || defined(LLVM_37)
     ModulePTR module = parseIRFile(filename, err, *context).release();
@@ -1938,7 +2680,7 @@ bool linkModules(Module* dst, ModulePTR src, char* error_msg)
 {
     bool res = false;
     
-#if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     if (Linker::linkModules(*dst, MovePTR(src))) {
         snprintf(error_msg, 256, "cannot link module");
         
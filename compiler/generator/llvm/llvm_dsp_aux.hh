@@ -27,6 +27,8 @@
 #include <vector>
 #include <utility>
 
+#include <stdint.h>
+
 #include "faust/gui/CInterface.h"
 #include "faust/dsp/dsp.h"
 #include "faust/gui/meta.h"
@@ -36,7 +38,7 @@
 #include "dsp_factory.hh"
 #include "TMutex.h"
 
-#if defined(LLVM_34) || defined(LLVM_35)  || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_34) || defined(LLVM_35)  || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #define LLVM_MAX_OPT_LEVEL 5
 #else
     #define LLVM_MAX_OPT_LEVEL 4
@@ -54,6 +56,33 @@ namespace llvm
 class llvm_dsp_factory;
 
 class FaustObjectCache;
+class FaustSectionMemoryManager;
+
+// Called on a worker thread with the result of an asynchronous compilation (factory or error message)
+typedef void (*llvmFactoryCallback)(llvm_dsp_factory* factory, const char* error_msg, void* arg);
+
+// Layout of a field of the DSP structure
+struct llvm_field_desc {
+    
+    int fOffset;    // In bytes
+    int fSize;      // Number of items
+    int fType;      // Items type : 0 for int32, sizeof(float) or sizeof(double) for reals, -1 otherwise
+    
+};
+
+// DSP source and compilation parameters of a factory, to compile it again
+struct llvm_dsp_source {
+    
+    string fName;
+    string fDSPContent;
+    std::vector<std::string> fArgv;
+    string fTarget;
+    int fOptLevel;
+    
+    llvm_dsp_source():fOptLevel(-1)
+    {}
+    
+};
 
 // Public C++ interface
 
@@ -69,6 +98,9 @@ class EXPORT llvm_dsp : public dsp {
         llvm_dsp(llvm_dsp_factory* factory, dsp_imp* dsp);
         virtual ~llvm_dsp();
     
+        // DSP structure, with the layout given by llvm_dsp_factory_aux::getFieldLayout
+        dsp_imp* getDSP() { return fDSP; }
+    
         void operator delete(void* ptr);
     
         virtual int getNumInputs();
@@ -109,8 +141,9 @@ class llvm_dsp_factory_aux : public dsp_factory_imp {
     
         llvm::ExecutionEngine* fJIT;
 
-    #if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
+    #if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
         FaustObjectCache* fObjectCache;
+        FaustSectionMemoryManager* fSectionMemoryManager;  // Owned by fJIT
     #endif
     
         llvm::Module* fModule;
@@ -122,6 +155,15 @@ class llvm_dsp_factory_aux : public dsp_factory_imp {
         string fTypeName;
         bool fIsDouble;
     
+        // Layout of the DSP structure, only known for factories compiled from a DSP source
+        std::map<string, llvm_field_desc> fFieldLayout;
+    
+        // Profile guided compilation (see llvm_dsp_profile.hh)
+        int fProfileMode;
+        int fProfileSites;                  // Number of instrumented sites
+        std::vector<uint64_t> fProfile;     // To be used by the next optimization of the module
+        llvm_dsp_source fProfileSource;     // Of an instrumented factory
+    
         newDspFun fNew;
         deleteDspFun fDelete;
         getNumInputsFun fGetNumInputs;
@@ -143,16 +185,17 @@ class llvm_dsp_factory_aux : public dsp_factory_imp {
         
         bool crossCompile(const std::string& target);
       
-    #if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+    #if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
         static void LLVMFatalErrorHandler(const char* reason);
     #endif
     
-        string writeDSPFactoryToMachineAux(const string& target);
         void startLLVMLibrary();
         void stopLLVMLibrary();
     
     public:
     
+        enum { kNoProfile, kProfileGen, kProfileUse };
+    
         llvm_dsp_factory_aux(const string& sha_key,
                              const std::vector<std::string>& pathname_list,
                              llvm::Module* module,
@@ -160,8 +203,9 @@ class llvm_dsp_factory_aux : public dsp_factory_imp {
                              const string& target,
                              int opt_level = 0);
         
-    #if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)) && !defined(_MSC_VER)
-        llvm_dsp_factory_aux(const string& sha_key, const string& machine_code, const string& target);
+    #if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+        llvm_dsp_factory_aux(const string& sha_key, const string& machine_code, const string& target,
+                             const std::vector<std::string>& pathname_list = std::vector<std::string>());
     #endif
     
         virtual ~llvm_dsp_factory_aux();
@@ -186,10 +230,19 @@ class llvm_dsp_factory_aux : public dsp_factory_imp {
         
         void writeDSPFactoryToIRFile(const string& ir_code_path);
         
+        string writeDSPFactoryToMachineAux(const string& target);
+        
         string writeDSPFactoryToMachine(const string& target);
         
         void writeDSPFactoryToMachineFile(const string& machine_code_path, const string& target);
         
+        // Machine code bundle for several targets
+        string writeDSPFactoryToMachineBundleAux(const std::vector<std::string>& targets);
+        
+        string writeDSPFactoryToMachineBundle(const std::vector<std::string>& targets);
+        
+        void writeDSPFactoryToMachineBundleFile(const string& machine_code_path, const std::vector<std::string>& targets);
+        
         bool initJIT(std::string& error_msg);
     
         std::string getTarget();
@@ -201,6 +254,20 @@ class llvm_dsp_factory_aux : public dsp_factory_imp {
         void setClassName(const string& class_name) { fClassName = class_name; }
     
         void setIsDouble(bool is_double) { fIsDouble = is_double; }
+    
+        void setFieldLayout(const std::map<string, llvm_field_desc>& layout) { fFieldLayout = layout; }
+        const std::map<string, llvm_field_desc>& getFieldLayout() { return fFieldLayout; }
+    
+        void setProfile(int mode, const std::vector<uint64_t>& profile) { fProfileMode = mode; fProfile = profile; }
+        void setProfileSource(const llvm_dsp_source& source) { fProfileSource = source; }
+        const llvm_dsp_source& getProfileSource() { return fProfileSource; }
+    
+        // Counters of an instrumented factory, since its JIT compilation
+        bool readProfile(std::vector<uint64_t>& profile);
+    
+        // Memory of the JIT compiled code and data, and of an instance
+        size_t getCodeSize();
+        size_t getDSPSize() { return (fGetSize) ? fGetSize() : 0; }
    
         llvm_dsp* createDSPInstance(dsp_factory* factory);
     
@@ -273,6 +340,16 @@ class EXPORT llvm_dsp_factory : public dsp_factory, public faust_smartable {
             fFactory->writeDSPFactoryToMachineFile(machine_code_path, target);
         }
     
+        std::string writeDSPFactoryToMachineBundle(const std::vector<std::string>& targets)
+        {
+            return fFactory->writeDSPFactoryToMachineBundle(targets);
+        }
+    
+        void writeDSPFactoryToMachineBundleFile(const std::string& machine_code_path, const std::vector<std::string>& targets)
+        {
+            fFactory->writeDSPFactoryToMachineBundleFile(machine_code_path, targets);
+        }
+    
         llvm_dsp_factory_aux* getFactory() { return fFactory; }
 
 };
@@ -289,6 +366,43 @@ EXPORT llvm_dsp_factory* createDSPFactoryFromString(const std::string& name_app,
                                                     const std::string& target, 
                                                     std::string& error_msg, int opt_level = -1);
 
+// Same as createDSPFactoryFromString, but the JIT compilation is done without holding the API lock
+llvm_dsp_factory* createDSPFactoryFromStringConcurrent(const std::string& name_app, const std::string& dsp_content,
+                                                       int argc, const char* argv[],
+                                                       const std::string& target,
+                                                       std::string& error_msg, int opt_level);
+
+EXPORT bool startAsyncDSPFactories(int workers, int max_waiting);
+
+EXPORT void stopAsyncDSPFactories();
+
+EXPORT int createAsyncDSPFactoryFromFile(const std::string& filename,
+                                         int argc, const char* argv[],
+                                         const std::string& target,
+                                         llvmFactoryCallback callback, void* arg,
+                                         int opt_level = -1, int priority = 0);
+
+EXPORT int createAsyncDSPFactoryFromString(const std::string& name_app, const std::string& dsp_content,
+                                           int argc, const char* argv[],
+                                           const std::string& target,
+                                           llvmFactoryCallback callback, void* arg,
+                                           int opt_level = -1, int priority = 0);
+
+EXPORT bool cancelAsyncDSPFactory(int request);
+
+// Profile guided compilation
+EXPORT llvm_dsp_factory* createInstrumentedDSPFactoryFromFile(const std::string& filename,
+                                                              int argc, const char* argv[],
+                                                              const std::string& target,
+                                                              std::string& error_msg, int opt_level = -1);
+
+EXPORT llvm_dsp_factory* createInstrumentedDSPFactoryFromString(const std::string& name_app, const std::string& dsp_content,
+                                                                int argc, const char* argv[],
+                                                                const std::string& target,
+                                                                std::string& error_msg, int opt_level = -1);
+
+EXPORT llvm_dsp_factory* createProfiledDSPFactory(llvm_dsp_factory* factory, std::string& error_msg);
+
 EXPORT bool deleteDSPFactory(llvm_dsp_factory* factory);
 
 EXPORT std::string getDSPMachineTarget();
@@ -303,6 +417,12 @@ EXPORT bool startMTDSPFactories();
 
 EXPORT void stopMTDSPFactories();
 
+EXPORT bool setDSPFactoryCacheDirectory(const std::string& directory, size_t max_size = 0);
+
+EXPORT void setDSPFactoriesMemoryBudget(size_t budget);
+
+EXPORT size_t getDSPFactoriesMemorySize();
+
 // Bitcode <==> string
 EXPORT llvm_dsp_factory* readDSPFactoryFromBitcode(const std::string& bit_code, const std::string& target, int opt_level = 0);
 
@@ -333,6 +453,11 @@ EXPORT llvm_dsp_factory* readDSPFactoryFromMachineFile(const std::string& machin
 
 EXPORT void writeDSPFactoryToMachineFile(llvm_dsp_factory* factory, const std::string& machine_code_path, const std::string& target);
 
+// Machine code bundle ==> string/file
+EXPORT std::string writeDSPFactoryToMachineBundle(llvm_dsp_factory* factory, const std::vector<std::string>& targets);
+
+EXPORT void writeDSPFactoryToMachineBundleFile(llvm_dsp_factory* factory, const std::string& machine_code_path, const std::vector<std::string>& targets);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -373,6 +498,42 @@ EXPORT bool startMTCDSPFactories();
 
 EXPORT void stopMTCDSPFactories();
 
+EXPORT bool setCDSPFactoryCacheDirectory(const char* directory, size_t max_size);
+
+EXPORT void setCDSPFactoriesMemoryBudget(size_t budget);
+
+EXPORT size_t getCDSPFactoriesMemorySize();
+
+EXPORT bool startAsyncCDSPFactories(int workers, int max_waiting);
+
+EXPORT void stopAsyncCDSPFactories();
+
+EXPORT int createAsyncCDSPFactoryFromFile(const char* filename,
+                                          int argc, const char* argv[],
+                                          const char* target,
+                                          llvmFactoryCallback callback, void* arg,
+                                          int opt_level, int priority);
+
+EXPORT int createAsyncCDSPFactoryFromString(const char* name_app, const char* dsp_content,
+                                            int argc, const char* argv[],
+                                            const char* target,
+                                            llvmFactoryCallback callback, void* arg,
+                                            int opt_level, int priority);
+
+EXPORT bool cancelAsyncCDSPFactory(int request);
+
+EXPORT llvm_dsp_factory* createInstrumentedCDSPFactoryFromFile(const char* filename,
+                                                               int argc, const char* argv[],
+                                                               const char* target,
+                                                               char* error_msg, int opt_level);
+
+EXPORT llvm_dsp_factory* createInstrumentedCDSPFactoryFromString(const char* name_app, const char* dsp_content,
+                                                                 int argc, const char* argv[],
+                                                                 const char* target,
+                                                                 char* error_msg, int opt_level);
+
+EXPORT llvm_dsp_factory* createProfiledCDSPFactory(llvm_dsp_factory* factory, char* error_msg);
+
 EXPORT llvm_dsp_factory* readCDSPFactoryFromBitcode(const char* bit_code, const char* target, int opt_level);
 
 EXPORT char* writeCDSPFactoryToBitcode(llvm_dsp_factory* factory);
@@ -396,6 +557,10 @@ EXPORT char* writeCDSPFactoryToMachine(llvm_dsp_factory* factory, const char* ta
 EXPORT llvm_dsp_factory* readCDSPFactoryFromMachineFile(const char* machine_code_path, const char* target);
 
 EXPORT void writeCDSPFactoryToMachineFile(llvm_dsp_factory* factory, const char* machine_code_path, const char* target);
+
+EXPORT char* writeCDSPFactoryToMachineBundle(llvm_dsp_factory* factory, const char** targets);
+
+EXPORT void writeCDSPFactoryToMachineBundleFile(llvm_dsp_factory* factory, const char* machine_code_path, const char** targets);
     
 EXPORT void metadataCDSPInstance(llvm_dsp* dsp, MetaGlue* meta);
 
@@ -0,0 +1,229 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "compatibility.hh"
+#include "llvm_dsp_cache.hh"
+#include "libfaust.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <utime.h>
+#endif
+
+#define CACHE_FILE_HEADER   "FAUST_LLVM_CACHE"
+#define CACHE_FILE_EXT      ".fmc"
+
+using namespace std;
+
+bool llvm_dsp_cache::setDirectory(const string& directory, size_t max_size)
+{
+    TLock lock(&fLock);
+    fDirectory = directory;
+    fMaxSize = max_size;
+
+    if (fDirectory == "") {
+        return true;
+    }
+
+    if (fDirectory[fDirectory.size() - 1] == DIRSEP) {
+        fDirectory = fDirectory.substr(0, fDirectory.size() - 1);
+    }
+
+    struct stat info;
+    if (stat(fDirectory.c_str(), &info) != 0 && faust_mkdir(fDirectory.c_str(), 0775) != 0) {
+        fDirectory = "";
+        return false;
+    }
+
+    evict(fDirectory, fMaxSize, "");
+    return true;
+}
+
+string llvm_dsp_cache::getKey(const string& sha_key, const string& target, int opt_level)
+{
+    stringstream key;
+    key << FAUSTVERSION << " " << sha_key << " " << target << " " << opt_level;
+    return generateSHA1(key.str());
+}
+
+string llvm_dsp_cache::getPath(const string& key)
+{
+    TLock lock(&fLock);
+    return fDirectory + DIRSEP + key + CACHE_FILE_EXT;
+}
+
+bool llvm_dsp_cache::read(const string& key, llvm_dsp_cache_entry& entry)
+{
+    string path = getPath(key);
+    ifstream in(path.c_str(), ifstream::in | ifstream::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    string header, version;
+    in >> header >> version;
+    if (header != CACHE_FILE_HEADER || version != FAUSTVERSION) {
+        return false;
+    }
+    in.get();
+
+    int pathnames, fields;
+    size_t size;
+    getline(in, entry.fName);
+    getline(in, entry.fClassName);
+    in >> entry.fIsDouble >> pathnames;
+    in.get();
+    for (int i = 0; i < pathnames && in.good(); i++) {
+        string pathname;
+        getline(in, pathname);
+        entry.fPathnameList.push_back(pathname);
+    }
+    in >> fields;
+    for (int i = 0; i < fields && in.good(); i++) {
+        string name;
+        llvm_field_desc field;
+        in >> name >> field.fOffset >> field.fSize >> field.fType;
+        entry.fFieldLayout[name] = field;
+    }
+    in >> size;
+    in.get();
+    if (!in.good()) {
+        return false;
+    }
+
+    entry.fMachineCode.resize(size);
+    in.read(&entry.fMachineCode[0], size);
+    if (size_t(in.gcount()) != size) {
+        return false;
+    }
+
+#ifndef _WIN32
+    // Most recently used
+    utime(path.c_str(), NULL);
+#endif
+    return true;
+}
+
+bool llvm_dsp_cache::write(const string& key, const llvm_dsp_cache_entry& entry)
+{
+    if (entry.fMachineCode == "") {
+        return false;
+    }
+
+    string directory;
+    size_t max_size;
+    {
+        TLock lock(&fLock);
+        directory = fDirectory;
+        max_size = fMaxSize;
+    }
+    if (directory == "") {
+        return false;
+    }
+    
+    string path = directory + DIRSEP + key + CACHE_FILE_EXT;
+    stringstream tmp_path;
+    tmp_path << path << "." << getpid() << ".tmp";
+
+    {
+        ofstream out(tmp_path.str().c_str(), ofstream::out | ofstream::binary);
+        if (!out.is_open()) {
+            return false;
+        }
+
+        out << CACHE_FILE_HEADER << " " << FAUSTVERSION << "\n";
+        out << entry.fName << "\n";
+        out << entry.fClassName << "\n";
+        out << entry.fIsDouble << " " << entry.fPathnameList.size() << "\n";
+        for (size_t i = 0; i < entry.fPathnameList.size(); i++) {
+            out << entry.fPathnameList[i] << "\n";
+        }
+        out << entry.fFieldLayout.size() << "\n";
+        for (map<string, llvm_field_desc>::const_iterator it = entry.fFieldLayout.begin(); it != entry.fFieldLayout.end(); it++) {
+            out << (*it).first << " " << (*it).second.fOffset << " " << (*it).second.fSize << " " << (*it).second.fType << "\n";
+        }
+        out << entry.fMachineCode.size() << "\n";
+        out.write(entry.fMachineCode.data(), entry.fMachineCode.size());
+
+        if (!out.good()) {
+            out.close();
+            remove(tmp_path.str().c_str());
+            return false;
+        }
+    }
+
+    // Readers either see the previous file or the complete new one
+    if (rename(tmp_path.str().c_str(), path.c_str()) != 0) {
+        remove(tmp_path.str().c_str());
+        return false;
+    }
+
+    evict(directory, max_size, path);
+    return true;
+}
+
+// Remove the least recently used files (except 'kept') until the cache fits in 'max_size'
+void llvm_dsp_cache::evict(const string& directory, size_t max_size, const string& kept)
+{
+#ifndef _WIN32
+    if (max_size == 0) {
+        return;
+    }
+
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return;
+    }
+
+    vector<pair<time_t, string> > files;
+    size_t total = 0;
+    struct dirent* file;
+
+    while ((file = readdir(dir)) != NULL) {
+        string name = file->d_name;
+        string ext = CACHE_FILE_EXT;
+        if (name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0) {
+            string path = directory + DIRSEP + name;
+            struct stat info;
+            if (stat(path.c_str(), &info) == 0) {
+                total += info.st_size;
+                files.push_back(make_pair(info.st_mtime, path));
+            }
+        }
+    }
+    closedir(dir);
+
+    sort(files.begin(), files.end());
+    for (size_t i = 0; i < files.size() && total > max_size; i++) {
+        struct stat info;
+        if (files[i].second != kept && stat(files[i].second.c_str(), &info) == 0 && remove(files[i].second.c_str()) == 0) {
+            total -= info.st_size;
+        }
+    }
+#endif
+}
@@ -0,0 +1,90 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef LLVM_DSP_CACHE_H
+#define LLVM_DSP_CACHE_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "llvm_dsp_aux.hh"
+
+/*
+ Persistent cache of LLVM factories : the machine code of the factories compiled from a DSP source is written
+ in a directory, one file per factory, and read back by the next createDSPFactoryFromString/File of the same DSP
+ (same SHA key, that is same expanded code and normalized compilation options) for the same target and optimization
+ level, possibly in another process. The LLVM pipeline is then skipped.
+
+ Files are written in a temporary file then renamed, so that several processes can share the same directory.
+ When the files exceed the maximum size, the least recently used ones (by modification time, updated on each read)
+ are removed.
+*/
+
+// What is needed to rebuild a factory from its machine code
+struct llvm_dsp_cache_entry {
+
+    std::string fName;
+    std::string fClassName;
+    bool fIsDouble;
+    std::vector<std::string> fPathnameList;
+    std::map<string, llvm_field_desc> fFieldLayout;
+    std::string fMachineCode;
+
+    llvm_dsp_cache_entry():fIsDouble(false)
+    {}
+
+};
+
+class llvm_dsp_cache {
+
+    private:
+
+        std::string fDirectory;     // Empty when the cache is not used
+        size_t fMaxSize;            // In bytes, 0 means no limit
+        TLockAble fLock;            // For the settings, files are written without gDSPFactoriesLock
+
+        std::string getPath(const std::string& key);
+        void evict(const std::string& directory, size_t max_size, const std::string& kept);
+
+    public:
+
+        llvm_dsp_cache():fMaxSize(0)
+        {}
+
+        bool setDirectory(const std::string& directory, size_t max_size);
+
+        bool isEnabled()
+        {
+            TLock lock(&fLock);
+            return fDirectory != "";
+        }
+
+        // Key of the machine code of a DSP, compiled for a given target (triple:CPU) and optimization level
+        std::string getKey(const std::string& sha_key, const std::string& target, int opt_level);
+
+        bool read(const std::string& key, llvm_dsp_cache_entry& entry);
+
+        bool write(const std::string& key, const llvm_dsp_cache_entry& entry);
+
+};
+
+#endif
@@ -0,0 +1,134 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#include <sstream>
+
+#include "llvm_dsp_profile.hh"
+
+#if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)) && !defined(_MSC_VER)
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/MDBuilder.h>
+
+using namespace llvm;
+using namespace std;
+
+// Conditional branches and scalar selects, in module order
+static void getSites(Module* module, vector<Instruction*>& sites)
+{
+    for (Module::iterator F = module->begin(); F != module->end(); F++) {
+        for (Function::iterator B = F->begin(); B != F->end(); B++) {
+            for (BasicBlock::iterator I = B->begin(); I != B->end(); I++) {
+                BranchInst* branch = dyn_cast<BranchInst>(&*I);
+                SelectInst* select = dyn_cast<SelectInst>(&*I);
+                if ((branch && branch->isConditional())
+                    || (select && select->getCondition()->getType()->isIntegerTy(1))) {
+                    sites.push_back(&*I);
+                }
+            }
+        }
+    }
+}
+
+static Value* getCondition(Instruction* site)
+{
+    BranchInst* branch = dyn_cast<BranchInst>(site);
+    return (branch) ? branch->getCondition() : cast<SelectInst>(site)->getCondition();
+}
+
+int instrumentDSPModule(Module* module)
+{
+    vector<Instruction*> sites;
+    getSites(module, sites);
+    if (sites.size() == 0) {
+        return 0;
+    }
+
+    LLVMContext& context = module->getContext();
+    ArrayType* counters_type = ArrayType::get(Type::getInt64Ty(context), 2 * sites.size());
+    GlobalVariable* counters = new GlobalVariable(*module, counters_type, false, GlobalValue::ExternalLinkage,
+                                                  ConstantAggregateZero::get(counters_type), PROFILE_COUNTERS);
+
+    IRBuilder<> builder(context);
+    for (size_t i = 0; i < sites.size(); i++) {
+        // counters[2*i] when true, counters[2*i+1] when false
+        builder.SetInsertPoint(sites[i]);
+        Value* idx[2];
+        idx[0] = builder.getInt32(0);
+        idx[1] = builder.CreateSelect(getCondition(sites[i]), builder.getInt32(2 * i), builder.getInt32(2 * i + 1));
+        Value* counter = builder.CreateInBoundsGEP(counters_type, counters, idx);
+        builder.CreateStore(builder.CreateAdd(builder.CreateLoad(builder.getInt64Ty(), counter), builder.getInt64(1)), counter);
+    }
+
+    return int(sites.size());
+}
+
+bool annotateDSPModule(Module* module, const vector<uint64_t>& profile)
+{
+    vector<Instruction*> sites;
+    getSites(module, sites);
+    if (profile.size() != 2 * sites.size()) {
+        return false;
+    }
+
+    // Weights are 32 bits values
+    uint64_t max_count = 0;
+    for (size_t i = 0; i < profile.size(); i++) {
+        max_count = std::max(max_count, profile[i]);
+    }
+    uint64_t scale = max_count / UINT32_MAX + 1;
+
+    MDBuilder md_builder(module->getContext());
+    for (size_t i = 0; i < sites.size(); i++) {
+        // Never taken paths keep a minimal weight
+        uint32_t true_weight = uint32_t(profile[2 * i] / scale) + 1;
+        uint32_t false_weight = uint32_t(profile[2 * i + 1] / scale) + 1;
+        sites[i]->setMetadata(LLVMContext::MD_prof, md_builder.createBranchWeights(true_weight, false_weight));
+    }
+
+    return true;
+}
+
+#else
+
+int instrumentDSPModule(llvm::Module* module)
+{
+    return 0;
+}
+
+bool annotateDSPModule(llvm::Module* module, const std::vector<uint64_t>& profile)
+{
+    return false;
+}
+
+#endif
+
+std::string writeDSPProfile(const std::vector<uint64_t>& profile)
+{
+    std::stringstream res;
+    for (size_t i = 0; i < profile.size(); i++) {
+        res << profile[i] << " ";
+    }
+    return res.str();
+}
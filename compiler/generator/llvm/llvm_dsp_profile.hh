@@ -0,0 +1,57 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef LLVM_DSP_PROFILE_H
+#define LLVM_DSP_PROFILE_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace llvm {
+    class Module;
+}
+
+/*
+ Profile guided compilation of LLVM factories.
+
+ The 'sites' of a module are its conditional branches (if, loops) and scalar selects (select2), taken in
+ functions, blocks and instructions order on the module generated by the Faust compiler, before any optimization.
+ Since the same DSP compiled with the same options gives the same module, a site has the same number in the
+ instrumented module and in the module to be optimized with the profile.
+
+ - an instrumented module counts how many times each site was true and false, in a global array
+ - the profile (2 counters per site) is then set as 'branch_weights' metadata on the sites of a new module,
+   which the LLVM optimizations use (block frequencies, block placement, select lowering...)
+*/
+
+#define PROFILE_COUNTERS "fProfileCounters"
+
+// Returns the number of instrumented sites
+int instrumentDSPModule(llvm::Module* module);
+
+// Returns false if the profile does not match the module
+bool annotateDSPModule(llvm::Module* module, const std::vector<uint64_t>& profile);
+
+std::string writeDSPProfile(const std::vector<uint64_t>& profile);
+
+#endif
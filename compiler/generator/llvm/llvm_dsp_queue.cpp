@@ -0,0 +1,170 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#include "llvm_dsp_queue.hh"
+#include "exception.hh"
+
+using namespace std;
+
+llvm_dsp_queue::llvm_dsp_queue(int workers, int max_waiting)
+    :fMaxWaiting(max_waiting), fNextID(1), fStop(false)
+{
+    pthread_mutex_init(&fMutex, NULL);
+    pthread_cond_init(&fCond, NULL);
+    for (int i = 0; i < workers; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker, this) == 0) {
+            fWorkers.push_back(thread);
+        }
+    }
+}
+
+llvm_dsp_queue::~llvm_dsp_queue()
+{
+    pthread_mutex_lock(&fMutex);
+    fStop = true;
+    for (list<llvm_dsp_request*>::iterator it = fWaiting.begin(); it != fWaiting.end(); it++) {
+        delete *it;
+    }
+    fWaiting.clear();
+    pthread_cond_broadcast(&fCond);
+    pthread_mutex_unlock(&fMutex);
+    
+    for (size_t i = 0; i < fWorkers.size(); i++) {
+        pthread_join(fWorkers[i], NULL);
+    }
+    pthread_cond_destroy(&fCond);
+    pthread_mutex_destroy(&fMutex);
+}
+
+bool llvm_dsp_queue::isWorker()
+{
+    // fWorkers is not changed after the constructor
+    for (size_t i = 0; i < fWorkers.size(); i++) {
+        if (pthread_equal(fWorkers[i], pthread_self())) return true;
+    }
+    return false;
+}
+
+int llvm_dsp_queue::push(llvm_dsp_request* request)
+{
+    pthread_mutex_lock(&fMutex);
+    if (fStop || fWorkers.empty() || fWaiting.size() >= fMaxWaiting) {
+        pthread_mutex_unlock(&fMutex);
+        return -1;
+    }
+    
+    request->fID = fNextID++;
+    request->fState = llvm_dsp_request::kWaiting;
+    
+    // After the requests of the same or higher priority
+    list<llvm_dsp_request*>::iterator it = fWaiting.begin();
+    while (it != fWaiting.end() && (*it)->fPriority >= request->fPriority) {
+        it++;
+    }
+    fWaiting.insert(it, request);
+    int id = request->fID;
+    
+    pthread_cond_signal(&fCond);
+    pthread_mutex_unlock(&fMutex);
+    return id;
+}
+
+bool llvm_dsp_queue::cancel(int id)
+{
+    bool res = false;
+    pthread_mutex_lock(&fMutex);
+    
+    for (list<llvm_dsp_request*>::iterator it = fWaiting.begin(); it != fWaiting.end(); it++) {
+        if ((*it)->fID == id) {
+            delete *it;
+            fWaiting.erase(it);
+            res = true;
+            break;
+        }
+    }
+    
+    if (!res) {
+        map<int, llvm_dsp_request*>::iterator it = fRunning.find(id);
+        if (it != fRunning.end()) {
+            (*it).second->fState = llvm_dsp_request::kCancelled;
+            res = true;
+        }
+    }
+    
+    // Otherwise unknown, or callback already called
+    pthread_mutex_unlock(&fMutex);
+    return res;
+}
+
+void* llvm_dsp_queue::worker(void* arg)
+{
+    llvm_dsp_queue* queue = static_cast<llvm_dsp_queue*>(arg);
+    
+    while (true) {
+        pthread_mutex_lock(&queue->fMutex);
+        while (queue->fWaiting.empty() && !queue->fStop) {
+            pthread_cond_wait(&queue->fCond, &queue->fMutex);
+        }
+        if (queue->fStop) {
+            pthread_mutex_unlock(&queue->fMutex);
+            return NULL;
+        }
+        llvm_dsp_request* request = queue->fWaiting.front();
+        queue->fWaiting.pop_front();
+        request->fState = llvm_dsp_request::kRunning;
+        queue->fRunning[request->fID] = request;
+        pthread_mutex_unlock(&queue->fMutex);
+        
+        queue->compile(request);
+        delete request;
+    }
+}
+
+void llvm_dsp_queue::compile(llvm_dsp_request* request)
+{
+    vector<const char*> argv;
+    for (size_t i = 0; i < request->fArgv.size(); i++) {
+        argv.push_back(request->fArgv[i].c_str());
+    }
+    argv.push_back(0);  // NULL terminated argv
+
+    string error_msg;
+    llvm_dsp_factory* factory = nullptr;
+    try {
+        factory = createDSPFactoryFromStringConcurrent(request->fNameApp, request->fDSPContent,
+                                                       int(request->fArgv.size()), &argv[0],
+                                                       request->fTarget, error_msg, request->fOptLevel);
+    } catch (faustexception& e) {
+        error_msg = e.Message();
+    }
+
+    pthread_mutex_lock(&fMutex);
+    bool cancelled = (request->fState == llvm_dsp_request::kCancelled);
+    fRunning.erase(request->fID);
+    pthread_mutex_unlock(&fMutex);
+
+    if (cancelled) {
+        if (factory) deleteDSPFactory(factory);
+    } else {
+        request->fCallback(factory, error_msg.c_str(), request->fArg);
+    }
+}
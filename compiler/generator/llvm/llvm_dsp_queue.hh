@@ -0,0 +1,96 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef LLVM_DSP_QUEUE_H
+#define LLVM_DSP_QUEUE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <pthread.h>
+
+#include "llvm_dsp_aux.hh"
+
+/*
+ Asynchronous factory compilation : requests are queued by priority (then in arrival order) and compiled by a
+ bounded pool of worker threads, the result being given to a callback on the worker thread.
+
+ A request can be cancelled until its callback is called : a waiting request is simply removed, the result of
+ a running one is released when its compilation ends.
+*/
+
+struct llvm_dsp_request {
+
+    enum { kWaiting, kRunning, kCancelled };
+
+    int fID;
+    int fPriority;
+    int fState;
+
+    std::string fNameApp;
+    std::string fDSPContent;
+    std::vector<std::string> fArgv;
+    std::string fTarget;
+    int fOptLevel;
+
+    llvmFactoryCallback fCallback;
+    void* fArg;
+
+};
+
+class llvm_dsp_queue {
+
+    private:
+
+        std::vector<pthread_t> fWorkers;
+        pthread_mutex_t fMutex;
+        pthread_cond_t fCond;
+
+        std::list<llvm_dsp_request*> fWaiting;      // By decreasing priority
+        std::map<int, llvm_dsp_request*> fRunning;
+
+        size_t fMaxWaiting;
+        int fNextID;
+        bool fStop;
+
+        static void* worker(void* arg);
+        void compile(llvm_dsp_request* request);
+
+    public:
+
+        llvm_dsp_queue(int workers, int max_waiting);
+
+        // Waiting requests are cancelled, running ones are finished (not to be called by a worker)
+        virtual ~llvm_dsp_queue();
+
+        // Return true if the calling thread is one of the workers (that is inside a callback)
+        bool isWorker();
+
+        // Return the request ID, or -1 if the queue is full
+        int push(llvm_dsp_request* request);
+
+        // Return true if the callback of the request will not be called
+        bool cancel(int id);
+
+};
+
+#endif
@@ -41,7 +41,7 @@ using namespace std;
 #include <llvm/Support/Host.h>
 #include <llvm/Support/TargetSelect.h>
 
-#if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #include <llvm/IR/IRBuilder.h>
     #include <llvm/IR/DataLayout.h>
     #include <llvm/IR/DerivedTypes.h>
@@ -57,25 +57,25 @@ using namespace std;
     #include <llvm/Module.h>
 #endif
 
-#if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #include <llvm/IR/Verifier.h>
 #else
     #include <llvm/Analysis/Verifier.h>
 #endif
 
-#if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #include <llvm/ExecutionEngine/MCJIT.h>
 #else
     #include <llvm/ExecutionEngine/JIT.h>
 #endif
 
-#if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #include <llvm/IR/PassManager.h>
 #else
     #include <llvm/PassManager.h>
 #endif
 
-#if defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #include <llvm/Bitcode/BitcodeWriter.h>
     #include <llvm/Bitcode/BitcodeReader.h>
 #else
@@ -90,7 +90,7 @@ using namespace std;
     #define LLVM_FREE   "free"
 #endif
 
-#if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+#if defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
     #define GET_ITERATOR(it) &(*(it))
 #else
     #define GET_ITERATOR(it) it
@@ -102,11 +102,68 @@ using namespace std;
 #define MAKE_VECTOR_OF_TYPES(vec) makeArrayRef(vec)
 #define MAKE_IXD(beg, end) llvm::ArrayRef<llvm::Value*>(beg, end)
 #define MAKE_ARGS(args) llvm::ArrayRef<llvm::Value*>(args)
-#define CREATE_CALL(fun, args) fBuilder->CreateCall(fun, MAKE_VECTOR_OF_TYPES(args))
 #define CREATE_CALL1(fun, args, str, block) CallInst::Create(fun, MAKE_VECTOR_OF_TYPES(args), str, block)
 #define CREATE_PHI(type, name) fBuilder->CreatePHI(type, 0, name);
 #define VECTOR_ALIGN 0
 
+#if defined(LLVM_140)
+
+// Pointers are still typed : the type of a load, a GEP or a call is the pointed type
+inline llvm::Type* getPointedType(llvm::Value* ptr)
+{
+    return ptr->getType()->getPointerElementType();
+}
+
+inline llvm::LoadInst* createLoad(llvm::IRBuilder<>* builder, llvm::Value* ptr, bool is_volatile = false)
+{
+    return builder->CreateLoad(getPointedType(ptr), ptr, is_volatile);
+}
+
+inline llvm::Value* createGEP(llvm::IRBuilder<>* builder, llvm::Value* ptr, llvm::ArrayRef<llvm::Value*> idx)
+{
+    return builder->CreateGEP(getPointedType(ptr), ptr, idx);
+}
+
+inline llvm::Value* createInBoundsGEP(llvm::IRBuilder<>* builder, llvm::Value* ptr, llvm::ArrayRef<llvm::Value*> idx)
+{
+    return builder->CreateInBoundsGEP(getPointedType(ptr), ptr, idx);
+}
+
+inline llvm::Value* createStructGEP(llvm::IRBuilder<>* builder, llvm::Value* ptr, unsigned int index)
+{
+    return builder->CreateStructGEP(getPointedType(ptr), ptr, index);
+}
+
+inline llvm::CallInst* createCall(llvm::IRBuilder<>* builder, llvm::Value* fun, llvm::ArrayRef<llvm::Value*> args)
+{
+    return builder->CreateCall(llvm::cast<llvm::FunctionType>(getPointedType(fun)), fun, args);
+}
+
+    #define CREATE_CALL(fun, args) createCall(fBuilder, fun, MAKE_VECTOR_OF_TYPES(args))
+    #define CREATE_LOAD(ptr) createLoad(fBuilder, ptr)
+    #define CREATE_VOLATILE_LOAD(ptr, is_volatile) createLoad(fBuilder, ptr, is_volatile)
+    #define CREATE_GEP(ptr, idx) createGEP(fBuilder, ptr, idx)
+    #define CREATE_IN_BOUNDS_GEP(ptr, idx) createInBoundsGEP(fBuilder, ptr, idx)
+    #define CREATE_STRUCT_GEP(ptr, index) createStructGEP(fBuilder, ptr, index)
+    #define NEW_LOAD_INST(ptr) new LoadInst(getPointedType(ptr), ptr, "", false, Align(1), (Instruction*)0)
+    #define VECTOR_TYPE(type, size) FixedVectorType::get(type, size)
+    #define GET_TYPE_BY_NAME(module, name) StructType::getTypeByName((module)->getContext(), name)
+    #define FUN_ALIGN(align) MaybeAlign(align)
+    #define INST_ALIGN(align) Align(align)
+#else
+    #define CREATE_CALL(fun, args) fBuilder->CreateCall(fun, MAKE_VECTOR_OF_TYPES(args))
+    #define CREATE_LOAD(ptr) fBuilder->CreateLoad(ptr)
+    #define CREATE_VOLATILE_LOAD(ptr, is_volatile) fBuilder->CreateLoad(ptr, is_volatile)
+    #define CREATE_GEP(ptr, idx) fBuilder->CreateGEP(ptr, idx)
+    #define CREATE_IN_BOUNDS_GEP(ptr, idx) fBuilder->CreateInBoundsGEP(ptr, idx)
+    #define CREATE_STRUCT_GEP(ptr, index) fBuilder->CreateStructGEP(0, ptr, index)
+    #define NEW_LOAD_INST(ptr) new LoadInst(ptr)
+    #define VECTOR_TYPE(type, size) VectorType::get(type, size)
+    #define GET_TYPE_BY_NAME(module, name) (module)->getTypeByName(name)
+    #define FUN_ALIGN(align) align
+    #define INST_ALIGN(align) align
+#endif
+
 using namespace llvm;
 
 typedef llvm::Value* LlvmValue;
@@ -125,22 +182,22 @@ struct LLVMTypeHelper {
         // LLVM type coding
         fTypeMap[Typed::kFloat] = llvm::Type::getFloatTy(module->getContext());
         fTypeMap[Typed::kFloat_ptr] = PointerType::get(fTypeMap[Typed::kFloat], 0);
-        fTypeMap[Typed::kFloat_vec] = VectorType::get(fTypeMap[Typed::kFloat], gGlobal->gVecSize);
+        fTypeMap[Typed::kFloat_vec] = VECTOR_TYPE(fTypeMap[Typed::kFloat], gGlobal->gVecSize);
         fTypeMap[Typed::kFloat_vec_ptr] = PointerType::get(fTypeMap[Typed::kFloat_vec], 0);
 
         fTypeMap[Typed::kInt32] = llvm::Type::getInt32Ty(module->getContext());
         fTypeMap[Typed::kInt32_ptr] = PointerType::get(fTypeMap[Typed::kInt32], 0);
-        fTypeMap[Typed::kInt32_vec] = VectorType::get(fTypeMap[Typed::kInt32], gGlobal->gVecSize);
+        fTypeMap[Typed::kInt32_vec] = VECTOR_TYPE(fTypeMap[Typed::kInt32], gGlobal->gVecSize);
         fTypeMap[Typed::kInt32_vec_ptr] = PointerType::get(fTypeMap[Typed::kInt32_vec], 0);
 
         fTypeMap[Typed::kDouble] = llvm::Type::getDoubleTy(module->getContext());
         fTypeMap[Typed::kDouble_ptr] = PointerType::get(fTypeMap[Typed::kDouble], 0);
-        fTypeMap[Typed::kDouble_vec] = VectorType::get(fTypeMap[Typed::kDouble], gGlobal->gVecSize);
+        fTypeMap[Typed::kDouble_vec] = VECTOR_TYPE(fTypeMap[Typed::kDouble], gGlobal->gVecSize);
         fTypeMap[Typed::kDouble_vec_ptr] = PointerType::get(fTypeMap[Typed::kDouble_vec], 0);
 
         fTypeMap[Typed::kBool] = llvm::Type::getInt1Ty(module->getContext());
         fTypeMap[Typed::kBool_ptr] = PointerType::get(fTypeMap[Typed::kBool], 0);
-        fTypeMap[Typed::kBool_vec] = VectorType::get(fTypeMap[Typed::kBool], gGlobal->gVecSize);
+        fTypeMap[Typed::kBool_vec] = VECTOR_TYPE(fTypeMap[Typed::kBool], gGlobal->gVecSize);
         fTypeMap[Typed::kBool_vec_ptr] = PointerType::get(fTypeMap[Typed::kBool_vec], 0);
 
         // Takes the type of internal real
@@ -160,7 +217,7 @@ struct LLVMTypeHelper {
     virtual LlvmValue genInt1(Module* module, int number, int size = 1)
     {
         if (size > 1) {
-            return ConstantInt::get(VectorType::get(llvm::Type::getInt1Ty(module->getContext()), size), number);
+            return ConstantInt::get(VECTOR_TYPE(llvm::Type::getInt1Ty(module->getContext()), size), number);
         } else {
             return ConstantInt::get(llvm::Type::getInt1Ty(module->getContext()), number);
         }
@@ -169,7 +226,7 @@ struct LLVMTypeHelper {
     virtual LlvmValue genInt32(Module* module, int number, int size = 1)
     {
         if (size > 1) {
-            return ConstantInt::get(VectorType::get(llvm::Type::getInt32Ty(module->getContext()), size), number);
+            return ConstantInt::get(VECTOR_TYPE(llvm::Type::getInt32Ty(module->getContext()), size), number);
         } else {
             return ConstantInt::get(llvm::Type::getInt32Ty(module->getContext()), number);
         }
@@ -178,7 +235,7 @@ struct LLVMTypeHelper {
     virtual LlvmValue genInt64(Module* module, long long number, int size = 1)
     {
         if (size > 1) {
-            return ConstantInt::get(VectorType::get(llvm::Type::getInt64Ty(module->getContext()), size), number);
+            return ConstantInt::get(VECTOR_TYPE(llvm::Type::getInt64Ty(module->getContext()), size), number);
         } else {
             return ConstantInt::get(llvm::Type::getInt64Ty(module->getContext()), number);
         }
@@ -187,7 +244,7 @@ struct LLVMTypeHelper {
     virtual LlvmValue genFloat(Module* module, float number, int size = 1)
     {
         if (size > 1) {
-            return ConstantFP::get(VectorType::get(llvm::Type::getFloatTy(module->getContext()), size), number);
+            return ConstantFP::get(VECTOR_TYPE(llvm::Type::getFloatTy(module->getContext()), size), number);
         } else {
             return ConstantFP::get(module->getContext(), APFloat(number));
         }
@@ -196,7 +253,7 @@ struct LLVMTypeHelper {
     virtual LlvmValue genDouble(Module* module, double number, int size = 1)
     {
         if (size > 1) {
-            return ConstantFP::get(VectorType::get(llvm::Type::getDoubleTy(module->getContext()), size), number);
+            return ConstantFP::get(VECTOR_TYPE(llvm::Type::getDoubleTy(module->getContext()), size), number);
         } else {
             return ConstantFP::get(module->getContext(), APFloat(number));
         }
@@ -205,7 +262,7 @@ struct LLVMTypeHelper {
     virtual LLVM_TYPE getFloatTy(Module* module, int size)
     {
         if (size > 1) {
-            return VectorType::get(llvm::Type::getFloatTy(module->getContext()), size);
+            return VECTOR_TYPE(llvm::Type::getFloatTy(module->getContext()), size);
         } else {
             return llvm::Type::getFloatTy(module->getContext());
         }
@@ -214,7 +271,7 @@ struct LLVMTypeHelper {
     virtual LLVM_TYPE getInt32Ty(Module* module, int size)
     {
         if (size > 1) {
-            return VectorType::get(llvm::Type::getInt32Ty(module->getContext()), size);
+            return VECTOR_TYPE(llvm::Type::getInt32Ty(module->getContext()), size);
         } else {
             return llvm::Type::getInt32Ty(module->getContext());
         }
@@ -223,7 +280,7 @@ struct LLVMTypeHelper {
     virtual LLVM_TYPE getInt64Ty(Module* module, int size)
     {
         if (size > 1) {
-            return VectorType::get(llvm::Type::getInt64Ty(module->getContext()), size);
+            return VECTOR_TYPE(llvm::Type::getInt64Ty(module->getContext()), size);
         } else {
             return llvm::Type::getInt64Ty(module->getContext());
         }
@@ -232,7 +289,7 @@ struct LLVMTypeHelper {
     virtual LLVM_TYPE getInt1Ty(Module* module, int size)
     {
         if (size > 1) {
-            return VectorType::get(llvm::Type::getInt1Ty(module->getContext()), size);
+            return VECTOR_TYPE(llvm::Type::getInt1Ty(module->getContext()), size);
         } else {
             return llvm::Type::getInt1Ty(module->getContext());
         }
@@ -241,7 +298,7 @@ struct LLVMTypeHelper {
     virtual LLVM_TYPE getDoubleTy(Module* module, int size)
     {
         if (size > 1) {
-            return VectorType::get(llvm::Type::getDoubleTy(module->getContext()), size);
+            return VECTOR_TYPE(llvm::Type::getDoubleTy(module->getContext()), size);
         } else {
             return llvm::Type::getDoubleTy(module->getContext());
         }
@@ -258,7 +315,7 @@ struct LLVMTypeHelper {
             return fTypeMap[basic_typed->fType];
         } else if (named_typed) {
             // Used for internal structures (RWTable... etc...)
-            LLVM_TYPE type = module->getTypeByName("struct.dsp" + named_typed->fName);
+            LLVM_TYPE type = GET_TYPE_BY_NAME(module, "struct.dsp" + named_typed->fName);
             faustassert(type);
             return PointerType::get(type, 0);
         } else if (array_typed) {
@@ -269,7 +326,7 @@ struct LLVMTypeHelper {
                 return ArrayType::get(fTypeMap[Typed::getTypeFromPtr(array_typed->getType())], array_typed->fSize);
             }
         } else if (vector_typed) {
-            return VectorType::get(fTypeMap[vector_typed->fType->fType], vector_typed->fSize);
+            return VECTOR_TYPE(fTypeMap[vector_typed->fType->fType], vector_typed->fSize);
         }
         
         faustassert(false);
@@ -291,7 +348,7 @@ class LLVMTypeInstVisitor : public DispatchVisitor, public LLVMTypeHelper {
         VECTOR_OF_TYPES fDSPFields;
         int fDSPFieldsCounter;
         string fPrefix;
-    #if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+    #if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
         DataLayout* fDataLayout;
     #endif
 
@@ -377,7 +434,7 @@ class LLVMTypeInstVisitor : public DispatchVisitor, public LLVMTypeHelper {
                 if (!fModule->getFunction("allocate" + fPrefix)) {
                     func_allocate = Function::Create(allocate_type, Function::ExternalLinkage, "allocate" + fPrefix, fModule);
                     func_allocate->setCallingConv(CallingConv::C);
-                    func_allocate->setAlignment(2);
+                    func_allocate->setAlignment(FUN_ALIGN(2));
                     Function::arg_iterator llvm_allocate_args_it = func_allocate->arg_begin();
                     Value* dsp = GET_ITERATOR(llvm_allocate_args_it++);
                     dsp->setName("dsp");
@@ -396,7 +453,7 @@ class LLVMTypeInstVisitor : public DispatchVisitor, public LLVMTypeHelper {
             // llvm_create_dsp block
             BasicBlock* entry_func_llvm_create_dsp = BasicBlock::Create(fModule->getContext(), "entry", func_llvm_create_dsp);
 
-        #if defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+        #if defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
             llvm::CallInst* call_inst1 = CallInst::Create(func_malloc, genInt64(fModule, fDataLayout->getTypeSizeInBits(dsp_type)), "", entry_func_llvm_create_dsp);
         #else
             // Dynamically computed object size (see http://nondot.org/sabre/LLVMNotes/SizeOf-OffsetOf-VariableSizedStructs.txt)
@@ -580,7 +637,7 @@ class LLVMTypeInstVisitor : public DispatchVisitor, public LLVMTypeHelper {
 
             Function* llvm_buildUserInterface = Function::Create(llvm_buildUserInterface_type, GlobalValue::ExternalLinkage, "buildUserInterface" + fPrefix, fModule);
             llvm_buildUserInterface->setCallingConv(CallingConv::C);
-            llvm_buildUserInterface->setAlignment(2);
+            llvm_buildUserInterface->setAlignment(FUN_ALIGN(2));
 
             // Name arguments
             Function::arg_iterator func_llvm_buildUserInterface_args_it = llvm_buildUserInterface->arg_begin();
@@ -597,8 +654,8 @@ class LLVMTypeInstVisitor : public DispatchVisitor, public LLVMTypeHelper {
             Value* idx[2];
             idx[0] = genInt64(fModule, 0);
             idx[1] = genInt32(fModule, 0);
-            Value* ui_ptr = fBuilder->CreateInBoundsGEP(interface1, MAKE_IXD(idx, idx+2));
-            fUIInterface_ptr = fBuilder->CreateLoad(ui_ptr);
+            Value* ui_ptr = CREATE_IN_BOUNDS_GEP(interface1, MAKE_IXD(idx, idx+2));
+            fUIInterface_ptr = CREATE_LOAD(ui_ptr);
        }
 
     public:
@@ -614,7 +671,7 @@ class LLVMTypeInstVisitor : public DispatchVisitor, public LLVMTypeHelper {
             initTypes(module);
         #if defined(LLVM_35) || defined(LLVM_36)
             fDataLayout = new DataLayout(*module->getDataLayout());
-        #elif defined(LLVM_34)  || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+        #elif defined(LLVM_34)  || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
             fDataLayout = new DataLayout(module->getDataLayout());
         #endif
         }
@@ -623,7 +680,7 @@ class LLVMTypeInstVisitor : public DispatchVisitor, public LLVMTypeHelper {
         {
             // External object not covered by Garbageable, so delete it here
             delete fBuilder;
-        #if defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+        #if defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
             delete fDataLayout;
         #endif
         }
@@ -727,6 +784,18 @@ class LLVMTypeInstVisitor : public DispatchVisitor, public LLVMTypeHelper {
         {
             return fDSPFieldsNames;
         }
+    
+        // Byte offset of a field in the DSP structure created by getDSPType
+        int getFieldOffset(llvm::PointerType* dsp_type_ptr, int index)
+        {
+            llvm::StructType* dsp_type = static_cast<llvm::StructType*>(dsp_type_ptr->getElementType());
+            return int(fDataLayout->getStructLayout(dsp_type)->getElementOffset(index));
+        }
+    
+        LLVM_TYPE getFieldType(int index)
+        {
+            return fDSPFields[index];
+        }
 };
 
 // Special version for DSP code (add call to "destroy" function)
@@ -747,7 +816,7 @@ class LLVMTypeInstVisitor1 : public LLVMTypeInstVisitor {
             if (!fModule->getFunction(LLVM_FREE)) {
                 func_free = Function::Create(free_type, GlobalValue::ExternalLinkage, LLVM_FREE, fModule);
                 func_free->setCallingConv(CallingConv::C);
-                func_free->setAlignment(2);
+                func_free->setAlignment(FUN_ALIGN(2));
             } else {
                 func_free = fModule->getFunction(LLVM_FREE);
             }
@@ -760,7 +829,7 @@ class LLVMTypeInstVisitor1 : public LLVMTypeInstVisitor {
             if (!fModule->getFunction("destroy" + fPrefix)) {
                 func_destroy = Function::Create(destroy_type, Function::ExternalLinkage, "destroy" + fPrefix, fModule);
                 func_destroy->setCallingConv(CallingConv::C);
-                func_destroy->setAlignment(2);
+                func_destroy->setAlignment(FUN_ALIGN(2));
                 Function::arg_iterator llvm_destroy_args_it = func_destroy->arg_begin();
                 Value* dsp = GET_ITERATOR(llvm_destroy_args_it++);
                 dsp->setName("dsp");
@@ -826,7 +895,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
 
         map <string, GlobalVariable*> fGlobalStringTable;
   
-        static list <string> gMathLibTable;
+        static thread_local list <string> gMathLibTable;
 
     public:
 
@@ -968,14 +1037,14 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
         Value* loadArrayAsPointer(Value* variable, bool isvolatile = false)
         {
             Value* load_ptr;
-            LoadInst* tmp_load = new LoadInst(variable);
+            LoadInst* tmp_load = NEW_LOAD_INST(variable);
             if (isa<ArrayType>(tmp_load->getType())) {
                 Value* idx[2];
                 idx[0] = genInt64(fModule, 0);
                 idx[1] = genInt64(fModule, 0);
-                load_ptr = fBuilder->CreateInBoundsGEP(variable, MAKE_IXD(idx, idx+2));
+                load_ptr = CREATE_IN_BOUNDS_GEP(variable, MAKE_IXD(idx, idx+2));
             } else {
-                load_ptr = fBuilder->CreateLoad(variable, isvolatile);
+                load_ptr = CREATE_VOLATILE_LOAD(variable, isvolatile);
             }
             delete tmp_load;
             return load_ptr;
@@ -992,8 +1061,8 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             Value* idx[2];
             idx[0] = genInt64(fModule, 0);
             idx[1] = fUICallTable["declare"];
-            Value* mth_ptr = fBuilder->CreateInBoundsGEP(ui, MAKE_IXD(idx, idx+2));
-            LoadInst* mth = fBuilder->CreateLoad(mth_ptr);
+            Value* mth_ptr = CREATE_IN_BOUNDS_GEP(ui, MAKE_IXD(idx, idx+2));
+            LoadInst* mth = CREATE_LOAD(mth_ptr);
 
             // Get LLVM constant string
             llvm::Type* type_def1 = 0;
@@ -1001,7 +1070,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             GlobalVariable* llvm_key = addStringConstant(inst->fKey, type_def1);
             GlobalVariable* llvm_value = addStringConstant(inst->fValue, type_def2);
 
-         #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+         #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
             Value* const_string1 = fBuilder->CreateConstGEP2_32(type_def1, llvm_key, 0, 0);
             Value* const_string2 = fBuilder->CreateConstGEP2_32(type_def2, llvm_value, 0, 0);
          #else
@@ -1015,8 +1084,8 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
                 zone_ptr = Constant::getNullValue((itfloat() == Typed::kFloat) ? fTypeMap[Typed::kFloat_ptr] : fTypeMap[Typed::kDouble_ptr]);
             } else {
                 int field_index = fDSPFieldsNames[inst->fZone];
-            #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
-                zone_ptr = fBuilder->CreateStructGEP(0, dsp, field_index);
+            #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
+                zone_ptr = CREATE_STRUCT_GEP(dsp, field_index);
             #else
                 zone_ptr = fBuilder->CreateStructGEP(dsp, field_index);
             #endif
@@ -1028,7 +1097,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             idx2[2] = const_string1;
             idx2[3] = const_string2;
 
-            CallInst* call_inst = fBuilder->CreateCall(mth, MAKE_IXD(idx2, idx2+4));
+            CallInst* call_inst = CREATE_CALL(mth, MAKE_IXD(idx2, idx2+4));
             call_inst->setCallingConv(CallingConv::C);
         }
 
@@ -1043,7 +1112,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             string name = replaceSpacesWithUnderscore(inst->fName);
             llvm::Type* type_def = 0;
             GlobalVariable* llvm_name = addStringConstant(inst->fName, type_def);
-       #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+       #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
             Value* const_string = fBuilder->CreateConstGEP2_32(type_def, llvm_name, 0, 0);
        #else
             Value* const_string = fBuilder->CreateConstGEP2_32(llvm_name, 0, 0);
@@ -1063,11 +1132,11 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             Value* idx[2];
             idx[0] = genInt64(fModule, 0);
             idx[1] = mth_index;
-            Value* mth_ptr = fBuilder->CreateInBoundsGEP(ui, MAKE_IXD(idx, idx+2));
-            LoadInst* mth = fBuilder->CreateLoad(mth_ptr);
-        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+            Value* mth_ptr = CREATE_IN_BOUNDS_GEP(ui, MAKE_IXD(idx, idx+2));
+            LoadInst* mth = CREATE_LOAD(mth_ptr);
+        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
             Value* fun_args[] = { fUIInterface_ptr, const_string };
-            CallInst* call_inst = fBuilder->CreateCall(mth, fun_args);
+            CallInst* call_inst = CREATE_CALL(mth, fun_args);
         #else
             CallInst* call_inst = fBuilder->CreateCall2(mth, fUIInterface_ptr, const_string);
         #endif
@@ -1084,10 +1153,10 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             Value* idx[2];
             idx[0] = genInt64(fModule, 0);
             idx[1] = fUICallTable["closeBox"];
-            Value* mth_ptr = fBuilder->CreateInBoundsGEP(ui, MAKE_IXD(idx, idx+2));
-            LoadInst* mth = fBuilder->CreateLoad(mth_ptr);
+            Value* mth_ptr = CREATE_IN_BOUNDS_GEP(ui, MAKE_IXD(idx, idx+2));
+            LoadInst* mth = CREATE_LOAD(mth_ptr);
 
-            CallInst* call_inst = fBuilder->CreateCall(mth, fUIInterface_ptr);
+            CallInst* call_inst = CREATE_CALL(mth, fUIInterface_ptr);
             call_inst->setCallingConv(CallingConv::C);
         }
 
@@ -1102,7 +1171,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             string name = replaceSpacesWithUnderscore(label);
             llvm::Type* type_def = 0;
             GlobalVariable* llvm_label = addStringConstant(label, type_def);
-       #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+       #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
             Value* const_string = fBuilder->CreateConstGEP2_32(type_def, llvm_label, 0, 0);
        #else
             Value* const_string = fBuilder->CreateConstGEP2_32(llvm_label, 0, 0);
@@ -1111,15 +1180,15 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             Value* idx[2];
             idx[0] = genInt64(fModule, 0);
             idx[1] = fUICallTable[button_type];
-            Value* mth_ptr = fBuilder->CreateInBoundsGEP(ui, MAKE_IXD(idx, idx+2));
-            LoadInst* mth = fBuilder->CreateLoad(mth_ptr);
+            Value* mth_ptr = CREATE_IN_BOUNDS_GEP(ui, MAKE_IXD(idx, idx+2));
+            LoadInst* mth = CREATE_LOAD(mth_ptr);
 
             // Generates access to zone
             int field_index = fDSPFieldsNames[zone];
-        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
-            Value* zone_ptr = fBuilder->CreateStructGEP(0, dsp, field_index);
+        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
+            Value* zone_ptr = CREATE_STRUCT_GEP(dsp, field_index);
             Value* fun_args[] = { fUIInterface_ptr, const_string, zone_ptr };
-            CallInst* call_inst = fBuilder->CreateCall(mth, fun_args);
+            CallInst* call_inst = CREATE_CALL(mth, fun_args);
         #else
             Value* zone_ptr = fBuilder->CreateStructGEP(dsp, field_index);
             CallInst* call_inst = fBuilder->CreateCall3(mth, fUIInterface_ptr, const_string, zone_ptr);
@@ -1153,7 +1222,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             string name = replaceSpacesWithUnderscore(label);
             llvm::Type* type_def = 0;
             GlobalVariable* llvm_label = addStringConstant(label, type_def);
-       #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+       #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
             Value* const_string = fBuilder->CreateConstGEP2_32(type_def, llvm_label, 0, 0);
        #else
             Value* const_string = fBuilder->CreateConstGEP2_32(llvm_label, 0, 0);
@@ -1161,13 +1230,13 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             Value* idx[2];
             idx[0] = genInt64(fModule, 0);
             idx[1] = fUICallTable[slider_type];
-            Value* mth_ptr = fBuilder->CreateInBoundsGEP(ui, MAKE_IXD(idx, idx+2));
-            LoadInst* mth = fBuilder->CreateLoad(mth_ptr);
+            Value* mth_ptr = CREATE_IN_BOUNDS_GEP(ui, MAKE_IXD(idx, idx+2));
+            LoadInst* mth = CREATE_LOAD(mth_ptr);
 
             // Generates access to zone
             int field_index = fDSPFieldsNames[zone];
-        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
-            Value* zone_ptr = fBuilder->CreateStructGEP(0, dsp, field_index);
+        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
+            Value* zone_ptr = CREATE_STRUCT_GEP(dsp, field_index);
         #else
             Value* zone_ptr = fBuilder->CreateStructGEP(dsp, field_index);
         #endif
@@ -1181,7 +1250,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             idx2[5] = (itfloat() == Typed::kFloat) ? genFloat(fModule, max) : genDouble(fModule, max);
             idx2[6] = (itfloat() == Typed::kFloat) ? genFloat(fModule, step) : genDouble(fModule, step);
 
-            CallInst* call_inst = fBuilder->CreateCall(mth, MAKE_IXD(idx2, idx2+7));
+            CallInst* call_inst = CREATE_CALL(mth, MAKE_IXD(idx2, idx2+7));
             call_inst->setCallingConv(CallingConv::C);
         }
 
@@ -1213,7 +1282,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             string name = replaceSpacesWithUnderscore(label);
             llvm::Type* type_def = 0;
             GlobalVariable* llvm_label = addStringConstant(label, type_def);
-       #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+       #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
             Value* const_string = fBuilder->CreateConstGEP2_32(type_def, llvm_label, 0, 0);
        #else
             Value* const_string = fBuilder->CreateConstGEP2_32(llvm_label, 0, 0);
@@ -1222,13 +1291,13 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             Value* idx[2];
             idx[0] = genInt64(fModule, 0);
             idx[1] = fUICallTable[bargraph_type];
-            Value* mth_ptr = fBuilder->CreateInBoundsGEP(ui, MAKE_IXD(idx, idx+2));
-            LoadInst* mth = fBuilder->CreateLoad(mth_ptr);
+            Value* mth_ptr = CREATE_IN_BOUNDS_GEP(ui, MAKE_IXD(idx, idx+2));
+            LoadInst* mth = CREATE_LOAD(mth_ptr);
 
             // Generates access to zone
             int field_index = fDSPFieldsNames[zone];
-        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
-            Value* zone_ptr = fBuilder->CreateStructGEP(0, dsp, field_index);
+        #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
+            Value* zone_ptr = CREATE_STRUCT_GEP(dsp, field_index);
         #else
             Value* zone_ptr = fBuilder->CreateStructGEP(dsp, field_index);
         #endif
@@ -1240,7 +1309,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             idx2[3] = (itfloat() == Typed::kFloat) ? genFloat(fModule, min) : genDouble(fModule, min);
             idx2[4] = (itfloat() == Typed::kFloat) ? genFloat(fModule, max) : genDouble(fModule, max);
 
-            CallInst* call_inst = fBuilder->CreateCall(mth, MAKE_IXD(idx2, idx2+5));
+            CallInst* call_inst = CREATE_CALL(mth, MAKE_IXD(idx2, idx2+5));
             call_inst->setCallingConv(CallingConv::C);
         }
 
@@ -1378,7 +1447,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
                                                     inst->fName, fModule);
                 function->setCallingConv(CallingConv::C);
                 
-            #if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
+            #if defined(LLVM_33) || defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
                 // In order for auto-vectorization to correctly work with vectorizable math functions
                 if (find(gMathLibTable.begin(), gMathLibTable.end(), inst->fName) != gMathLibTable.end()) {
                     function->setDoesNotAccessMemory();
@@ -1424,15 +1493,15 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
         {
             if (size > 1) {
                 //cerr << "genPointer2VectorLoad" << endl;
-                Value* casted_load_ptr = fBuilder->CreateBitCast(load_ptr, PointerType::get(VectorType::get(load->getType(), size), 0));
+                Value* casted_load_ptr = fBuilder->CreateBitCast(load_ptr, PointerType::get(VECTOR_TYPE(load->getType(), size), 0));
 
                 // By default: non aligned vector load
-                LoadInst* load_inst = fBuilder->CreateLoad(casted_load_ptr);
+                LoadInst* load_inst = CREATE_LOAD(casted_load_ptr);
                 if (!aligned) {
-                #ifdef VECTOR_ALIGN
-                    load_inst->setAlignment(16);
+                #if VECTOR_ALIGN
+                    load_inst->setAlignment(INST_ALIGN(16));
                 #else
-                    load_inst->setAlignment(1);
+                    load_inst->setAlignment(INST_ALIGN(1));
                 #endif
                 }
                 return load_inst;
@@ -1445,7 +1514,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
         {
             if (size > 1) {
                 //cerr << "genScalar2VectorLoad" << endl;
-                Value* vector = UndefValue::get(VectorType::get(load->getType(), size));
+                Value* vector = UndefValue::get(VECTOR_TYPE(load->getType(), size));
                 Value* idx = genInt32(fModule, 0);
                 vector = fBuilder->CreateInsertElement(vector, load, idx);
                 SmallVector<Constant*, 16> args;
@@ -1461,7 +1530,10 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
 
         Value* genVectorLoad(Value* load_ptr, Value* load, int size, bool aligned)
         {
-            if (isa<PointerType>(load->getType())) {
+            if (isa<VectorType>(load->getType())) {
+                // Vector variable (local to a vectorized loop)
+                return load;
+            } else if (isa<PointerType>(load->getType())) {
                 return genPointer2VectorLoad(load_ptr, load, size, aligned);
             } else {
                 return genScalar2VectorLoad(load, size, aligned);
@@ -1499,8 +1571,8 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
         {
             if (named_address->fAccess & Address::kStruct) {
                 int field_index = fDSPFieldsNames[named_address->fName];
-            #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
-                return fBuilder->CreateStructGEP(0, getDSP(), field_index);
+            #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
+                return CREATE_STRUCT_GEP(getDSP(), field_index);
             #else
                 return fBuilder->CreateStructGEP(getDSP(), field_index);
             #endif
@@ -1555,7 +1627,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
                 idx[0] = genInt64(fModule, 0);
                 idx[1] = genInt32(fModule, field_index);
 
-                Value* load_ptr1 = fBuilder->CreateInBoundsGEP(getDSP(), MAKE_IXD(idx, idx+2));
+                Value* load_ptr1 = CREATE_IN_BOUNDS_GEP(getDSP(), MAKE_IXD(idx, idx+2));
                 res_load_ptr = loadArrayAsPointer(load_ptr1);
       
             } else if (named_address->fAccess & Address::kFunArgs) {
@@ -1573,7 +1645,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
                 return NULL;
             }
             
-            return fBuilder->CreateInBoundsGEP(res_load_ptr, fCurValue);
+            return CREATE_IN_BOUNDS_GEP(res_load_ptr, fCurValue);
         }
         
         void visitIndexedAddress(LoadVarInst* inst, IndexedAddress* indexed_address)
@@ -1582,7 +1654,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
             faustassert(named_address); // One level indexation for now
             
             Value* load_ptr = visitIndexedAddressAux(indexed_address);
-            fCurValue = genPointer2VectorLoad(load_ptr, fBuilder->CreateLoad(load_ptr), inst->fSize, false);
+            fCurValue = genPointer2VectorLoad(load_ptr, CREATE_LOAD(load_ptr), inst->fSize, false);
         }
 
         virtual void visit(LoadVarInst* inst)
@@ -1646,10 +1718,10 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
                 // By default: non aligned vector store
                 StoreInst* store_inst = fBuilder->CreateStore(store, casted_store_ptr, isvolatile);
                 if (!aligned) {
-                #ifdef VECTOR_ALIGN
-                    store_inst->setAlignment(16);
+                #if VECTOR_ALIGN
+                    store_inst->setAlignment(INST_ALIGN(16));
                 #else
-                    load_inst->setAlignment(1);
+                    store_inst->setAlignment(INST_ALIGN(1));
                 #endif
                 }
 
@@ -1672,8 +1744,8 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
                 
             if (named_address->fAccess & Address::kStruct) {
                 int field_index = fDSPFieldsNames[named_address->fName];
-            #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50)
-                Value* store_ptr = fBuilder->CreateStructGEP(0, getDSP(), field_index);
+            #if defined(LLVM_37) || defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140)
+                Value* store_ptr = CREATE_STRUCT_GEP(getDSP(), field_index);
             #else
                 Value* store_ptr = fBuilder->CreateStructGEP(getDSP(), field_index);
             #endif
@@ -1709,22 +1781,22 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
                 idx[0] = genInt64(fModule, 0);
                 idx[1] = genInt32(fModule, field_index);
 
-                Value* store_ptr1 = fBuilder->CreateInBoundsGEP(getDSP(), MAKE_IXD(idx, idx+2));
+                Value* store_ptr1 = CREATE_IN_BOUNDS_GEP(getDSP(), MAKE_IXD(idx, idx+2));
                 Value* store_ptr2 = loadArrayAsPointer(store_ptr1);
-                store_ptr = fBuilder->CreateInBoundsGEP(store_ptr2, fCurValue);
+                store_ptr = CREATE_IN_BOUNDS_GEP(store_ptr2, fCurValue);
 
             } else if (named_address->fAccess & Address::kFunArgs) {
-                store_ptr = fBuilder->CreateInBoundsGEP(getDSPArg(named_address->fName), fCurValue);
+                store_ptr = CREATE_IN_BOUNDS_GEP(getDSPArg(named_address->fName), fCurValue);
             } else if (named_address->fAccess & Address::kStack || named_address->fAccess & Address::kLoop) {
                 faustassert(fDSPStackVars.find(named_address->fName) != fDSPStackVars.end());
                 // We want to see array like [256 x float] as a float*
                 Value* store_ptr1 = loadArrayAsPointer(fDSPStackVars[named_address->fName]);
-                store_ptr = fBuilder->CreateInBoundsGEP(store_ptr1, fCurValue);
+                store_ptr = CREATE_IN_BOUNDS_GEP(store_ptr1, fCurValue);
             } else if (named_address->fAccess & Address::kGlobal || named_address->fAccess & Address::kStaticStruct) {
                 faustassert(fModule->getGlobalVariable(named_address->fName, true));
                 // We want to see array like [256 x float] as a float*
                 Value* store_ptr1 = loadArrayAsPointer(fModule->getGlobalVariable(named_address->fName, true));
-                store_ptr = fBuilder->CreateInBoundsGEP(store_ptr1, fCurValue);
+                store_ptr = CREATE_IN_BOUNDS_GEP(store_ptr1, fCurValue);
             } else {
                 // default
                 faustassert(false);
@@ -1924,13 +1996,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
     
         virtual void visit(FunCallInst* inst)
         {
-            // Don't know how to compile vectorized function call for now...
-            if (inst->fSize > 1) {
-                stringstream error;
-                error << "LLVM : Error FunCallInst with fSize = " << inst->fSize << endl;
-                throw faustexception(error.str());
-            }
-            // Special case
+            // Special case (also vectorized)
             if (startWith(inst->fName, "min") || startWith(inst->fName, "max")) {
                 generateFunPolymorphicMinMax(inst);
                 return;
@@ -1958,6 +2024,22 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
                 }
             }
 
+            if (inst->fSize > 1) {
+                // No vector version of math functions: the scalar function is called on each lane
+                Value* res_vector = UndefValue::get(VECTOR_TYPE(function->getReturnType(), inst->fSize));
+                for (int i = 0; i < inst->fSize; i++) {
+                    vector<LlvmValue> scalar_args;
+                    for (size_t arg = 0; arg < fun_args.size(); arg++) {
+                        scalar_args.push_back(fBuilder->CreateExtractElement(fun_args[arg], genInt32(fModule, i)));
+                    }
+                    CallInst* call_inst = CREATE_CALL(function, scalar_args);
+                    call_inst->setCallingConv(CallingConv::C);
+                    res_vector = fBuilder->CreateInsertElement(res_vector, call_inst, genInt32(fModule, i));
+                }
+                fCurValue = res_vector;
+                return;
+            }
+
             CallInst* call_inst = CREATE_CALL(function, fun_args);
             call_inst->setCallingConv(CallingConv::C);
 
@@ -1967,66 +2049,27 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
 
         virtual void visit(Select2Inst* inst)
         {
-            // Select vector mode X86 code generator sill not implemented, generates the code in scalar for now
-            if (inst->fSize > 1) {
-
-                // Compile condition, result in fCurValue
-                inst->fCond->accept(this);
-                Value* cond_value = fCurValue;
-
-                // Compile then branch, result in fCurValue
-                inst->fThen->accept(this);
-                Value* then_value = fCurValue;
-
-                // Compile else branch, result in fCurValue
-                inst->fElse->accept(this);
-                Value* else_value = fCurValue;
-
-                // Create resulting vector
-                Value* select_vector = UndefValue::get(then_value->getType());
-
-                // Convert condition to a bool by comparing to 0
-                for (int i = 0; i < inst->fSize; i++) {
-
-                    Value* scalar_cond_value1 = fBuilder->CreateExtractElement(cond_value, genInt32(fModule, i));
-                    Value* scalar_cond_value2 = fBuilder->CreateICmpNE(scalar_cond_value1, genInt32(fModule, 0), "ifcond");
-                    Value* scalar_then_value = fBuilder->CreateExtractElement(then_value, genInt32(fModule, i));
-                    Value* scalar_else_value = fBuilder->CreateExtractElement(else_value, genInt32(fModule, i));
-
-                    // Scalar select
-                    Value* scalar_res = fBuilder->CreateSelect(scalar_cond_value2, scalar_then_value, scalar_else_value);
-
-                    // Fill resulting vector
-                    select_vector = fBuilder->CreateInsertElement(select_vector, scalar_res, genInt32(fModule, i));
-                }
-
-                // Final result
-                fCurValue = select_vector;
+            // Compile condition, result in fCurValue
+            inst->fCond->accept(this);
 
+            // Convert condition to a bool (or a vector of bool) by comparing to 0
+            Value* cond_value;
+            if (fCurValue->getType() == getInt64Ty(fModule, inst->fSize)) {
+                cond_value = fBuilder->CreateICmpNE(fCurValue, genInt64(fModule, 0, inst->fSize), "ifcond");
             } else {
+                cond_value = fBuilder->CreateICmpNE(fCurValue, genInt32(fModule, 0, inst->fSize), "ifcond");
+            }
 
-                // Compile condition, result in fCurValue
-                inst->fCond->accept(this);
-   
-                // Convert condition to a bool by comparing to 0
-                Value* cond_value;
-                if (fCurValue->getType() == getInt64Ty(fModule, inst->fSize)) {
-                    cond_value = fBuilder->CreateICmpNE(fCurValue, genInt64(fModule, 0, inst->fSize), "ifcond");
-                } else {
-                    cond_value = fBuilder->CreateICmpNE(fCurValue, genInt32(fModule, 0, inst->fSize), "ifcond");
-                }
-
-                // Compile then branch, result in fCurValue
-                inst->fThen->accept(this);
-                Value* then_value = fCurValue;
+            // Compile then branch, result in fCurValue
+            inst->fThen->accept(this);
+            Value* then_value = fCurValue;
 
-                // Compile else branch, result in fCurValue
-                inst->fElse->accept(this);
-                Value* else_value = fCurValue;
+            // Compile else branch, result in fCurValue
+            inst->fElse->accept(this);
+            Value* else_value = fCurValue;
 
-                // Creates the result
-                fCurValue = fBuilder->CreateSelect(cond_value, then_value, else_value);
-            }
+            // Creates the result
+            fCurValue = fBuilder->CreateSelect(cond_value, then_value, else_value);
         }
 
         virtual void visit(IfInst* inst)
@@ -2329,30 +2372,8 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
 
         LlvmValue generateScalarSelect(int opcode, LlvmValue cond_value, LlvmValue then_value, LlvmValue else_value, int size)
         {
-            if (size == 1) {
-                return fBuilder->CreateSelect(cond_value, then_value, else_value);
-            } else {
-
-                // Select vector mode X86 code generator sill not implemented, generates the code in scalar for now
-                // Create resulting vector
-                Value* select_vector = UndefValue::get(then_value->getType());
-
-                for (int i = 0; i < size; i++) {
-
-                    Value* scalar_cond_value = fBuilder->CreateExtractElement(cond_value, genInt32(fModule, i));
-                    Value* scalar_then_value = fBuilder->CreateExtractElement(then_value, genInt32(fModule, i));
-                    Value* scalar_else_value = fBuilder->CreateExtractElement(else_value, genInt32(fModule, i));
-
-                    // Scalar select
-                    Value* scalar_res = fBuilder->CreateSelect(scalar_cond_value, scalar_then_value, scalar_else_value);
-
-                    // Fill resulting vector
-                    select_vector = fBuilder->CreateInsertElement(select_vector, scalar_res, genInt32(fModule, i));
-                }
-
-                // Final result
-                return select_vector;
-            }
+            // Vector select is done lane by lane with a <size x i1> condition
+            return fBuilder->CreateSelect(cond_value, then_value, else_value);
         }
 
         LlvmValue generateBinOpReal(int opcode, LlvmValue arg1, LlvmValue arg2, int size)
@@ -2362,7 +2383,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
                 // Inst result for comparison
                 return generateScalarSelect(opcode, comp_value, genInt32(fModule, 1, size), genInt32(fModule, 0, size), size);
             } else {
-            #if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) ||defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50))
+            #if (defined(LLVM_34) || defined(LLVM_35) || defined(LLVM_36) || defined(LLVM_37) ||defined(LLVM_38) || defined(LLVM_39) || defined(LLVM_40) || defined(LLVM_50) || defined(LLVM_140))
                 LlvmValue value = fBuilder->CreateBinOp((Instruction::BinaryOps)gBinOpTable[opcode]->fLLVMFloatInst, arg1, arg2);
                 Instruction* inst = cast<Instruction>(value);
                 inst->setMetadata(LLVMContext::MD_fpmath, fBuilder->getDefaultFPMathTag());
@@ -0,0 +1,169 @@
+/************************************************************************
+ ************************************************************************
+ Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef TIERED_DSP_H
+#define TIERED_DSP_H
+
+#include <string>
+#include "faust/dsp/dsp.h"
+#include "faust/gui/meta.h"
+
+/*!
+ \addtogroup tieredcpp C++ interface for tiered compilation of Faust code : the DSP instances start running on the
+ interpreter backend, and continue on the LLVM backend as soon as it has been compiled on a background thread.
+ The switch happens at a buffer boundary, controls and DSP state (delay lines, recursive states...) being kept.
+ Note that DSP using soundfiles stay on the interpreter backend.
+ @{
+ */
+
+/**
+ * DSP instance class with methods.
+ */
+class tiered_dsp : public dsp {
+
+    private:
+
+        // tiered_dsp objects are allocated using tiered_dsp_factory::createDSPInstance();
+        tiered_dsp() {}
+
+    public:
+
+        int getNumInputs();
+
+        int getNumOutputs();
+
+        void buildUserInterface(UI* ui_interface);
+
+        int getSampleRate();
+
+        void init(int samplingRate);
+
+        void instanceInit(int samplingRate);
+
+        void instanceConstants(int samplingRate);
+
+        void instanceResetUserInterface();
+
+        void instanceClear();
+
+        tiered_dsp* clone();
+
+        void metadata(Meta* m);
+
+        void compute(int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs);
+
+        /* Return whether the instance runs the LLVM compiled code */
+        bool isNative();
+
+};
+
+/**
+ * DSP factory class.
+ */
+
+class tiered_dsp_factory : public dsp_factory {
+
+     public:
+
+        /**
+         *  Return factory name:
+         *  either the name declared in DSP with [declare name "foo"] syntax
+         *  or 'filename' (if createTieredDSPFactoryFromFile is used)
+         *  or 'name_app' (if createTieredDSPFactoryFromString is used)
+        */
+        std::string getName();
+
+        /* Return factory SHA key */
+        std::string getSHAKey();
+
+        /* Return factory expanded DSP code */
+        std::string getDSPCode();
+
+        /* Create a new DSP instance, to be deleted with C++ 'delete' */
+        tiered_dsp* createDSPInstance();
+
+        /* Set a custom memory manager to be used when creating instances */
+        void setMemoryManager(dsp_memory_manager* manager);
+
+        /* Return the currently set custom memory manager */
+        dsp_memory_manager* getMemoryManager();
+
+        /* Return whether the LLVM factory is compiled (new instances then directly run the LLVM compiled code) */
+        bool isNative();
+
+        /* Return the LLVM compilation error, or an empty string */
+        std::string getNativeError();
+};
+
+/**
+ * Create a tiered Faust DSP factory from a DSP source code as a file. The interpreter factory is compiled before
+ * returning, the LLVM one is compiled on a background thread.
+ *
+ * @param filename - the DSP filename
+ * @param argc - the number of parameters in argv array
+ * @param argv - the array of parameters (Warning : aux files generation options will be filtered (-svg, ...) --> use generateAuxFiles)
+ * @param target - the LLVM machine target (using empty string will take current machine settings)
+ * @param error_msg - the error string to be filled
+ * @param opt_level - LLVM IR to IR optimization level (from -1 to 4, -1 means 'maximum possible value'
+ * since the maximum value may change with new LLVM versions)
+ *
+ * @return a valid DSP factory on success, otherwise a null pointer.
+ */
+tiered_dsp_factory* createTieredDSPFactoryFromFile(const std::string& filename,
+                                                   int argc, const char* argv[],
+                                                   const std::string& target,
+                                                   std::string& error_msg, int opt_level = -1);
+
+/**
+ * Create a tiered Faust DSP factory from a DSP source code as a string. The interpreter factory is compiled before
+ * returning, the LLVM one is compiled on a background thread.
+ *
+ * @param name_app - the name of the Faust program
+ * @param dsp_content - the Faust program as a string
+ * @param argc - the number of parameters in argv array
+ * @param argv - the array of parameters (Warning : aux files generation options will be filtered (-svg, ...) --> use generateAuxFiles)
+ * @param target - the LLVM machine target (using empty string will take current machine settings)
+ * @param error_msg - the error string to be filled
+ * @param opt_level - LLVM IR to IR optimization level (from -1 to 4, -1 means 'maximum possible value'
+ * since the maximum value may change with new LLVM versions)
+ *
+ * @return a valid DSP factory on success, otherwise a null pointer.
+ */
+tiered_dsp_factory* createTieredDSPFactoryFromString(const std::string& name_app, const std::string& dsp_content,
+                                                     int argc, const char* argv[],
+                                                     const std::string& target,
+                                                     std::string& error_msg, int opt_level = -1);
+
+/**
+ * Delete a tiered Faust DSP factory, waiting for the end of the LLVM compilation if needed.
+ * All DSP instances of the factory have to be deleted before.
+ *
+ * @param factory - the DSP factory
+ *
+ * @return true if the factory was deleted.
+ */
+bool deleteTieredDSPFactory(tiered_dsp_factory* factory);
+
+/*!
+ @}
+ */
+
+#endif
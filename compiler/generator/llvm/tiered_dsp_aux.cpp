@@ -0,0 +1,508 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifdef INTERP_BUILD
+
+#include <string.h>
+#include <map>
+
+#include "compatibility.hh"
+#include "tiered_dsp_aux.hh"
+#include "llvm_dsp_aux.hh"
+#include "interpreter_dsp_aux.hh"
+#include "Text.hh"
+
+using namespace std;
+
+// Serializes the compilations done by tiered factories (the compiler is not reentrant)
+static TLockAble gTieredLock;
+
+// Collects the zones of a DSP, in the order of the UI description
+
+struct ZoneCollector : public UI {
+
+    vector<FAUSTFLOAT*> fZones;
+    vector<bool> fOutputZones;
+
+    void addZone(FAUSTFLOAT* zone, bool output)
+    {
+        fZones.push_back(zone);
+        fOutputZones.push_back(output);
+    }
+
+    void openTabBox(const char* label) {}
+    void openHorizontalBox(const char* label) {}
+    void openVerticalBox(const char* label) {}
+    void closeBox() {}
+
+    void addButton(const char* label, FAUSTFLOAT* zone) { addZone(zone, false); }
+    void addCheckButton(const char* label, FAUSTFLOAT* zone) { addZone(zone, false); }
+    void addVerticalSlider(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+    {
+        addZone(zone, false);
+    }
+    void addHorizontalSlider(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+    {
+        addZone(zone, false);
+    }
+    void addNumEntry(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+    {
+        addZone(zone, false);
+    }
+
+    void addHorizontalBargraph(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT min, FAUSTFLOAT max) { addZone(zone, true); }
+    void addVerticalBargraph(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT min, FAUSTFLOAT max) { addZone(zone, true); }
+
+    void addSoundfile(const char* label, const char* filename, Soundfile** sf_zone) {}
+
+};
+
+// Gives the zones owned by the tiered instance to the user UI, in place of the ones of the running DSP
+
+struct ZoneForwarder : public UI {
+
+    UI* fUI;
+    map<FAUSTFLOAT*, FAUSTFLOAT*> fZoneMap;
+
+    ZoneForwarder(UI* ui, const vector<FAUSTFLOAT*>& zones, vector<FAUSTFLOAT>& values):fUI(ui)
+    {
+        for (size_t i = 0; i < zones.size(); i++) {
+            fZoneMap[zones[i]] = &values[i];
+        }
+    }
+
+    FAUSTFLOAT* getZone(FAUSTFLOAT* zone)
+    {
+        map<FAUSTFLOAT*, FAUSTFLOAT*>::iterator it = fZoneMap.find(zone);
+        return (it != fZoneMap.end()) ? (*it).second : zone;
+    }
+
+    void openTabBox(const char* label) { fUI->openTabBox(label); }
+    void openHorizontalBox(const char* label) { fUI->openHorizontalBox(label); }
+    void openVerticalBox(const char* label) { fUI->openVerticalBox(label); }
+    void closeBox() { fUI->closeBox(); }
+
+    void addButton(const char* label, FAUSTFLOAT* zone) { fUI->addButton(label, getZone(zone)); }
+    void addCheckButton(const char* label, FAUSTFLOAT* zone) { fUI->addCheckButton(label, getZone(zone)); }
+    void addVerticalSlider(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+    {
+        fUI->addVerticalSlider(label, getZone(zone), init, min, max, step);
+    }
+    void addHorizontalSlider(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+    {
+        fUI->addHorizontalSlider(label, getZone(zone), init, min, max, step);
+    }
+    void addNumEntry(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+    {
+        fUI->addNumEntry(label, getZone(zone), init, min, max, step);
+    }
+
+    void addHorizontalBargraph(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT min, FAUSTFLOAT max)
+    {
+        fUI->addHorizontalBargraph(label, getZone(zone), min, max);
+    }
+    void addVerticalBargraph(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT min, FAUSTFLOAT max)
+    {
+        fUI->addVerticalBargraph(label, getZone(zone), min, max);
+    }
+
+    // Soundfiles are not migrated (see prepareNative), so the interpreter one is given as is
+    void addSoundfile(const char* label, const char* filename, Soundfile** sf_zone)
+    {
+        fUI->addSoundfile(label, filename, sf_zone);
+    }
+
+    void declare(FAUSTFLOAT* zone, const char* key, const char* val)
+    {
+        fUI->declare((zone) ? getZone(zone) : zone, key, val);
+    }
+
+};
+
+// Field values conversion : 'type' is 0 for int32, otherwise sizeof(real)
+
+static double readField(void* field, int type, int index)
+{
+    if (type == 0) {
+        return double(static_cast<int*>(field)[index]);
+    } else if (type == sizeof(float)) {
+        return double(static_cast<float*>(field)[index]);
+    } else {
+        return static_cast<double*>(field)[index];
+    }
+}
+
+static void writeField(void* field, int type, int index, double value)
+{
+    if (type == 0) {
+        static_cast<int*>(field)[index] = int(value);
+    } else if (type == sizeof(float)) {
+        static_cast<float*>(field)[index] = float(value);
+    } else {
+        static_cast<double*>(field)[index] = value;
+    }
+}
+
+static int fieldSize(int type)
+{
+    return (type == 0) ? sizeof(int) : type;
+}
+
+// tiered_dsp
+
+tiered_dsp::tiered_dsp(tiered_dsp_factory* factory, interpreter_dsp* interpreter, llvm_dsp* native)
+    :fFactory(factory), fInterpreter(interpreter), fNative(native), fNextNative(0), fSampleRate(-1)
+{
+    fCurrent = (fNative) ? static_cast<dsp*>(fNative) : static_cast<dsp*>(fInterpreter);
+
+    ZoneCollector collector;
+    fCurrent->buildUserInterface(&collector);
+    fCurrentZones = collector.fZones;
+    fOutputZones = collector.fOutputZones;
+    fZones.resize(fCurrentZones.size());
+    readZones();
+}
+
+tiered_dsp::~tiered_dsp()
+{
+    fFactory->removeInstance(this);
+    delete fNextNative.exchange(0);
+    delete fNative;
+    delete fInterpreter;
+}
+
+void tiered_dsp::readZones()
+{
+    for (size_t i = 0; i < fZones.size(); i++) {
+        fZones[i] = *fCurrentZones[i];
+    }
+}
+
+// Called by the compilation thread
+void tiered_dsp::prepareNative(llvm_dsp* native)
+{
+    TLock lock(&fLock);
+
+    native->init((fSampleRate > 0) ? fSampleRate : 44100);
+
+    ZoneCollector collector;
+    native->buildUserInterface(&collector);
+
+    // Both instances must have the same UI
+    if (collector.fZones.size() != fCurrentZones.size() || collector.fOutputZones != fOutputZones) {
+        delete native;
+        return;
+    }
+
+    // Every field of the LLVM DSP structure is taken from the interpreter heap
+    const map<string, llvm_field_desc>& layout = fFactory->fNativeFactory->getFactory()->getFieldLayout();
+    interpreter_dsp_base* interpreter = fInterpreter->getDSP();
+    char* base = reinterpret_cast<char*>(native->getDSP());
+    vector<tiered_field_copy> state;
+
+    for (map<string, llvm_field_desc>::const_iterator it = layout.begin(); it != layout.end(); it++) {
+        tiered_field_copy copy;
+        copy.fSrc = interpreter->getField((*it).first, copy.fSize, copy.fSrcType);
+        copy.fDst = base + (*it).second.fOffset;
+        copy.fDstType = (*it).second.fType;
+        // Pointers (soundfiles...) or fields unknown on one side : stay on the interpreter
+        if (!copy.fSrc || copy.fDstType == -1 || copy.fSize != (*it).second.fSize) {
+            delete native;
+            return;
+        }
+        state.push_back(copy);
+    }
+
+    if (state.size() == 0) {
+        delete native;
+        return;
+    }
+
+    fNextState = state;
+    fNextZones = collector.fZones;
+    fNextNative.store(native);
+}
+
+// Called by 'compute' at a buffer boundary : the native instance continues where the interpreter stopped
+void tiered_dsp::switchToNative(llvm_dsp* native)
+{
+    for (size_t i = 0; i < fNextState.size(); i++) {
+        const tiered_field_copy& copy = fNextState[i];
+        if (copy.fSrcType == copy.fDstType) {
+            memcpy(copy.fDst, copy.fSrc, copy.fSize * fieldSize(copy.fSrcType));
+        } else {
+            for (int j = 0; j < copy.fSize; j++) {
+                writeField(copy.fDst, copy.fDstType, j, readField(copy.fSrc, copy.fSrcType, j));
+            }
+        }
+    }
+
+    // The interpreter instance is kept until the tiered one is deleted, so that nothing is deallocated here
+    fNative = native;
+    fCurrent = native;
+    fCurrentZones = fNextZones;
+}
+
+int tiered_dsp::getNumInputs() { return fCurrent->getNumInputs(); }
+
+int tiered_dsp::getNumOutputs() { return fCurrent->getNumOutputs(); }
+
+void tiered_dsp::buildUserInterface(UI* ui_interface)
+{
+    ZoneForwarder forwarder(ui_interface, fCurrentZones, fZones);
+    fCurrent->buildUserInterface(&forwarder);
+}
+
+int tiered_dsp::getSampleRate() { return fCurrent->getSampleRate(); }
+
+// The init methods are also applied on a native instance not yet taken by 'compute'
+
+void tiered_dsp::init(int samplingRate)
+{
+    TLock lock(&fLock);
+    fSampleRate = samplingRate;
+    llvm_dsp* next = fNextNative.load();
+    if (next) next->init(samplingRate);
+    fCurrent->init(samplingRate);
+    readZones();
+}
+
+void tiered_dsp::instanceInit(int samplingRate)
+{
+    TLock lock(&fLock);
+    fSampleRate = samplingRate;
+    llvm_dsp* next = fNextNative.load();
+    if (next) next->instanceInit(samplingRate);
+    fCurrent->instanceInit(samplingRate);
+    readZones();
+}
+
+void tiered_dsp::instanceConstants(int samplingRate)
+{
+    TLock lock(&fLock);
+    fSampleRate = samplingRate;
+    llvm_dsp* next = fNextNative.load();
+    if (next) next->instanceConstants(samplingRate);
+    fCurrent->instanceConstants(samplingRate);
+}
+
+void tiered_dsp::instanceResetUserInterface()
+{
+    TLock lock(&fLock);
+    fCurrent->instanceResetUserInterface();
+    readZones();
+}
+
+void tiered_dsp::instanceClear()
+{
+    TLock lock(&fLock);
+    fCurrent->instanceClear();
+}
+
+tiered_dsp* tiered_dsp::clone() { return fFactory->createDSPInstance(); }
+
+void tiered_dsp::metadata(Meta* m) { fCurrent->metadata(m); }
+
+bool tiered_dsp::isNative() { return fNative != 0; }
+
+void tiered_dsp::compute(int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs)
+{
+    llvm_dsp* native = fNextNative.exchange(0);
+    if (native) switchToNative(native);
+
+    for (size_t i = 0; i < fZones.size(); i++) {
+        if (!fOutputZones[i]) *fCurrentZones[i] = fZones[i];
+    }
+
+    fCurrent->compute(count, inputs, outputs);
+
+    for (size_t i = 0; i < fZones.size(); i++) {
+        if (fOutputZones[i]) fZones[i] = *fCurrentZones[i];
+    }
+}
+
+// tiered_dsp_factory
+
+tiered_dsp_factory::tiered_dsp_factory(interpreter_dsp_factory* factory,
+                                       const string& name_app,
+                                       const string& dsp_content,
+                                       int argc, const char* argv[],
+                                       const string& target,
+                                       int opt_level)
+    :fInterpreterFactory(factory), fNativeFactory(0),
+    fNameApp(name_app), fDSPContent(dsp_content), fTarget(target), fOptLevel(opt_level), fCompiled(false)
+{
+    for (int i = 0; i < argc; i++) {
+        fArgv.push_back(argv[i]);
+    }
+
+#ifdef _WIN32
+    compileNative(this);
+#else
+    fThreadStarted = (pthread_create(&fThread, NULL, compileNative, this) == 0);
+    if (!fThreadStarted) {
+        fCompiled = true;
+        fNativeError = "ERROR : cannot start the native compilation thread";
+    }
+#endif
+}
+
+tiered_dsp_factory::~tiered_dsp_factory()
+{
+#ifndef _WIN32
+    if (fThreadStarted) pthread_join(fThread, NULL);
+#endif
+    if (fNativeFactory) deleteDSPFactory(fNativeFactory);
+    deleteInterpreterDSPFactory(fInterpreterFactory);
+}
+
+void* tiered_dsp_factory::compileNative(void* arg)
+{
+    tiered_dsp_factory* factory = static_cast<tiered_dsp_factory*>(arg);
+
+    vector<const char*> argv;
+    for (size_t i = 0; i < factory->fArgv.size(); i++) {
+        argv.push_back(factory->fArgv[i].c_str());
+    }
+    argv.push_back(0);
+
+    string error_msg;
+    llvm_dsp_factory* native;
+    {
+        TLock lock(&gTieredLock);
+        native = createDSPFactoryFromString(factory->fNameApp, factory->fDSPContent,
+                                            int(factory->fArgv.size()), &argv[0],
+                                            factory->fTarget, error_msg, factory->fOptLevel);
+    }
+    factory->setNative(native, error_msg);
+    return NULL;
+}
+
+void tiered_dsp_factory::setNative(llvm_dsp_factory* factory, const string& error_msg)
+{
+    TLock lock(&fLock);
+    fNativeFactory = factory;
+    fNativeError = error_msg;
+    fCompiled = true;
+
+    if (fNativeFactory) {
+        for (set<tiered_dsp*>::iterator it = fInstances.begin(); it != fInstances.end(); it++) {
+            (*it)->prepareNative(fNativeFactory->createDSPInstance());
+        }
+    }
+    fInstances.clear();
+}
+
+void tiered_dsp_factory::removeInstance(tiered_dsp* dsp)
+{
+    TLock lock(&fLock);
+    fInstances.erase(dsp);
+}
+
+string tiered_dsp_factory::getName() { return fInterpreterFactory->getName(); }
+
+string tiered_dsp_factory::getSHAKey() { return fInterpreterFactory->getSHAKey(); }
+
+string tiered_dsp_factory::getDSPCode() { return fInterpreterFactory->getDSPCode(); }
+
+tiered_dsp* tiered_dsp_factory::createDSPInstance()
+{
+    TLock lock(&fLock);
+
+    if (fNativeFactory) {
+        return new tiered_dsp(this, 0, fNativeFactory->createDSPInstance());
+    } else {
+        tiered_dsp* dsp = new tiered_dsp(this, fInterpreterFactory->createDSPInstance(), 0);
+        if (!fCompiled) fInstances.insert(dsp);
+        return dsp;
+    }
+}
+
+void tiered_dsp_factory::setMemoryManager(dsp_memory_manager* manager)
+{
+    TLock lock(&fLock);
+    fInterpreterFactory->setMemoryManager(manager);
+    if (fNativeFactory) fNativeFactory->setMemoryManager(manager);
+}
+
+dsp_memory_manager* tiered_dsp_factory::getMemoryManager() { return fInterpreterFactory->getMemoryManager(); }
+
+bool tiered_dsp_factory::isNative()
+{
+    TLock lock(&fLock);
+    return fNativeFactory != 0;
+}
+
+string tiered_dsp_factory::getNativeError()
+{
+    TLock lock(&fLock);
+    return fNativeError;
+}
+
+// External API
+
+EXPORT tiered_dsp_factory* createTieredDSPFactoryFromFile(const string& filename,
+                                                          int argc, const char* argv[],
+                                                          const string& target,
+                                                          string& error_msg, int opt_level)
+{
+    string base = basename((char*)filename.c_str());
+    size_t pos = filename.find(".dsp");
+
+    if (pos != string::npos) {
+        return createTieredDSPFactoryFromString(base.substr(0, pos), pathToContent(filename), argc, argv, target, error_msg, opt_level);
+    } else {
+        error_msg = "File Extension is not the one expected (.dsp expected)";
+        return NULL;
+    }
+}
+
+EXPORT tiered_dsp_factory* createTieredDSPFactoryFromString(const string& name_app, const string& dsp_content,
+                                                            int argc, const char* argv[],
+                                                            const string& target,
+                                                            string& error_msg, int opt_level)
+{
+    interpreter_dsp_factory* factory;
+    {
+        TLock lock(&gTieredLock);
+        factory = createInterpreterDSPFactoryFromString(name_app, dsp_content, argc, argv, error_msg);
+    }
+
+    if (!factory) {
+        return NULL;
+    }
+
+    // The LLVM factory is compiled on another thread
+    startMTDSPFactories();
+    return new tiered_dsp_factory(factory, name_app, dsp_content, argc, argv, target, opt_level);
+}
+
+EXPORT bool deleteTieredDSPFactory(tiered_dsp_factory* factory)
+{
+    if (factory) {
+        delete factory;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+#endif
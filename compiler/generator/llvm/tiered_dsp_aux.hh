@@ -0,0 +1,203 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef TIERED_DSP_AUX_H
+#define TIERED_DSP_AUX_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <atomic>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "faust/dsp/dsp.h"
+#include "faust/gui/UI.h"
+#include "faust/gui/meta.h"
+#include "export.hh"
+#include "TMutex.h"
+
+class llvm_dsp;
+class llvm_dsp_factory;
+class interpreter_dsp;
+class interpreter_dsp_factory;
+class tiered_dsp_factory;
+
+/*
+ Tiered execution : a tiered factory compiles an interpreter factory, available almost immediately, and compiles
+ the LLVM factory of the same DSP on a background thread. Its instances first run the interpreter code, then
+ switch to the native code at a buffer boundary once it is available : the native instance is prepared by the
+ compilation thread, and the first 'compute' that sees it moves the interpreter heap fields (controls, delay lines,
+ recursive states...) in the LLVM DSP structure, both being laid out from the same FIR declarations.
+
+ The user interface is built on zones owned by the tiered instance, copied in (and bargraphs back from)
+ the zones of the running instance at each buffer, so that the switch is not visible from the UI side.
+*/
+
+// Copy of one DSP field from the interpreter heap to the LLVM DSP structure
+struct tiered_field_copy {
+
+    void* fSrc;
+    void* fDst;
+    int fSrcType;   // 0 for int32, otherwise sizeof(real)
+    int fDstType;
+    int fSize;
+
+};
+
+class EXPORT tiered_dsp : public dsp {
+
+    friend class tiered_dsp_factory;
+
+    private:
+
+        tiered_dsp_factory* fFactory;
+        interpreter_dsp* fInterpreter;
+        llvm_dsp* fNative;
+        dsp* fCurrent;
+
+        // Native instance prepared by the compilation thread, taken by the next 'compute'
+        std::atomic<llvm_dsp*> fNextNative;
+        std::vector<tiered_field_copy> fNextState;
+        std::vector<FAUSTFLOAT*> fNextZones;
+
+        // Zones given to the user interface, and the matching ones of the running instance
+        std::vector<FAUSTFLOAT> fZones;
+        std::vector<FAUSTFLOAT*> fCurrentZones;
+        std::vector<bool> fOutputZones;     // Bargraphs, copied back after 'compute'
+
+        int fSampleRate;
+        TLockAble fLock;        // Between the user (init...) and the compilation thread
+
+        tiered_dsp(tiered_dsp_factory* factory, interpreter_dsp* interpreter, llvm_dsp* native);
+
+        void prepareNative(llvm_dsp* native);
+        void switchToNative(llvm_dsp* native);
+        void readZones();
+
+    public:
+
+        virtual ~tiered_dsp();
+
+        virtual int getNumInputs();
+
+        virtual int getNumOutputs();
+
+        virtual void buildUserInterface(UI* ui_interface);
+
+        virtual int getSampleRate();
+
+        virtual void init(int samplingRate);
+
+        virtual void instanceInit(int samplingRate);
+
+        virtual void instanceConstants(int samplingRate);
+
+        virtual void instanceResetUserInterface();
+
+        virtual void instanceClear();
+
+        virtual tiered_dsp* clone();
+
+        virtual void metadata(Meta* m);
+
+        virtual void compute(int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs);
+
+        // Whether the instance runs the native code
+        bool isNative();
+
+};
+
+class EXPORT tiered_dsp_factory : public dsp_factory {
+
+    friend class tiered_dsp;
+
+    private:
+
+        interpreter_dsp_factory* fInterpreterFactory;
+        llvm_dsp_factory* fNativeFactory;
+
+        // Native compilation parameters
+        std::string fNameApp;
+        std::string fDSPContent;
+        std::vector<std::string> fArgv;
+        std::string fTarget;
+        int fOptLevel;
+
+    #ifndef _WIN32
+        pthread_t fThread;
+        bool fThreadStarted;
+    #endif
+        bool fCompiled;
+        std::string fNativeError;
+        std::set<tiered_dsp*> fInstances;   // Interpreter instances waiting for the native code
+        TLockAble fLock;
+
+        static void* compileNative(void* arg);
+
+        void setNative(llvm_dsp_factory* factory, const std::string& error_msg);
+        void removeInstance(tiered_dsp* dsp);
+
+        virtual ~tiered_dsp_factory();
+
+    public:
+
+        tiered_dsp_factory(interpreter_dsp_factory* factory,
+                           const std::string& name_app,
+                           const std::string& dsp_content,
+                           int argc, const char* argv[],
+                           const std::string& target,
+                           int opt_level);
+
+        std::string getName();
+
+        std::string getSHAKey();
+
+        std::string getDSPCode();
+
+        tiered_dsp* createDSPInstance();
+
+        void setMemoryManager(dsp_memory_manager* manager);
+
+        dsp_memory_manager* getMemoryManager();
+
+        bool isNative();
+
+        std::string getNativeError();
+
+        friend bool deleteTieredDSPFactory(tiered_dsp_factory* factory);
+
+};
+
+EXPORT tiered_dsp_factory* createTieredDSPFactoryFromFile(const std::string& filename,
+                                                          int argc, const char* argv[],
+                                                          const std::string& target,
+                                                          std::string& error_msg, int opt_level = -1);
+
+EXPORT tiered_dsp_factory* createTieredDSPFactoryFromString(const std::string& name_app, const std::string& dsp_content,
+                                                            int argc, const char* argv[],
+                                                            const std::string& target,
+                                                            std::string& error_msg, int opt_level = -1);
+
+EXPORT bool deleteTieredDSPFactory(tiered_dsp_factory* factory);
+
+#endif
@@ -91,6 +91,7 @@ void OccMarkup::mark(Tree root)
 {
     fRootTree = root;
     fPropKey = tree(unique("OCCURRENCES"));
+    CTree::allocateSlot(fPropKey);
     
     if (isList(root)) {
         while (isList(root)) {
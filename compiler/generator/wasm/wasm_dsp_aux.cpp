@@ -106,8 +106,8 @@ EXPORT wasm_dsp_factory* createWasmDSPFactoryFromString(const string& name_app,
                                                             true);
     if (dsp_factory_aux) {
         wasm_dsp_factory* factory = new wasm_dsp_factory(dsp_factory_aux);
-        gWasmFactoryTable.setFactory(factory);
         factory->setSHAKey(sha_key);
+        gWasmFactoryTable.setFactory(factory);
         factory->setDSPCode(expanded_dsp_content);
         return factory;
     } else {
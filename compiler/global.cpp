@@ -20,6 +20,7 @@
  ************************************************************************/
 
 #include <limits.h>
+#include <stddef.h>
 
 #include "global.hh"
 #include "sourcereader.hh"
@@ -82,12 +83,11 @@
 #endif
 
 // Parser
-extern FILE* yyin;
-extern const char* yyfilename;
+extern thread_local const char* yyfilename;
 
 // CG globals
-list<Garbageable*> global::gObjectTable;
-bool global::gHeapCleanup = false;
+thread_local GarbageableArena global::gObjectArena;
+thread_local bool global::gHeapCleanup = false;
   
 /*
 faust1 uses a loop size of 512, but 512 makes faust2 crash (stack allocation error).
@@ -135,6 +135,7 @@ global::global():TABBER(1), gLoopDetector(1024, 400), gNextFreeColor(1)
     gUIMacroSwitch = false;
     gDumpNorm = false;
     gFTZMode = 0;
+    gFixedSampleRate = 0;
 
     gFloatSize = 1;
 
@@ -156,11 +157,16 @@ global::global():TABBER(1), gLoopDetector(1024, 400), gNextFreeColor(1)
     gComputeIOTA = false;
     gFAUSTFLOATToInternal = false;
     gInPlace = false;
+    gValueNumbering = false;
+    gApproxReductions = false;
     gHasExp10 = false;
     gLoopVarInBytes = false;
     gWaveformInDSP = false;
     gHasTeeLocal = false;
     gFastMath = false;
+    gInterpRegisterMode = false;
+    gInterpNativeMode = false;
+    gInterpSpecializeBuffers = 0;
     gFastMathLib = "default";
     
     // Fastmath mapping float version
@@ -408,12 +414,10 @@ global::global():TABBER(1), gLoopDetector(1024, 400), gNextFreeColor(1)
 
     gTimeout = 120;            // time out to abort compiler (in seconds)
     
-    // Globals to transfer results in thread based evaluation
+    // Result of the 'process' evaluation
     gProcessTree = 0;
-    gLsignalsTree = 0;
     gNumInputs = 0;
     gNumOutputs = 0;
-    gErrorMessage = "";
     
     // By default use "cpp" output
     gOutputLang = (getenv("FAUST_DEFAULT_BACKEND")) ? string(getenv("FAUST_DEFAULT_BACKEND")) : "cpp";
@@ -479,13 +483,19 @@ void global::init()
     DEFNAMEPROPERTY = tree(symbol("DEFNAMEPROPERTY"));
     NICKNAMEPROPERTY = tree(symbol("NICKNAMEPROPERTY"));
     BCOMPLEXITY = tree("BCOMPLEXITY");
+    
+    // The most used property keys keep their values in dense slots of the trees
+    CTree::allocateSlot(NUMERICPROPERTY);
+    CTree::allocateSlot(BOXTYPEPROP);
+    CTree::allocateSlot(BCOMPLEXITY);
+    CTree::allocateSlot(ORDERPROP);
+    CTree::allocateSlot(RECURSIVNESS);
     LETRECBODY = boxIdent("RECURSIVEBODY");
     
     PROPAGATEPROPERTY = symbol("PropagateProperty");
     
     // yyfilename is defined in errormsg.cpp but must be redefined at each compilation.
     yyfilename = "";
-    yyin = 0;
     
     gLatexheaderfilename = "latexheader.tex";
     gDocTextsDefaultFile = "mathdoctexts-default.txt";
@@ -626,59 +636,144 @@ Garbageable::Garbageable()
 Garbageable::~Garbageable()
 {}
 
-void Garbageable::cleanup()
+void* GarbageableArena::link(Header* header, uint32_t index)
 {
-    std::list<Garbageable*>::iterator it;
+    header->fClass = index;
+    header->fLive = 1;
+    header->fPrev = 0;
+    header->fNext = fLiveList;
+    if (fLiveList) fLiveList->fPrev = header;
+    fLiveList = header;
+    fLiveCount++;
+    return header + 1;
+}
 
-    // Here removing the deleted pointer from the list is pointless 
-    // and takes time, thus we don't do it.
+void* GarbageableArena::allocate(size_t size)
+{
+    if (size > kMaxSmallSize) {
+        Header* header = (Header*)malloc(sizeof(Header) + size);
+        if (!header) throw std::bad_alloc();
+        return link(header, kLarge);
+    }
     
-    global::gHeapCleanup = true;
-    for (it = global::gObjectTable.begin(); it != global::gObjectTable.end(); it++) {
-	#ifdef _WIN32
-		// Hack : "this" and actual pointer are not the same: destructor cannot be called...
-		Garbageable::operator delete(*it);
-	#else
-		delete(*it);
-  	#endif
+    uint32_t index = uint32_t((size + kGranularity - 1) / kGranularity) - 1;
+    SizeClass& cl = fClasses[index];
+    Header* header;
+    
+    if (cl.fFreeList) {
+        // Recycle a deleted object
+        header = (Header*)cl.fFreeList - 1;
+        cl.fFreeList = *(void**)cl.fFreeList;
+    } else {
+        size_t slot = slotSize(index);
+        if (cl.fCur == cl.fEnd) {
+            // Chunks are an exact multiple of the slot size
+            size_t chunk = (kChunkSize / slot) * slot;
+            char* mem = (char*)malloc(chunk);
+            if (!mem) throw std::bad_alloc();
+            cl.fChunks.push_back(mem);
+            cl.fCur = mem;
+            cl.fEnd = mem + chunk;
+        }
+        header = (Header*)cl.fCur;
+        cl.fCur += slot;
+    }
+    
+    return link(header, index);
+}
+
+void GarbageableArena::release(void* ptr, bool recycle)
+{
+    Header* header = (Header*)ptr - 1;
+    if (!header->fLive) return;
+    header->fLive = 0;
+    fLiveCount--;
+    
+    // When not recycled, the object stays in the list and its memory is freed by cleanup()
+    if (!recycle) return;
+    
+    if (header->fPrev) header->fPrev->fNext = header->fNext; else fLiveList = header->fNext;
+    if (header->fNext) header->fNext->fPrev = header->fPrev;
+    
+    if (header->fClass == kLarge) {
+        free(header);
+    } else {
+        SizeClass& cl = fClasses[header->fClass];
+        *(void**)ptr = cl.fFreeList;
+        cl.fFreeList = ptr;
+    }
+}
+
+static void destroyGarbageable(void* ptr)
+{
+#ifdef _WIN32
+    // Hack : "this" and actual pointer are not the same: destructor cannot be called...
+#else
+    delete static_cast<Garbageable*>(ptr);
+#endif
+}
+
+void GarbageableArena::cleanup()
+{
+    // Objects are destroyed in reverse allocation order (like the previous gObjectTable list),
+    // an object deleted by the destructor of another one is just marked as dead
+    for (Header* header = fLiveList; header; header = header->fNext) {
+        if (header->fLive) {
+            destroyGarbageable(header + 1);
+            release(header + 1, false);
+        }
     }
     
-    global::gObjectTable.clear();
+    // Bulk release : the large objects first, since the list also goes through the chunks
+    Header* header = fLiveList;
+    while (header) {
+        Header* next = header->fNext;
+        if (header->fClass == kLarge) free(header);
+        header = next;
+    }
+    fLiveList = 0;
+    for (size_t index = 0; index < kMaxSmallSize / kGranularity; index++) {
+        SizeClass& cl = fClasses[index];
+        for (size_t c = 0; c < cl.fChunks.size(); c++) {
+            free(cl.fChunks[c]);
+        }
+        cl.fChunks.clear();
+        cl.fCur = cl.fEnd = 0;
+        cl.fFreeList = 0;
+    }
+    fLiveCount = 0;
+}
+
+void Garbageable::cleanup()
+{
+    global::gHeapCleanup = true;
+    global::gObjectArena.cleanup();
+    global::gHeapCleanup = false;
 }
 
 void* Garbageable::operator new(size_t size)
 {
     // HACK : add 16 bytes to avoid unsolved memory smashing bug...
-    Garbageable* res = (Garbageable*)malloc(size + 16);
-  	global::gObjectTable.push_front(res);
-    return res;
+    return global::gObjectArena.allocate(size + 16);
 }
 
 void Garbageable::operator delete(void* ptr)
 {
     // We may have cases when a pointer will be deleted during 
-    // a compilation, thus the pointer has to be removed from the list.
-    if (!global::gHeapCleanup) {
-        global::gObjectTable.remove(static_cast<Garbageable*>(ptr));
-    }
-    free(ptr);
+    // a compilation, thus its slot is recycled for the next allocations.
+    if (ptr) global::gObjectArena.release(ptr, !global::gHeapCleanup);
 }
 
 void* Garbageable::operator new[](size_t size)
 {
     // HACK : add 16 bytes to avoid unsolved memory smashing bug...
-    Garbageable* res = (Garbageable*)malloc(size + 16);
- 	global::gObjectTable.push_front(res);
-    return res;
+    return global::gObjectArena.allocate(size + 16);
 }
 
 void Garbageable::operator delete[](void* ptr)
 {
     // We may have cases when a pointer will be deleted during 
-    // a compilation, thus the pointer has to be removed from the list.
-    if (!global::gHeapCleanup) {
-        global::gObjectTable.remove(static_cast<Garbageable*>(ptr));
-    }
-    free(ptr);
+    // a compilation, thus its slot is recycled for the next allocations.
+    if (ptr) global::gObjectArena.release(ptr, !global::gHeapCleanup);
 }
 
@@ -128,6 +128,7 @@ struct global {
     bool            gUIMacroSwitch;
     bool            gDumpNorm;
     int             gFTZMode;
+    int             gFixedSampleRate;   // Sample rate known at compile time (0 if not fixed)
 
     int             gFloatSize;
 
@@ -149,11 +150,16 @@ struct global {
     bool gComputeIOTA;           // Cache some computation done with IOTA variable
     bool gFAUSTFLOATToInternal;  // FAUSTFLOAT type (= kFloatMacro) forced to internal real
     bool gInPlace;               // Add cache to input for correct in-place computations
+    bool gValueNumbering;        // Value numbering and loop-invariant code motion on the scalar loop
+    bool gApproxReductions;      // Strength reductions that may change the rounding of results
     bool gHasExp10;              // If the 'exp10' math function is available
     bool gLoopVarInBytes;        // If the 'i' variable used in the scalar loop moves by bytes instead of frames
     bool gWaveformInDSP;         // If waveform are allocated in the DSP and not as global data
     bool gHasTeeLocal;           // For wast/wasm backends
     bool gFastMath;              // Faster version of some mathematical functions (pow/exp/log)
+    bool gInterpRegisterMode;    // Interpreter backend executes register code instead of stack code
+    bool gInterpNativeMode;      // Interpreter backend executes native code generated from the register code
+    int gInterpSpecializeBuffers; // Interpreter instances specialize their code for the controls stable during this number of buffers (0 = off)
     string gFastMathLib;         // The fastmath code mapping file
     map <string, string> gFastMathLibTable; // Mapping table for fastmtah functions
     
@@ -490,16 +496,14 @@ struct global {
 
     int gTimeout;   // Time out to abort compiler (in seconds)
     
-    // Globals to transfer results in thread based evaluation
+    // Result of the 'process' evaluation
     Tree gProcessTree;
-    Tree gLsignalsTree;
     int gNumInputs;
     int gNumOutputs;
-    string gErrorMessage;
    
     // GC
-    static list<Garbageable*> gObjectTable;
-    static bool gHeapCleanup;
+    static thread_local GarbageableArena gObjectArena;
+    static thread_local bool gHeapCleanup;
 
     global();
     ~global();
@@ -535,7 +539,7 @@ struct global {
 };
 
 // Unique shared global pointer
-extern global* gGlobal;
+extern thread_local global* gGlobal;
 
 #define FAUST_LIB_PATH "FAUST_LIB_PATH"
 #define MAX_STACK_SIZE 50000
@@ -109,23 +109,24 @@
 
 using namespace std;
 
-extern const char* mathsuffix[4];
-extern const char* numsuffix[4];
-extern const char* floatname[4];
-extern const char* castname[4];
-extern double floatmin[4];
+extern thread_local const char* mathsuffix[4];
+extern thread_local const char* numsuffix[4];
+extern thread_local const char* floatname[4];
+extern thread_local const char* castname[4];
+extern thread_local double floatmin[4];
 
-static ifstream* injcode = NULL;
-static ifstream* enrobage = NULL;
+// Compilation state is thread local, so that several compilations can run concurrently
+static thread_local ifstream* injcode = NULL;
+static thread_local ifstream* enrobage = NULL;
 
 #if OCPP_BUILD
 // Old CPP compiler
-Compiler* old_comp = NULL;
+thread_local Compiler* old_comp = NULL;
 #endif
 
 // FIR container
-InstructionsCompiler* new_comp = NULL;
-CodeContainer* container = NULL;
+thread_local InstructionsCompiler* new_comp = NULL;
+thread_local CodeContainer* container = NULL;
 
 typedef void* (*compile_fun)(void* arg);
 
@@ -133,63 +134,34 @@ string reorganizeCompilationOptions(int argc, const char* argv[]);
 
 std::string generateSHA1(const std::string& dsp_content);
 
-#ifdef _WIN32
-static void callFun(compile_fun fun)
+// The whole compilation runs in a thread with more stack size, and uses the thread local compiler state
+#if defined(_WIN32) || defined(EMCC)
+static void callFun(compile_fun fun, void* arg)
 {
-    fun(NULL);
+    fun(arg);
 }
 #else
-static void callFun(compile_fun fun)
+static void callFun(compile_fun fun, void* arg)
 {
-    if (gGlobal->gOutputLang == "ajs"
-        || startWith(gGlobal->gOutputLang, "wast")
-        || startWith(gGlobal->gOutputLang, "wasm")) {
-        // No thread support in asm.js and wast/wasm
-        fun(NULL);
-    } else {
-        pthread_t thread;
-        pthread_attr_t attr;
-        pthread_attr_init(&attr);
-    #ifndef EMCC
-        pthread_attr_setstacksize(&attr, 524288 * 128);
-    #endif
-        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-        pthread_create(&thread, &attr, fun, NULL);
-        pthread_join(thread, NULL);
-    }
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 524288 * 128);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    pthread_create(&thread, &attr, fun, arg);
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
 }
 #endif
 
-static Tree evaluateBlockDiagram(Tree expandedDefList, int& numInputs, int& numOutputs);
-
-static void* threadEvaluateBlockDiagram(void* arg)
-{
-    try {
-        gGlobal->gProcessTree = evaluateBlockDiagram(gGlobal->gExpandedDefList, gGlobal->gNumInputs, gGlobal->gNumOutputs);
-    } catch (faustexception& e) {
-        gGlobal->gErrorMessage = e.Message();
-    }
-    return 0;
-}
-
-static void* threadBoxPropagateSig(void* arg)
-{
-    try {
-        gGlobal->gLsignalsTree = boxPropagateSig(gGlobal->nil, gGlobal->gProcessTree, makeSigInputList(gGlobal->gNumInputs));
-    } catch (faustexception& e) {
-        gGlobal->gErrorMessage = e.Message();
-    }
-    return 0;
-}
-
 /****************************************************************
  						Global context variable
 *****************************************************************/
 
-global* gGlobal = NULL;
+thread_local global* gGlobal = NULL;
 
 // Timing can be used outside of the scope of 'gGlobal'
-extern bool gTimingSwitch;
+extern thread_local bool gTimingSwitch;
 
 /****************************************************************
  						Parser variables
@@ -451,11 +423,46 @@ static bool processCmdline(int argc, const char* argv[])
             }
             i += 2;
 
+        } else if (isCmd(argv[i], "-sr", "--sample-rate")) {
+            gGlobal->gFixedSampleRate = atoi(argv[i+1]);
+            if (gGlobal->gFixedSampleRate <= 0) {
+                stringstream error;
+                error << "ERROR : invalid -sr option: " << argv[i+1] << endl;
+                throw faustexception(error.str());
+            }
+            i += 2;
+
+        } else if (isCmd(argv[i], "-vn", "--value-numbering")) {
+            gGlobal->gValueNumbering = true;
+            i += 1;
+
+        } else if (isCmd(argv[i], "-ar", "--approximate-reductions")) {
+            gGlobal->gApproxReductions = true;
+            i += 1;
+
         } else if (isCmd(argv[i], "-fm", "--fast-math")) {
             gGlobal->gFastMath = true;
             gGlobal->gFastMathLib = argv[i+1];
             i += 2;
 
+        } else if (isCmd(argv[i], "-reg", "--register-mode")) {
+            gGlobal->gInterpRegisterMode = true;
+            i += 1;
+
+        } else if (isCmd(argv[i], "-nc", "--native-code")) {
+            gGlobal->gInterpRegisterMode = true;
+            gGlobal->gInterpNativeMode = true;
+            i += 1;
+
+        } else if (isCmd(argv[i], "-cs", "--control-specialization") && (i+1 < argc)) {
+            gGlobal->gInterpSpecializeBuffers = atoi(argv[i+1]);
+            if (gGlobal->gInterpSpecializeBuffers < 0) {
+                stringstream error;
+                error << "ERROR : invalid -cs option: " << gGlobal->gInterpSpecializeBuffers << endl;
+                throw faustexception(error.str());
+            }
+            i += 2;
+
         } else if (isCmd(argv[i], "-I", "--import-dir") && (i+1 < argc)) {
             if ((strstr(argv[i+1], "http://") != 0) || (strstr(argv[i+1], "https://") != 0)) {
                 gGlobal->gImportDirList.push_back(argv[i+1]);
@@ -570,6 +577,12 @@ static bool processCmdline(int argc, const char* argv[])
         throw faustexception(error.str());
     }
 
+    if ((gGlobal->gVecLoopSize & (gGlobal->gVecLoopSize - 1)) != 0) {
+        stringstream error;
+        error << "ERROR : invalid vector loop size [-vls = "<< gGlobal->gVecLoopSize << "] has to be a power of 2" << endl;
+        throw faustexception(error.str());
+    }
+
     if (gGlobal->gFastMath) {
         if (!(gGlobal->gOutputLang == "c"
             || gGlobal->gOutputLang == "cpp"
@@ -642,7 +655,7 @@ static void printHelp()
     cout << "-o <file> \tC, C++, JAVA, JavaScript, ASM JavaScript, WebAssembly, LLVM IR or FVM (interpreter) output file\n";
     cout << "-scal   \t--scalar generate non-vectorized code\n";
     cout << "-vec    \t--vectorize generate easier to vectorize code\n";
-    cout << "-vls <n>  \t--vec-loop-size size of the vector DSP loop for auto-vectorization (experimental) \n";
+    cout << "-vls <n>  \t--vec-loop-size size of the vector DSP loop for auto-vectorization (experimental, a power of 2, default is the SIMD width of the host in LLVM) \n";
     cout << "-vs <n> \t--vec-size <n> size of the vector (default 32 samples)\n";
     cout << "-lv <n> \t--loop-variant [0:fastest (default), 1:simple] \n";
     cout << "-omp    \t--openMP generate OpenMP pragmas, activates --vectorize option\n";
@@ -669,7 +682,13 @@ static void printHelp()
     cout << "-inpl    \t--in-place generates code working when input and output buffers are the same (in scalar mode only) \n";
     cout << "-inj <f> \t--inject source file <f> into architecture file instead of compile a dsp file\n";
     cout << "-ftz     \t--flush-to-zero code added to recursive signals [0:no (default), 1:fabs based, 2:mask based (fastest)]\n";
+    cout << "-sr <n>  \t--sample-rate <n> compiles for the fixed sample rate <n> : the sample rate dependent constants are computed at compile time, and the instances always run at this rate\n";
+    cout << "-vn      \t--value-numbering computes the common and loop-invariant expressions of the DSP loop only once (in scalar mode only)\n";
+    cout << "-ar      \t--approximate-reductions allows the strength reductions of math primitives that may change the rounding of results (real powers into multiplications, pow(x,0.5) into sqrt(x))\n";
     cout << "-fm <file> \t--fast-math <file> uses optimized versions of mathematical functions implemented in <file>, takes the '/faust/dsp/fastmath.cpp' file if 'def' is used\n";
+    cout << "-reg     \t--register-mode interpreter factories execute register based code instead of stack based code (ignored by other backends)\n";
+    cout << "-nc      \t--native-code interpreter factories execute x86-64 machine code generated from the register code, implies -reg (x86-64 Linux only, ignored by other backends)\n";
+    cout << "-cs <n>  \t--control-specialization <n> interpreter instances specialize their stack code for the controls that are stable during <n> buffers, and go back to the generic code when they change (the code is compiled in 'compute', ignored by other backends)\n";
     cout << "\nexample :\n";
     cout << "---------\n";
 
@@ -1480,10 +1499,7 @@ static string expandDspInternal(int argc, const char* argv[], const char* name,
      3 - evaluate 'process' definition
     *****************************************************************/
 
-    callFun(threadEvaluateBlockDiagram); // In a thread with more stack size...
-    if (!gGlobal->gProcessTree) {
-        throw faustexception(gGlobal->gErrorMessage);
-    }
+    gGlobal->gProcessTree = evaluateBlockDiagram(gGlobal->gExpandedDefList, gGlobal->gNumInputs, gGlobal->gNumOutputs);
     stringstream out;
 
     // Encode compilation options as a 'declare' : has to be located first in the string
@@ -1553,10 +1569,7 @@ static void compileFaustInternal(int argc, const char* argv[], const char* name,
      3 - evaluate 'process' definition
     *****************************************************************/
 
-    callFun(threadEvaluateBlockDiagram); // In a thread with more stack size...
-    if (!gGlobal->gProcessTree) {
-        throw faustexception(gGlobal->gErrorMessage);
-    }
+    gGlobal->gProcessTree = evaluateBlockDiagram(gGlobal->gExpandedDefList, gGlobal->gNumInputs, gGlobal->gNumOutputs);
     Tree process = gGlobal->gProcessTree;
     int numInputs = gGlobal->gNumInputs;
     int numOutputs = gGlobal->gNumOutputs;
@@ -1584,11 +1597,7 @@ static void compileFaustInternal(int argc, const char* argv[], const char* name,
     *****************************************************************/
     startTiming("propagation");
 
-    callFun(threadBoxPropagateSig); // In a thread with more stack size...
-    if (!gGlobal->gLsignalsTree) {
-        throw faustexception(gGlobal->gErrorMessage);
-    }
-    Tree lsignals = gGlobal->gLsignalsTree;
+    Tree lsignals = boxPropagateSig(gGlobal->nil, gGlobal->gProcessTree, makeSigInputList(gGlobal->gNumInputs));
 
     if (gGlobal->gDetailsSwitch) { cout << "output signals are : " << endl; printSignal(lsignals, stdout); cout << "\n\n"; }
 
@@ -1598,6 +1607,10 @@ static void compileFaustInternal(int argc, const char* argv[], const char* name,
     5 - preparation of the signal tree and translate output signals
     **************************************************************************/
     generateCode(lsignals, numInputs, numOutputs, generate);
+    
+    if (gTimingSwitch) {
+        CTree::printStats(cerr);
+    }
 
     /****************************************************************
      6 - generate xml description, documentation or dot files
@@ -1607,39 +1620,73 @@ static void compileFaustInternal(int argc, const char* argv[], const char* name,
 
 // Backend API
 
-dsp_factory_base* compileFaustFactory(int argc, const char* argv[], const char* name, const char* dsp_content, string& error_msg, bool generate)
+// Arguments and results of a compilation, exchanged with the compilation thread
+struct CompilationArgs {
+    int fArgc;
+    const char** fArgv;
+    const char* fName;
+    const char* fDSPContent;
+    bool fGenerate;
+    dsp_factory_base* fFactory;
+    string fExpandedDSP;
+    string fSHAKey;
+    string fErrorMsg;
+    
+    CompilationArgs(int argc, const char* argv[], const char* name, const char* dsp_content, bool generate)
+        :fArgc(argc), fArgv(argv), fName(name), fDSPContent(dsp_content), fGenerate(generate), fFactory(NULL)
+    {}
+};
+
+static void* threadCompileFaustFactory(void* arg)
 {
+    CompilationArgs* args = static_cast<CompilationArgs*>(arg);
     gGlobal = NULL;
-    dsp_factory_base* factory = NULL;
 
     try {
         global::allocate();
-        compileFaustInternal(argc, argv, name, dsp_content, generate);
-        error_msg = gGlobal->gErrorMsg;
-        factory = gGlobal->gDSPFactory;
+        compileFaustInternal(args->fArgc, args->fArgv, args->fName, args->fDSPContent, args->fGenerate);
+        args->fErrorMsg = gGlobal->gErrorMsg;
+        args->fFactory = gGlobal->gDSPFactory;
     } catch (faustexception& e) {
-        error_msg = e.Message();
+        args->fErrorMsg = e.Message();
     }
 
     global::destroy();
-    return factory;
+    return 0;
 }
 
-string expandDsp(int argc, const char* argv[], const char* name, const char* dsp_content, string& sha_key, string& error_msg)
+static void* threadExpandDsp(void* arg)
 {
+    CompilationArgs* args = static_cast<CompilationArgs*>(arg);
     gGlobal = NULL;
-    string res = "";
 
     try {
         global::allocate();
-        res = expandDspInternal(argc, argv, name, dsp_content);
-        sha_key = generateSHA1(res);
-        error_msg = gGlobal->gErrorMsg;
+        args->fExpandedDSP = expandDspInternal(args->fArgc, args->fArgv, args->fName, args->fDSPContent);
+        args->fSHAKey = generateSHA1(args->fExpandedDSP);
+        args->fErrorMsg = gGlobal->gErrorMsg;
     } catch (faustexception& e) {
-        error_msg = e.Message();
+        args->fErrorMsg = e.Message();
     }
 
     global::destroy();
-    return res;
+    return 0;
+}
+
+dsp_factory_base* compileFaustFactory(int argc, const char* argv[], const char* name, const char* dsp_content, string& error_msg, bool generate)
+{
+    CompilationArgs args(argc, argv, name, dsp_content, generate);
+    callFun(threadCompileFaustFactory, &args);
+    error_msg = args.fErrorMsg;
+    return args.fFactory;
+}
+
+string expandDsp(int argc, const char* argv[], const char* name, const char* dsp_content, string& sha_key, string& error_msg)
+{
+    CompilationArgs args(argc, argv, name, dsp_content, false);
+    callFun(threadExpandDsp, &args);
+    sha_key = args.fSHAKey;
+    error_msg = args.fErrorMsg;
+    return args.fExpandedDSP;
 }
 
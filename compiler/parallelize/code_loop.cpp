@@ -87,6 +87,21 @@ struct VectorCloneVisitor : public BasicCloneVisitor {
     }
     */
 
+    // Scalar variables local to the loop body become vectors
+    virtual StatementInst* visit(DeclareVarInst* inst)
+    {
+        BasicTyped* basic_typed = dynamic_cast<BasicTyped*>(inst->fType);
+
+        if (basic_typed && inst->fAddress->getAccess() == Address::kStack) {
+            BasicCloneVisitor cloner;
+            return new DeclareVarInst(inst->fAddress->clone(&cloner),
+                                      new VectorTyped(dynamic_cast<BasicTyped*>(basic_typed->clone(&cloner)), fSize),
+                                      ((inst->fValue) ? inst->fValue->clone(this) : NULL));
+        } else {
+            return BasicCloneVisitor::visit(inst);
+        }
+    }
+
     virtual ValueInst* visit(LoadVarInst* inst)
     {
         if (inst->fAddress->getAccess() != Address::kLoop) {
@@ -170,12 +185,91 @@ struct VectorCloneVisitor : public BasicCloneVisitor {
 
 };
 
+/*
+ A loop body can be cloned by VectorCloneVisitor when:
+ - arrays are only accessed at the loop index, so that N consecutive samples are N consecutive elements
+ - the loop index is not used as a value
+ - only arrays and variables local to the body are written
+ - there is no control flow and no instruction that VectorCloneVisitor keeps scalar
+*/
+struct VectorizableLoopChecker : public DispatchVisitor {
+
+    string fLoopIndex;
+    set<string> fLocals;
+    bool fVectorizable;
+
+    VectorizableLoopChecker(const string& index):fLoopIndex(index), fVectorizable(true)
+    {}
+
+    bool isLoopIndex(ValueInst* inst)
+    {
+        LoadVarInst* load = dynamic_cast<LoadVarInst*>(inst);
+        return load
+            && dynamic_cast<NamedAddress*>(load->fAddress)
+            && load->fAddress->getAccess() == Address::kLoop
+            && load->fAddress->getName() == fLoopIndex;
+    }
+
+    void checkAddress(Address* address)
+    {
+        IndexedAddress* indexed = dynamic_cast<IndexedAddress*>(address);
+        if (indexed) {
+            // Index is kept scalar, and is not visited
+            fVectorizable &= dynamic_cast<NamedAddress*>(indexed->fAddress) && isLoopIndex(indexed->fIndex);
+        } else {
+            fVectorizable &= (address->getAccess() != Address::kLoop);
+        }
+    }
+
+    virtual void visit(DeclareVarInst* inst)
+    {
+        fVectorizable &= (dynamic_cast<BasicTyped*>(inst->fType) && inst->fAddress->getAccess() == Address::kStack);
+        fLocals.insert(inst->fAddress->getName());
+        DispatchVisitor::visit(inst);
+    }
+
+    virtual void visit(LoadVarInst* inst) { checkAddress(inst->fAddress); }
+
+    virtual void visit(StoreVarInst* inst)
+    {
+        if (dynamic_cast<NamedAddress*>(inst->fAddress)) {
+            fVectorizable &= (fLocals.find(inst->fAddress->getName()) != fLocals.end());
+        } else {
+            checkAddress(inst->fAddress);
+        }
+        inst->fValue->accept(this);
+    }
+
+    virtual void visit(LoadVarAddressInst* inst) { fVectorizable = false; }
+    virtual void visit(TeeVarInst* inst) { fVectorizable = false; }
+    virtual void visit(ShiftArrayVarInst* inst) { fVectorizable = false; }
+    virtual void visit(Int64NumInst* inst) { fVectorizable = false; }
+    virtual void visit(FloatArrayNumInst* inst) { fVectorizable = false; }
+    virtual void visit(Int32ArrayNumInst* inst) { fVectorizable = false; }
+    virtual void visit(DoubleArrayNumInst* inst) { fVectorizable = false; }
+    virtual void visit(BitcastInst* inst) { fVectorizable = false; }
+    virtual void visit(RetInst* inst) { fVectorizable = false; }
+    virtual void visit(DropInst* inst) { fVectorizable = false; }
+    virtual void visit(IfInst* inst) { fVectorizable = false; }
+    virtual void visit(ForLoopInst* inst) { fVectorizable = false; }
+    virtual void visit(WhileLoopInst* inst) { fVectorizable = false; }
+    virtual void visit(SwitchInst* inst) { fVectorizable = false; }
+
+    virtual void visit(FunCallInst* inst)
+    {
+        // Vectorized by VectorCloneVisitor only with (vectorized) arguments
+        fVectorizable &= (inst->fArgs.size() > 0);
+        DispatchVisitor::visit(inst);
+    }
+
+};
+
 void CodeLoop::generateDAGVectorLoop(BlockInst* block, DeclareVarInst* count, bool omp, int size)
 {
-    // TODO
     // 1) Vectorize access to all scalar that are not "kLoop" type: declare a Vector version of them, then transform Load/Store access.
     // 2) Vectorize access to all constant numbers (Load)
     // 3) Vectorize all array access (Load/Store)
+    // The 'count % size' remaining samples are computed by a scalar loop, and loops that cannot be vectorized stay scalar.
 
     // Generate code for extra loops
     for (list<CodeLoop*>::const_iterator s = fExtraLoops.begin(); s != fExtraLoops.end(); s++) {
@@ -194,23 +288,48 @@ void CodeLoop::generateDAGVectorLoop(BlockInst* block, DeclareVarInst* count, bo
     // Generate loop code
     if (fComputeInst->fCode.size() > 0) {
 
-        DeclareVarInst* loop_decl = InstBuilder::genDecLoopVar(fLoopIndex, InstBuilder::genBasicTyped(Typed::kInt32), InstBuilder::genInt32NumInst(0));
-        ValueInst* loop_end = InstBuilder::genLessThan(loop_decl->load(), count->load());
-        StoreVarInst* loop_increment = loop_decl->store(InstBuilder::genAdd(loop_decl->load(), size));
+        VectorizableLoopChecker checker(fLoopIndex);
+        fComputeInst->accept(&checker);
 
-        VectorCloneVisitor vector_cloner(size);
-        BlockInst* cloned = dynamic_cast<BlockInst*>(fComputeInst->clone(&vector_cloner));
+        if (!checker.fVectorizable) {
+            generateDAGScalarLoopCompute(block, count, omp);
+        } else {
 
-        block->pushBackInst(InstBuilder::genLabelInst("/* Compute code */"));
-        if (omp) {
-            block->pushBackInst(InstBuilder::genLabelInst("#pragma omp for"));
-        }
+            // Vector loop on the first 'count & -size' samples (size is a power of 2)
+            DeclareVarInst* loop_decl = InstBuilder::genDecLoopVar(fLoopIndex, InstBuilder::genBasicTyped(Typed::kInt32), InstBuilder::genInt32NumInst(0));
+            ValueInst* loop_end = InstBuilder::genLessThan(loop_decl->load(), InstBuilder::genAnd(count->load(), InstBuilder::genInt32NumInst(-size)));
+            StoreVarInst* loop_increment = loop_decl->store(InstBuilder::genAdd(loop_decl->load(), size));
 
-        BlockInst* block1 = InstBuilder::genBlockInst();
-        pushBlock(cloned, block1);
+            VectorCloneVisitor vector_cloner(size);
+            BlockInst* cloned = dynamic_cast<BlockInst*>(fComputeInst->clone(&vector_cloner));
 
-        ForLoopInst* loop = InstBuilder::genForLoopInst(loop_decl, loop_end, loop_increment, block1);
-        block->pushBackInst(loop);
+            block->pushBackInst(InstBuilder::genLabelInst("/* Compute code */"));
+            if (omp) {
+                block->pushBackInst(InstBuilder::genLabelInst("#pragma omp for"));
+            }
+
+            BlockInst* block1 = InstBuilder::genBlockInst();
+            pushBlock(cloned, block1);
+
+            ForLoopInst* loop = InstBuilder::genForLoopInst(loop_decl, loop_end, loop_increment, block1);
+            block->pushBackInst(loop);
+
+            // Scalar loop on the remaining samples
+            DeclareVarInst* loop_decl2 = InstBuilder::genDecLoopVar(fLoopIndex, InstBuilder::genBasicTyped(Typed::kInt32),
+                                                                    InstBuilder::genAnd(count->load(), InstBuilder::genInt32NumInst(-size)));
+            ValueInst* loop_end2 = InstBuilder::genLessThan(loop_decl2->load(), count->load());
+            StoreVarInst* loop_increment2 = loop_decl2->store(InstBuilder::genAdd(loop_decl2->load(), 1));
+
+            BasicCloneVisitor cloner;
+            BlockInst* block2 = InstBuilder::genBlockInst();
+            pushBlock(dynamic_cast<BlockInst*>(fComputeInst->clone(&cloner)), block2);
+
+            block->pushBackInst(InstBuilder::genLabelInst("/* Remaining samples */"));
+            if (omp) {
+                block->pushBackInst(InstBuilder::genLabelInst("#pragma omp single"));
+            }
+            block->pushBackInst(InstBuilder::genForLoopInst(loop_decl2, loop_end2, loop_increment2, block2));
+        }
     }
 
     // Generate code after the loop
@@ -223,6 +342,24 @@ void CodeLoop::generateDAGVectorLoop(BlockInst* block, DeclareVarInst* count, bo
     }
 }
 
+void CodeLoop::generateDAGScalarLoopCompute(BlockInst* block, DeclareVarInst* count, bool omp)
+{
+    DeclareVarInst* loop_decl = InstBuilder::genDecLoopVar(fLoopIndex, InstBuilder::genBasicTyped(Typed::kInt32), InstBuilder::genInt32NumInst(0));
+    ValueInst* loop_end = InstBuilder::genLessThan(loop_decl->load(), count->load());
+    StoreVarInst* loop_increment = loop_decl->store(InstBuilder::genAdd(loop_decl->load(), 1));
+
+    block->pushBackInst(InstBuilder::genLabelInst("/* Compute code */"));
+    if (omp) {
+        block->pushBackInst(InstBuilder::genLabelInst("#pragma omp for"));
+    }
+
+    BlockInst* block1 = InstBuilder::genBlockInst();
+    pushBlock(fComputeInst, block1);
+
+    ForLoopInst* loop = InstBuilder::genForLoopInst(loop_decl, loop_end, loop_increment, block1);
+    block->pushBackInst(loop);
+}
+
 void CodeLoop::generateDAGScalarLoop(BlockInst* block, DeclareVarInst* count, bool omp)
 {
     // Generate code for extra loops
@@ -241,21 +378,7 @@ void CodeLoop::generateDAGScalarLoop(BlockInst* block, DeclareVarInst* count, bo
 
     // Generate loop code
     if (fComputeInst->fCode.size() > 0) {
-
-        DeclareVarInst* loop_decl = InstBuilder::genDecLoopVar(fLoopIndex, InstBuilder::genBasicTyped(Typed::kInt32), InstBuilder::genInt32NumInst(0));
-        ValueInst* loop_end = InstBuilder::genLessThan(loop_decl->load(), count->load());
-        StoreVarInst* loop_increment = loop_decl->store(InstBuilder::genAdd(loop_decl->load(), 1));
-
-        block->pushBackInst(InstBuilder::genLabelInst("/* Compute code */"));
-        if (omp) {
-            block->pushBackInst(InstBuilder::genLabelInst("#pragma omp for"));
-        }
-
-        BlockInst* block1 = InstBuilder::genBlockInst();
-        pushBlock(fComputeInst, block1);
-
-        ForLoopInst* loop = InstBuilder::genForLoopInst(loop_decl, loop_end, loop_increment, block1);
-        block->pushBackInst(loop);
+        generateDAGScalarLoopCompute(block, count, omp);
     }
 
     // Generate code after the loop
@@ -101,6 +101,8 @@ class CodeLoop : public virtual Garbageable {
             }
         }
 
+        void generateDAGScalarLoopCompute(BlockInst* block, DeclareVarInst* count, bool omp);
+
         bool isEmpty();                 ///< true when the loop doesn't contain any line of code
 
         void absorb(CodeLoop* l);       ///< absorb a loop inside this one
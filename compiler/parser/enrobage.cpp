@@ -213,23 +213,17 @@ void streamCopyUntilEnd(istream& src, ostream& dst)
 #define TRY_OPEN(filename)                      \
     ifstream* f = new ifstream();               \
     f->open(filename, ifstream::in);            \
-    err = chdir(old);                           \
     if (f->is_open()) return f; else delete f;  \
 
 /**
  * Try to open an architecture file searching in various directories
+ * (the current directory is shared by concurrent compilations, so it is not changed)
  */
 ifstream* openArchStream(const char* filename)
 {
-    char	buffer[FAUST_PATH_MAX];
-    char*	old = getcwd(buffer, FAUST_PATH_MAX);
-    int		err;
-    
     TRY_OPEN(filename);
     for (string dirname : gGlobal->gArchitectureDirList) {
-        if ((err = chdir(dirname.c_str()))==0) {
-            TRY_OPEN(filename);
-        }
+        TRY_OPEN((dirname + '/' + filename).c_str());
     }
     
     return 0;
@@ -294,44 +288,20 @@ bool checkURL(const char* filename)
 
 /**
  * Try to open the file '<dir>/<filename>'. If it succeed, it stores the full pathname
- * of the file into <fullpath>
+ * of the file into <fullpath> (the current directory is shared by concurrent compilations, so it is not changed)
  */
 static FILE* fopenAt(string& fullpath, const char* dir, const char* filename)
 {
-    int err;
-    char olddirbuffer[FAUST_PATH_MAX];
-    char newdirbuffer[FAUST_PATH_MAX];
-
-    char* olddir = getcwd(olddirbuffer, FAUST_PATH_MAX);
-
-    if (chdir(dir) == 0) {
-        FILE* f = fopen(filename, "r");
-        char* newdir = getcwd(newdirbuffer, FAUST_PATH_MAX);
-        if (!newdir) {
-            fclose(f);
-            stringstream error;
-            error << "ERROR : getcwd '" << strerror(errno) << endl;
-            throw faustexception(error.str());
-        }
-        fullpath = newdir;
+    string path = string(dir) + '/' + filename;
+    FILE* f = fopen(path.c_str(), "r");
+    if (f) {
+        char temp[PATH_MAX+1];
+        char* newdir = realpath(dir, temp);
+        fullpath = (newdir) ? newdir : dir;
         fullpath += '/';
         fullpath += filename;
-        err = chdir(olddir);
-        if (err != 0) {
-            fclose(f);
-            stringstream error;
-            error << "ERROR : cannot change back directory to '" << olddir << "' : " << strerror(errno) << endl;
-            throw faustexception(error.str());
-        }
-        return f;
     }
-    err = chdir(olddir);
-    if (err != 0) {
-        stringstream error;
-        error << "ERROR : cannot change back directory to '" << olddir << "' : " << strerror(errno) << endl;
-        throw faustexception(error.str());
-    }
-    return 0;
+    return f;
 }
 
 /**
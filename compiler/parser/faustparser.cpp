@@ -349,7 +349,7 @@
 using namespace std;
 
 extern char* 		yytext;
-extern const char* 	yyfilename;
+extern thread_local const char* 	yyfilename;
 extern int 			yylineno;
 extern int 			yyerr;
 
@@ -29,6 +29,8 @@
 #include <map>
 #include <list>
 #include <string>
+#include <string.h>
+#include <sys/stat.h>
 #ifndef _WIN32
 #include <unistd.h>
 #endif
@@ -43,8 +45,10 @@
 #include "enrobage.hh"
 #include "ppbox.hh"
 #include "exception.hh"
+#include "errormsg.hh"
 #include "global.hh"
 #include "Text.hh"
+#include "TMutex.h"
 
 using namespace std;
 
@@ -61,7 +65,185 @@ extern int yyerr;
 extern int yydebug;
 extern FILE* yyin;
 extern int yylineno;
-extern const char* yyfilename;
+extern thread_local const char* yyfilename;
+
+std::string generateSHA1(const std::string& dsp_content);
+
+// The flex/bison parser state is global : concurrent compilations are serialized while parsing
+static TLockAble gParserLock;
+
+/****************************************************************
+ Cache of the parsed files, kept between compilations
+ *****************************************************************/
+
+/*
+ Trees only live during a compilation : the trees made by the parser for a local file are kept as a flat list
+ of nodes (branches first, in the order the parser made them, so that the compilation output does not depend
+ on the cache), and made again by the next compilations importing the file as long as its content has the same
+ SHA1 key, instead of lexing and parsing it again. The cache is accessed with gParserLock held.
+*/
+
+struct ParsedNode {
+    int fType;
+    int fArity;
+    int fFirst;             ///< index of the first branch in ParsedFile::fBranches
+    union {
+        int     i;
+        double  f;
+        void*   p;
+        int     s;          ///< index of the symbol name in ParsedFile::fSymbols
+    } fData;
+};
+
+struct ParsedFile {
+    string                  fSHAKey;            ///< SHA1 key of the file content
+    vector<ParsedNode>      fNodes;
+    vector<int>             fBranches;
+    vector<string>          fSymbols;
+    int                     fFileSymbol;        ///< index of the file name in fSymbols, or -1
+    int                     fResult;
+    vector<pair<int, int> > fMetadata;  ///< (key, value) of the 'declare' statements
+    vector<pair<int, int> > fDefLines;  ///< (definition name, line)
+    vector<pair<int, int> > fUseLines;  ///< (identifier, line)
+};
+
+static map<string, ParsedFile> gParsedFiles;
+
+// Side effects of the file being parsed, kept to be replayed with the cached definitions
+static vector<pair<Tree, Tree> > gParsedMetadata;
+static bool gParsedDoc = false;
+
+// Reads the content of the file, and goes back to its beginning to parse it
+static bool readFile(FILE* file, string& content)
+{
+    struct stat infos;
+    if (fstat(fileno(file), &infos) == 0) content.reserve(infos.st_size);
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, size);
+    }
+    bool res = !ferror(file);
+    rewind(file);
+    return res;
+}
+
+static int flattenTree(Tree t, ParsedFile& file, map<Tree, int>& nodes, map<Sym, int>& symbols)
+{
+    map<Tree, int>::iterator it = nodes.find(t);
+    if (it != nodes.end()) return it->second;
+    
+    vector<int> branches;
+    for (int i = 0; i < t->arity(); i++) {
+        branches.push_back(flattenTree(t->branch(i), file, nodes, symbols));
+    }
+    
+    const Node& n = t->node();
+    ParsedNode node;
+    node.fType = n.type();
+    node.fArity = t->arity();
+    node.fFirst = int(file.fBranches.size());
+    file.fBranches.insert(file.fBranches.end(), branches.begin(), branches.end());
+    
+    switch (n.type()) {
+        case kIntNode:
+            node.fData.i = n.getInt();
+            break;
+        case kDoubleNode:
+            node.fData.f = n.getDouble();
+            break;
+        case kSymNode: {
+            map<Sym, int>::iterator sym = symbols.find(n.getSym());
+            if (sym == symbols.end()) {
+                sym = symbols.insert(make_pair(n.getSym(), int(file.fSymbols.size()))).first;
+                if (strcmp(name(n.getSym()), yyfilename) == 0) {
+                    file.fFileSymbol = int(file.fSymbols.size());
+                }
+                file.fSymbols.push_back(name(n.getSym()));
+            }
+            node.fData.s = sym->second;
+            break;
+        }
+        default:
+            // Pointers to primitive functions, that are the same for all compilations
+            node.fData.p = n.getPointer();
+            break;
+    }
+    
+    int index = int(file.fNodes.size());
+    file.fNodes.push_back(node);
+    nodes[t] = index;
+    
+    // Lines set by this file, the tree may also be used by previously parsed files
+    if (getDefLineProp(t) >= 0 && strcmp(getDefFileProp(t), yyfilename) == 0) {
+        file.fDefLines.push_back(make_pair(index, getDefLineProp(t)));
+    }
+    if (getUseLineProp(t) >= 0 && strcmp(getUseFileProp(t), yyfilename) == 0) {
+        file.fUseLines.push_back(make_pair(index, getUseLineProp(t)));
+    }
+    return index;
+}
+
+static void flattenFile(Tree res, const vector<Tree>& made, ParsedFile& file)
+{
+    map<Tree, int> nodes;
+    map<Sym, int> symbols;
+    file.fFileSymbol = -1;
+    for (size_t i = 0; i < made.size(); i++) {
+        flattenTree(made[i], file, nodes, symbols);
+    }
+    file.fResult = flattenTree(res, file, nodes, symbols);
+    for (size_t i = 0; i < gParsedMetadata.size(); i++) {
+        file.fMetadata.push_back(make_pair(flattenTree(gParsedMetadata[i].first, file, nodes, symbols),
+                                           flattenTree(gParsedMetadata[i].second, file, nodes, symbols)));
+    }
+}
+
+static Tree rebuildFile(const ParsedFile& file)
+{
+    // Symbols are made when first needed, like in the parser
+    vector<Sym> symbols(file.fSymbols.size(), (Sym)0);
+    
+    vector<Tree> trees(file.fNodes.size());
+    tvec branches;
+    for (size_t i = 0; i < file.fNodes.size(); i++) {
+        const ParsedNode& node = file.fNodes[i];
+        branches.clear();
+        for (int j = 0; j < node.fArity; j++) {
+            branches.push_back(trees[file.fBranches[node.fFirst + j]]);
+        }
+        switch (node.fType) {
+            case kIntNode:
+                trees[i] = CTree::make(Node(node.fData.i), branches);
+                break;
+            case kDoubleNode:
+                trees[i] = CTree::make(Node(node.fData.f), branches);
+                break;
+            case kSymNode: {
+                Sym& sym = symbols[node.fData.s];
+                if (!sym) {
+                    sym = (node.fData.s == file.fFileSymbol) ? symbol(yyfilename) : symbol(file.fSymbols[node.fData.s]);
+                }
+                trees[i] = CTree::make(Node(sym), branches);
+                break;
+            }
+            default:
+                trees[i] = CTree::make(Node(node.fData.p), branches);
+                break;
+        }
+    }
+    
+    for (size_t i = 0; i < file.fDefLines.size(); i++) {
+        setDefProp(trees[file.fDefLines[i].first], yyfilename, file.fDefLines[i].second);
+    }
+    for (size_t i = 0; i < file.fUseLines.size(); i++) {
+        setUseProp(trees[file.fUseLines[i].first], yyfilename, file.fUseLines[i].second);
+    }
+    for (size_t i = 0; i < file.fMetadata.size(); i++) {
+        declareMetadata(trees[file.fMetadata[i].first], trees[file.fMetadata[i].second]);
+    }
+    return trees[file.fResult];
+}
 
 /**
  * Checks an argument list for containing only 
@@ -249,6 +431,7 @@ void SourceReader::checkName()
 
 Tree SourceReader::parseFile(const char* fname)
 {
+    TLock lock(&gParserLock);
     yyerr = 0;
     yylineno = 1;
     yyfilename = fname;
@@ -322,8 +505,40 @@ Tree SourceReader::parseFile(const char* fname)
             error << "ERROR : unable to open file " << yyfilename << endl;
             throw faustexception(error.str());
         }
-        Tree res = parseLocal(fullpath.c_str());
+        
+        // Definitions parsed by a previous compilation, if the file content is the same
+        // (a modification time may not change when the file is rewritten)
+        string content, sha_key;
+        bool cacheable = readFile(tmp_file, content);
+        if (cacheable) sha_key = generateSHA1(content);
+        map<string, ParsedFile>::iterator it = gParsedFiles.find(fullpath);
+        if (cacheable && it != gParsedFiles.end() && it->second.fSHAKey == sha_key) {
+            fclose(tmp_file);
+            Tree res = rebuildFile(it->second);
+            checkName();
+            fFilePathnames.push_back(fullpath);
+            return res;
+        }
+        
+        vector<Tree> made;
+        CTree::recordMadeTrees(cacheable ? &made : 0);
+        Tree res;
+        try {
+            res = parseLocal(fullpath.c_str());
+        } catch (...) {
+            CTree::recordMadeTrees(0);
+            throw;
+        }
+        CTree::recordMadeTrees(0);
         fclose(tmp_file);
+        
+        // Documentation is only kept in the compilation that parses it
+        if (cacheable && !gParsedDoc) {
+            ParsedFile& file = gParsedFiles[fullpath];
+            file = ParsedFile();
+            file.fSHAKey = sha_key;
+            flattenFile(res, made, file);
+        }
         return res;
     #endif
     }
@@ -331,6 +546,7 @@ Tree SourceReader::parseFile(const char* fname)
 
 Tree SourceReader::parseString(const char* fname)
 {
+    TLock lock(&gParserLock);
     yyerr = 0;
     yylineno = 1;
     yyfilename = fname;
@@ -344,6 +560,9 @@ Tree SourceReader::parseString(const char* fname)
 
 Tree SourceReader::parseLocal(const char* fname)
 {
+    gParsedMetadata.clear();
+    gParsedDoc = false;
+    
     int r = yyparse();
     stringstream error;
 
@@ -447,6 +666,7 @@ Tree SourceReader::expandRec(Tree ldef, set<string>& visited, Tree lresult)
 
 void declareMetadata(Tree key, Tree value)
 {
+    gParsedMetadata.push_back(make_pair(key, value));
     if (gGlobal->gMasterDocument == yyfilename) {
         // Inside master document, no prefix needed to declare metadata
         gGlobal->gMetaDataSet[key].insert(value);
@@ -462,5 +682,6 @@ void declareMetadata(Tree key, Tree value)
 
 void declareDoc(Tree t)
 {
+    gParsedDoc = true;
 	gGlobal->gDocVector.push_back(t);
 }
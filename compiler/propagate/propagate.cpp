@@ -286,6 +286,10 @@ siglist realPropagate (Tree slotenv, Tree path, Tree box, const siglist&  lsig)
 
     else if (isBoxFConst(box, type, name, file))    { 
         faustassert(lsig.size()==0); 
+        // A fixed sample rate is a number, so that the signals depending on it are computed at compile time
+        if (gGlobal->gFixedSampleRate > 0 && strcmp(tree2str(name), "fSamplingFreq") == 0) {
+            return makeList((tree2int(type) == kInt) ? sigInt(gGlobal->gFixedSampleRate) : sigReal(gGlobal->gFixedSampleRate));
+        }
         return makeList(sigFConst(type, name, file)); 
     }
     
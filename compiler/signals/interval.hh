@@ -70,6 +70,12 @@ inline interval reunion(const interval& x, const interval& y)
 	}
 }
 
+// Values converted to int (rounded toward zero)
+inline interval truncate(const interval& x)
+{
+	return (x.valid) ? interval(trunc(x.lo), trunc(x.hi)) : interval();
+}
+
 inline interval operator+(const interval& x, const interval& y) 	
 { 
 	return (x.valid&y.valid) ? interval(x.lo+y.lo, x.hi+y.hi) : interval(); 
@@ -101,6 +101,7 @@ class Node : public virtual Garbageable
 	double 	getDouble() 	const 	{ return fData.f; }
 	Sym 	getSym() 		const 	{ return fData.s; }
 	void* 	getPointer() 	const 	{ return fData.p; }
+    int64_t getBits()       const   { return fData.v; }     ///< raw content, used for hashing
 
 	// conversions and promotion for numbers
 	operator int() 	 const 	    { return (fType == kIntNode) ? fData.i : (fType == kDoubleNode) ? int(fData.f) : 0 ; }
@@ -63,7 +63,9 @@ Tree Occurrences::specificKey(Tree root)
 	char 	keyname[256];
 	snprintf(keyname, 256, "OCCURRENCES COUNT IN %p : ", (void*)(CTree*)root);
 
-	return tree(unique(keyname));	
+	Tree key = tree(unique(keyname));
+	CTree::allocateSlot(key);
+	return key;
 }	
 
 /**
@@ -25,27 +25,81 @@
 #include "tree.hh"
 #include "garbageable.hh"
 
-template<class P> class property : public virtual Garbageable
+// Key of a property : values are kept in a dense slot of the trees when one is available
+// (allocated again after each CTree::init), otherwise in their property list.
+// Properties built with the same 'keyname' share their values, so they always use the property list.
+
+class propertyKey : public virtual Garbageable
 {
-    Tree	fKey;
+protected:
+
+    Tree            fKey;
+    int             fSlot;
+    unsigned int    fGeneration;
+    bool            fShared;
+
+    propertyKey() : fKey(tree(Node(unique("property_")))), fSlot(-1), fGeneration(0), fShared(false) {}
+
+    propertyKey(const char* keyname) : fKey(tree(Node(keyname))), fSlot(-1), fGeneration(0), fShared(true) {}
+
+    bool hasSlot()
+    {
+        if (!fShared && (fGeneration != CTree::slotGeneration())) {
+            fSlot = CTree::allocateSlot();
+            fGeneration = CTree::slotGeneration();
+        }
+        return fSlot >= 0;
+    }
+
+    Tree getTree(Tree t)
+    {
+        return (hasSlot()) ? (Tree)t->getSlot(fSlot) : t->getProperty(fKey);
+    }
+
+    void setTree(Tree t, Tree data)
+    {
+        if (hasSlot()) {
+            t->setSlot(fSlot, data);
+        } else {
+            t->setProperty(fKey, data);
+        }
+    }
+
+    void clearTree(Tree t)
+    {
+        if (hasSlot()) {
+            t->setSlot(fSlot, 0);
+        } else {
+            t->clearProperty(fKey);
+        }
+    }
+};
 
+template<class P> class property : public propertyKey
+{
+    // In a slot, the value is directly kept without being boxed in a tree
     P*	access(Tree t)
     {
+        if (hasSlot()) {
+            return (P*)t->getSlot(fSlot);
+        }
         Tree d = t->getProperty(fKey);
         return d ? (P*)(d->node().getPointer()) : 0;
     }
 
 public:
 
-    property () : fKey(tree(Node(unique("property_")))) {}
+    property () {}
 
-    property (const char* keyname) : fKey(tree(Node(keyname))) {}
+    property (const char* keyname) : propertyKey(keyname) {}
   
     void set(Tree t, const P& data)
     {
         P* p = access(t);
         if (p) {
             *p = data;
+        } else if (hasSlot()) {
+            t->setSlot(fSlot, (new GarbageablePtr<P>(data))->getPointer());
         } else {
             t->setProperty(fKey, tree(Node((new GarbageablePtr<P>(data))->getPointer())));
         }
@@ -64,30 +118,34 @@ public:
 
     void clear(Tree t)
     {
-        P* p = access(t);
-        if (p) { delete p; }
-        t->clearProperty(fKey);
+        if (hasSlot()) {
+            // The value is deleted with its GarbageablePtr
+            t->setSlot(fSlot, 0);
+        } else {
+            P* p = access(t);
+            if (p) { delete p; }
+            t->clearProperty(fKey);
+        }
     }
 };
 
-template<> class property<Tree> : public virtual Garbageable
+template<> class property<Tree> : public propertyKey
 {
-    Tree	fKey;
 
 public:
 
-    property () : fKey(tree(Node(unique("property_")))) {}
+    property () {}
 
-    property (const char* keyname) : fKey(tree(Node(keyname))) {}
+    property (const char* keyname) : propertyKey(keyname) {}
 
     void set(Tree t, Tree data)
     {
-        t->setProperty(fKey, data);
+        setTree(t, data);
     }
 
     bool get(Tree t, Tree& data)
     {
-        Tree d = t->getProperty(fKey);
+        Tree d = getTree(t);
         if (d) {
             data = d;
             return true;
@@ -98,28 +156,27 @@ public:
 
     void clear(Tree t)
     {
-        t->clearProperty(fKey);
+        clearTree(t);
     }
 };
 
-template<> class property<int> : public virtual Garbageable
+template<> class property<int> : public propertyKey
 {
-    Tree	fKey;
 
 public:
 
-    property () : fKey(tree(Node(unique("property_")))) {}
+    property () {}
 
-    property (const char* keyname) : fKey(tree(Node(keyname))) {}
+    property (const char* keyname) : propertyKey(keyname) {}
 
     void set(Tree t, int i)
     {
-        t->setProperty(fKey, tree(Node(i)));
+        setTree(t, tree(Node(i)));
     }
 
     bool get(Tree t, int& i)
     {
-        Tree d = t->getProperty(fKey);
+        Tree d = getTree(t);
         if (d) {
             i = d->node().getInt();
             return true;
@@ -130,28 +187,27 @@ public:
 
     void clear(Tree t)
     {
-        t->clearProperty(fKey);
+        clearTree(t);
     }
 };
 
-template<> class property<double> : public virtual Garbageable
+template<> class property<double> : public propertyKey
 {
-    Tree	fKey;
 
 public:
 
-    property () : fKey(tree(Node(unique("property_")))) {}
+    property () {}
 
-    property (const char* keyname) : fKey(tree(Node(keyname))) {}
+    property (const char* keyname) : propertyKey(keyname) {}
 
     void set(Tree t, double x)
     {
-        t->setProperty(fKey, tree(Node(x)));
+        setTree(t, tree(Node(x)));
     }
 
     bool get(Tree t, double& x)
     {
-        Tree d = t->getProperty(fKey);
+        Tree d = getTree(t);
         if (d) {
             x = d->node().getDouble();
             return true;
@@ -162,7 +218,7 @@ public:
 
     void clear(Tree t)
     {
-        t->clearProperty(fKey);
+        clearTree(t);
     }
 };
 
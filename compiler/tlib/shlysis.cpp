@@ -70,7 +70,9 @@ Tree shprkey(Tree t)
 {
 	char 	name[256];
 	snprintf(name, 256, "SHARED IN %p : ", (void*)(CTree*)t);
-	return tree(unique(name));
+	Tree key = tree(unique(name));
+	CTree::allocateSlot(key);
+	return key;
 }	
 
 
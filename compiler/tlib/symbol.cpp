@@ -35,9 +35,9 @@ using namespace std;
  * Hash table used to store the symbols
  */
  
-Symbol*	Symbol::gSymbolTable[kHashTableSize];
+thread_local Symbol*	Symbol::gSymbolTable[kHashTableSize];
 
-map<const char*, unsigned int> Symbol::gPrefixCounters;
+thread_local map<const char*, unsigned int> Symbol::gPrefixCounters;
 
 /**
  * Search the hash table for the symbol of name \p str or returns a new one.
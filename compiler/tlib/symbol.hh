@@ -56,8 +56,8 @@ class Symbol : public virtual Garbageable {
  private:
 		 
 	static const int 	kHashTableSize = 511;					///< Size of the hash table (a prime number is recommended)
-    static Symbol*		gSymbolTable[kHashTableSize];			///< Hash table used to store the symbols
-    static map<const char*, unsigned int> gPrefixCounters;
+    static thread_local Symbol*	gSymbolTable[kHashTableSize];			///< Hash table used to store the symbols
+    static thread_local map<const char*, unsigned int> gPrefixCounters;
 	
  // Fields
     string			fName;										///< Name of the symbol
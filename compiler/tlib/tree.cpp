@@ -79,6 +79,8 @@ storage of trees.
 #include <stdio.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
+#include <new>
 #include "tree.hh"
 #include <fstream>
 #include <cstdlib>
@@ -86,9 +88,20 @@ storage of trees.
 
 #define ERROR(s,t) { throw faustexception(s); }
 
-Tree CTree::gHashTable[kHashTableSize];
-bool CTree::gDetails = false;
-unsigned int CTree::gVisitTime = 0;
+thread_local CTree::HashEntry* CTree::gHashTable = 0;
+thread_local unsigned int CTree::gHashTableSize = 0;
+thread_local unsigned int CTree::gHashCount = 0;
+thread_local unsigned long CTree::gHashLookups = 0;
+thread_local unsigned long CTree::gHashCollisions = 0;
+thread_local unsigned int CTree::gHashResizes = 0;
+thread_local vector<Tree>* CTree::gMadeTrees = 0;
+thread_local vector<void**> CTree::gSlotTables[kSlots];
+thread_local Tree CTree::gSlotKeys[kSlots];
+thread_local int CTree::gSlotCount = 0;
+thread_local unsigned int CTree::gSlotGeneration = 0;
+thread_local unsigned int CTree::gSerialCounter = 0;
+thread_local bool CTree::gDetails = false;
+thread_local unsigned int CTree::gVisitTime = 0;
 
 // Constructor : add the tree to the hash table
 CTree::CTree (unsigned int hk, const Node& n, const tvec& br) 
@@ -97,32 +110,69 @@ CTree::CTree (unsigned int hk, const Node& n, const tvec& br)
 		fHashKey(hk), 
 	 	fAperture(calcTreeAperture(n,br)), 
         fVisitTime(0),
+        fSerial(gSerialCounter++),
+        fSlot(-1),
 		fBranch(br) 
 { 
-	// link dans la hash table
-   	int j = hk % kHashTableSize;
-	fNext = gHashTable[j];
-	gHashTable[j] = this;
+	insertHash(this);
 }
 
 // Destructor : remove the tree form the hash table
 CTree::~CTree () 
 {
-	int		i = fHashKey % kHashTableSize;
-	Tree	t = gHashTable[i];
+	unsigned int mask = gHashTableSize - 1;
+	unsigned int i = fHashKey & mask;
 	
-	//printf("Delete of "); this->print(); printf("\n");
-	if (t == this) {
-		gHashTable[i] = fNext;
-	} else {
-		Tree p = NULL;
-		while (t != this) {
-			p = t;
-			t = t->fNext;
+	while (gHashTable[i].fTree != this) {
+		faustassert(gHashTable[i].fTree);
+		i = (i + 1) & mask;
+	}
+	
+	// Backward shift of the following entries, so that no probe sequence is broken
+	unsigned int j = i;
+	while (true) {
+		j = (j + 1) & mask;
+		if (!gHashTable[j].fTree) break;
+		unsigned int k = gHashTable[j].fHashKey & mask;
+		if ((j > i) ? (k <= i || k > j) : (k <= i && k > j)) {
+			gHashTable[i] = gHashTable[j];
+			i = j;
 		}
-        faustassert(p);
-		p->fNext = fNext;
 	}
+	gHashTable[i].fTree = 0;
+	gHashCount--;
+}
+
+void CTree::insertHash(Tree t)
+{
+	if ((gHashCount + 1) * 4 > gHashTableSize * 3) {
+		resizeHash(gHashTableSize * 2);
+	}
+	unsigned int mask = gHashTableSize - 1;
+	unsigned int i = t->fHashKey & mask;
+	while (gHashTable[i].fTree) {
+		i = (i + 1) & mask;
+	}
+	gHashTable[i].fTree = t;
+	gHashTable[i].fHashKey = t->fHashKey;
+	gHashCount++;
+}
+
+void CTree::resizeHash(unsigned int size)
+{
+	HashEntry* old_table = gHashTable;
+	unsigned int old_size = gHashTableSize;
+	
+	gHashTable = (HashEntry*)calloc(size, sizeof(HashEntry));
+	if (!gHashTable) throw std::bad_alloc();
+	gHashTableSize = size;
+	gHashCount = 0;
+	gHashResizes++;
+	
+	for (unsigned int i = 0; i < old_size; i++) {
+		if (old_table[i].fTree) insertHash(old_table[i].fTree);
+	}
+	free(old_table);
 }
 
 // equivalence 
@@ -131,14 +181,25 @@ bool CTree::equiv (const Node& n, const tvec& br) const
 	return (fNode == n) && (fBranch == br);
 }
 
+// 64 bits finalizer of MurmurHash3
+static inline unsigned int mixHash(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return (unsigned int)x;
+}
+
 unsigned int CTree::calcTreeHash( const Node& n, const tvec& br )
 {
-	unsigned int 			hk = n.type() ^ n.getInt();
+	unsigned int 			hk = mixHash(uint64_t(n.getBits()) ^ (uint64_t(n.type()) << 61));
 	tvec::const_iterator  b = br.begin();
 	tvec::const_iterator  z = br.end();
 	
 	while (b != z) {
-    	hk = (hk << 1) ^ (hk >> 20) ^ ((*b)->fHashKey);
+    	hk = mixHash((uint64_t(hk) << 32) | (*b)->fHashKey);
 		++b;
 	}
 	return hk;
@@ -150,24 +211,27 @@ Tree CTree::make(const Node& n, int ar, Tree* tbl)
 	
 	for (int i=0; i<ar; i++)  br[i] = tbl[i];
 	
-	unsigned int 	hk  = calcTreeHash(n, br);
-	Tree	t = gHashTable[hk % kHashTableSize];
-	
-	while (t && !t->equiv(n, br)) {
-		t = t->fNext;
-	}
-	return (t) ? t : new CTree(hk, n, br);
+	return make(n, br);
 }
 
 Tree CTree::make(const Node& n, const tvec& br)
 {
 	unsigned int 	hk  = calcTreeHash(n, br);
-	Tree	t = gHashTable[hk % kHashTableSize];
+	unsigned int 	mask = gHashTableSize - 1;
+	unsigned int 	i = hk & mask;
 	
-	while (t && !t->equiv(n, br)) {
-		t = t->fNext;
+	gHashLookups++;
+	while (Tree t = gHashTable[i].fTree) {
+		if ((gHashTable[i].fHashKey == hk) && t->equiv(n, br)) {
+			if (gMadeTrees) gMadeTrees->push_back(t);
+			return t;
+		}
+		gHashCollisions++;
+		i = (i + 1) & mask;
 	}
-	return (t) ? t : new CTree(hk, n, br);
+	Tree t = new CTree(hk, n, br);
+	if (gMadeTrees) gMadeTrees->push_back(t);
+	return t;
 }
 
 ostream& CTree::print (ostream& fout) const
@@ -192,24 +256,47 @@ ostream& CTree::print (ostream& fout) const
 void CTree::control ()
 {
 	printf("\ngHashTable Content :\n\n");
-	for (int i = 0; i < kHashTableSize; i++) {
-		Tree t = gHashTable[i];
+	for (unsigned int i = 0; i < gHashTableSize; i++) {
+		Tree t = gHashTable[i].fTree;
 		if (t) {
-			printf ("%4d = ", i);
-			while (t) {
-				/*t->print();*/
-				printf(" => ");
-				t = t->fNext;
-			}
-			printf("VOID\n");
+			printf ("%4d = %08x (home %d)\n", i, gHashTable[i].fHashKey, gHashTable[i].fHashKey & (gHashTableSize - 1));
 		}
 	}
 	printf("\nEnd gHashTable\n");
 }
 
+void CTree::printStats (ostream& fout)
+{
+	fout << "tree hash table : " << gHashCount << " trees in " << gHashTableSize << " entries ("
+		 << (100.0 * gHashCount) / gHashTableSize << "% occupancy, " << gHashResizes << " resizes), "
+		 << gHashLookups << " lookups, " << gHashCollisions << " collisions ("
+		 << ((gHashLookups) ? double(gHashCollisions) / gHashLookups : 0.) << " per lookup), "
+		 << gSlotCount << "/" << kSlots << " property slots" << endl;
+}
+
 void CTree::init ()
 {
-    memset(gHashTable, 0, sizeof(Tree) * kHashTableSize);
+    // Trees of a previous compilation have been removed by their destructor
+    free(gHashTable);
+    gHashTable = (HashEntry*)calloc(kInitHashTableSize, sizeof(HashEntry));
+    if (!gHashTable) throw std::bad_alloc();
+    gHashTableSize = kInitHashTableSize;
+    gHashCount = 0;
+    gHashLookups = 0;
+    gHashCollisions = 0;
+    gHashResizes = 0;
+    
+    // Free all property slots
+    for (int slot = 0; slot < kSlots; slot++) {
+        for (size_t p = 0; p < gSlotTables[slot].size(); p++) {
+            free(gSlotTables[slot][p]);
+        }
+        vector<void**>().swap(gSlotTables[slot]);
+        gSlotKeys[slot] = 0;
+    }
+    gSlotCount = 0;
+    gSlotGeneration++;
+    gSerialCounter = 0;
 }
 
 // if t has a node of type int, return it otherwise error
@@ -375,8 +462,60 @@ void* getUserData(Tree t)
  * and one for the associated values
  */
 
+bool CTree::allocateSlot(Tree key)
+{
+    if (key->fSlot >= 0) {
+        return true;
+    } else if (gSlotCount < kSlots) {
+        gSlotKeys[gSlotCount] = key;
+        key->fSlot = gSlotCount++;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+int CTree::allocateSlot()
+{
+    if (gSlotCount < kSlots) {
+        gSlotKeys[gSlotCount] = 0;
+        return gSlotCount++;
+    } else {
+        return -1;
+    }
+}
+
+void CTree::setSlot(int slot, void* value)
+{
+    vector<void**>& pages = gSlotTables[slot];
+    unsigned int p = fSerial >> kSlotPageBits;
+    if (p >= pages.size()) {
+        pages.resize(p + 1, 0);
+    }
+    if (!pages[p]) {
+        pages[p] = (void**)calloc(1 << kSlotPageBits, sizeof(void*));
+        if (!pages[p]) throw std::bad_alloc();
+    }
+    pages[p][fSerial & ((1 << kSlotPageBits) - 1)] = value;
+}
+
+void CTree::clearProperties()
+{
+    for (int slot = 0; slot < gSlotCount; slot++) {
+        if (getSlot(slot)) setSlot(slot, 0);
+    }
+    fProperties = plist();
+}
+
 void CTree::exportProperties(vector<Tree>& keys, vector<Tree>& values)
 {
+    for (int slot = 0; slot < gSlotCount; slot++) {
+        Tree value = (Tree)getSlot(slot);
+        if (gSlotKeys[slot] && value) {
+            keys.push_back(gSlotKeys[slot]);
+            values.push_back(value);
+        }
+    }
     for (plist::const_iterator p = fProperties.begin(); p != fProperties.end(); p++) {
         keys.push_back(p->first);
         values.push_back(p->second);
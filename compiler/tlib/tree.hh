@@ -109,22 +109,44 @@ typedef vector<Tree>	tvec;
 class CTree : public virtual Garbageable
 {
  private:
-	static const int 	kHashTableSize = 2000000; //510511;	///< size of the hash table used for "hash consing"
-	static Tree			gHashTable[kHashTableSize];	///< hash table used for "hash consing"
+    // Open addressing (linear probing) table used for "hash consing", grown when 3/4 full
+    struct HashEntry {
+        Tree            fTree;
+        unsigned int    fHashKey;
+    };
+	static const unsigned int kInitHashTableSize = 4096;
+	static thread_local HashEntry*       gHashTable;
+	static thread_local unsigned int     gHashTableSize;     ///< always a power of 2
+	static thread_local unsigned int     gHashCount;
+	static thread_local unsigned long    gHashLookups;       ///< statistics
+	static thread_local unsigned long    gHashCollisions;
+	static thread_local unsigned int     gHashResizes;
+	static thread_local vector<Tree>*    gMadeTrees;         ///< when set, receives the trees returned by make()
+	
+    // Dense property slots for the most used keys : values indexed by tree serial number
+    // in side tables of 1024 entries pages, instead of the property list of each tree
+	static const int        kSlots = 32;
+	static const int        kSlotPageBits = 10;
+	static thread_local vector<void**>   gSlotTables[kSlots];
+	static thread_local Tree             gSlotKeys[kSlots];  ///< key of a slot of trees, 0 for the slots of pointers
+	static thread_local int              gSlotCount;
+	static thread_local unsigned int     gSlotGeneration;    ///< incremented by init(), all slots are then free
+	static thread_local unsigned int     gSerialCounter;
 
  public:
-	static bool			gDetails;					///< Ctree::print() print with more details when true
-    static unsigned int gVisitTime;                 ///< Should be incremented for each new visit to keep track of visited tree.
+	static thread_local bool			gDetails;					///< Ctree::print() print with more details when true
+    static thread_local unsigned int gVisitTime;                 ///< Should be incremented for each new visit to keep track of visited tree.
 
  private:
 	// fields
-    Tree            fNext;				///< next tree in the same hashtable entry
     Node            fNode;				///< the node content of the tree
     void*           fType;				///< the type of a tree
     plist           fProperties;		///< the properties list attached to the tree
     unsigned int	fHashKey;			///< the hashtable key
     int             fAperture;			///< how "open" is a tree (synthezised field)
     unsigned int	fVisitTime;			///< keep track of visits
+    unsigned int	fSerial;			///< index in the property slots
+    int             fSlot;              ///< property slot of a key tree, or -1
     tvec            fBranch;			///< the subtrees
 
 	CTree (unsigned int hk, const Node& n, const tvec& br); 						///< construction is private, uses tree::make instead
@@ -132,6 +154,8 @@ class CTree : public virtual Garbageable
 	bool 		equiv 				(const Node& n, const tvec& br) const;	///< used to check if an equivalent tree already exists
 	static unsigned int	calcTreeHash 		(const Node& n, const tvec& br);		///< compute the hash key of a tree according to its node and branches
 	static int	calcTreeAperture 	(const Node& n, const tvec& br);		///< compute how open is a tree
+	static void insertHash          (Tree t);                                ///< add a tree to the hash table
+	static void resizeHash          (unsigned int size);
 
  public:
 	virtual ~CTree ();
@@ -152,8 +176,10 @@ class CTree : public virtual Garbageable
 	// Print a tree and the hash table (for debugging purposes)
 	ostream& 	print (ostream& fout) const; 					///< print recursively the content of a tree on a stream
 	static void control ();										///< print the hash table content (for debug purpose)
+	static void printStats (ostream& fout);						///< print occupancy and collisions of the hash table
     
     static void init ();
+    static void recordMadeTrees(vector<Tree>* trees) { gMadeTrees = trees; }   ///< keep the trees returned by make() in 'trees' (0 to stop)
   
 	// type information
 	void		setType(void* t) 	{ fType = t; }
@@ -165,14 +191,41 @@ class CTree : public virtual Garbageable
     void            setVisited()                    { /*faustassert(fVisitTime!=gVisitTime);*/ fVisitTime=gVisitTime; }
 
 
+    // Property slots, allocated until the next init(). The property list is used when all are taken
+    static bool         allocateSlot(Tree key);     ///< keep the values of 'key' in a slot (to call before any use of the key)
+    static int          allocateSlot();             ///< slot for arbitrary pointers, -1 if none is left
+    static unsigned int slotGeneration()            { return gSlotGeneration; }
+
+    void*       getSlot(int slot) const {
+        const vector<void**>& pages = gSlotTables[slot];
+        unsigned int p = fSerial >> kSlotPageBits;
+        return (p < pages.size() && pages[p]) ? pages[p][fSerial & ((1 << kSlotPageBits) - 1)] : 0;
+    }
+    void        setSlot(int slot, void* value);
+
 	// Property list of a tree
-	void		setProperty(Tree key, Tree value) { fProperties[key] = value; }
-	void		clearProperty(Tree key) { fProperties.erase(key); }
-	void		clearProperties()		{ fProperties = plist(); }
+	void		setProperty(Tree key, Tree value) {
+		if (key->fSlot >= 0) {
+			setSlot(key->fSlot, value);
+		} else {
+			fProperties[key] = value;
+		}
+	}
+	void		clearProperty(Tree key) {
+		if (key->fSlot >= 0) {
+			setSlot(key->fSlot, 0);
+		} else {
+			fProperties.erase(key);
+		}
+	}
+	void		clearProperties();
 
 	void		exportProperties(vector<Tree>& keys, vector<Tree>& values);
 
 	Tree		getProperty(Tree key) {
+		if (key->fSlot >= 0) {
+			return (Tree)getSlot(key->fSlot);
+		}
 		plist::iterator i = fProperties.find(key);
 		if (i==fProperties.end()) {
 			return 0;
@@ -0,0 +1,11 @@
+// Strength reductions of math primitives : integer powers, fmod and integer remainder by powers of two.
+// The reduced code must give the same impulse response as the generic one (with and without -ar)
+
+declare name "reduction";
+
+t = (+(1) ~ _) - 1;
+x = _ + float(t % 1000) * 0.001;
+q = abs(sin(float(t) * 0.01)) * 8.0;
+
+process = _ <: x^2.0, x^3.0, (1.0 + q)^(-1.0), (1.0 + q)^(-2.0), q^0.5,
+               fmod(q, 4.0), fmod(q, 0.5), fmod(x * 8.0 - 4.0, 4.0), int(q) % 8, int(q * 3.0) % 4, t % 8;
@@ -6,6 +6,7 @@
 #include <errno.h>
 #include <time.h>
 #include <ctype.h>
+#include <unistd.h>
 #include <string>
 #include <map>
 #include <iostream>
@@ -22,6 +23,7 @@
 #include "faust/misc.h"
 #include "faust/gui/console.h"
 #include "faust/dsp/llvm-dsp.h"
+#include "faust/dsp/tiered-dsp.h"
 #include "faust/gui/FUI.h"
 #include "faust/gui/DecoratorUI.h"
 #include "faust/audio/channels.h"
@@ -184,7 +186,16 @@ static void testPolyphony(dsp_factory* factory, bool is_mem_alloc = false)
     delete DSP;
 }
 
-static void runFactory(dsp_factory* factory, const string& file, bool is_mem_alloc = false, bool inpl = false)
+// Wait for the LLVM code of a tiered factory, running instances switch to it at their next 'compute'
+static void waitNative(tiered_dsp_factory* factory)
+{
+    while (!factory->isNative() && factory->getNativeError() == "") {
+        usleep(1000);
+    }
+}
+
+// With 'tiered', the instance switches from the interpreter to the LLVM code in the middle of the impulse response
+static void runFactory(dsp_factory* factory, const string& file, bool is_mem_alloc = false, bool inpl = false, tiered_dsp_factory* tiered = nullptr)
 {
     char rcfilename[256];
     dsp* DSP = nullptr;
@@ -248,7 +259,9 @@ static void runFactory(dsp_factory* factory, const string& file, bool is_mem_all
     int nbsamples = 60000;
     int linenum = 0;
     int run = 0;
-    
+    int switch_run = (nbsamples / kFrames) / 2;
+
+
     // recall saved state
     finterface.recallState(rcfilename);
     
@@ -269,6 +282,9 @@ static void runFactory(dsp_factory* factory, const string& file, bool is_mem_all
                 ichan->zero();
                 finterface.setButtons(false);
             }
+            if (tiered && run == switch_run) {
+                waitNative(tiered);
+            }
             int nFrames = min(kFrames, nbsamples);
             DSP->compute(nFrames, ichan->buffers(), ochan->buffers());
             run++;
@@ -285,7 +301,11 @@ static void runFactory(dsp_factory* factory, const string& file, bool is_mem_all
     } catch (...) {
         cerr << "ERROR in " << file << " line : " << i << std::endl;
     }
-    
+
+    if (tiered && !static_cast<tiered_dsp*>(DSP)->isNative()) {
+        cerr << "ERROR in tiered factory : " << tiered->getNativeError() << std::endl;
+    }
+
     delete DSP;
 }
 
@@ -301,7 +321,19 @@ int main(int argc, char* argv[])
     llvm_dsp_factory* factory = NULL;
     
     bool inpl = isopt(argv, "-inpl");
-    
+
+    {
+        // Test createTieredDSPFactoryFromFile (first, so that the LLVM factory is not already compiled)
+        string error_msg;
+        tiered_dsp_factory* tiered_factory = createTieredDSPFactoryFromFile(argv[1], argc1, argv1, "", error_msg, 3);
+        if (!tiered_factory) {
+            cerr << "createTieredDSPFactoryFromFile " << error_msg << endl;
+            exit(-1);
+        }
+        runFactory(tiered_factory, argv[1], false, false, tiered_factory);
+        deleteTieredDSPFactory(tiered_factory);
+    }
+
     {
         // Test factory generated from compilation
         string error_msg;
@@ -395,6 +427,52 @@ int main(int argc, char* argv[])
         runFactory(factory, argv[1]);
         runFactory(factory, argv[1], true);
     }
-    
+
+    {
+        // Test writeDSPFactoryToMachineBundle/readDSPFactoryFromMachine (the factory has to be compiled from the DSP)
+        string error_msg;
+        factory = createDSPFactoryFromFile(argv[1], argc1, argv1, "", error_msg, 3);
+        string host_target = getDSPMachineTarget();
+        string generic_target = host_target.substr(0, host_target.find(':')) + ":generic";
+        vector<string> targets;
+        targets.push_back(generic_target);
+        targets.push_back(host_target);
+        factory_str = writeDSPFactoryToMachineBundle(factory, targets);
+
+        // Variant chosen for the host CPU
+        factory = readDSPFactoryFromMachine(factory_str, "");
+        if (!factory) {
+            cerr << " ERROR in readDSPFactoryFromMachine with a bundle " << endl;
+            exit(-1);
+        }
+        runFactory(factory, argv[1]);
+
+        // Given variant
+        factory = readDSPFactoryFromMachine(factory_str, generic_target);
+        if (!factory) {
+            cerr << " ERROR in readDSPFactoryFromMachine with a bundle and " << generic_target << endl;
+            exit(-1);
+        }
+        runFactory(factory, argv[1]);
+    }
+
+    {
+        // Test createInstrumentedDSPFactoryFromFile/createProfiledDSPFactory
+        string error_msg;
+        llvm_dsp_factory* instrumented_factory = createInstrumentedDSPFactoryFromFile(argv[1], argc1, argv1, "", error_msg, 3);
+        if (!instrumented_factory) {
+            cerr << "createInstrumentedDSPFactoryFromFile " << error_msg << endl;
+            exit(-1);
+        }
+        runFactory(instrumented_factory, argv[1]);
+
+        factory = createProfiledDSPFactory(instrumented_factory, error_msg);
+        if (!factory) {
+            cerr << "createProfiledDSPFactory " << error_msg << endl;
+            exit(-1);
+        }
+        runFactory(factory, argv[1]);
+    }
+
     return 0;
 }
@@ -127,6 +127,16 @@ if [ $BACKEND = "cpp" ] || [ $BACKEND = "all" ]; then
         filesCompare $D/$f.scal.ir ../expected-responses/$f.scal.ir && echo "OK $f scalar -fm mode" || echo "ERROR $f scalar -fm mode"
     done
 
+    for f in *.dsp; do
+        faust2impulse -double -ar $f > $D/$f.scal.ir
+        filesCompare $D/$f.scal.ir ../expected-responses/$f.scal.ir && echo "OK $f scalar -ar mode" || echo "ERROR $f scalar -ar mode"
+    done
+
+    for f in *.dsp; do
+        faust2impulse -double -vn $f > $D/$f.scal.ir
+        filesCompare $D/$f.scal.ir ../expected-responses/$f.scal.ir && echo "OK $f scalar -vn mode" || echo "ERROR $f scalar -vn mode"
+    done
+
     for f in *.dsp; do
         faust2impulse1 -double $f > $D/$f.scal.ir
         filesCompare $D/$f.scal.ir ../expected-responses/$f.scal.ir && echo "OK $f scalar -mem mode" || echo "ERROR $f scalar -mem mode"
@@ -283,6 +293,11 @@ if [ $BACKEND = "interp" ] || [ $BACKEND = "all" ]; then
         filesCompare $D/$f.scal.ir ../expected-responses/$f.scal.ir && echo "OK $f scalar mode" || echo "ERROR $f scalar mode"
     done
 
+    for f in *.dsp; do
+        faust2impulse3 -double -vn $f > $D/$f.scal.ir
+        filesCompare $D/$f.scal.ir ../expected-responses/$f.scal.ir && echo "OK $f scalar -vn mode" || echo "ERROR $f scalar -vn mode"
+    done
+
     for f in *.dsp; do
         faust2impulse3bis -inpl -double $f > $D/$f.scal.ir
         filesCompare $D/$f.scal.ir ../expected-responses/$f.scal.ir && echo "OK $f -inpl scalar mode" || echo "ERROR $f -inpl scalar mode"
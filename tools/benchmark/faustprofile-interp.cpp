@@ -0,0 +1,130 @@
+/************************************************************************
+    FAUST Architecture File
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This Architecture section is free software; you can redistribute it
+    and/or modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 3 of
+    the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; If not, see <http://www.gnu.org/licenses/>.
+
+    EXCEPTION : As a special exception, you may create a larger work
+    that contains this FAUST architecture section and distribute
+    that work under terms of your choice, so long as this FAUST
+    architecture section is not modified.
+
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "faust/misc.h"
+#include "faust/dsp/interpreter-dsp.h"
+
+using namespace std;
+
+/*
+ Runs a set of DSP with the interpreter in trace mode 4 : the opcode sequences executed by all DSP are cumulated,
+ so that the last statistics that are printed (when the last DSP is deleted) show the hottest sequences of the whole set,
+ the candidates for new fused instructions in FIRInstructionOptimizer.
+ With '-sample', the interpreter runs in trace mode 5 and the sampling profile of each DSP is printed instead.
+*/
+
+int main(int argc, char* argv[])
+{
+    if (isopt(argv, "-h") || isopt(argv, "-help") || argc < 2) {
+        cout << "faustprofile-interp [-run <buffers>] [-sample] [additional Faust options (-vec -vs 8...)] foo1.dsp foo2.dsp..." << endl;
+        return 0;
+    }
+
+    int run = lopt(argv, "-run", 100);
+    bool sample = isopt(argv, "-sample");
+    int buffer_size = 512;
+
+    setenv("FAUST_INTERP_TRACE", "on", 1);
+    setenv("FAUST_INTERP_TRACE_MODE", (sample) ? "5" : "4", 1);
+
+    int argc1 = 0;
+    const char* argv1[64];
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "-run") {
+            i++;
+        } else if (string(argv[i]) == "-sample") {
+            continue;
+        } else if (strstr(argv[i], ".dsp")) {
+            files.push_back(argv[i]);
+        } else {
+            argv1[argc1++] = argv[i];
+        }
+    }
+
+    // Add library
+    argv1[argc1++] = "-I";
+    argv1[argc1++] = "/usr/local/share/faust";
+    argv1[argc1] = 0;  // NULL terminated argv
+
+    for (size_t f = 0; f < files.size(); f++) {
+
+        string error_msg;
+        interpreter_dsp_factory* factory = createInterpreterDSPFactoryFromFile(files[f], argc1, argv1, error_msg);
+        if (!factory) {
+            cerr << "Cannot create factory for '" << files[f] << "' : " << error_msg << endl;
+            continue;
+        }
+
+        dsp* DSP = factory->createDSPInstance();
+        if (!DSP) {
+            cerr << "Cannot create instance for '" << files[f] << "'" << endl;
+            deleteInterpreterDSPFactory(factory);
+            continue;
+        }
+
+        cout << "Profiling '" << files[f] << "'" << endl;
+        DSP->init(44100);
+
+        int inputs = DSP->getNumInputs();
+        int outputs = DSP->getNumOutputs();
+        FAUSTFLOAT** inputs_buffer = new FAUSTFLOAT*[inputs];
+        FAUSTFLOAT** outputs_buffer = new FAUSTFLOAT*[outputs];
+        for (int i = 0; i < inputs; i++) {
+            inputs_buffer[i] = new FAUSTFLOAT[buffer_size];
+            for (int j = 0; j < buffer_size; j++) {
+                inputs_buffer[i][j] = FAUSTFLOAT(rand()) / FAUSTFLOAT(RAND_MAX) - FAUSTFLOAT(0.5);
+            }
+        }
+        for (int i = 0; i < outputs; i++) {
+            outputs_buffer[i] = new FAUSTFLOAT[buffer_size];
+        }
+
+        for (int i = 0; i < run; i++) {
+            DSP->compute(buffer_size, inputs_buffer, outputs_buffer);
+        }
+
+        // Statistics are printed here
+        delete DSP;
+        deleteInterpreterDSPFactory(factory);
+
+        for (int i = 0; i < inputs; i++) {
+            delete [] inputs_buffer[i];
+        }
+        for (int i = 0; i < outputs; i++) {
+            delete [] outputs_buffer[i];
+        }
+        delete [] inputs_buffer;
+        delete [] outputs_buffer;
+    }
+
+  	return 0;
+}